@@ -17,9 +17,12 @@
     samples: [],
     events: [],
     sessions: [],
+    sessionSeq: 0,
     maxSamples: 800,
+    maxSessions: 200,
     newWarningCount: 0,
-    newErrorCount: 0
+    newErrorCount: 0,
+    liveLastMs: 0
   };
 
   let buzzerEnabled = true;
@@ -36,7 +39,9 @@
     6: "RTC non calibre",
     7: "Auth echec",
     8: "Non autorise",
-    9: "Client deconnecte"
+    9: "Client deconnecte",
+    10: "Surchauffe prevue",
+    11: "Marche planifiee ignoree"
   };
 
   const errText = {
@@ -259,8 +264,12 @@
   // Snapshot live
   // ==============================
   async function pollStatus() {
-    const data = await fetchJson("/api/status");
+    if (liveActive()) return;
+    applyStatus(await fetchJson("/api/status"));
+  }
 
+  // Snapshot (/api/status ou push "status").
+  function applyStatus(data) {
     setText("stateChip", formatState(data.state));
     setText("relayChip", `R: ${data.relay_on ? "marche" : "arret"}`);
     setText("faultChip", `F: ${data.fault_latched ? "verrouille" : "ok"}`);
@@ -290,6 +299,23 @@
     updateGauges(data);
   }
 
+  // Resultat de commande (reponse /api/control) : etat resultant deja connu,
+  // pas besoin de relire /api/status.
+  function applyCommandResult(res) {
+    if (!res || res.status !== "done") return false;
+    setText("stateChip", formatState(res.state));
+    setText("relayChip", `R: ${res.relay_on ? "marche" : "arret"}`);
+    setText("faultChip", `F: ${res.fault_latched ? "verrouille" : "ok"}`);
+
+    const relayIndicator = $("relayIndicator");
+    if (relayIndicator) relayIndicator.classList.toggle("on", !!res.relay_on);
+    const relayStateText = $("relayStateText");
+    if (relayStateText) relayStateText.textContent = res.relay_on ? "ON" : "OFF";
+
+    setStateDot(res.state, res.fault_latched);
+    return true;
+  }
+
   function updateNotifBadges() {
     const wChip = $("warningChip");
     const eChip = $("errorChip");
@@ -321,10 +347,83 @@
   // ==============================
   // Historique mesures
   // ==============================
-  async function pollHistory() {
+  async function pollHistory(force = false) {
+    if (!force && liveActive()) return;
     const url = `/api/history?since=${state.historySeq}&max=200`;
-    const data = await fetchJson(url);
-    const samples = data.samples || [];
+    applyHistory(await fetchHistory(url));
+  }
+
+  // /api/history en binaire (format : src/reseau/HistoryBinary.hpp) ;
+  // JSON si le serveur ne le propose pas.
+  async function fetchHistory(url) {
+    const res = await fetch(url, {
+      headers: { Accept: "application/octet-stream, application/json" },
+      cache: "no-store"
+    });
+    if (!res.ok) {
+      const text = await res.text();
+      throw new Error(`${res.status} ${text}`);
+    }
+    const type = res.headers.get("Content-Type") || "";
+    if (!type.startsWith("application/octet-stream")) return res.json();
+    return decodeHistory(await res.arrayBuffer());
+  }
+
+  const HISTORY_COLUMNS = ["ts_ms", "current_a", "motor_c", "bme_c", "bme_pa"];
+
+  function decodeHistory(buf) {
+    const view = new DataView(buf);
+    if (buf.byteLength < 16 || view.getUint8(0) !== 0x48 || view.getUint8(1) !== 0x42 || view.getUint8(2) !== 1) {
+      throw new Error("history_format");
+    }
+    const n = view.getUint16(4, true);
+    const ncols = view.getUint8(6);
+    const samples = [];
+    for (let i = 0; i < n; i++) samples.push({});
+
+    let off = 16 + ncols * 8;
+    for (let c = 0; c < ncols; c++) {
+      const d = 16 + c * 8;
+      const width = view.getUint8(d);
+      const div = Math.pow(10, -view.getInt8(d + 1));
+      const name = HISTORY_COLUMNS[c];
+      if (!width) {
+        // Colonne entierement absente (NAN).
+        if (name) samples.forEach((s) => (s[name] = null));
+        continue;
+      }
+      const Arr = width === 1 ? Int8Array : width === 2 ? Int16Array : Int32Array;
+      const deltas = new Arr(buf, off, n);
+      const nan = c === 0 ? null : -(2 ** (8 * width - 1));
+      let v = view.getInt32(d + 4, true);
+      for (let i = 0; i < n; i++) {
+        if (deltas[i] === nan) {
+          if (name) samples[i][name] = null;
+          continue;
+        }
+        v = (v + deltas[i]) | 0;
+        // ts_ms : entier non signe (millis qui reboucle).
+        if (name) samples[i][name] = c === 0 ? v >>> 0 : v / div;
+      }
+      off += (n * width + 3) & ~3;
+    }
+
+    return {
+      ch: view.getUint8(3),
+      seq_start: view.getUint32(8, true),
+      seq_end: view.getUint32(12, true),
+      samples
+    };
+  }
+
+  // Echantillons (/api/history ou push "history", qui porte seq_start).
+  function applyHistory(data) {
+    let samples = data.samples || [];
+    if (data.seq_start !== undefined) {
+      // Deja recus par HTTP : ignores.
+      const skip = state.historySeq - Number(data.seq_start);
+      if (skip > 0) samples = samples.slice(skip);
+    }
     state.historySeq = data.seq_end || state.historySeq;
 
     if (samples.length) {
@@ -340,11 +439,16 @@
   // ==============================
   // Evenements warnings / errors
   // ==============================
-  async function pollEvents() {
+  async function pollEvents(force = false) {
+    if (!force && liveActive()) return;
     const url = `/api/events?since=${state.eventSeq}&max=100`;
-    const data = await fetchJson(url);
-    const events = data.events || [];
-    state.eventSeq = data.seq_end || state.eventSeq;
+    applyEvents(await fetchJson(url));
+  }
+
+  // Evenements (/api/events ou push "events").
+  function applyEvents(data) {
+    const events = (data.events || []).filter((e) => Number(e.seq) > state.eventSeq);
+    state.eventSeq = Math.max(state.eventSeq, Number(data.seq_end) || 0);
 
     if (events.length) {
       const eventsTab = $("eventsTab");
@@ -391,7 +495,10 @@
       const label = e.level === 2
         ? `E${String(e.code || 0).padStart(2, "0")}`
         : `W${String(e.code || 0).padStart(2, "0")}`;
-      const msg = (e.level === 2 ? errText[e.code] : warnText[e.code]) || e.message || "";
+      const base = (e.level === 2 ? errText[e.code] : warnText[e.code]) || e.message || "";
+      // Entree resumee (alerte repetee) : nombre d'occurrences.
+      const count = Number(e.count) || 1;
+      const msg = count > 1 ? `${base} (x${count})` : base;
       const when = formatEventTime(e.ts_ms);
       const item = document.createElement("div");
       item.className = `event-item ${level}`;
@@ -424,6 +531,54 @@
     return `+${formatClock(ms)}`;
   }
 
+  // ==============================
+  // Push SSE (/api/live), polling en secours
+  // ==============================
+  let live = null;
+
+  // Flux ouvert et vivant (un "status" par snapshot) : pollers en pause.
+  function liveActive() {
+    return !!live && live.readyState === 1 && Date.now() - state.liveLastMs < 5000;
+  }
+
+  function onLive(fn) {
+    return (ev) => {
+      state.liveLastMs = Date.now();
+      let data;
+      try {
+        data = JSON.parse(ev.data);
+      } catch (_) {
+        return;
+      }
+      fn(data);
+    };
+  }
+
+  function startLive() {
+    // Sans EventSource (ou flux refuse / coupe) : le polling continue.
+    // Le navigateur se reconnecte seul apres une coupure.
+    if (!window.EventSource) return;
+    live = new EventSource("/api/live");
+    live.addEventListener("status", onLive(applyStatus));
+    live.addEventListener("history", onLive((data) => {
+      // Trou (envoi saute pour client lent, onglet en veille) : relecture HTTP.
+      if (Number(data.seq_start) > state.historySeq) {
+        pollHistory(true).catch(() => {});
+        return;
+      }
+      applyHistory(data);
+    }));
+    live.addEventListener("events", onLive((data) => {
+      const first = (data.events || [])[0];
+      if (first && Number(first.seq) > state.eventSeq + 1) {
+        pollEvents(true).catch(() => {});
+        return;
+      }
+      applyEvents(data);
+    }));
+    live.addEventListener("sessions", onLive(() => loadSessions().catch(() => {})));
+  }
+
   // ==============================
   // Sessions
   // ==============================
@@ -439,9 +594,25 @@
     return `${yyyy}-${mm}-${dd} ${hh}:${min}`;
   }
 
-  async function loadSessions() {
-    const data = await fetchJson("/api/sessions");
-    state.sessions = data.sessions || [];
+  async function loadSessions(full = false) {
+    // Incremental : seules les sessions apres sessionSeq sont transferees.
+    const incremental = !full && state.sessionSeq > 0;
+    const url = incremental ? `/api/sessions?since=${state.sessionSeq}` : "/api/sessions";
+    const data = await fetchJson(url);
+    const fresh = data.sessions || [];
+    const seqEnd = Number(data.seq_end) || 0;
+
+    // Historique efface / renumerote : rechargement complet.
+    if (incremental && seqEnd < state.sessionSeq) return loadSessions(true);
+    if (incremental && !fresh.length) return;
+
+    // Plus de nouvelles sessions qu'une page : on garde la page recue.
+    if (incremental && data.next_before === undefined) {
+      state.sessions = fresh.concat(state.sessions).slice(0, state.maxSessions);
+    } else {
+      state.sessions = fresh;
+    }
+    state.sessionSeq = seqEnd;
 
     const body = $("sessionTableBody");
     if (!body) return;
@@ -454,7 +625,8 @@
       return;
     }
 
-    state.sessions.slice().reverse().forEach((s) => {
+    // Plus recente en premier (ordre de /api/sessions).
+    state.sessions.forEach((s) => {
       const row = document.createElement("tr");
       row.innerHTML = `
         <td>${formatEpochSec(s.start_epoch)}</td>
@@ -797,13 +969,14 @@
 
     const map = {
       ovc_mode: data.ovc_mode === 1 ? "auto" : "latch",
-      wifi_mode: data.wifi_mode === 1 ? "ap" : "sta"
+      wifi_mode: data.wifi_mode === 1 ? "ap" : "sta",
+      trend_action: data.trend_action === 1 ? "stop" : "warn"
     };
 
     Object.keys(data).forEach((k) => {
       const field = form.elements.namedItem(k);
       if (!field) return;
-      if (k === "ovc_mode" || k === "wifi_mode") return;
+      if (k === "ovc_mode" || k === "wifi_mode" || k === "trend_action") return;
       field.value = data[k];
     });
 
@@ -811,6 +984,8 @@
     if (ovcEl) ovcEl.value = map.ovc_mode;
     const wifiEl = form.elements.namedItem("wifi_mode");
     if (wifiEl) wifiEl.value = map.wifi_mode;
+    const trendEl = form.elements.namedItem("trend_action");
+    if (trendEl) trendEl.value = map.trend_action;
 
     const latch = form.elements.namedItem("latch_overtemp");
     if (latch) latch.value = data.latch_overtemp ? "true" : "false";
@@ -845,8 +1020,13 @@
       "temp_ambient_c",
       "temp_hyst_c",
       "latch_overtemp",
+      "trend_window",
+      "trend_horizon_s",
+      "trend_action",
       "motor_vcc_v",
       "sampling_hz",
+      "archive_minute_days",
+      "archive_hour_days",
       "buzzer_enabled",
       "wifi_mode",
       "sta_ssid",
@@ -867,7 +1047,7 @@
         return;
       }
 
-      if (name === "ovc_mode" || name === "wifi_mode") {
+      if (name === "ovc_mode" || name === "wifi_mode" || name === "trend_action") {
         payload[name] = String(raw).toLowerCase();
         return;
       }
@@ -911,8 +1091,8 @@
     const label = actionLabel[action] || action;
     try {
       if (status) status.textContent = `Envoi: ${label}...`;
-      await fetchJson("/api/control", { method: "POST", auth: true, body: { action } });
-      await pollStatus().catch(() => {});
+      const res = await fetchJson("/api/control", { method: "POST", auth: true, body: { action } });
+      if (!applyCommandResult(res)) await pollStatus().catch(() => {});
       await pollEvents().catch(() => {});
       if (status) status.textContent = `OK: ${label}`;
     } catch (err) {
@@ -926,8 +1106,8 @@
     const status = $("controlStatus");
     try {
       if (status) status.textContent = "Envoi: minuterie...";
-      await fetchJson("/api/run_timer", { method: "POST", auth: true, body: { seconds } });
-      await pollStatus().catch(() => {});
+      const res = await fetchJson("/api/run_timer", { method: "POST", auth: true, body: { seconds } });
+      if (!applyCommandResult(res)) await pollStatus().catch(() => {});
       await pollEvents().catch(() => {});
       if (status) status.textContent = "Minuterie OK";
     } catch (err) {
@@ -1059,7 +1239,7 @@
 
     $("rtcSyncBtn")?.addEventListener("click", syncRtcFromClient);
 
-    $("sessionReloadBtn")?.addEventListener("click", () => loadSessions().catch(() => {}));
+    $("sessionReloadBtn")?.addEventListener("click", () => loadSessions(true).catch(() => {}));
   }
 
   // ==============================
@@ -1080,10 +1260,13 @@
       pollEvents().catch(() => {})
     ]);
 
+    startLive();
     setInterval(() => pollStatus().catch(() => {}), 1000);
     setInterval(() => pollHistory().catch(() => {}), 1500);
     setInterval(() => pollEvents().catch(() => {}), 2000);
-    setInterval(() => loadSessions().catch(() => {}), 15000);
+    setInterval(() => {
+      if (!liveActive()) loadSessions().catch(() => {});
+    }, 15000);
   }
 
   window.addEventListener("load", () => {
@@ -82,6 +82,8 @@
     latch_overtemp: true,
     motor_vcc_v: 12.0,
     sampling_hz: 50,
+    archive_minute_days: 7,
+    archive_hour_days: 365,
     buzzer_enabled: true,
     wifi_mode: 0, // 0=sta, 1=ap
     sta_ssid: "demo",
@@ -173,6 +175,7 @@
   let eventSeq = 0;
 
   const sessions = [];
+  let sessionSeq = 0;
 
   function pushEvent(level, code, message, source) {
     eventSeq += 1;
@@ -207,7 +210,9 @@
     if (!device.session_active) return;
     const end_epoch = nowRtcEpochSec();
     const duration_s = Math.max(0, Math.floor((Date.now() - device.session_start_ms) / 1000));
+    sessionSeq += 1;
     sessions.push({
+      seq: sessionSeq,
       start_epoch: device.session_start_epoch,
       end_epoch,
       duration_s,
@@ -263,6 +268,7 @@
     const now = nowRtcEpochSec();
     sessions.push(
       {
+        seq: ++sessionSeq,
         start_epoch: now - 3600,
         end_epoch: now - 3300,
         duration_s: 300,
@@ -272,6 +278,7 @@
         success: true
       },
       {
+        seq: ++sessionSeq,
         start_epoch: now - 2400,
         end_epoch: now - 2310,
         duration_s: 90,
@@ -554,6 +561,8 @@
     if (body.latch_overtemp !== undefined) config.latch_overtemp = !!body.latch_overtemp;
     if (body.motor_vcc_v !== undefined) config.motor_vcc_v = Number(body.motor_vcc_v);
     if (body.sampling_hz !== undefined) config.sampling_hz = Number(body.sampling_hz);
+    if (body.archive_minute_days !== undefined) config.archive_minute_days = Number(body.archive_minute_days);
+    if (body.archive_hour_days !== undefined) config.archive_hour_days = Number(body.archive_hour_days);
     if (body.buzzer_enabled !== undefined) config.buzzer_enabled = !!body.buzzer_enabled;
     if (body.sta_ssid !== undefined) config.sta_ssid = String(body.sta_ssid);
     if (body.sta_pass !== undefined) config.sta_pass = String(body.sta_pass);
@@ -688,6 +697,8 @@
         latch_overtemp: config.latch_overtemp,
         motor_vcc_v: config.motor_vcc_v,
         sampling_hz: config.sampling_hz,
+        archive_minute_days: config.archive_minute_days,
+        archive_hour_days: config.archive_hour_days,
         buzzer_enabled: config.buzzer_enabled,
         current_zero_mv: calibration.zero_mv,
         current_sens_mv_a: calibration.sens_mv_a,
@@ -741,7 +752,14 @@
     }
 
     if (parsed.pathname === "/api/sessions" && method === "GET") {
-      return jsonResponse({ sessions });
+      const since = Number(parsed.searchParams.get("since") || 0);
+      const list = sessions.filter((s) => s.seq > since).reverse();
+      return jsonResponse({
+        total: sessions.length,
+        seq_first: sessions.length ? sessions[0].seq : 0,
+        seq_end: sessions.length ? sessions[sessions.length - 1].seq : 0,
+        sessions: list
+      });
     }
 
     return jsonResponse({ error: "not_found" }, 404);
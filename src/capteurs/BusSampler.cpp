@@ -6,12 +6,14 @@ BusSampler* BusSampler::Get() {
     return &inst;
 }
 
-void BusSampler::begin(Acs712Sensor* current,
+void BusSampler::begin(Acs712Sensor* const* currents,
                        Ds18b20Sensor* ds18,
                        Bme280Sensor* bme,
                        uint32_t samplingHz) {
     // Injection dependances capteurs
-    current_ = current;
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        current_[ch] = currents ? currents[ch] : nullptr;
+    }
     ds18_ = ds18;
     bme_ = bme;
 
@@ -40,19 +42,16 @@ void BusSampler::stop() {
 }
 
 bool BusSampler::sampleNow() {
-    if (!current_) return false;
+    if (!current_[0]) return false;
 
     Sample s{};
     s.ts_ms = millis();
 
-    // Courant (lecture fraiche)
-    s.current_a = current_->readCurrent();
-
-    // DS18B20 et BME280 utilisent le cache interne
-    if (ds18_) {
-        s.motor_c = ds18_->getTempC();
-    } else {
-        s.motor_c = NAN;
+    // Une passe sur tous les canaux : courant (lecture fraiche, ~2 ms par
+    // canal) + temperature moteur (cache DS18, pas d'acces bus ici).
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        s.current_a[ch] = current_[ch] ? current_[ch]->readCurrent() : NAN;
+        s.motor_c[ch] = ds18_ ? ds18_->getTempC(ch, nullptr) : NAN;
     }
 
     if (bme_) {
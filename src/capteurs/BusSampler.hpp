@@ -9,6 +9,8 @@
  *  - On stocke donc des echantillons (Sample) avec un timestamp commun.
  *
  *  Points importants :
+ *  - Un echantillon porte tous les canaux (courant + sonde moteur par
+ *    canal), lus dans la meme passe : un seul timestamp par echantillon.
  *  - Historique fixe (BUS_SAMPLER_HISTORY_SIZE = 800) en RAM.
  *  - getHistorySince() renvoie une fenetre a partir d'un numero de sequence.
  *  - Thread-safe via mutex (semaphore) car acces depuis tache sampler + HTTP.
@@ -27,11 +29,11 @@ public:
         // Timestamp commun (millis()) pour aligner toutes les mesures.
         uint32_t ts_ms;
 
-        // Courant instantane (A) (lecture "fraiche" du capteur).
-        float current_a;
+        // Courant instantane (A) par canal (lecture "fraiche" du capteur).
+        float current_a[DEVICE_CHANNELS];
 
-        // Temperature moteur (DS18) (valeur cache si lecture fail).
-        float motor_c;
+        // Temperature moteur (DS18) par canal (valeur cache si lecture fail).
+        float motor_c[DEVICE_CHANNELS];
 
         // Temperature carte (BME) (valeur cache si lecture fail).
         float bme_c;
@@ -42,8 +44,9 @@ public:
 
     static BusSampler* Get();
 
-    // Injecte les capteurs et fixe la frequence d'echantillonnage (Hz).
-    void begin(Acs712Sensor* current,
+    // Injecte les capteurs (currents : tableau de DEVICE_CHANNELS capteurs,
+    // index = canal, nullptr autorise) et fixe la frequence (Hz).
+    void begin(Acs712Sensor* const* currents,
                Ds18b20Sensor* ds18,
                Bme280Sensor* bme,
                uint32_t samplingHz = DEFAULT_SAMPLING_HZ);
@@ -74,7 +77,7 @@ private:
     bool lock_() const;
     void unlock_() const;
 
-    Acs712Sensor* current_ = nullptr;
+    Acs712Sensor* current_[DEVICE_CHANNELS] = {nullptr};
     Ds18b20Sensor* ds18_ = nullptr;
     Bme280Sensor* bme_ = nullptr;
 
@@ -1,21 +1,24 @@
 #include <CurrentSensor.hpp>
 
-Acs712Sensor::Acs712Sensor() = default;
+Acs712Sensor::Acs712Sensor(int pin, uint8_t channel)
+    : pin_(pin),
+      channel_(channel) {
+}
 
 void Acs712Sensor::begin() {
-    // Pin ADC en entree (ADC1/ADC2 selon mapping ESP32-S3)
-    pinMode(PIN_CURRENT_ADC, INPUT);
+    // Pin ADC en entree (ADC1 uniquement si le Wi-Fi est actif)
+    pinMode(pin_, INPUT);
     if (!mutex_) {
         // Mutex protege: calibration + cache courant
         mutex_ = xSemaphoreCreateMutex();
     }
 
-    // Charger calibration depuis NVS
-    zeroMv_ = CONF->GetFloat(KEY_CUR_ZERO, DEFAULT_CURRENT_ZERO_MV);
-    sensMvPerA_ = CONF->GetFloat(KEY_CUR_SENS, DEFAULT_CURRENT_SENS_MV_A);
-    inputScale_ = CONF->GetFloat(KEY_CUR_SCALE, DEFAULT_CURRENT_INPUT_SCALE);
-    adcRefV_ = CONF->GetFloat(KEY_ADC_REF, DEFAULT_ADC_REF_V);
-    adcMax_ = CONF->GetInt(KEY_ADC_MAX, DEFAULT_ADC_MAX);
+    // Charger calibration depuis NVS (schema : valeurs du canal, bornees)
+    zeroMv_ = CONF->GetCfg<CfgId::CurZero>(channel_);
+    sensMvPerA_ = CONF->GetCfg<CfgId::CurSens>(channel_);
+    inputScale_ = CONF->GetCfg<CfgId::CurScale>(channel_);
+    adcRefV_ = CONF->GetCfg<CfgId::AdcRef>();
+    adcMax_ = CONF->GetCfg<CfgId::AdcMax>();
 
     // Securites simples
     if (inputScale_ <= 0.0f) inputScale_ = 1.0f;
@@ -63,20 +66,21 @@ void Acs712Sensor::calibrateZero(uint16_t samples) {
     }
 
     // Persist
-    CONF->PutFloat(KEY_CUR_ZERO, mv);
+    CONF->PutCfg<CfgId::CurZero>(mv, channel_);
 }
 
 void Acs712Sensor::setCalibration(float zeroMv, float sensMvPerA, float inputScale) {
+    // Valeur hors bornes du schema : ignoree (comme avant pour <= 0).
     if (lock_()) {
-        if (zeroMv > 0.0f) zeroMv_ = zeroMv;
-        if (sensMvPerA > 0.0f) sensMvPerA_ = sensMvPerA;
-        if (inputScale > 0.0f) inputScale_ = inputScale;
+        if (zeroMv > 0.0f && cfgInRange(CfgId::CurZero, CfgConv<float>::make(zeroMv))) zeroMv_ = zeroMv;
+        if (cfgInRange(CfgId::CurSens, CfgConv<float>::make(sensMvPerA))) sensMvPerA_ = sensMvPerA;
+        if (cfgInRange(CfgId::CurScale, CfgConv<float>::make(inputScale))) inputScale_ = inputScale;
         unlock_();
     }
 
-    CONF->PutFloat(KEY_CUR_ZERO, zeroMv_);
-    CONF->PutFloat(KEY_CUR_SENS, sensMvPerA_);
-    CONF->PutFloat(KEY_CUR_SCALE, inputScale_);
+    CONF->PutCfg<CfgId::CurZero>(zeroMv_, channel_);
+    CONF->PutCfg<CfgId::CurSens>(sensMvPerA_, channel_);
+    CONF->PutCfg<CfgId::CurScale>(inputScale_, channel_);
 }
 
 float Acs712Sensor::getLastCurrent(bool* valid) const {
@@ -115,7 +119,7 @@ int Acs712Sensor::readAdcAverage_(uint8_t samples) const {
     if (samples == 0) samples = 1;
     uint32_t sum = 0;
     for (uint8_t i = 0; i < samples; ++i) {
-        sum += static_cast<uint32_t>(analogRead(PIN_CURRENT_ADC));
+        sum += static_cast<uint32_t>(analogRead(pin_));
         // Petit delai pour decorreler les conversions
         delayMicroseconds(100);
     }
@@ -3,6 +3,8 @@
  *  - Calibration zero / sensibilite
  *  - Cache de la derniere valeur valide
  *  - Detection saturation ADC
+ *  - Une instance par canal : pin ADC et calibration (cles NVS
+ *    suffixees, voir NVS::ChannelKey) propres au canal
  **************************************************************/
 #ifndef CURRENT_SENSOR_H
 #define CURRENT_SENSOR_H
@@ -12,7 +14,8 @@
 
 class Acs712Sensor {
 public:
-    Acs712Sensor();
+    // Par defaut : canal 0 sur PIN_CURRENT_ADC (cles NVS historiques).
+    explicit Acs712Sensor(int pin = PIN_CURRENT_ADC, uint8_t channel = 0);
 
     // begin():
     // - configure le pin ADC
@@ -45,6 +48,8 @@ public:
     // true si l'ADC n'est pas sature (valeur pas collee a 0 ou max)
     bool  isAdcOk() const;
 
+    uint8_t channel() const { return channel_; }
+
 private:
     float adcToMillivolts_(int adc) const;
     int   readAdcAverage_(uint8_t samples) const;
@@ -54,6 +59,9 @@ private:
 
     mutable SemaphoreHandle_t mutex_ = nullptr;
 
+    int pin_ = PIN_CURRENT_ADC;
+    uint8_t channel_ = 0;
+
     float zeroMv_ = DEFAULT_CURRENT_ZERO_MV;
     float sensMvPerA_ = DEFAULT_CURRENT_SENS_MV_A;
     float inputScale_ = DEFAULT_CURRENT_INPUT_SCALE;
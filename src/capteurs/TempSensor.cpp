@@ -14,20 +14,23 @@ namespace {
     static constexpr uint32_t kConvertDelayMs = 750; // 12-bit
 }
 
-Ds18b20Sensor::Ds18b20Sensor(OneWire* bus)
-    : oneWire_(bus) {}
+Ds18b20Sensor::Ds18b20Sensor(OneWire* bus, uint8_t probes)
+    : oneWire_(bus),
+      probes_(probes == 0 ? 1 : (probes > DEVICE_CHANNELS ? DEVICE_CHANNELS : probes)) {
+    for (uint8_t p = 0; p < DEVICE_CHANNELS; ++p) lastTempC_[p] = NAN;
+}
 
 void Ds18b20Sensor::begin(uint32_t periodMs) {
     if (!oneWire_) return;
     if (!mutex_) {
-        // Mutex protege: present_ + lastTempC_ + lastValid_ + adresse
+        // Mutex protege: present_ + lastTempC_ + lastValid_ + adresses
         mutex_ = xSemaphoreCreateMutex();
     }
 
     periodMs_ = (periodMs == 0) ? 1000 : periodMs;
 
     // Premiere detection
-    discoverSensor_();
+    discoverSensors_();
 
     if (!task_) {
         // Tache de lecture periodique (non-bloquante pour le reste du systeme)
@@ -41,39 +44,61 @@ void Ds18b20Sensor::begin(uint32_t periodMs) {
 void Ds18b20Sensor::update() {
     if (!oneWire_) return;
 
-    float tempC = NAN;
-    bool ok = readTempOnce_(tempC);
+    // Une seule conversion pour toutes les sondes : la periode ne depend
+    // pas du nombre de canaux (750 ms puis ~10 ms de lecture par sonde).
+    const bool converted = startConversion_();
+    if (converted) vTaskDelay(pdMS_TO_TICKS(kConvertDelayMs));
 
-    if (lock_()) {
-        if (ok) {
-            lastTempC_ = tempC;
-            lastValid_ = true;
-            badReadStreak_ = 0;
-            present_ = true;
-        } else {
-            // On conserve la derniere valeur valide
-            lastValid_ = false;
-            if (badReadStreak_ < 255) badReadStreak_++;
-            if (badReadStreak_ >= kBadReadThreshold) {
-                present_ = false;
-                hasAddress_ = false;
+    bool allOk = true;
+    for (uint8_t p = 0; p < probes_; ++p) {
+        uint8_t addr[8] = {0};
+        bool haveAddr = false;
+        if (lock_()) {
+            haveAddr = hasAddress_[p];
+            if (haveAddr) memcpy(addr, address_[p], sizeof(addr));
+            unlock_();
+        }
+
+        float tempC = NAN;
+        const bool ok = converted && haveAddr && readScratch_(addr, tempC);
+
+        if (lock_()) {
+            if (ok) {
+                lastTempC_[p] = tempC;
+                lastValid_[p] = true;
+                badReadStreak_[p] = 0;
+                present_[p] = true;
+            } else {
+                // On conserve la derniere valeur valide
+                lastValid_[p] = false;
+                if (badReadStreak_[p] < 255) badReadStreak_[p]++;
+                if (badReadStreak_[p] >= kBadReadThreshold) present_[p] = false;
             }
+            unlock_();
         }
-        unlock_();
+        if (!ok) allOk = false;
     }
 
-    if (!ok) {
+    if (!allOk) {
         // Tentative de recuperation plus tard (re-scan OneWire)
         tryReconnect_();
     }
 }
 
 float Ds18b20Sensor::getTempC(bool* valid) const {
-    float t = lastTempC_;
-    bool v = lastValid_;
+    return getTempC(0, valid);
+}
+
+float Ds18b20Sensor::getTempC(uint8_t probe, bool* valid) const {
+    if (probe >= probes_) {
+        if (valid) *valid = false;
+        return NAN;
+    }
+    float t = lastTempC_[probe];
+    bool v = lastValid_[probe];
     if (lock_()) {
-        t = lastTempC_;
-        v = lastValid_;
+        t = lastTempC_[probe];
+        v = lastValid_[probe];
         unlock_();
     }
     if (valid) *valid = v;
@@ -81,64 +106,85 @@ float Ds18b20Sensor::getTempC(bool* valid) const {
 }
 
 bool Ds18b20Sensor::isPresent() const {
-    bool p = present_;
+    return isPresent(0);
+}
+
+bool Ds18b20Sensor::isPresent(uint8_t probe) const {
+    if (probe >= probes_) return false;
+    bool p = present_[probe];
     if (lock_()) {
-        p = present_;
+        p = present_[probe];
         unlock_();
     }
     return p;
 }
 
-bool Ds18b20Sensor::discoverSensor_() {
+bool Ds18b20Sensor::discoverSensors_() {
     if (!oneWire_) return false;
 
+    // ROMs DS18* presentes sur le bus (ordre de recherche).
+    uint8_t found[DEVICE_CHANNELS][8];
+    uint8_t nFound = 0;
     uint8_t addr[8] = {0};
-    bool found = false;
 
     oneWire_->reset_search();
-    while (oneWire_->search(addr)) {
+    while (nFound < DEVICE_CHANNELS && oneWire_->search(addr)) {
         // Verifie CRC et famille DS18*
         if (OneWire::crc8(addr, 7) != addr[7]) continue;
         uint8_t family = addr[0];
         if (family != 0x28 && family != 0x22 && family != 0x10) continue;
+        memcpy(found[nFound++], addr, sizeof(addr));
+    }
 
-        if (lock_()) {
-            memcpy(address_, addr, sizeof(address_));
-            hasAddress_ = true;
-            present_ = true;
-            unlock_();
+    if (!lock_()) return false;
+    bool used[DEVICE_CHANNELS] = {false};
+    bool any = false;
+
+    // 1) Slots deja attribues : conserves tant que la sonde repond ou
+    //    reste sur le bus (une sonde perdue ne decale pas les autres canaux).
+    for (uint8_t p = 0; p < probes_; ++p) {
+        if (!hasAddress_[p]) continue;
+        bool seen = false;
+        for (uint8_t f = 0; f < nFound; ++f) {
+            if (memcmp(address_[p], found[f], 8) == 0) {
+                used[f] = true;
+                seen = true;
+            }
         }
-        found = true;
-        break;
+        if (!seen && !present_[p]) hasAddress_[p] = false;
     }
 
-    if (!found && lock_()) {
-        hasAddress_ = false;
-        present_ = false;
-        unlock_();
+    // 2) Slots libres : ROMs non attribuees (sonde ajoutee ou remplacee).
+    uint8_t f = 0;
+    for (uint8_t p = 0; p < probes_; ++p) {
+        if (!hasAddress_[p]) {
+            while (f < nFound && used[f]) f++;
+            if (f < nFound) {
+                memcpy(address_[p], found[f], 8);
+                used[f] = true;
+                hasAddress_[p] = true;
+                present_[p] = true;
+                badReadStreak_[p] = 0;
+            } else {
+                present_[p] = false;
+            }
+        }
+        if (hasAddress_[p]) any = true;
     }
+    unlock_();
 
-    return found;
+    return any;
 }
 
-bool Ds18b20Sensor::readTempOnce_(float& outTempC) {
-    if (!oneWire_) return false;
-
-    uint8_t addr[8] = {0};
-    bool haveAddr = false;
-    if (lock_()) {
-        haveAddr = hasAddress_;
-        if (haveAddr) memcpy(addr, address_, sizeof(address_));
-        unlock_();
-    }
-    if (!haveAddr) return false;
-
-    // Conversion temperature (blocant, mais uniquement dans la tache capteur).
+bool Ds18b20Sensor::startConversion_() {
+    // Skip ROM : toutes les sondes du bus convertissent en meme temps.
     if (!oneWire_->reset()) return false;
-    oneWire_->select(addr);
+    oneWire_->skip();
     oneWire_->write(kCmdConvertT, 0);
-    vTaskDelay(pdMS_TO_TICKS(kConvertDelayMs));
+    return true;
+}
 
+bool Ds18b20Sensor::readScratch_(const uint8_t* addr, float& outTempC) {
     // Lecture scratchpad (9 octets)
     if (!oneWire_->reset()) return false;
     oneWire_->select(addr);
@@ -163,7 +209,7 @@ void Ds18b20Sensor::tryReconnect_() {
     lastReconnectMs_ = now;
 
     // Re-scan du bus OneWire
-    discoverSensor_();
+    discoverSensors_();
 }
 
 bool Ds18b20Sensor::isTempValid_(float tempC) const {
@@ -1,8 +1,14 @@
 /**************************************************************
- *  Capteur DS18B20 (OneWire) - capteur unique
+ *  Capteur DS18B20 (OneWire) - une sonde moteur par canal
+ *  - Plusieurs sondes sur le meme bus : une conversion commune
+ *    (Skip ROM + Convert T) puis lecture de chaque scratchpad
  *  - Lecture periodique avec cache de la derniere valeur valide
  *  - Reconnexion automatique si capteur debranche
  *  - Implementation OneWire "directe" (sans DallasTemperature)
+ *
+ *  Affectation sonde -> canal :
+ *  - Ordre de recherche ROM au premier scan, puis conservee : une sonde
+ *    perdue garde son slot, une sonde neuve prend un slot libre.
  **************************************************************/
 #ifndef TEMP_SENSOR_H
 #define TEMP_SENSOR_H
@@ -13,7 +19,8 @@
 
 class Ds18b20Sensor {
 public:
-    explicit Ds18b20Sensor(OneWire* bus);
+    // probes : nombre de sondes attendues (borne a DEVICE_CHANNELS).
+    explicit Ds18b20Sensor(OneWire* bus, uint8_t probes = 1);
 
     // Demarrage de la lecture periodique
     // periodMs: periode de lecture en millisecondes.
@@ -24,21 +31,26 @@ public:
     // NOTE: update() met a jour le cache si la lecture est valide.
     void update();
 
-    // Derniere valeur connue
+    // Derniere valeur connue (sonde 0 ou sonde donnee)
     // valid = true si la derniere lecture etait valide.
     // Si la lecture echoue, on conserve lastTempC_ mais valid=false.
     float getTempC(bool* valid = nullptr) const;
+    float getTempC(uint8_t probe, bool* valid) const;
 
-    // true si au moins un capteur est detecte sur le bus.
+    // true si la sonde (0 par defaut) est detectee sur le bus.
     bool isPresent() const;
+    bool isPresent(uint8_t probe) const;
+
+    uint8_t probeCount() const { return probes_; }
 
 private:
     static void taskThunk_(void* param);
     void taskLoop_();
 
     // Bus OneWire (DS18B20) : scan + lecture scratchpad
-    bool discoverSensor_();
-    bool readTempOnce_(float& outTempC);
+    bool discoverSensors_();
+    bool startConversion_();
+    bool readScratch_(const uint8_t* addr, float& outTempC);
     void tryReconnect_();
 
     bool isTempValid_(float tempC) const;
@@ -47,20 +59,22 @@ private:
     void unlock_() const;
 
     OneWire* oneWire_ = nullptr;
+    uint8_t probes_ = 1;
 
     mutable SemaphoreHandle_t mutex_ = nullptr;
     TaskHandle_t task_ = nullptr;
     uint32_t periodMs_ = 1000;
 
-    bool present_ = false;
-    bool hasAddress_ = false;
-    uint8_t address_[8] = {0};
-    uint8_t badReadStreak_ = 0;
+    // Etat par sonde (index = canal)
+    bool present_[DEVICE_CHANNELS] = {false};
+    bool hasAddress_[DEVICE_CHANNELS] = {false};
+    uint8_t address_[DEVICE_CHANNELS][8] = {{0}};
+    uint8_t badReadStreak_[DEVICE_CHANNELS] = {0};
 
     // Derniere valeur valide (ou derniere valeur connue)
-    float lastTempC_ = NAN;
+    float lastTempC_[DEVICE_CHANNELS];
     // Indique si lastTempC_ provient d'une lecture valide recente
-    bool lastValid_ = false;
+    bool lastValid_[DEVICE_CHANNELS] = {false};
     uint32_t lastReconnectMs_ = 0;
 
     static constexpr uint32_t kReconnectIntervalMs = 5000;
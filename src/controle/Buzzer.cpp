@@ -26,7 +26,7 @@ void Buzzer::begin() {
     digitalWrite(PIN_BUZZER, LOW);
 
     // Lecture de l'activation depuis NVS
-    enabled_ = CONF->GetBool(KEY_BUZZ_EN, DEFAULT_BUZZER_ENABLED);
+    enabled_ = CONF->GetCfg<CfgId::BuzzerEnabled>();
 
     ledcSetup(kBuzzerPwmChannel, kBuzzerPwmBaseFreq, kBuzzerPwmResolution);
     ledcAttachPin(PIN_BUZZER, kBuzzerPwmChannel);
@@ -43,7 +43,7 @@ void Buzzer::begin() {
 
 void Buzzer::setEnabled(bool on) {
     enabled_ = on;
-    CONF->PutBool(KEY_BUZZ_EN, on);
+    CONF->PutCfg<CfgId::BuzzerEnabled>(on);
     if (!on) {
         ledcWriteTone(kBuzzerPwmChannel, 0);
         digitalWrite(PIN_BUZZER, LOW);
@@ -42,8 +42,8 @@ void SwitchManager::taskLoop_() {
             // Relache
             const uint32_t heldMs = now - pressStartMs_;
             if (heldMs < BUTTON_LONG_RESET_MS) {
-                // Appui court : toggle marche/arret.
-                if (DEVTRAN) DEVTRAN->toggle();
+                // Appui court : toggle marche/arret (canal 0).
+                if (DEVTRAN) DEVTRAN->toggle(0);
             }
         }
 
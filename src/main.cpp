@@ -1,13 +1,16 @@
 #include <Arduino.h>
-#include <SPIFFS.h>
 #include <OneWire.h>
 
 #include <Config.hpp>
 #include <Utils.hpp>
 #include <NVSManager.hpp>
+#include <StorageManager.hpp>
 #include <RTCManager.hpp>
 #include <SessionHistory.hpp>
 #include <EventLog.hpp>
+#include <PersistWorker.hpp>
+#include <SessionProfile.hpp>
+#include <TimeArchive.hpp>
 
 #include <Relay.hpp>
 #include <StatusLeds.hpp>
@@ -22,6 +25,7 @@
 #include <DeviceTransport.hpp>
 #include <SwitchManager.hpp>
 #include <WiFiManager.hpp>
+#include <RunScheduler.hpp>
 
 // -----------------------------------------------------------------------------
 // main.cpp
@@ -39,9 +43,18 @@
 // -----------------------------------------------------------------------------
 // OneWire bus (for digital temperature sensors like DS18B20)
 OneWire oneWire(PIN_DS18B20);
-Relay* gRelay = nullptr;
+
+// Pins par canal (voir Config.hpp) : une entree par canal au minimum.
+static const int kRelayPins[] = PIN_RELAY_CHANNELS;
+static const int kCurrentPins[] = PIN_CURRENT_ADC_CHANNELS;
+static_assert(sizeof(kRelayPins) / sizeof(kRelayPins[0]) >= DEVICE_CHANNELS,
+              "PIN_RELAY_CHANNELS : une pin par canal requise");
+static_assert(sizeof(kCurrentPins) / sizeof(kCurrentPins[0]) >= DEVICE_CHANNELS,
+              "PIN_CURRENT_ADC_CHANNELS : une pin par canal requise");
+
+Relay* gRelays[DEVICE_CHANNELS] = {nullptr};
  StatusLeds* gLeds = nullptr;
- Acs712Sensor* gCurrent = nullptr;
+ Acs712Sensor* gCurrents[DEVICE_CHANNELS] = {nullptr};
  Ds18b20Sensor* gDs18 = nullptr;
  Bme280Sensor* gBme = nullptr;
  SessionHistory* gSessions = nullptr;
@@ -61,8 +74,8 @@ void WiFiEvent(WiFiEvent_t event) {
         if (gEvents) {
             gEvents->append(EventLevel::Warning,
                             static_cast<uint16_t>(WarnCode::W09_ClientGone),
-                            "Client disconnect",
-                            "wifi");
+                            EvtMsg::ClientGone,
+                            EvtSrc::Wifi);
         }
     }
 }
@@ -81,16 +94,16 @@ void setup() {
     delay(2000);
 
     // --------------------------------------------------
-    // 1) SPIFFS
+    // 1) Stockage fichiers (SPIFFS ou LittleFS, voir STORAGE_BACKEND)
     // --------------------------------------------------
-    DEBUG_PRINTLN("[BOOT] Initializing SPIFFS...");
-    if (!SPIFFS.begin(true)) {
-        DEBUG_PRINTLN("[FATAL] SPIFFS init FAILED");
+    DEBUG_PRINTLN("[BOOT] Initializing Storage...");
+    if (!STORAGE->begin()) {
+        DEBUG_PRINTLN("[FATAL] Storage init FAILED");
         while (true) {
             delay(500);
         }
     }
-    DEBUG_PRINTLN("[BOOT] SPIFFS OK");
+    DEBUG_PRINTLN("[BOOT] Storage OK");
 
     Debug::enableMemoryLog(1024 * 1024);
     DEBUG_PRINTLN("[BOOT] Debug memory log enabled");
@@ -123,10 +136,12 @@ void setup() {
     BUZZ->playStartupSequence();
     DEBUG_PRINTLN("[BOOT] Buzzer OK");
 
-    DEBUG_PRINTLN("[BOOT] Initializing Relay...");
-    gRelay = new Relay();
-    gRelay->begin();
-    DEBUG_PRINTLN("[BOOT] Relay OK");
+    DEBUG_PRINTLN("[BOOT] Initializing Relays...");
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        gRelays[ch] = new Relay(kRelayPins[ch]);
+        gRelays[ch]->begin();
+    }
+    DEBUG_PRINTLN("[BOOT] Relays OK");
 
     DEBUG_PRINTLN("[BOOT] Initializing Status LEDs...");
     gLeds = new StatusLeds();
@@ -134,10 +149,12 @@ void setup() {
     gLeds->bootAnimation();
     DEBUG_PRINTLN("[BOOT] LEDs OK");
 
-    DEBUG_PRINTLN("[BOOT] Initializing Current Sensor...");
-    gCurrent = new Acs712Sensor();
-    gCurrent->begin();
-    DEBUG_PRINTLN("[BOOT] Current Sensor OK");
+    DEBUG_PRINTLN("[BOOT] Initializing Current Sensors...");
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        gCurrents[ch] = new Acs712Sensor(kCurrentPins[ch], ch);
+        gCurrents[ch]->begin();
+    }
+    DEBUG_PRINTLN("[BOOT] Current Sensors OK");
     // --------------------------------------------------
     // 8) Switch manager
     // --------------------------------------------------
@@ -147,7 +164,7 @@ void setup() {
     DEBUG_PRINTLN("[BOOT] SwitchManager OK");
 
     DEBUG_PRINTLN("[BOOT] Initializing DS18B20...");
-    gDs18 = new Ds18b20Sensor(&oneWire);
+    gDs18 = new Ds18b20Sensor(&oneWire, DEVICE_CHANNELS);
     gDs18->begin();
     DEBUG_PRINTLN("[BOOT] DS18B20 OK");
 
@@ -159,13 +176,13 @@ void setup() {
     // --------------------------------------------------
     // 5) BusSampler
     // --------------------------------------------------
-    uint32_t samplingHz = CONF->GetUInt(KEY_SAMPLING_HZ, DEFAULT_SAMPLING_HZ);
+    uint32_t samplingHz = CONF->GetCfg<CfgId::SamplingHz>();
     DEBUG_PRINT("[BOOT] Initializing BusSampler @ ");
     DEBUG_PRINT(samplingHz);
     DEBUG_PRINTLN(" Hz");
 
     (void)BUS_SAMPLER;
-    BUS_SAMPLER->begin(gCurrent, gDs18, gBme, samplingHz);
+    BUS_SAMPLER->begin(gCurrents, gDs18, gBme, samplingHz);
     DEBUG_PRINTLN("[BOOT] BusSampler started");
 
     // --------------------------------------------------
@@ -176,19 +193,34 @@ void setup() {
     gSessions->begin();
     DEBUG_PRINTLN("[BOOT] SessionHistory OK");
 
+    DEBUG_PRINTLN("[BOOT] Initializing SessionProfile...");
+    PROFILES->begin();
+    DEBUG_PRINTLN("[BOOT] SessionProfile OK");
+
+    DEBUG_PRINTLN("[BOOT] Initializing TimeArchive...");
+    ARCHIVE->begin();
+    DEBUG_PRINTLN("[BOOT] TimeArchive OK");
+
     DEBUG_PRINTLN("[BOOT] Initializing EventLog...");
     gEvents = new EventLog();
     gEvents->begin();
+    // Warnings d'usure NVS (W12) journalises a partir d'ici.
+    CONF->setEventLog(gEvents);
     DEBUG_PRINTLN("[BOOT] EventLog OK");
 
+    // Ecritures flash (sessions, journal, NVS) deleguees a partir d'ici.
+    DEBUG_PRINTLN("[BOOT] Initializing Persist...");
+    PERSIST->begin();
+    DEBUG_PRINTLN("[BOOT] Persist OK");
+
     // --------------------------------------------------
     // 7) Device core + transport
     // --------------------------------------------------
     DEBUG_PRINTLN("[BOOT] Initializing Device core...");
     Device::Init(
-        gRelay,
+        gRelays,
         gLeds,
-        gCurrent,
+        gCurrents,
         gDs18,
         gBme,
         RTC,
@@ -202,6 +234,10 @@ void setup() {
     (void)DEVTRAN;
     DEBUG_PRINTLN("[BOOT] DeviceTransport OK");
 
+    DEBUG_PRINTLN("[BOOT] Initializing RunScheduler...");
+    RunScheduler::Init(RTC, gEvents);
+    SCHED->begin();
+    DEBUG_PRINTLN("[BOOT] RunScheduler OK");
 
 
     // --------------------------------------------------
@@ -0,0 +1,125 @@
+#include <CsvStream.hpp>
+#include <WiFiEndpoints.hpp>
+
+CsvStream::CsvStream(const char* const* names, uint8_t count)
+    : names_(names), colCount_(count > CSV_MAX_COLUMNS ? CSV_MAX_COLUMNS : count) {
+    for (uint8_t i = 0; i < colCount_; ++i) cols_[i] = i;
+    nCols_ = colCount_;
+}
+
+void CsvStream::send(AsyncWebServerRequest* request, CsvStream* stream, const char* filename) {
+    JsonStream::send(request, stream, CT_TEXT_CSV, filename);
+}
+
+bool CsvStream::selectColumns(AsyncWebServerRequest* request) {
+    if (!request->hasParam("cols")) return true;
+    const char* p = request->getParam("cols")->value().c_str();
+    uint8_t n = 0;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        const size_t len = end ? static_cast<size_t>(end - p) : strlen(p);
+        if (len) {
+            uint8_t i = 0;
+            while (i < colCount_ && (strncmp(names_[i], p, len) != 0 || names_[i][len] != 0)) i++;
+            if (i == colCount_ || n == CSV_MAX_COLUMNS) {
+                request->send(400, CT_APP_JSON, "{\"error\":\"bad_column\"}");
+                return false;
+            }
+            cols_[n++] = i;
+        }
+        if (!end) break;
+        p = end + 1;
+    }
+    if (n == 0) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_column\"}");
+        return false;
+    }
+    nCols_ = n;
+    return true;
+}
+
+void CsvStream::header(Print& out) {
+    for (uint8_t i = 0; i < nCols_; ++i) row_.text(names_[cols_[i]]);
+    row_.end(out);
+}
+
+// -----------------------------------------------------------------------------
+// Row
+// -----------------------------------------------------------------------------
+void CsvStream::Row::put_(char c) {
+    // Place gardee pour "\r\n" ; au-dela, le champ est tronque.
+    if (len_ + 2 < sizeof(buf_)) buf_[len_++] = c;
+}
+
+void CsvStream::Row::sep_() {
+    if (!first_) put_(',');
+    first_ = false;
+}
+
+void CsvStream::Row::digits_(uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) put_(tmp[--n]);
+}
+
+void CsvStream::Row::u32(uint32_t v) {
+    sep_();
+    digits_(v);
+}
+
+void CsvStream::Row::i32(int32_t v) {
+    sep_();
+    if (v < 0) {
+        put_('-');
+        digits_(static_cast<uint64_t>(-static_cast<int64_t>(v)));
+    } else {
+        digits_(static_cast<uint64_t>(v));
+    }
+}
+
+void CsvStream::Row::fixed(float v, uint8_t decimals) {
+    static const uint32_t kPow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    sep_();
+    if (isnan(v) || isinf(v)) return;
+    if (decimals > 6) decimals = 6;
+
+    double x = v;
+    const bool neg = x < 0;
+    if (neg) x = -x;
+    // Hors plage des mesures : borne (pas de debordement de l'entier).
+    if (x > 1e12) x = 1e12;
+    const uint64_t scaled = static_cast<uint64_t>(x * kPow10[decimals] + 0.5);
+    if (neg && scaled) put_('-');
+    digits_(scaled / kPow10[decimals]);
+    if (decimals == 0) return;
+    put_('.');
+    uint32_t frac = static_cast<uint32_t>(scaled % kPow10[decimals]);
+    for (int8_t d = static_cast<int8_t>(decimals) - 1; d >= 0; --d) {
+        put_(static_cast<char>('0' + (frac / kPow10[d]) % 10));
+    }
+}
+
+void CsvStream::Row::text(const char* s) {
+    sep_();
+    if (!s) return;
+    // Guillemets seulement si le champ contient un separateur.
+    const bool quote = strpbrk(s, ",\"\r\n") != nullptr;
+    if (quote) put_('"');
+    for (; *s; ++s) {
+        if (*s == '"') put_('"');
+        put_(*s);
+    }
+    if (quote) put_('"');
+}
+
+void CsvStream::Row::end(Print& out) {
+    buf_[len_++] = '\r';
+    buf_[len_++] = '\n';
+    out.write(reinterpret_cast<const uint8_t*>(buf_), len_);
+    len_ = 0;
+    first_ = true;
+}
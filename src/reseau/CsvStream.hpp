@@ -0,0 +1,74 @@
+/**************************************************************
+ *  CsvStream - export CSV ecrit au fil de l'envoi
+ *
+ *  But :
+ *  - Exporter historique, sessions et journal (/api/export/*) sans
+ *    copier-coller depuis l'UI : une ligne par element, lue par lots dans
+ *    la source (ring buffer / fichier) quand AsyncTCP demande des octets.
+ *  - Memoire constante : meme mecanique que JsonStream (reponse chunked,
+ *    un morceau a la fois) ; des dizaines de milliers de lignes sans
+ *    croissance du tas.
+ *
+ *  Formatage :
+ *  - Row : entiers et flottants a nombre de decimales fixe ecrits chiffre
+ *    par chiffre dans un tampon de CSV_ROW_BYTES (ni String, ni printf,
+ *    ni ArduinoJson). NAN : champ vide. Texte entre guillemets si besoin.
+ *  - Fin de ligne "\r\n" (RFC 4180), premiere ligne = noms de colonnes.
+ *
+ *  Colonnes :
+ *  - ?cols=a,b,c : colonnes retenues, dans l'ordre donne ; toutes par
+ *    defaut. Nom inconnu : 400.
+ **************************************************************/
+#ifndef CSV_STREAM_H
+#define CSV_STREAM_H
+
+#include <JsonStream.hpp>
+
+class CsvStream : public JsonStream {
+public:
+    // Envoie la reponse text/csv, proposee en piece jointe filename.
+    static void send(AsyncWebServerRequest* request, CsvStream* stream, const char* filename);
+
+    // Lit ?cols= ; false (400 deja envoye) si une colonne est inconnue.
+    bool selectColumns(AsyncWebServerRequest* request);
+
+protected:
+    // names : noms des colonnes de la source (tableau statique).
+    CsvStream(const char* const* names, uint8_t count);
+
+    // Ligne en cours, champs separes par des virgules.
+    class Row {
+    public:
+        void u32(uint32_t v);
+        void i32(int32_t v);
+        // decimals : 0..6 ; NAN / infini : champ vide.
+        void fixed(float v, uint8_t decimals);
+        void text(const char* s);
+        void empty() { sep_(); }
+        // Ecrit la ligne ("\r\n" compris) et la remet a zero.
+        void end(Print& out);
+
+    private:
+        void sep_();
+        void put_(char c);
+        void digits_(uint64_t v);
+
+        char buf_[CSV_ROW_BYTES];
+        size_t len_ = 0;
+        bool first_ = true;
+    };
+
+    // Ligne des noms des colonnes retenues.
+    void header(Print& out);
+
+    // Colonnes retenues (indices dans names), dans l'ordre de sortie.
+    uint8_t cols_[CSV_MAX_COLUMNS];
+    uint8_t nCols_ = 0;
+    Row row_;
+
+private:
+    const char* const* names_;
+    uint8_t colCount_;
+};
+
+#endif // CSV_STREAM_H
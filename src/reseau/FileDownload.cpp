@@ -0,0 +1,144 @@
+#include <FileDownload.hpp>
+#include <StorageManager.hpp>
+#include <WiFiEndpoints.hpp>
+#include <esp_rom_crc.h>
+#include <memory>
+
+namespace {
+// Fichier ouvert pendant la reponse : libere avec elle (fin ou coupure).
+struct DownloadCtx {
+    File f;
+    size_t start = 0;      // premier octet envoye
+    size_t len = 0;        // octets a envoyer
+};
+
+bool parseUint_(const char* s, const char* end, size_t& out) {
+    if (s == end) return false;
+    size_t v = 0;
+    for (; s < end; ++s) {
+        if (*s < '0' || *s > '9') return false;
+        v = v * 10 + static_cast<size_t>(*s - '0');
+    }
+    out = v;
+    return true;
+}
+} // namespace
+
+void FileDownload::etag(File& f, char* buf, size_t len) {
+    const size_t size = f.size();
+    const size_t tail = (size < DOWNLOAD_ETAG_TAIL_BYTES) ? size : DOWNLOAD_ETAG_TAIL_BYTES;
+    uint8_t data[DOWNLOAD_ETAG_TAIL_BYTES];
+    size_t n = 0;
+    if (tail && f.seek(size - tail)) n = f.read(data, tail);
+    const uint32_t crc = esp_rom_crc32_le(0, data, n);
+    snprintf(buf, len, "\"%lx-%08lx\"", static_cast<unsigned long>(size),
+             static_cast<unsigned long>(crc));
+}
+
+bool FileDownload::parseRange_(const String& value, size_t size,
+                               size_t& start, size_t& end, bool& unsatisfiable) {
+    unsatisfiable = false;
+    const char* s = value.c_str();
+    while (*s == ' ') s++;
+    if (strncmp(s, "bytes=", 6) != 0) return false;
+    s += 6;
+    if (strchr(s, ',')) return false;  // plusieurs intervalles : ignores
+
+    const char* dash = strchr(s, '-');
+    if (!dash) return false;
+    const char* last = s + strlen(s);
+    while (last > dash + 1 && last[-1] == ' ') last--;
+
+    if (dash == s) {
+        // "bytes=-n" : n derniers octets.
+        size_t n = 0;
+        if (!parseUint_(dash + 1, last, n)) return false;
+        if (n == 0 || size == 0) {
+            unsatisfiable = true;
+            return true;
+        }
+        start = (n < size) ? size - n : 0;
+        end = size - 1;
+        return true;
+    }
+
+    if (!parseUint_(s, dash, start)) return false;
+    end = size ? size - 1 : 0;
+    if (dash + 1 < last) {
+        if (!parseUint_(dash + 1, last, end)) return false;
+        if (end < start) return false;
+        if (size && end > size - 1) end = size - 1;
+    }
+    if (start >= size) unsatisfiable = true;
+    return true;
+}
+
+void FileDownload::send(AsyncWebServerRequest* request, const char* path) {
+    std::shared_ptr<DownloadCtx> ctx(new DownloadCtx());
+    ctx->f = STORAGE->open(path, "r");
+    if (!ctx->f || ctx->f.isDirectory()) {
+        request->send(404, CT_APP_JSON, "{\"error\":\"not_found\"}");
+        return;
+    }
+
+    const size_t size = ctx->f.size();
+    char tag[32];
+    etag(ctx->f, tag, sizeof(tag));
+
+    const AsyncWebHeader* inm = request->getHeader("If-None-Match");
+    if (inm && inm->value() == tag) {
+        AsyncWebServerResponse* r = request->beginResponse(304, CT_APP_JSON, String());
+        r->addHeader("ETag", tag);
+        request->send(r);
+        return;
+    }
+
+    // Range pris en compte si If-Range absent ou egal a l'ETag courant.
+    size_t start = 0;
+    size_t end = size ? size - 1 : 0;
+    bool partial = false;
+    const AsyncWebHeader* range = request->getHeader("Range");
+    const AsyncWebHeader* ifRange = request->getHeader("If-Range");
+    if (range && (!ifRange || ifRange->value() == tag)) {
+        bool unsatisfiable = false;
+        partial = parseRange_(range->value(), size, start, end, unsatisfiable);
+        if (partial && unsatisfiable) {
+            AsyncWebServerResponse* r = request->beginResponse(416, CT_APP_JSON,
+                                                               "{\"error\":\"bad_range\"}");
+            r->addHeader("Content-Range", String("bytes */") + String(static_cast<unsigned long>(size)));
+            r->addHeader("ETag", tag);
+            request->send(r);
+            return;
+        }
+    }
+
+    ctx->start = partial ? start : 0;
+    ctx->len = size ? (partial ? end - start + 1 : size) : 0;
+    ctx->f.seek(ctx->start);
+
+    AsyncWebServerResponse* response = request->beginResponse(
+        CT_OCTET_STREAM, ctx->len, [ctx](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+            if (index >= ctx->len) return 0;
+            size_t n = ctx->len - index;
+            if (n > maxLen) n = maxLen;
+            if (n > DOWNLOAD_CHUNK_BYTES) n = DOWNLOAD_CHUNK_BYTES;
+            const size_t pos = ctx->start + index;
+            if (ctx->f.position() != pos && !ctx->f.seek(pos)) return 0;
+            return ctx->f.read(buf, n);
+        });
+    if (partial) {
+        response->setCode(206);
+        char cr[48];
+        snprintf(cr, sizeof(cr), "bytes %lu-%lu/%lu", static_cast<unsigned long>(start),
+                 static_cast<unsigned long>(end), static_cast<unsigned long>(size));
+        response->addHeader("Content-Range", cr);
+    }
+    response->addHeader("Accept-Ranges", "bytes");
+    response->addHeader("ETag", tag);
+    // Revalidation a chaque fois : les journaux grandissent.
+    response->addHeader("Cache-Control", "no-cache");
+    const char* name = strrchr(path, '/');
+    response->addHeader("Content-Disposition",
+                        String("attachment; filename=\"") + (name ? name + 1 : path) + "\"");
+    request->send(response);
+}
@@ -0,0 +1,53 @@
+/**************************************************************
+ *  FileDownload - fichier persistant servi en binaire (Range / ETag)
+ *
+ *  But :
+ *  - Recuperer sessions, journal, profils et archive sur un Wi-Fi faible :
+ *    un transfert coupe reprend a l'octet ou il s'est arrete (Range), un
+ *    collecteur ne recupere que la fin d'un fichier qui a grandi.
+ *  - Lecture directe en flash par morceaux de DOWNLOAD_CHUNK_BYTES au
+ *    rythme de TCP : memoire constante quelle que soit la taille.
+ *
+ *  HTTP :
+ *  - Content-Length, Accept-Ranges: bytes, ETag.
+ *  - Range "bytes=a-b", "bytes=a-", "bytes=-n" (un seul intervalle) :
+ *    206 + Content-Range ; hors du fichier : 416. Plusieurs intervalles :
+ *    Range ignore (200, fichier entier).
+ *  - If-Range different de l'ETag : fichier entier (200).
+ *    If-None-Match egal : 304.
+ *
+ *  ETag :
+ *  - Taille + CRC32 des DOWNLOAD_ETAG_TAIL_BYTES derniers octets. Journaux
+ *    en ajout seul : chaque enregistrement finit par son CRC, tout ajout
+ *    change la fin ; AtomicFile : le pied (generation, CRC) change a chaque
+ *    reecriture. Pas de relecture du fichier entier.
+ *
+ *  Limites :
+ *  - Taille figee a la requete : un ajout pendant le transfert sera lu
+ *    par la requete suivante (Range a partir de l'ancienne taille).
+ *  - Fichier supprime pendant le transfert (retention) : la lecture
+ *    echoue, le client expire ; la reprise rend 404 ou un autre ETag.
+ **************************************************************/
+#ifndef FILE_DOWNLOAD_H
+#define FILE_DOWNLOAD_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <Config.hpp>
+
+class FileDownload {
+public:
+    // Repond a la requete avec le fichier path (404 s'il n'existe pas).
+    static void send(AsyncWebServerRequest* request, const char* path);
+
+    // ETag (guillemets compris) d'un fichier ouvert ; buf >= 24 octets.
+    static void etag(File& f, char* buf, size_t len);
+
+private:
+    // Intervalle demande ; false si l'en-tete est ignore (syntaxe,
+    // plusieurs intervalles). unsatisfiable : debut hors du fichier.
+    static bool parseRange_(const String& value, size_t size,
+                            size_t& start, size_t& end, bool& unsatisfiable);
+};
+
+#endif // FILE_DOWNLOAD_H
@@ -0,0 +1,172 @@
+#include <HistoryBinary.hpp>
+#include <BusSampler.hpp>
+#include <WiFiEndpoints.hpp>
+#include <esp_heap_caps.h>
+#include <memory>
+
+namespace {
+// Tampon encode : libere avec la reponse (fin ou coupure).
+struct BinaryCtx {
+    uint8_t* buf = nullptr;
+    size_t len = 0;
+    ~BinaryCtx() { free(buf); }
+};
+
+// Exposant decimal par colonne : ms, mA, 0.01 C, 0.01 C, 0.1 Pa.
+const int8_t kExp[HistoryBinary::kColumns] = {0, -3, -2, -2, -1};
+const float kScale[HistoryBinary::kColumns] = {1.0f, 1000.0f, 100.0f, 100.0f, 10.0f};
+
+const int32_t kNan = INT32_MIN;
+// Bornes des valeurs brutes : tout ecart tient dans un i32.
+const int32_t kRawMax = (1L << 30) - 1;
+
+int32_t toRaw_(float v, float scale) {
+    if (isnan(v) || isinf(v)) return kNan;
+    double x = static_cast<double>(v) * scale;
+    if (x > kRawMax) x = kRawMax;
+    if (x < -kRawMax) x = -kRawMax;
+    return static_cast<int32_t>(lround(x));
+}
+
+void put16_(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put32_(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+size_t align4_(size_t n) { return (n + 3) & ~static_cast<size_t>(3); }
+} // namespace
+
+bool HistoryBinary::wanted(AsyncWebServerRequest* request) {
+    if (request->hasParam("format")) return request->getParam("format")->value() == "bin";
+    const AsyncWebHeader* accept = request->getHeader("Accept");
+    return accept && accept->value().indexOf(CT_OCTET_STREAM) >= 0;
+}
+
+size_t HistoryBinary::pack_(uint8_t* buf, uint32_t count, uint32_t stride) {
+    uint8_t* out = buf + kHeaderBytes + kColumns * kColumnBytes;
+    const int32_t* raw = reinterpret_cast<const int32_t*>(out);
+
+    for (uint8_t c = 0; c < kColumns; ++c) {
+        const int32_t* col = raw + static_cast<size_t>(c) * stride;
+        // ts_ms n'est jamais NAN (INT32_MIN y est une date valide).
+        const bool nullable = (c != 0);
+
+        // 1) Largeur : plus grand ecart entre valeurs successives.
+        int32_t base = 0;
+        bool any = false;
+        uint32_t maxAbs = 0;
+        int32_t prev = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (nullable && col[i] == kNan) continue;
+            if (!any) {
+                base = prev = col[i];
+                any = true;
+            }
+            const int32_t d = static_cast<int32_t>(static_cast<uint32_t>(col[i]) - static_cast<uint32_t>(prev));
+            const uint32_t a = (d < 0) ? static_cast<uint32_t>(-static_cast<int64_t>(d)) : static_cast<uint32_t>(d);
+            if (a > maxAbs) maxAbs = a;
+            prev = col[i];
+        }
+        const uint8_t width = !any ? 0 : (maxAbs <= 127) ? 1 : (maxAbs <= 32767) ? 2 : 4;
+
+        uint8_t* desc = buf + kHeaderBytes + c * kColumnBytes;
+        desc[0] = width;
+        desc[1] = static_cast<uint8_t>(kExp[c]);
+        desc[2] = 0;
+        desc[3] = 0;
+        put32_(desc + 4, static_cast<uint32_t>(base));
+        if (!width) continue;
+
+        // 2) Ecarts ecrits sur place : out <= col, l'ecart i n'atteint
+        //    jamais la valeur brute i + 1 (largeur <= 4).
+        prev = base;
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t v = col[i];
+            int32_t d;
+            if (nullable && v == kNan) {
+                d = (width == 1) ? INT8_MIN : (width == 2) ? INT16_MIN : INT32_MIN;
+            } else {
+                d = static_cast<int32_t>(static_cast<uint32_t>(v) - static_cast<uint32_t>(prev));
+                prev = v;
+            }
+            uint8_t* p = out + i * width;
+            if (width == 1) {
+                p[0] = static_cast<uint8_t>(d);
+            } else if (width == 2) {
+                put16_(p, static_cast<uint16_t>(d));
+            } else {
+                put32_(p, static_cast<uint32_t>(d));
+            }
+        }
+        const size_t used = static_cast<size_t>(count) * width;
+        memset(out + used, 0, align4_(used) - used);
+        out += align4_(used);
+    }
+    return static_cast<size_t>(out - buf);
+}
+
+void HistoryBinary::send(AsyncWebServerRequest* request, uint32_t since, uint32_t maxN, uint8_t ch) {
+    std::shared_ptr<BinaryCtx> ctx(new BinaryCtx());
+    const size_t cap = kHeaderBytes + kColumns * (kColumnBytes + static_cast<size_t>(maxN) * 4);
+    ctx->buf = static_cast<uint8_t*>(heap_caps_malloc(cap, MALLOC_CAP_SPIRAM));
+    if (!ctx->buf) ctx->buf = static_cast<uint8_t*>(malloc(cap));
+    if (!ctx->buf) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_memory\"}");
+        return;
+    }
+
+    // Colonnes brutes, lues par lots dans le ring buffer.
+    int32_t* raw = reinterpret_cast<int32_t*>(ctx->buf + kHeaderBytes + kColumns * kColumnBytes);
+    BusSampler::Sample batch[JSON_STREAM_BATCH];
+    uint32_t seq = since;
+    uint32_t start = since;
+    uint32_t n = 0;
+    while (n < maxN) {
+        const uint32_t want = (maxN - n < JSON_STREAM_BATCH) ? maxN - n : JSON_STREAM_BATCH;
+        const size_t got = BUS_SAMPLER->getHistorySince(seq, batch, want, seq);
+        if (!got) break;
+        if (n == 0) start = seq - static_cast<uint32_t>(got);
+        for (size_t i = 0; i < got; ++i) {
+            const BusSampler::Sample& s = batch[i];
+            const uint32_t k = n + static_cast<uint32_t>(i);
+            raw[k] = static_cast<int32_t>(s.ts_ms);
+            raw[maxN + k] = toRaw_(s.current_a[ch], kScale[1]);
+            raw[2 * maxN + k] = toRaw_(s.motor_c[ch], kScale[2]);
+            raw[3 * maxN + k] = toRaw_(s.bme_c, kScale[3]);
+            raw[4 * maxN + k] = toRaw_(s.bme_pa, kScale[4]);
+        }
+        n += static_cast<uint32_t>(got);
+    }
+    if (n == 0) start = seq;
+
+    uint8_t* h = ctx->buf;
+    h[0] = 'H';
+    h[1] = 'B';
+    h[2] = kVersion;
+    h[3] = ch;
+    put16_(h + 4, static_cast<uint16_t>(n));
+    h[6] = kColumns;
+    h[7] = 0;
+    put32_(h + 8, start);
+    put32_(h + 12, seq);
+    ctx->len = pack_(ctx->buf, n, maxN);
+
+    // Seule la taille encodee reste allouee pendant l'envoi.
+    uint8_t* shrunk = static_cast<uint8_t*>(realloc(ctx->buf, ctx->len));
+    if (shrunk) ctx->buf = shrunk;
+
+    AsyncWebServerResponse* response = request->beginResponse(
+        CT_OCTET_STREAM, ctx->len, [ctx](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+            if (index >= ctx->len) return 0;
+            size_t len = ctx->len - index;
+            if (len > maxLen) len = maxLen;
+            memcpy(buf, ctx->buf + index, len);
+            return len;
+        });
+    response->addHeader("Vary", "Accept");
+    request->send(response);
+}
@@ -0,0 +1,59 @@
+/**************************************************************
+ *  HistoryBinary - encodage binaire compact de /api/history
+ *
+ *  But :
+ *  - Le JSON coute ~100 octets par echantillon (noms de champs repetes,
+ *    flottants en pleine precision) : 200 echantillons = ~20 Ko et du
+ *    formatage de flottants sur la tache AsyncTCP. Ici : entiers a virgule
+ *    fixe, par colonne, en ecarts successifs ; ~5 a 10 octets par
+ *    echantillon, sans aucun formatage texte.
+ *  - Decodage direct en typed arrays dans l'UI (app.js).
+ *  - Negocie : ?format=bin ou "Accept: application/octet-stream" ; sans
+ *    l'un ou l'autre, /api/history reste en JSON.
+ *
+ *  Format (petit-boutiste, blocs alignes sur 4 octets) :
+ *  - En-tete (16 octets) : "HB", version (1), canal, nombre n (u16),
+ *    colonnes (5), 0, seq_start (u32 : seq precedant le premier
+ *    echantillon), seq_end (u32 : prochain echantillon attendu).
+ *  - 5 descripteurs (8 octets), colonnes ts_ms, current_a, motor_c,
+ *    bme_c, bme_pa : largeur (0, 1, 2 ou 4 octets), exposant e (valeur =
+ *    entier * 10^e), 2 octets a 0, base (i32).
+ *  - Puis par colonne n ecarts signes de la largeur indiquee (complete a
+ *    4 octets) : valeur[i] = valeur[i-1] + ecart[i], valeur[-1] = base.
+ *    Ecart minimal (-128, -32768, INT32_MIN) : NAN, valeur precedente
+ *    inchangee. Largeur 0 : colonne entierement NAN, pas de donnees.
+ *  - ts_ms : exposant 0, somme modulo 2^32 (millis qui reboucle).
+ *
+ *  Memoire :
+ *  - Un tampon (16 + 40 + 20 * max octets) rempli depuis le ring buffer
+ *    par lots de JSON_STREAM_BATCH, compacte sur place puis reduit a la
+ *    taille encodee ; libere avec la reponse.
+ **************************************************************/
+#ifndef HISTORY_BINARY_H
+#define HISTORY_BINARY_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <Config.hpp>
+
+class HistoryBinary {
+public:
+    static constexpr uint8_t kVersion = 1;
+    static constexpr uint8_t kColumns = 5;
+    static constexpr size_t kHeaderBytes = 16;
+    static constexpr size_t kColumnBytes = 8;
+
+    // true si la requete demande le format binaire.
+    static bool wanted(AsyncWebServerRequest* request);
+
+    // Repond avec les echantillons du canal ch apres since (max au plus).
+    static void send(AsyncWebServerRequest* request, uint32_t since, uint32_t maxN, uint8_t ch);
+
+private:
+    // Colonnes brutes (i32, NAN = INT32_MIN, pas stride) a partir de
+    // kHeaderBytes + kColumns * kColumnBytes : ecrit les descripteurs puis
+    // les ecarts sur place. Renvoie la taille encodee.
+    static size_t pack_(uint8_t* buf, uint32_t count, uint32_t stride);
+};
+
+#endif // HISTORY_BINARY_H
@@ -0,0 +1,85 @@
+#include <JsonStream.hpp>
+#include <Utils.hpp>
+#include <WiFiEndpoints.hpp>
+#include <memory>
+
+void JsonStream::send(AsyncWebServerRequest* request, JsonStream* stream,
+                      const char* contentType, const char* attachment) {
+    // Partage avec le filler : libere a la destruction de la reponse.
+    std::shared_ptr<JsonStream> s(stream);
+    AsyncWebServerResponse* response = request->beginChunkedResponse(
+        contentType ? contentType : CT_APP_JSON, [s](uint8_t* buf, size_t maxLen, size_t) -> size_t {
+            return s->fill_(buf, maxLen);
+        });
+    if (attachment) {
+        response->addHeader("Content-Disposition",
+                            String("attachment; filename=\"") + attachment + "\"");
+    }
+    request->send(response);
+}
+
+size_t JsonStream::fill_(uint8_t* buf, size_t maxLen) {
+    size_t n = 0;
+    while (n < maxLen) {
+        if (piece_.pos == piece_.len) {
+            if (done_) break;
+            piece_.len = 0;
+            piece_.pos = 0;
+            piece_.overflow = false;
+            done_ = !next(piece_);
+            if (piece_.overflow) {
+                // En-tete / pied plus grand que le tampon (element : voir
+                // item()) : fin du flux sur un marqueur d'erreur explicite
+                // plutot qu'une reponse tronquee d'apparence valide.
+                DEBUG_PRINTLN("[JsonStream] morceau trop grand : flux interrompu");
+                static const char kMarker[] = "\n{\"error\":\"piece_overflow\"}\n";
+                memcpy(piece_.data, kMarker, sizeof(kMarker) - 1);
+                piece_.len = sizeof(kMarker) - 1;
+                piece_.overflow = false;
+                done_ = true;
+            }
+            // Morceau vide (budget de filtrage epuise) : rendre la main ;
+            // rien encore envoye dans cet appel => rappel plus tard.
+            if (piece_.len == 0 && !done_) return n ? n : RESPONSE_TRY_AGAIN;
+            continue;
+        }
+        size_t chunk = piece_.len - piece_.pos;
+        if (chunk > maxLen - n) chunk = maxLen - n;
+        memcpy(buf + n, piece_.data + piece_.pos, chunk);
+        piece_.pos += chunk;
+        n += chunk;
+    }
+    return n;
+}
+
+void JsonStream::item(Print& out, const JsonDocument& doc) {
+    const size_t mark = piece_.len;
+    const bool comma = !first_;
+    if (comma) out.write(',');
+    first_ = false;
+    const size_t n = serializeJson(doc, out);
+    // Piece::write refuse tout ce qui depasse (overflow) : n seul ne suffit pas.
+    if (&out != &piece_ || (!piece_.overflow && mark + comma + n <= sizeof(piece_.data))) return;
+
+    // Element plus grand que le morceau : retire et remplace par un
+    // marqueur (le tableau reste du JSON valide).
+    DEBUG_PRINTLN("[JsonStream] element trop grand : remplace");
+    piece_.len = mark;
+    piece_.overflow = false;
+    if (comma) out.write(',');
+    out.print("{\"error\":\"item_too_large\"}");
+}
+
+size_t JsonStream::Piece::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t JsonStream::Piece::write(const uint8_t* buf, size_t n) {
+    if (len + n > sizeof(data)) {
+        overflow = true;
+        return 0;
+    }
+    memcpy(data + len, buf, n);
+    len += n;
+    return n;
+}
@@ -0,0 +1,72 @@
+/**************************************************************
+ *  JsonStream - reponse HTTP JSON ecrite au fil de l'envoi
+ *
+ *  But :
+ *  - Les listes longues (/api/history, /api/events, /api/sessions) ne
+ *    sont plus construites en entier (document + String + tampon TCP) :
+ *    la reponse est chunked et chaque morceau (en-tete, un element, pied)
+ *    est serialise quand AsyncTCP demande des octets.
+ *  - Memoire constante quelle que soit la taille de la reponse : un
+ *    morceau (JSON_STREAM_PIECE_BYTES) + le lot lu par la classe derivee.
+ *
+ *  Utilisation :
+ *  - Deriver, implementer next() (un morceau par appel, false a la fin),
+ *    puis JsonStream::send(request, new Derive(...)) : le flux est libere
+ *    avec la reponse (fin ou connexion coupee).
+ *  - next() est appele dans la tache AsyncTCP : pas d'attente longue.
+ *    Filtre : au plus JSON_STREAM_SCAN_MAX elements examines par appel ;
+ *    morceau vide (true sans rien ecrire) = rien a envoyer pour l'instant,
+ *    next() est rappele au rappel AsyncTCP suivant (RESPONSE_TRY_AGAIN).
+ *  - Meme mecanique pour les exports CSV (CsvStream) : type de contenu
+ *    et piece jointe passes a send().
+ **************************************************************/
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <Config.hpp>
+
+class JsonStream {
+public:
+    virtual ~JsonStream() = default;
+
+    // Envoie la reponse chunked (prend possession de stream).
+    // contentType : nullptr = JSON ; attachment : nom de fichier propose.
+    static void send(AsyncWebServerRequest* request, JsonStream* stream,
+                     const char* contentType = nullptr, const char* attachment = nullptr);
+
+protected:
+    // Ecrit le morceau suivant dans out ; false quand tout est ecrit.
+    // Morceau vide : reprise au rappel suivant.
+    virtual bool next(Print& out) = 0;
+
+    // Element de tableau : virgule si besoin puis doc. doc plus grand que
+    // le morceau : {"error":"item_too_large"} a sa place.
+    void item(Print& out, const JsonDocument& doc);
+    // Debut d'un nouveau tableau (pas de virgule avant le premier element).
+    void resetItems() { first_ = true; }
+
+private:
+    // Morceau en cours, JSON_STREAM_PIECE_BYTES au plus ; depassement hors
+    // item() : flux termine par {"error":"piece_overflow"}.
+    class Piece : public Print {
+    public:
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buf, size_t n) override;
+        char data[JSON_STREAM_PIECE_BYTES];
+        size_t len = 0;
+        size_t pos = 0;
+        bool overflow = false;
+    };
+
+    // Copie dans buf (maxLen octets au plus) ; 0 = fin de reponse.
+    size_t fill_(uint8_t* buf, size_t maxLen);
+
+    Piece piece_;
+    bool first_ = true;
+    bool done_ = false;
+};
+
+#endif // JSON_STREAM_H
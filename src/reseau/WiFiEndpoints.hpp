@@ -18,11 +18,31 @@
 #define EP_API_RTC         "/api/rtc"
 #define EP_API_RUN_TIMER   "/api/run_timer"
 #define EP_API_SESSIONS    "/api/sessions"
+#define EP_API_SESSION_PROFILE "/api/session_profile"
+#define EP_API_SESSION_STATS "/api/session_stats"
+#define EP_API_ARCHIVE     "/api/archive"
+#define EP_API_FILES       "/api/files"
+#define EP_API_DOWNLOAD    "/api/download"
+#define EP_API_EXPORT_HISTORY  "/api/export/history"
+#define EP_API_EXPORT_SESSIONS "/api/export/sessions"
+#define EP_API_EXPORT_EVENTS   "/api/export/events"
+#define EP_API_COMMAND     "/api/command"
+#define EP_API_DIAG_LATENCY "/api/diag/latency"
+#define EP_API_DIAG_NVS    "/api/diag/nvs"
+#define EP_API_DIAG_STORAGE "/api/diag/storage"
+#define EP_API_DIAG_PERSIST "/api/diag/persist"
+#define EP_API_DIAG_ARCHIVE "/api/diag/archive"
+#define EP_API_DIAG_LIVE   "/api/diag/live"
+#define EP_API_DIAG_RESET  "/api/diag/reset"
+#define EP_API_LIVE        "/api/live"
+#define EP_API_SCHEDULE    "/api/schedule"
 
 // ===== Headers utiles =====
 #define HDR_AUTH_TOKEN     "X-Auth-Token"
 
 // ===== Content types =====
 #define CT_APP_JSON        "application/json"
+#define CT_OCTET_STREAM    "application/octet-stream"
+#define CT_TEXT_CSV        "text/csv"
 
 #endif // WIFI_ENDPOINTS_H
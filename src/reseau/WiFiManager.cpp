@@ -2,8 +2,18 @@
 #include <Utils.hpp>
 #include <ArduinoJson.h>
 #include <AsyncJson.h>
-#include <SPIFFS.h>
+#include <StorageManager.hpp>
+#include <PersistWorker.hpp>
+#include <SessionProfile.hpp>
+#include <TimeArchive.hpp>
+#include <JsonStream.hpp>
+#include <FileDownload.hpp>
+#include <CsvStream.hpp>
+#include <HistoryBinary.hpp>
+#include <PowerTracker.hpp>
 #include <WiFiEndpoints.hpp>
+#include <RunScheduler.hpp>
+#include <memory>
 
 WiFiManager* WiFiManager::inst_ = nullptr;
 
@@ -39,12 +49,123 @@ static const char* stateName_(DeviceState s) {
     }
 }
 
+// Convertit le statut d'une commande en string stable pour l'UI.
+static const char* cmdStatusName_(Device::CommandResult::Status st) {
+    switch (st) {
+        case Device::CommandResult::Status::Pending: return "pending";
+        case Device::CommandResult::Status::Done: return "done";
+        case Device::CommandResult::Status::Rejected: return "rejected";
+        default: return "unknown";
+    }
+}
+
+// Nom stable d'un type de commande (cles JSON diagnostic).
+static const char* cmdTypeName_(Device::Command::Type t) {
+    switch (t) {
+        case Device::Command::Type::Start: return "start";
+        case Device::Command::Type::Stop: return "stop";
+        case Device::Command::Type::Toggle: return "toggle";
+        case Device::Command::Type::ClearFault: return "clear_fault";
+        case Device::Command::Type::TimedRun: return "timed_run";
+        case Device::Command::Type::SetRelay: return "set_relay";
+        case Device::Command::Type::Reset: return "reset";
+        default: return "unknown";
+    }
+}
+
+// "HH:MM" <-> minutes depuis minuit (regles de planification).
+static String minToHhmm_(uint16_t m) {
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%02u:%02u", m / 60, m % 60);
+    return String(buf);
+}
+
+static int hhmmToMin_(const String& s) {
+    const int colon = s.indexOf(':');
+    if (colon <= 0) return -1;
+    const int h = s.substring(0, colon).toInt();
+    const int m = s.substring(colon + 1).toInt();
+    if (h < 0 || h > 23 || m < 0 || m > 59) return -1;
+    return h * 60 + m;
+}
+
+// Canal d'une requete : nombre, ou "all" (CHANNEL_ALL) ; def si absent.
+// La validite (bornes, "all" autorise) est verifiee par Device.
+static uint8_t channelParam_(JsonVariantConst v, uint8_t def) {
+    if (v.isNull()) return def;
+    int ch = 0;
+    if (v.is<const char*>()) {
+        const String str = v.as<String>();
+        if (str == "all") return CHANNEL_ALL;
+        ch = str.toInt();
+    } else {
+        ch = v.as<int>();
+    }
+    // Hors bornes : valeur invalide (refusee par Device), jamais CHANNEL_ALL.
+    return (ch < 0 || ch >= CHANNEL_ALL) ? 0xFE : static_cast<uint8_t>(ch);
+}
+
+// Champs communs d'un resultat de commande (reponse control + /api/command).
+static void fillCommandResult_(JsonVariant doc, const Device::CommandResult& r) {
+    doc["id"] = r.id;
+    doc["status"] = cmdStatusName_(r.status);
+    if (r.status != Device::CommandResult::Status::Unknown) {
+        if (r.channel == CHANNEL_ALL) doc["channel"] = "all";
+        else doc["channel"] = r.channel;
+    }
+    if (r.status != Device::CommandResult::Status::Done) return;
+    doc["applied"] = r.ok;
+    doc["done_ms"] = r.done_ms;
+    doc["relay_on"] = r.relay_on;
+    doc["state"] = stateName_(r.state);
+    doc["fault_latched"] = r.fault_latched;
+    doc["seq"] = r.seq;
+}
+
+// Resultat de commande serialise ; withOk : champ "ok" (reponse control).
+static void serializeResult_(bool withOk, bool ok, const Device::CommandResult& r, String& out) {
+    DynamicJsonDocument doc(256);
+    if (withOk) doc["ok"] = ok;
+    fillCommandResult_(doc, r);
+    serializeJson(doc, out);
+}
+
+// Reponse differee d'une commande en attente : tant qu'elle est pending et
+// que waitMs n'est pas ecoule, le filler rend RESPONSE_TRY_AGAIN et AsyncTCP
+// le rappelle a l'ack / poll suivant. Rien n'attend sur la tache AsyncTCP :
+// les autres connexions (SSE, telechargements) restent servies.
+static void sendResultDeferred_(AsyncWebServerRequest* request, bool withOk,
+                                uint32_t id, uint32_t waitMs) {
+    const uint32_t start = millis();
+    std::shared_ptr<String> body(new String());
+    AsyncWebServerResponse* response = request->beginChunkedResponse(
+        CT_APP_JSON, [withOk, id, waitMs, start, body](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+            if (body->length() == 0) {
+                Device::CommandResult r;
+                r.id = id;
+                r.status = Device::CommandResult::Status::Pending;
+                DeviceTransport* transport = DEVTRAN;
+                if (transport) transport->getResult(id, r);
+                if (r.status == Device::CommandResult::Status::Pending && millis() - start < waitMs) {
+                    return RESPONSE_TRY_AGAIN;
+                }
+                // Delai ecoule : etat courant (pending) plutot qu'une erreur.
+                serializeResult_(withOk, true, r, *body);
+            }
+            if (index >= body->length()) return 0;
+            size_t n = body->length() - index;
+            if (n > maxLen) n = maxLen;
+            memcpy(buf, body->c_str() + index, n);
+            return n;
+        });
+    request->send(response);
+}
+
 void WiFiManager::begin() {
     // Demarrage Wi-Fi :
     // - Tentative STA en premier
     // - Fallback AP si echec de connexion
-    const WiFiModeSetting mode = static_cast<WiFiModeSetting>(
-        CONF->GetInt(KEY_WIFI_MODE, static_cast<int>(WiFiModeSetting::Sta)));
+    const WiFiModeSetting mode = static_cast<WiFiModeSetting>(CONF->GetCfg<CfgId::WifiMode>());
 
     bool staOk = false;
     if (mode == WiFiModeSetting::Ap) {
@@ -65,6 +186,7 @@ void WiFiManager::begin() {
 
     // Routes / API HTTP
     setupRoutes_();
+    setupLive_();
     server_.begin();
 
     // Worker unique (housekeeping).
@@ -74,8 +196,8 @@ void WiFiManager::begin() {
 
 bool WiFiManager::startSta_() {
     // Lecture identifiants depuis NVS
-    String ssid = CONF->GetString(KEY_STA_SSID, DEFAULT_STA_SSID);
-    String pass = CONF->GetString(KEY_STA_PASS, DEFAULT_STA_PASS);
+    String ssid = CONF->GetCfg<CfgId::StaSsid>();
+    String pass = CONF->GetCfg<CfgId::StaPass>();
 
     if (ssid.length() == 0) {
         return false;
@@ -98,8 +220,8 @@ bool WiFiManager::startSta_() {
 
 void WiFiManager::startAp_() {
     // Lecture identifiants AP depuis NVS.
-    String apSsid = CONF->GetString(KEY_AP_SSID, DEFAULT_AP_SSID);
-    String apPass = CONF->GetString(KEY_AP_PASS, DEFAULT_AP_PASS);
+    String apSsid = CONF->GetCfg<CfgId::ApSsid>();
+    String apPass = CONF->GetCfg<CfgId::ApPass>();
 
     WiFi.mode(WIFI_AP);
     WiFi.softAP(apSsid.c_str(), apPass.c_str());
@@ -109,21 +231,23 @@ bool WiFiManager::checkAuth_(AsyncWebServerRequest* request) {
     // Mode auth configurable :
     // - "basic" : user/pass (HTTP basic auth)
     // - "token" : header X-Auth-Token
-    String mode = CONF->GetString(KEY_AUTH_MODE, DEFAULT_AUTH_MODE);
-    mode.toLowerCase();
-
-    if (mode == "basic") {
-        String user = CONF->GetString(KEY_AUTH_USER, DEFAULT_AUTH_USER);
-        String pass = CONF->GetString(KEY_AUTH_PASS, DEFAULT_AUTH_PASS);
-        return request->authenticate(user.c_str(), pass.c_str());
+    // Lectures sans allocation (miroir RAM NVS, buffers pile).
+    char mode[8];
+    CONF->GetCfgChars(CfgId::AuthMode, mode, sizeof(mode));
+
+    if (strcasecmp(mode, "basic") == 0) {
+        char user[64];
+        char pass[64];
+        CONF->GetCfgChars(CfgId::AuthUser, user, sizeof(user));
+        CONF->GetCfgChars(CfgId::AuthPass, pass, sizeof(pass));
+        return request->authenticate(user, pass);
     }
 
-    if (mode == "token") {
-        String token = CONF->GetString(KEY_AUTH_TOKEN, "");
-        String hdr = request->getHeader(HDR_AUTH_TOKEN)
-                       ? request->getHeader(HDR_AUTH_TOKEN)->value()
-                       : "";
-        return token.length() > 0 && hdr == token;
+    if (strcasecmp(mode, "token") == 0) {
+        char token[72];
+        CONF->GetCfgChars(CfgId::AuthToken, token, sizeof(token));
+        const AsyncWebHeader* hdr = request->getHeader(HDR_AUTH_TOKEN);
+        return token[0] != 0 && hdr && hdr->value() == token;
     }
 
     // Mode inconnu -> refuse
@@ -138,8 +262,8 @@ bool WiFiManager::requireAuth_(AsyncWebServerRequest* request) {
     if (events_) {
         events_->append(EventLevel::Warning,
                         static_cast<uint16_t>(WarnCode::W07_AuthFail),
-                        "Auth fail",
-                        "http");
+                        EvtMsg::AuthFail,
+                        EvtSrc::Http);
     }
     BUZZ->playAuthFail();
 
@@ -149,7 +273,7 @@ bool WiFiManager::requireAuth_(AsyncWebServerRequest* request) {
 
 void WiFiManager::setupRoutes_() {
     // UI statique (SPIFFS) : index.html + app.css + app.js + assets
-    server_.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+    server_.serveStatic("/", STORAGE->fs(), "/").setDefaultFile("index.html");
 
     // API "open" (pas d'auth) : infos et statut live.
     server_.on(EP_API_INFO, HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -211,15 +335,94 @@ void WiFiManager::setupRoutes_() {
     server_.on(EP_API_SESSIONS, HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleApiSessions_(request);
     });
+
+    server_.on(EP_API_SESSION_PROFILE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiSessionProfile_(request);
+    });
+    server_.on(EP_API_SESSION_STATS, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiSessionStats_(request);
+    });
+
+    server_.on(EP_API_ARCHIVE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiArchive_(request);
+    });
+
+    server_.on(EP_API_FILES, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiFiles_(request);
+    });
+    server_.on(EP_API_DOWNLOAD, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDownload_(request);
+    });
+
+    server_.on(EP_API_EXPORT_HISTORY, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiExportHistory_(request);
+    });
+    server_.on(EP_API_EXPORT_SESSIONS, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiExportSessions_(request);
+    });
+    server_.on(EP_API_EXPORT_EVENTS, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiExportEvents_(request);
+    });
+
+    server_.on(EP_API_SCHEDULE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiScheduleGet_(request);
+    });
+
+    auto* schedHandler = new AsyncCallbackJsonWebHandler(EP_API_SCHEDULE,
+        [this](AsyncWebServerRequest* request, JsonVariant& json) {
+            if (!requireAuth_(request)) return;
+            handleApiSchedulePost_(request, json);
+        });
+    server_.addHandler(schedHandler);
+
+    server_.on(EP_API_COMMAND, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiCommand_(request);
+    });
+
+    server_.on(EP_API_DIAG_LATENCY, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagLatency_(request);
+    });
+
+    server_.on(EP_API_DIAG_NVS, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagNvs_(request);
+    });
+
+    server_.on(EP_API_DIAG_STORAGE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagStorageGet_(request);
+    });
+
+    auto* benchHandler = new AsyncCallbackJsonWebHandler(EP_API_DIAG_STORAGE,
+        [this](AsyncWebServerRequest* request, JsonVariant& json) {
+            if (!requireAuth_(request)) return;
+            handleApiDiagStoragePost_(request, json);
+        });
+    server_.addHandler(benchHandler);
+
+    server_.on(EP_API_DIAG_PERSIST, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagPersist_(request);
+    });
+
+    server_.on(EP_API_DIAG_ARCHIVE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagArchive_(request);
+    });
+
+    // Remise a zero des compteurs de diagnostic : modifie l'etat, donc
+    // POST authentifie comme les autres routes (les GET restent en lecture).
+    auto* diagResetHandler = new AsyncCallbackJsonWebHandler(EP_API_DIAG_RESET,
+        [this](AsyncWebServerRequest* request, JsonVariant& json) {
+            if (!requireAuth_(request)) return;
+            handleApiDiagReset_(request, json);
+        });
+    server_.addHandler(diagResetHandler);
 }
 
 void WiFiManager::handleApiInfo_(AsyncWebServerRequest* request) {
     // Endpoint simple : infos device, version, ip, mdns.
     DynamicJsonDocument doc(512);
-    doc["device_id"] = CONF->GetString(KEY_DEV_ID, "");
-    doc["device_name"] = CONF->GetString(KEY_DEV_NAME, "");
-    doc["sw"] = CONF->GetString(KEY_DEV_SW, DEVICE_SW_VERSION);
-    doc["hw"] = CONF->GetString(KEY_DEV_HW, DEVICE_HW_VERSION);
+    doc["device_id"] = CONF->GetCfg<CfgId::DevId>();
+    doc["device_name"] = CONF->GetCfg<CfgId::DevName>();
+    doc["sw"] = CONF->GetCfg<CfgId::DevSw>();
+    doc["hw"] = CONF->GetCfg<CfgId::DevHw>();
 
     doc["mdns"] = String(MDNS_HOSTNAME) + ".local";
     doc["ip"] = WiFi.isConnected() ? WiFi.localIP().toString() : WiFi.softAPIP().toString();
@@ -240,10 +443,16 @@ void WiFiManager::workerTaskThunk_(void* param) {
 }
 
 void WiFiManager::workerTask_() {
-    // Tache unique: mise a jour RTC (string cache) + autres petites actions.
+    // Tache unique: mise a jour RTC (string cache) + push SSE.
+    uint32_t lastRtcMs = 0;
     for (;;) {
-        if (rtc_) rtc_->update();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        const uint32_t now = millis();
+        if (now - lastRtcMs >= 1000) {
+            lastRtcMs = now;
+            if (rtc_) rtc_->update();
+        }
+        pushLive_();
+        vTaskDelay(pdMS_TO_TICKS(LIVE_TICK_MS));
     }
 }
 
@@ -256,7 +465,13 @@ void WiFiManager::handleApiStatus_(AsyncWebServerRequest* request) {
         return;
     }
 
-    DynamicJsonDocument doc(512);
+    String out;
+    buildStatus_(snap, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::buildStatus_(const SystemSnapshot& snap, String& out) {
+    DynamicJsonDocument doc(512 + DEVICE_CHANNELS * 320);
     doc["seq"] = snap.seq;
     doc["ts_ms"] = snap.ts_ms;
     doc["age_ms"] = snap.age_ms;
@@ -273,6 +488,12 @@ void WiFiManager::handleApiStatus_(AsyncWebServerRequest* request) {
     doc["board_c"] = snap.board_c;
     doc["ambient_c"] = snap.ambient_c;
 
+    doc["motor_slope_c_s"] = snap.motor_slope_c_s;
+    doc["motor_eta_s"] = snap.motor_eta_s;
+    doc["board_slope_c_s"] = snap.board_slope_c_s;
+    doc["board_eta_s"] = snap.board_eta_s;
+    doc["trend_alert"] = snap.trend_alert;
+
     doc["ds18_ok"] = snap.ds18_ok;
     doc["bme_ok"] = snap.bme_ok;
     doc["adc_ok"] = snap.adc_ok;
@@ -280,13 +501,410 @@ void WiFiManager::handleApiStatus_(AsyncWebServerRequest* request) {
     doc["last_warning"] = snap.last_warning;
     doc["last_error"] = snap.last_error;
 
+    // Etat par canal (le premier niveau reste celui du canal 0).
+    JsonArray chans = doc.createNestedArray("channels");
+    for (uint8_t ch = 0; ch < snap.channel_count; ++ch) {
+        const ChannelSnapshot& c = snap.ch[ch];
+        JsonObject o = chans.createNestedObject();
+        o["channel"] = ch;
+        o["state"] = stateName_(c.state);
+        o["fault_latched"] = c.fault_latched;
+        o["relay_on"] = c.relay_on;
+        o["current_a"] = c.current_a;
+        o["power_w"] = c.power_w;
+        o["energy_wh"] = c.energy_wh;
+        o["motor_c"] = c.motor_c;
+        o["motor_slope_c_s"] = c.motor_slope_c_s;
+        o["motor_eta_s"] = c.motor_eta_s;
+        o["trend_alert"] = c.trend_alert;
+        o["ds18_ok"] = c.ds18_ok;
+        o["adc_ok"] = c.adc_ok;
+    }
+
+    serializeJson(doc, out);
+}
+
+// -----------------------------------------------------------------------------
+// Push SSE (/api/live)
+// -----------------------------------------------------------------------------
+void WiFiManager::setupLive_() {
+    liveMutex_ = xSemaphoreCreateRecursiveMutex();
+
+    // Curseurs : seules les nouveautes posterieures sont poussees (l'UI
+    // charge l'etat initial par HTTP).
+    if (BUS_SAMPLER) {
+        BusSampler::Sample one;
+        BUS_SAMPLER->getHistorySince(UINT32_MAX, &one, 1, liveSampleSeq_);
+    }
+    EventLog::Entry e;
+    if (events_ && events_->getEntry(0, e)) liveEventSeq_ = e.seq;
+    uint32_t first = 0;
+    if (sessions_) sessions_->getSeqRange(first, liveSessionSeq_);
+
+    // Callbacks appeles par la tache AsyncTCP : seul contexte ou les
+    // abonnes (listes et files non protegees de la bibliotheque) sont
+    // touches.
+    live_.onConnect([this](AsyncEventSourceClient* client) {
+        xSemaphoreTakeRecursive(liveMutex_, portMAX_DELAY);
+        LiveClient* slot = nullptr;
+        for (LiveClient& lc : liveClients_) {
+            if (!lc.client) {
+                slot = &lc;
+                break;
+            }
+        }
+        if (slot) {
+            slot->client = client;
+            slot->congestedMs = 0;
+            // Messages deja en file : couverts par l'etat HTTP ou la reprise.
+            slot->sentN = liveN_;
+            liveCount_++;
+            liveStats_.connects++;
+            // Premier envoi "status" complet au prochain tick.
+            liveStatusSeq_ = 0;
+            // Envoi de la file a chaque poll TCP de ce client (~500 ms).
+            client->client()->onPoll([](void* arg, AsyncClient*) {
+                AsyncEventSourceClient* c = static_cast<AsyncEventSourceClient*>(arg);
+                c->_onPoll();
+                if (inst_) inst_->liveDeliver_(c);
+            }, client);
+            liveReplay_(client);
+        } else {
+            liveStats_.refused++;
+        }
+        xSemaphoreGiveRecursive(liveMutex_);
+        if (!slot) client->close();
+    });
+    live_.onDisconnect([this](AsyncEventSourceClient* client) {
+        // Avant destruction du client : plus utilise apres ce retour.
+        xSemaphoreTakeRecursive(liveMutex_, portMAX_DELAY);
+        for (LiveClient& lc : liveClients_) {
+            if (lc.client == client) {
+                lc.client = nullptr;
+                liveCount_--;
+            }
+        }
+        xSemaphoreGiveRecursive(liveMutex_);
+    });
+    server_.addHandler(&live_);
+
+    server_.on(EP_API_DIAG_LIVE, HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleApiDiagLive_(request);
+    });
+}
+
+void WiFiManager::buildLiveEvents_(const EventLog::Entry* batch, size_t n, uint32_t seqEnd, String& out) {
+    // Forme de /api/events.
+    DynamicJsonDocument doc(256 + n * 320);
+    JsonArray arr = doc.createNestedArray("events");
+    for (size_t i = 0; i < n; ++i) {
+        const EventLog::Entry& e = batch[i];
+        char message[64];
+        char source[16];
+        EventLog::formatMessage(e, message, sizeof(message));
+        EventLog::formatSource(e, source, sizeof(source));
+        JsonObject o = arr.createNestedObject();
+        o["seq"] = e.seq;
+        o["ts_ms"] = e.ts_ms;
+        o["first_ms"] = e.first_ms;
+        o["count"] = e.count;
+        o["level"] = (int)e.level;
+        o["code"] = e.code;
+        o["message"] = message;
+        o["source"] = source;
+        if (!isnan(e.arg)) o["arg"] = e.arg;
+    }
+    doc["seq_end"] = seqEnd;
+    serializeJson(doc, out);
+}
+
+void WiFiManager::liveSend_(const char* event, String& payload, bool droppable) {
+    // Tache worker, sous liveMutex_ : mise en file seulement (le plus
+    // ancien message est remplace), envoi par liveDeliver_.
+    liveStats_.messages++;
+    LiveMsg& m = liveOutbox_[liveN_ % LIVE_OUTBOX_LEN];
+    liveN_++;
+    m.event = event;
+    m.payload = std::move(payload);
+    m.n = liveN_;
+    m.id = liveEventSeq_;
+    m.droppable = droppable;
+}
+
+void WiFiManager::liveDeliver_(AsyncEventSourceClient* client) {
+    // Tache AsyncTCP (poll du client) : messages non encore envoyes a ce
+    // client, retard surveille ici. Verrou pris par le worker (mise en
+    // file) : pas d'attente, envoi au poll suivant (~500 ms).
+    if (!liveMutex_) return;
+    if (xSemaphoreTakeRecursive(liveMutex_, 0) != pdTRUE) {
+        liveDeferred_++;
+        return;
+    }
+    LiveClient* lc = nullptr;
+    for (LiveClient& c : liveClients_) {
+        if (c.client == client) lc = &c;
+    }
+    if (!lc) {
+        xSemaphoreGiveRecursive(liveMutex_);
+        return;
+    }
+
+    const uint32_t now = millis();
+    const size_t waiting = client->packetsWaiting();
+    if (waiting > liveStats_.max_queue) liveStats_.max_queue = static_cast<uint32_t>(waiting);
+    if (waiting < LIVE_SLOW_QUEUE) {
+        lc->congestedMs = 0;
+    } else if (!lc->congestedMs) {
+        lc->congestedMs = now ? now : 1;
+    }
+
+    // File du client trop longue (messages jetes par la bibliotheque),
+    // messages remplaces dans la file commune ou retard durable : fermeture.
+    // Le navigateur se reconnecte avec Last-Event-ID, les evenements
+    // manques sont renvoyes (liveReplay_).
+    const uint32_t oldest = (liveN_ > LIVE_OUTBOX_LEN) ? liveN_ - LIVE_OUTBOX_LEN + 1 : 1;
+    bool close = lc->sentN + 1 < oldest ||
+                 (lc->congestedMs && now - lc->congestedMs > LIVE_SLOW_CLOSE_MS);
+    while (!close && lc->sentN < liveN_) {
+        const LiveMsg& m = liveOutbox_[lc->sentN % LIVE_OUTBOX_LEN];
+        if (m.droppable && lc->congestedMs) {
+            liveStats_.skipped++;
+        } else if (client->packetsWaiting() + 1 >= SSE_MAX_QUEUED_MESSAGES) {
+            close = true;
+            break;
+        } else {
+            client->send(m.payload.c_str(), m.event, m.id);
+        }
+        lc->sentN++;
+    }
+    if (close) {
+        lc->client = nullptr;
+        liveCount_--;
+        liveStats_.closed++;
+    }
+    xSemaphoreGiveRecursive(liveMutex_);
+    if (close) client->close();
+}
+
+void WiFiManager::liveReplay_(AsyncEventSourceClient* client) {
+    // Tache AsyncTCP, sous liveMutex_ (abonnement) : reconnexion avec
+    // Last-Event-ID (= dernier seq d'evenement recu) => evenements manques
+    // jusqu'au curseur de la file, au plus LIVE_REPLAY_MAX ; au-dela, l'UI
+    // voit un seq non contigu et relit /api/events.
+    const uint32_t from = client->lastId();
+    if (!events_ || from == 0 || from >= liveEventSeq_) return;
+    EventLog::Entry batch[LIVE_EVENTS_MAX];
+    uint32_t seq = from;
+    uint32_t sent = 0;
+    while (seq < liveEventSeq_ && sent < LIVE_REPLAY_MAX) {
+        uint32_t seqEnd = seq;
+        size_t n = events_->getSince(seq, batch, LIVE_EVENTS_MAX, seqEnd);
+        // Evenements ajoutes depuis le dernier tick : envoyes par la file.
+        while (n && batch[n - 1].seq > liveEventSeq_) n--;
+        if (!n) break;
+        seqEnd = batch[n - 1].seq;
+        String out;
+        buildLiveEvents_(batch, n, seqEnd, out);
+        client->send(out.c_str(), "events", seqEnd);
+        sent += static_cast<uint32_t>(n);
+        seq = seqEnd;
+    }
+    liveStats_.replayed += sent;
+}
+
+void WiFiManager::pushLive_() {
+    // Tache worker : construit les messages (une serialisation pour tous
+    // les abonnes) hors verrou ; liveMutex_ n'est pris que pour lire
+    // l'etat des abonnes puis deplacer les messages prets dans la file
+    // (liveDeliver_ ne l'attend jamais). Aucun acces aux clients ici.
+    if (!liveMutex_) return;
+    xSemaphoreTakeRecursive(liveMutex_, portMAX_DELAY);
+    const uint8_t count = liveCount_;
+    const uint32_t statusSeq = liveStatusSeq_;
+    xSemaphoreGiveRecursive(liveMutex_);
+
+    // Curseurs echantillons / sessions : worker seul ; liveEventSeq_ (lu
+    // par liveReplay_) mis a jour sous verrou.
+    uint32_t eventSeq = liveEventSeq_;
+    if (count == 0) {
+        // Sans abonne : curseurs tenus a jour au prochain abonnement.
+        if (BUS_SAMPLER) {
+            BusSampler::Sample one;
+            BUS_SAMPLER->getHistorySince(UINT32_MAX, &one, 1, liveSampleSeq_);
+        }
+        EventLog::Entry e;
+        if (events_ && events_->getEntry(0, e)) eventSeq = e.seq;
+        uint32_t first = 0;
+        if (sessions_) sessions_->getSeqRange(first, liveSessionSeq_);
+        xSemaphoreTakeRecursive(liveMutex_, portMAX_DELAY);
+        liveEventSeq_ = eventSeq;
+        xSemaphoreGiveRecursive(liveMutex_);
+        return;
+    }
+
+    // 1) Snapshot : seulement sur nouveau seq.
+    SystemSnapshot snap{};
+    DeviceTransport* transport = DEVTRAN;
+    String status;
+    if (transport && transport->getSnapshot(snap) && snap.seq != statusSeq) {
+        buildStatus_(snap, status);
+    }
+
+    // 2) Echantillons du canal 0 (forme de /api/history) + seq_start :
+    //    un trou (client en retard, ring depasse) se comble par HTTP.
+    String history;
+    if (BUS_SAMPLER) {
+        static BusSampler::Sample batch[LIVE_SAMPLES_MAX];
+        uint32_t seqEnd = liveSampleSeq_;
+        const size_t n = BUS_SAMPLER->getHistorySince(liveSampleSeq_, batch, LIVE_SAMPLES_MAX, seqEnd);
+        if (n) {
+            DynamicJsonDocument doc(256 + n * (160 + DEVICE_CHANNELS * 24));
+            doc["ch"] = 0;
+            doc["seq_start"] = seqEnd - static_cast<uint32_t>(n);
+            doc["seq_end"] = seqEnd;
+            JsonArray arr = doc.createNestedArray("samples");
+            for (size_t i = 0; i < n; ++i) {
+                const BusSampler::Sample& s = batch[i];
+                JsonObject o = arr.createNestedObject();
+                o["ts_ms"] = s.ts_ms;
+                o["current_a"] = s.current_a[0];
+                o["motor_c"] = s.motor_c[0];
+                o["bme_c"] = s.bme_c;
+                o["bme_pa"] = s.bme_pa;
+                if (DEVICE_CHANNELS > 1) {
+                    // Autres canaux : [courant, temperature moteur] par canal.
+                    JsonArray chans = o.createNestedArray("channels");
+                    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+                        JsonArray c = chans.createNestedArray();
+                        c.add(s.current_a[ch]);
+                        c.add(s.motor_c[ch]);
+                    }
+                }
+            }
+            serializeJson(doc, history);
+        }
+        liveSampleSeq_ = seqEnd;
+    }
+
+    // 3) Evenements (forme de /api/events) : jamais sautes pour un client
+    //    lent ; un client ferme les recoit a la reconnexion (Last-Event-ID).
+    String events;
+    uint32_t eventEnd = eventSeq;
+    if (events_) {
+        static EventLog::Entry batch[LIVE_EVENTS_MAX];
+        const size_t n = events_->getSince(eventSeq, batch, LIVE_EVENTS_MAX, eventEnd);
+        if (n) buildLiveEvents_(batch, n, eventEnd, events);
+    }
+
+    // 4) Nouvelle session : notification, l'UI relit /api/sessions?since=.
+    String session;
+    if (sessions_) {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        sessions_->getSeqRange(first, last);
+        if (last != liveSessionSeq_) {
+            liveSessionSeq_ = last;
+            char buf[40];
+            snprintf(buf, sizeof(buf), "{\"seq_end\":%lu}", static_cast<unsigned long>(last));
+            session = buf;
+        }
+    }
+
+    // Mise en file : deplacements seulement, dans l'ordre des envois.
+    xSemaphoreTakeRecursive(liveMutex_, portMAX_DELAY);
+    if (status.length()) {
+        liveStatusSeq_ = snap.seq;
+        liveSend_("status", status, true);
+    }
+    if (history.length()) liveSend_("history", history, true);
+    // id SSE des messages suivants = dernier seq mis en file (reprise).
+    liveEventSeq_ = eventEnd;
+    if (events.length()) liveSend_("events", events, false);
+    if (session.length()) liveSend_("sessions", session, false);
+    xSemaphoreGiveRecursive(liveMutex_);
+}
+
+void WiFiManager::handleApiDiagLive_(AsyncWebServerRequest* request) {
+    // Push SSE : abonnes, files d'attente, envois sautes / clients fermes.
+    DynamicJsonDocument doc(512);
+    // Handler HTTP : tache AsyncTCP, liste des abonnes lisible ici.
+    if (!liveMutex_ || xSemaphoreTakeRecursive(liveMutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"busy\"}");
+        return;
+    }
+    doc["clients"] = live_.count();
+    doc["avg_queue"] = live_.avgPacketsWaiting();
+    doc["tick_ms"] = LIVE_TICK_MS;
+    doc["connects"] = liveStats_.connects;
+    doc["refused"] = liveStats_.refused;
+    doc["messages"] = liveStats_.messages;
+    doc["skipped"] = liveStats_.skipped;
+    doc["closed"] = liveStats_.closed;
+    doc["replayed"] = liveStats_.replayed;
+    doc["max_queue"] = liveStats_.max_queue;
+    doc["deferred"] = liveDeferred_;
+    xSemaphoreGiveRecursive(liveMutex_);
+
     String out;
     serializeJson(doc, out);
     request->send(200, CT_APP_JSON, out);
 }
 
+// Flux /api/history : echantillons lus par lots dans le ring buffer.
+class HistoryStream : public JsonStream {
+public:
+    HistoryStream(uint32_t since, uint32_t maxN, uint8_t ch)
+        : seq_(since), left_(maxN), ch_(ch) {}
+
+protected:
+    bool next(Print& out) override {
+        switch (phase_) {
+            case 0:
+                out.printf("{\"ch\":%u,\"samples\":[", static_cast<unsigned>(ch_));
+                phase_ = 1;
+                return true;
+            case 1:
+                if (pos_ == count_) {
+                    const uint32_t want = (left_ < JSON_STREAM_BATCH) ? left_ : JSON_STREAM_BATCH;
+                    count_ = want ? BUS_SAMPLER->getHistorySince(seq_, batch_, want, seq_) : 0;
+                    pos_ = 0;
+                    left_ -= count_;
+                    if (count_ == 0) {
+                        // seq_end : prochain echantillon attendu.
+                        out.printf("],\"seq_end\":%lu}", static_cast<unsigned long>(seq_));
+                        phase_ = 2;
+                        return true;
+                    }
+                }
+                {
+                    const BusSampler::Sample& e = batch_[pos_++];
+                    DynamicJsonDocument doc(256);
+                    doc["ts_ms"] = e.ts_ms;
+                    doc["current_a"] = e.current_a[ch_];
+                    doc["motor_c"] = e.motor_c[ch_];
+                    doc["bme_c"] = e.bme_c;
+                    doc["bme_pa"] = e.bme_pa;
+                    item(out, doc);
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    BusSampler::Sample batch_[JSON_STREAM_BATCH];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t seq_;
+    uint32_t left_;
+    uint8_t ch_;
+    uint8_t phase_ = 0;
+};
+
 void WiFiManager::handleApiHistory_(AsyncWebServerRequest* request) {
-    // Historique de mesures (800 max en RAM, on renvoie une fenetre).
+    // Historique de mesures (BUS_SAMPLER_HISTORY_SIZE max en RAM), envoye
+    // en flux : pas de copie de la fenetre demandee.
     if (!BUS_SAMPLER) {
         request->send(503, CT_APP_JSON, "{\"error\":\"no_sampler\"}");
         return;
@@ -294,37 +912,85 @@ void WiFiManager::handleApiHistory_(AsyncWebServerRequest* request) {
 
     uint32_t since = 0;
     uint32_t maxN = 50;
+    uint32_t ch = 0;
     if (request->hasParam("since")) since = request->getParam("since")->value().toInt();
     if (request->hasParam("max")) maxN = request->getParam("max")->value().toInt();
-    if (maxN > 200) maxN = 200;
+    if (request->hasParam("ch")) ch = request->getParam("ch")->value().toInt();
+    if (maxN > BUS_SAMPLER_HISTORY_SIZE) maxN = BUS_SAMPLER_HISTORY_SIZE;
+    if (ch >= DEVICE_CHANNELS) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_channel\"}");
+        return;
+    }
 
-    // Note memoire : allocation temporaire (max 200 samples).
-    BusSampler::Sample* buf = new BusSampler::Sample[maxN];
-    uint32_t newSeq = since;
-    size_t n = BUS_SAMPLER->getHistorySince(since, buf, maxN, newSeq);
+    if (HistoryBinary::wanted(request)) {
+        HistoryBinary::send(request, since, maxN, static_cast<uint8_t>(ch));
+        return;
+    }
+    JsonStream::send(request, new HistoryStream(since, maxN, static_cast<uint8_t>(ch)));
+}
 
-    // Estimation capacity JSON (evite un doc trop petit).
-    const size_t cap = 512 + (maxN * 64);
-    DynamicJsonDocument doc(cap);
-    JsonArray arr = doc.createNestedArray("samples");
-    for (size_t i = 0; i < n; ++i) {
-        JsonObject o = arr.createNestedObject();
-        o["ts_ms"] = buf[i].ts_ms;
-        o["current_a"] = buf[i].current_a;
-        o["motor_c"] = buf[i].motor_c;
-        o["bme_c"] = buf[i].bme_c;
-        o["bme_pa"] = buf[i].bme_pa;
+// Flux /api/events : entrees lues par lots dans le ring buffer du journal.
+class EventsStream : public JsonStream {
+public:
+    EventsStream(const EventLog* log, uint32_t since, uint32_t maxN)
+        : log_(log), seq_(since), left_(maxN) {}
+
+protected:
+    bool next(Print& out) override {
+        switch (phase_) {
+            case 0:
+                out.print("{\"events\":[");
+                phase_ = 1;
+                return true;
+            case 1:
+                if (pos_ == count_) {
+                    const uint32_t want = (left_ < kBatch) ? left_ : kBatch;
+                    count_ = want ? log_->getSince(seq_, batch_, want, seq_) : 0;
+                    pos_ = 0;
+                    left_ -= count_;
+                    if (count_ == 0) {
+                        out.printf("],\"seq_end\":%lu}", static_cast<unsigned long>(seq_));
+                        phase_ = 2;
+                        return true;
+                    }
+                }
+                {
+                    const EventLog::Entry& e = batch_[pos_++];
+                    char message[64];
+                    char source[16];
+                    EventLog::formatMessage(e, message, sizeof(message));
+                    EventLog::formatSource(e, source, sizeof(source));
+                    DynamicJsonDocument doc(384);
+                    doc["seq"] = e.seq;
+                    doc["ts_ms"] = e.ts_ms;
+                    doc["first_ms"] = e.first_ms;
+                    doc["count"] = e.count;
+                    doc["level"] = (int)e.level;
+                    doc["code"] = e.code;
+                    doc["message"] = message;
+                    doc["source"] = source;
+                    if (!isnan(e.arg)) doc["arg"] = e.arg;
+                    item(out, doc);
+                }
+                return true;
+            default:
+                return false;
+        }
     }
-    doc["seq_end"] = newSeq;
 
-    String out;
-    serializeJson(doc, out);
-    request->send(200, CT_APP_JSON, out);
-    delete[] buf;
-}
+private:
+    static constexpr uint32_t kBatch = 16;  // Entry : 28 octets
+    const EventLog* log_;
+    EventLog::Entry batch_[kBatch];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t seq_;
+    uint32_t left_;
+    uint8_t phase_ = 0;
+};
 
 void WiFiManager::handleApiEvents_(AsyncWebServerRequest* request) {
-    // Flux d'evenements (warnings/erreurs) pour l'UI.
+    // Flux d'evenements (warnings/erreurs) pour l'UI, envoye en flux.
     if (!events_) {
         request->send(503, CT_APP_JSON, "{\"error\":\"no_events\"}");
         return;
@@ -334,58 +1000,41 @@ void WiFiManager::handleApiEvents_(AsyncWebServerRequest* request) {
     uint32_t maxN = 50;
     if (request->hasParam("since")) since = request->getParam("since")->value().toInt();
     if (request->hasParam("max")) maxN = request->getParam("max")->value().toInt();
-    if (maxN > 200) maxN = 200;
+    // Au plus le ring buffer entier (eventlog.max_entries).
+    const uint32_t limit = CONF->GetCfg<CfgId::EventMax>();
+    if (maxN > limit) maxN = limit;
 
-    // Allocation temporaire (max 200 events).
-    EventLog::Entry* buf = new EventLog::Entry[maxN];
-    uint32_t newSeq = since;
-    size_t n = events_->getSince(since, buf, maxN, newSeq);
-
-    const size_t cap = 512 + (maxN * 96);
-    DynamicJsonDocument doc(cap);
-    JsonArray arr = doc.createNestedArray("events");
-    for (size_t i = 0; i < n; ++i) {
-        JsonObject o = arr.createNestedObject();
-        o["seq"] = buf[i].seq;
-        o["ts_ms"] = buf[i].ts_ms;
-        o["level"] = (int)buf[i].level;
-        o["code"] = buf[i].code;
-        o["message"] = buf[i].message;
-        o["source"] = buf[i].source;
-    }
-    doc["seq_end"] = newSeq;
-
-    String out;
-    serializeJson(doc, out);
-    request->send(200, CT_APP_JSON, out);
-    delete[] buf;
+    JsonStream::send(request, new EventsStream(events_, since, maxN));
 }
 
 void WiFiManager::handleApiConfigGet_(AsyncWebServerRequest* request) {
-    // Retourne un miroir de la config persistante (NVS) utile pour UI.
-    DynamicJsonDocument doc(512);
-
-    doc["limit_current_a"] = CONF->GetFloat(KEY_LIM_CUR, DEFAULT_LIMIT_CURRENT_A);
-    doc["ovc_mode"] = CONF->GetInt(KEY_OVC_MODE, 0);
-    doc["ovc_min_ms"] = CONF->GetUInt(KEY_OVC_MIN, DEFAULT_OVC_MIN_DURATION_MS);
-    doc["ovc_retry_ms"] = CONF->GetUInt(KEY_OVC_RTRY, DEFAULT_OVC_RETRY_DELAY_MS);
-
-    doc["temp_motor_c"] = CONF->GetFloat(KEY_TEMP_MOTOR, DEFAULT_TEMP_MOTOR_C);
-    doc["temp_board_c"] = CONF->GetFloat(KEY_TEMP_BOARD, DEFAULT_TEMP_BOARD_C);
-    doc["temp_ambient_c"] = CONF->GetFloat(KEY_TEMP_AMB, DEFAULT_TEMP_AMBIENT_C);
-    doc["temp_hyst_c"] = CONF->GetFloat(KEY_TEMP_HYST, DEFAULT_TEMP_HYST_C);
-    doc["latch_overtemp"] = CONF->GetBool(KEY_LATCH_TEMP, DEFAULT_LATCH_OVERTEMP);
-
-    doc["motor_vcc_v"] = CONF->GetFloat(KEY_MOTOR_VCC, DEFAULT_MOTOR_VCC_V);
-    doc["sampling_hz"] = CONF->GetUInt(KEY_SAMPLING_HZ, DEFAULT_SAMPLING_HZ);
-    doc["buzzer_enabled"] = CONF->GetBool(KEY_BUZZ_EN, DEFAULT_BUZZER_ENABLED);
-    doc["current_zero_mv"] = CONF->GetFloat(KEY_CUR_ZERO, DEFAULT_CURRENT_ZERO_MV);
-    doc["current_sens_mv_a"] = CONF->GetFloat(KEY_CUR_SENS, DEFAULT_CURRENT_SENS_MV_A);
-    doc["current_input_scale"] = CONF->GetFloat(KEY_CUR_SCALE, DEFAULT_CURRENT_INPUT_SCALE);
+    // Retourne un miroir de la config persistante, genere depuis le schema
+    // (classes Setting et ReadOnly ; Secret et Internal jamais renvoyes).
+    // Premier niveau : canal 0 pour les parametres par canal.
+    DynamicJsonDocument doc(768 + DEVICE_CHANNELS * 256);
+
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        if (p.cls != CfgClass::Setting && p.cls != CfgClass::ReadOnly) continue;
+        if (p.type == CfgType::String) {
+            doc[p.json] = CONF->GetCfgString(p.id);
+        } else {
+            cfgToJson(p.id, CONF->GetCfgValue(p.id, 0), doc[p.json]);
+        }
+    }
 
-    doc["wifi_mode"] = CONF->GetInt(KEY_WIFI_MODE, 0);
-    doc["sta_ssid"] = CONF->GetString(KEY_STA_SSID, "");
-    doc["ap_ssid"] = CONF->GetString(KEY_AP_SSID, DEFAULT_AP_SSID);
+    // Parametres par canal (cles NVS suffixees, canal 0 = cles historiques).
+    JsonArray chans = doc.createNestedArray("channels");
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        JsonObject o = chans.createNestedObject();
+        o["channel"] = ch;
+        for (size_t i = 0; i < CFG_COUNT; ++i) {
+            const CfgParam& p = kCfgSchema[i];
+            if (p.scope != CfgScope::Channel) continue;
+            if (p.cls != CfgClass::Setting && p.cls != CfgClass::ReadOnly) continue;
+            cfgToJson(p.id, CONF->GetCfgValue(p.id, ch), o[p.json]);
+        }
+    }
 
     String out;
     serializeJson(doc, out);
@@ -394,7 +1043,8 @@ void WiFiManager::handleApiConfigGet_(AsyncWebServerRequest* request) {
 
 void WiFiManager::handleApiConfigPost_(AsyncWebServerRequest* request, JsonVariant& json) {
     // Applique une mise a jour partielle de config.
-    // Seul Device ecrit la NVS : on appelle device->applyConfig().
+    // Chaque champ connu du schema (Setting / Secret) est valide ici ;
+    // seul Device ecrit la NVS : on appelle device->applyConfig().
     Device* device = DEVICE;
     if (!device) {
         request->send(500, CT_APP_JSON, "{\"error\":\"no_device\"}");
@@ -404,85 +1054,37 @@ void WiFiManager::handleApiConfigPost_(AsyncWebServerRequest* request, JsonVaria
     Device::ConfigUpdate cfg;
     JsonObject obj = json.as<JsonObject>();
 
-    if (obj.containsKey("limit_current_a")) {
-        cfg.hasLimitCurrent = true;
-        cfg.limitCurrentA = obj["limit_current_a"].as<float>();
-    }
-    if (obj.containsKey("ovc_mode")) {
-        cfg.hasOvcMode = true;
-        String mode = obj["ovc_mode"].as<String>();
-        mode.toLowerCase();
-        cfg.ovcMode = (mode == "auto") ? OvcMode::AutoRetry : OvcMode::Latch;
-    }
-    if (obj.containsKey("ovc_min_ms")) {
-        cfg.hasOvcMinMs = true;
-        cfg.ovcMinMs = obj["ovc_min_ms"].as<uint32_t>();
-    }
-    if (obj.containsKey("ovc_retry_ms")) {
-        cfg.hasOvcRetryMs = true;
-        cfg.ovcRetryMs = obj["ovc_retry_ms"].as<uint32_t>();
-    }
-
-    if (obj.containsKey("temp_motor_c")) {
-        cfg.hasTempMotor = true;
-        cfg.tempMotorC = obj["temp_motor_c"].as<float>();
-    }
-    if (obj.containsKey("temp_board_c")) {
-        cfg.hasTempBoard = true;
-        cfg.tempBoardC = obj["temp_board_c"].as<float>();
-    }
-    if (obj.containsKey("temp_ambient_c")) {
-        cfg.hasTempAmbient = true;
-        cfg.tempAmbientC = obj["temp_ambient_c"].as<float>();
-    }
-    if (obj.containsKey("temp_hyst_c")) {
-        cfg.hasTempHyst = true;
-        cfg.tempHystC = obj["temp_hyst_c"].as<float>();
-    }
-    if (obj.containsKey("latch_overtemp")) {
-        cfg.hasLatchOvertemp = true;
-        cfg.latchOvertemp = obj["latch_overtemp"].as<bool>();
-    }
-
-    if (obj.containsKey("motor_vcc_v")) {
-        cfg.hasMotorVcc = true;
-        cfg.motorVcc = obj["motor_vcc_v"].as<float>();
-    }
-    if (obj.containsKey("sampling_hz")) {
-        cfg.hasSamplingHz = true;
-        cfg.samplingHz = obj["sampling_hz"].as<uint32_t>();
-    }
-    if (obj.containsKey("buzzer_enabled")) {
-        cfg.hasBuzzerEnabled = true;
-        cfg.buzzerEnabled = obj["buzzer_enabled"].as<bool>();
+    // Parametres par canal : "channel" (absent = tous les canaux).
+    cfg.channel = channelParam_(obj["channel"], CHANNEL_ALL);
+
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        if (p.cls != CfgClass::Setting && p.cls != CfgClass::Secret) continue;
+        if (!obj.containsKey(p.json)) continue;
+
+        bool ok;
+        if (p.type == CfgType::String) {
+            String text;
+            ok = cfgFromJson(p.id, obj[p.json], text) && cfg.add(p.id, text);
+        } else {
+            CfgValue v;
+            ok = cfgFromJson(p.id, obj[p.json], v) && cfg.add(p.id, v);
+        }
+        if (!ok) {
+            DynamicJsonDocument err(128);
+            err["error"] = "bad_value";
+            err["field"] = p.json;
+            String out;
+            serializeJson(err, out);
+            request->send(400, CT_APP_JSON, out);
+            return;
+        }
     }
 
-    if (obj.containsKey("sta_ssid") || obj.containsKey("sta_pass")) {
-        cfg.hasWifiSta = true;
-        cfg.staSsid = obj.containsKey("sta_ssid")
-                        ? obj["sta_ssid"].as<String>()
-                        : CONF->GetString(KEY_STA_SSID, DEFAULT_STA_SSID);
-        cfg.staPass = obj.containsKey("sta_pass")
-                        ? obj["sta_pass"].as<String>()
-                        : CONF->GetString(KEY_STA_PASS, DEFAULT_STA_PASS);
-    }
-    if (obj.containsKey("ap_ssid") || obj.containsKey("ap_pass")) {
-        cfg.hasWifiAp = true;
-        cfg.apSsid = obj.containsKey("ap_ssid")
-                        ? obj["ap_ssid"].as<String>()
-                        : CONF->GetString(KEY_AP_SSID, DEFAULT_AP_SSID);
-        cfg.apPass = obj.containsKey("ap_pass")
-                        ? obj["ap_pass"].as<String>()
-                        : CONF->GetString(KEY_AP_PASS, DEFAULT_AP_PASS);
-    }
-    if (obj.containsKey("wifi_mode")) {
-        cfg.hasWifiMode = true;
-        String mode = obj["wifi_mode"].as<String>();
-        mode.toLowerCase();
-        cfg.wifiMode = (mode == "ap") ? WiFiModeSetting::Ap : WiFiModeSetting::Sta;
+    if (!device->applyConfig(cfg)) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_channel\"}");
+        return;
     }
-
-    device->applyConfig(cfg);
     device->notifyCommand();
 
     request->send(200, CT_APP_JSON, "{\"ok\":true}");
@@ -495,38 +1097,474 @@ void WiFiManager::handleApiControl_(AsyncWebServerRequest* request, JsonVariant&
     action.toLowerCase();
     DEBUG_PRINTLN(String("[HTTP] /api/control action: ") + action);
 
+    // wait_ms : attente max du resultat (0 = repondre des la mise en file).
+    uint32_t waitMs = obj["wait_ms"] | CMD_WAIT_DEFAULT_MS;
+    if (waitMs > CMD_WAIT_MAX_MS) waitMs = CMD_WAIT_MAX_MS;
+
+    // Canal vise (0 par defaut ; "all" pour stop / clear_fault).
+    const uint8_t ch = channelParam_(obj["channel"], 0);
+
     bool ok = false;
+    uint32_t id = 0;
     const bool isNoop = (action == "noop");
     DeviceTransport* transport = DEVTRAN;
     if (transport) {
-        if (action == "relay_on") ok = transport->setRelay(true);
-        else if (action == "relay_off") ok = transport->setRelay(false);
-        else if (action == "start") ok = transport->start();
-        else if (action == "stop") ok = transport->stop();
-        else if (action == "clear_fault") ok = transport->clearFault();
+        if (action == "relay_on") ok = transport->setRelay(ch, true, &id);
+        else if (action == "relay_off") ok = transport->setRelay(ch, false, &id);
+        else if (action == "start") ok = transport->start(ch, &id);
+        else if (action == "stop") ok = transport->stop(ch, &id);
+        else if (action == "clear_fault") ok = transport->clearFault(ch, &id);
         else if (action == "reset") ok = true;
     }
     if (isNoop) ok = true;
 
     if (ok && DEVICE && !isNoop && action != "reset") DEVICE->notifyCommand();
     if (!ok && !isNoop) BUZZ->playFailed();
-    request->send(200, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"ok\":false}");
+    sendCommandReply_(request, ok, id, waitMs);
 
     if (ok && action == "reset") {
         CONF->RestartSysDelay(1000);
     }
 }
 
+void WiFiManager::sendCommandReply_(AsyncWebServerRequest* request, bool ok, uint32_t id, uint32_t waitMs) {
+    // Sans id (noop/reset/refus avant file) : reponse historique.
+    if (id == 0) {
+        request->send(200, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"ok\":false}");
+        return;
+    }
+
+    // Attente bornee du resultat : la reponse embarque l'etat resultant et le
+    // seq snapshot, l'UI n'a plus besoin de relire /api/status.
+    Device::CommandResult r;
+    r.id = id;
+    r.status = ok ? Device::CommandResult::Status::Pending
+                  : Device::CommandResult::Status::Rejected;
+    DeviceTransport* transport = DEVTRAN;
+    if (ok && transport) transport->getResult(id, r);
+    if (ok && waitMs > 0 && r.status == Device::CommandResult::Status::Pending) {
+        sendResultDeferred_(request, true, id, waitMs);
+        return;
+    }
+
+    String out;
+    serializeResult_(true, ok, r, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiCommand_(AsyncWebServerRequest* request) {
+    // Poll du resultat d'une commande par id (/api/command?id=N[&wait_ms=M]).
+    if (!request->hasParam("id")) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"missing_id\"}");
+        return;
+    }
+    const uint32_t id = request->getParam("id")->value().toInt();
+    uint32_t waitMs = 0;
+    if (request->hasParam("wait_ms")) waitMs = request->getParam("wait_ms")->value().toInt();
+    if (waitMs > CMD_WAIT_MAX_MS) waitMs = CMD_WAIT_MAX_MS;
+
+    DeviceTransport* transport = DEVTRAN;
+    Device::CommandResult r;
+    const bool known = transport && transport->getResult(id, r);
+    if (!known) {
+        request->send(404, CT_APP_JSON, "{\"error\":\"unknown_id\"}");
+        return;
+    }
+    if (waitMs > 0 && r.status == Device::CommandResult::Status::Pending) {
+        sendResultDeferred_(request, false, id, waitMs);
+        return;
+    }
+
+    String out;
+    serializeResult_(false, true, r, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiDiagLatency_(AsyncWebServerRequest* request) {
+    // Latences commandes par type (us) : creation -> file -> actionnement,
+    // plus l'etat des voies de commandes (express / normale).
+    if (!DEVICE) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_device\"}");
+        return;
+    }
+
+    DynamicJsonDocument doc(1536);
+    JsonObject types = doc.createNestedObject("types");
+    for (uint8_t i = 0; i < Device::kCmdTypeCount; ++i) {
+        const auto type = static_cast<Device::Command::Type>(i);
+        Device::LatencySummary s;
+        if (!DEVICE->getLatency(type, s)) continue;
+
+        JsonObject o = types.createNestedObject(cmdTypeName_(type));
+        o["count"] = s.count;
+        o["queue_full"] = s.queue_full;
+        o["queue_p50_us"] = s.queue_p50_us;
+        o["queue_p99_us"] = s.queue_p99_us;
+        o["queue_max_us"] = s.queue_max_us;
+        o["total_p50_us"] = s.total_p50_us;
+        o["total_p99_us"] = s.total_p99_us;
+        o["total_max_us"] = s.total_max_us;
+    }
+
+    // Voies de commandes : profondeur courante/max et refus.
+    static const char* const kLaneNames[] = {"express", "normal"};
+    JsonObject lanes = doc.createNestedObject("lanes");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Device::Lane::Count); ++i) {
+        Device::LaneStats s;
+        if (!DEVICE->getLaneStats(static_cast<Device::Lane>(i), s)) continue;
+
+        JsonObject o = lanes.createNestedObject(kLaneNames[i]);
+        o["depth"] = s.depth;
+        o["capacity"] = s.capacity;
+        o["max_depth"] = s.max_depth;
+        o["accepted"] = s.accepted;
+        o["coalesced"] = s.coalesced;
+        o["dropped"] = s.dropped;
+        o["flushed"] = s.flushed;
+    }
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiDiagNvs_(AsyncWebServerRequest* request) {
+    // Usure NVS : debit d'ecriture, occupation de la partition, duree de
+    // vie estimee, puis les cles les plus ecrites.
+    NVS::WearStats w;
+    CONF->GetWearStats(w);
+
+    DynamicJsonDocument doc(3072);
+    doc["puts"] = w.puts;
+    doc["elided"] = w.elided;
+    doc["writes"] = w.writes;
+    doc["direct"] = w.direct;
+    doc["bytes"] = w.bytes;
+    doc["entries"] = w.entries;
+    doc["window_s"] = w.window_s;
+    doc["window_writes"] = w.window_writes;
+    doc["writes_per_h"] = w.writes_per_h;
+    doc["entries_per_h"] = w.entries_per_h;
+    doc["budget_per_key_h"] = NVS_WRITE_BUDGET_H;
+
+    if (w.part_ok) {
+        JsonObject part = doc.createNestedObject("partition");
+        part["used_entries"] = w.used_entries;
+        part["free_entries"] = w.free_entries;
+        part["total_entries"] = w.total_entries;
+        part["namespaces"] = w.namespaces;
+    }
+    if (w.endurance_years >= 0.0f) doc["endurance_years"] = w.endurance_years;
+    else doc["endurance_years"] = nullptr;
+
+    NVS::KeyWear keys[16];
+    const size_t n = CONF->GetKeyWear(keys, 16);
+    JsonArray arr = doc.createNestedArray("keys");
+    for (size_t i = 0; i < n; ++i) {
+        JsonObject o = arr.createNestedObject();
+        o["key"] = keys[i].key;
+        o["puts"] = keys[i].puts;
+        o["writes"] = keys[i].writes;
+        o["bytes"] = keys[i].bytes;
+        o["hour_writes"] = keys[i].hour_writes;
+        o["over_budget"] = keys[i].over_budget;
+    }
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+// Mesure d'un type d'operation du banc de stockage.
+static void benchOpJson_(JsonObject parent, const char* name, const Storage::OpStats& s) {
+    JsonObject o = parent.createNestedObject(name);
+    o["count"] = s.count;
+    o["avg_us"] = s.avg_us;
+    o["max_us"] = s.max_us;
+    o["failed"] = s.failed;
+}
+
+void WiFiManager::handleApiDiagStorageGet_(AsyncWebServerRequest* request) {
+    // Backend, occupation et dernier banc de mesure (POST pour le lancer).
+    Storage* st = STORAGE;
+    Storage::BenchResult b;
+    st->getBench(b);
+
+    DynamicJsonDocument doc(2560);
+    doc["backend"] = st->backendName();
+    doc["mounted"] = st->mounted();
+    doc["total_bytes"] = static_cast<uint32_t>(st->totalBytes());
+    doc["used_bytes"] = static_cast<uint32_t>(st->usedBytes());
+
+    Storage::MigrationInfo mig;
+    st->getMigration(mig);
+    JsonObject migration = doc.createNestedObject("migration");
+    migration["state"] = Storage::migrationName(mig.state);
+    migration["files"] = mig.files;
+    migration["written"] = mig.written;
+
+    JsonObject bench = doc.createNestedObject("bench");
+    bench["running"] = b.running;
+    bench["valid"] = b.valid;
+    if (b.valid) {
+        bench["age_s"] = (millis() - b.ts_ms) / 1000U;
+        bench["duration_ms"] = b.duration_ms;
+        benchOpJson_(bench, "open", b.open);
+        benchOpJson_(bench, "exists", b.exists);
+        benchOpJson_(bench, "append", b.append);
+        benchOpJson_(bench, "read", b.read);
+        benchOpJson_(bench, "rename", b.rename);
+        if (b.fill) {
+            benchOpJson_(bench, "fill_write", b.fill_write);
+            bench["fill_kb"] = b.fill_kb;
+        }
+    }
+
+    // Ecritures atomiques et reprise au boot par module.
+    Storage::AtomicStats a;
+    st->getAtomicStats(a);
+    JsonObject atomic = doc.createNestedObject("atomic");
+    atomic["commits"] = a.commits;
+    atomic["commit_failed"] = a.commit_failed;
+    atomic["loads"] = a.loads;
+    atomic["fallbacks"] = a.fallbacks;
+    atomic["load_failed"] = a.load_failed;
+    atomic["max_load_us"] = a.max_load_us;
+
+    Storage::Recovery rec[STORAGE_RECOVERY_SLOTS];
+    const size_t nRec = st->getRecovery(rec, STORAGE_RECOVERY_SLOTS);
+    uint32_t recTotal = 0;
+    JsonArray recovery = doc.createNestedArray("recovery");
+    for (size_t i = 0; i < nRec; ++i) {
+        JsonObject o = recovery.createNestedObject();
+        o["store"] = rec[i].store;
+        o["us"] = rec[i].us;
+        o["repaired"] = rec[i].repaired;
+        recTotal += rec[i].us;
+    }
+    doc["recovery_us"] = recTotal;
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiDiagPersist_(AsyncWebServerRequest* request) {
+    // Tache Persist : profondeur / abandons par voie, lots, durees flash.
+    Persist::Stats s;
+    PERSIST->getStats(s);
+
+    DynamicJsonDocument doc(1024);
+    doc["running"] = s.running;
+    doc["batches"] = s.batches;
+    doc["max_batch"] = s.max_batch;
+    doc["avg_us"] = s.avg_us;
+    doc["max_us"] = s.max_us;
+    doc["nvs_flushes"] = s.nvs_flushes;
+    doc["nvs_keys"] = s.nvs_keys;
+    doc["nvs_max_us"] = s.nvs_max_us;
+    doc["inline_writes"] = s.inline_writes;
+    doc["high_pending"] = s.high_pending;
+    doc["high_pending_max"] = s.high_pending_max;
+    doc["high_overflow"] = s.high_overflow;
+    doc["high_lost"] = s.high_lost;
+    doc["refused"] = s.refused;
+    doc["events_dropped"] = events_ ? events_->droppedCount() : 0;
+
+    static const char* const kLaneNames[] = {"high", "low"};
+    JsonObject lanes = doc.createNestedObject("lanes");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(Persist::Lane::Count); ++i) {
+        Persist::LaneStats l;
+        if (!PERSIST->getLaneStats(static_cast<Persist::Lane>(i), l)) continue;
+
+        JsonObject o = lanes.createNestedObject(kLaneNames[i]);
+        o["depth"] = l.depth;
+        o["capacity"] = l.capacity;
+        o["max_depth"] = l.max_depth;
+        o["accepted"] = l.accepted;
+        o["dropped"] = l.dropped;
+        o["written"] = l.written;
+    }
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiDiagArchive_(AsyncWebServerRequest* request) {
+    // TimeArchive : segments par resolution, octets / budget, ecritures.
+    TimeArchive::Stats s;
+    ARCHIVE->getStats(s);
+
+    DynamicJsonDocument doc(512);
+    doc["bytes"] = s.bytes;
+    doc["budget"] = s.budget;
+    doc["written"] = s.written;
+    doc["dropped"] = s.dropped;
+    doc["evicted"] = s.evicted;
+
+    static const char* const kResNames[] = {"minute", "hour"};
+    for (uint8_t r = 0; r < static_cast<uint8_t>(TimeArchive::Res::Count); ++r) {
+        JsonObject o = doc.createNestedObject(kResNames[r]);
+        o["segments"] = s.segments[r];
+        // Jours UTC (epoch / 86400) du plus ancien / recent segment.
+        o["first_day"] = s.first_day[r];
+        o["last_day"] = s.last_day[r];
+    }
+    doc["minute"]["retention_days"] = CONF->GetCfg<CfgId::ArchMinuteDays>();
+    doc["hour"]["retention_days"] = CONF->GetCfg<CfgId::ArchHourDays>();
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiDiagReset_(AsyncWebServerRequest* request, JsonVariant& json) {
+    // {"diag":"latency|nvs|persist|archive|live"} : compteurs remis a zero
+    // (mesure d'une fenetre : lire le GET, puis remettre a zero).
+    const String diag = json["diag"] | "";
+    if (diag == "latency" && DEVICE) {
+        DEVICE->resetLatency();
+    } else if (diag == "nvs") {
+        CONF->ResetWearStats();
+    } else if (diag == "persist") {
+        PERSIST->resetStats();
+    } else if (diag == "archive") {
+        ARCHIVE->resetStats();
+    } else if (diag == "live") {
+        // Tache AsyncTCP : meme verrou que /api/diag/live.
+        if (!liveMutex_ || xSemaphoreTakeRecursive(liveMutex_, pdMS_TO_TICKS(100)) != pdTRUE) {
+            request->send(503, CT_APP_JSON, "{\"error\":\"busy\"}");
+            return;
+        }
+        liveStats_ = LiveStats();
+        liveDeferred_ = 0;
+        xSemaphoreGiveRecursive(liveMutex_);
+    } else {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_diag\"}");
+        return;
+    }
+    request->send(200, CT_APP_JSON, "{\"ok\":true}");
+}
+
+void WiFiManager::handleApiDiagStoragePost_(AsyncWebServerRequest* request, JsonVariant& json) {
+    // {"fill":true} : remplit aussi la partition (pire pause, plus long).
+    const bool fill = json["fill"] | false;
+    if (!STORAGE->startBench(fill)) {
+        request->send(409, CT_APP_JSON, "{\"error\":\"busy\"}");
+        return;
+    }
+    request->send(202, CT_APP_JSON, "{\"ok\":true}");
+}
+
+void WiFiManager::handleApiScheduleGet_(AsyncWebServerRequest* request) {
+    // Regles de marche recurrentes + prochaine echeance.
+    RunScheduler* sched = SCHED;
+    if (!sched) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_scheduler\"}");
+        return;
+    }
+
+    RunScheduler::Rule rules[SCHED_MAX_RULES];
+    uint32_t next[SCHED_MAX_RULES];
+    const uint8_t n = sched->getRules(rules, next, SCHED_MAX_RULES);
+
+    DynamicJsonDocument doc(512 + n * 160);
+    doc["now"] = rtc_ ? rtc_->getUnixTime() : 0;
+    doc["fired"] = sched->firedCount();
+    doc["skipped"] = sched->skippedCount();
+    JsonArray arr = doc.createNestedArray("rules");
+    for (uint8_t i = 0; i < n; ++i) {
+        JsonObject o = arr.createNestedObject();
+        o["id"] = rules[i].id;
+        o["enabled"] = rules[i].enabled != 0;
+        o["days"] = rules[i].days;
+        o["start"] = minToHhmm_(rules[i].start_min);
+        o["end"] = minToHhmm_(rules[i].end_min);
+        o["every_min"] = rules[i].period_min;
+        o["duration_s"] = rules[i].duration_s;
+        o["channel"] = rules[i].channel;
+        o["next_epoch"] = next[i];
+    }
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+void WiFiManager::handleApiSchedulePost_(AsyncWebServerRequest* request, JsonVariant& json) {
+    // Actions : set (ajout / modification par id) et delete.
+    RunScheduler* sched = SCHED;
+    if (!sched) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_scheduler\"}");
+        return;
+    }
+
+    JsonObject obj = json.as<JsonObject>();
+    String action = obj["action"] | "";
+
+    if (action == "delete") {
+        const uint8_t id = obj["id"] | 0;
+        const bool ok = sched->removeRule(id);
+        request->send(ok ? 200 : 404, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"error\":\"unknown_id\"}");
+        return;
+    }
+    if (action != "set") {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_action\"}");
+        return;
+    }
+
+    RunScheduler::Rule r;
+    r.id = obj["id"] | 0;
+    r.enabled = (obj["enabled"] | true) ? 1 : 0;
+    r.days = obj["days"] | 0x7F;
+    const int startMin = hhmmToMin_(obj["start"] | "");
+    const int endMin = obj.containsKey("end") ? hhmmToMin_(obj["end"] | "") : startMin;
+    // Lus en 32 bits : une valeur hors du champ (u16 / u8) est refusee,
+    // pas tronquee.
+    const uint32_t periodMin = obj["every_min"] | 0;
+    const uint32_t durationS = obj["duration_s"] | 0;
+    const uint32_t channel = obj["channel"] | 0;
+    if (startMin < 0 || endMin < 0) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_time\"}");
+        return;
+    }
+    if (periodMin > UINT16_MAX || durationS > UINT16_MAX || channel > UINT8_MAX) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"invalid_rule\"}");
+        return;
+    }
+    r.period_min = static_cast<uint16_t>(periodMin);
+    r.duration_s = static_cast<uint16_t>(durationS);
+    r.channel = static_cast<uint8_t>(channel);
+    r.start_min = static_cast<uint16_t>(startMin);
+    r.end_min = static_cast<uint16_t>(endMin);
+
+    if (!sched->setRule(r)) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"invalid_rule\"}");
+        return;
+    }
+
+    DynamicJsonDocument doc(64);
+    doc["ok"] = true;
+    doc["id"] = r.id;
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
 void WiFiManager::handleApiCalibrate_(AsyncWebServerRequest* request, JsonVariant& json) {
     // Calibration capteur courant (zero + parametres).
     JsonObject obj = json.as<JsonObject>();
     String action = obj["action"] | "";
     action.toLowerCase();
 
+    // Capteur du canal vise (0 par defaut).
+    const uint8_t ch = channelParam_(obj["channel"], 0);
+
     if (action == "current_zero") {
-        if (DEVICE) DEVICE->calibrateCurrentZero();
-        if (DEVICE) DEVICE->notifyCommand();
-        request->send(200, CT_APP_JSON, "{\"ok\":true}");
+        const bool ok = DEVICE && DEVICE->calibrateCurrentZero(ch);
+        if (ok) DEVICE->notifyCommand();
+        request->send(ok ? 200 : 400, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"error\":\"bad_channel\"}");
         return;
     }
 
@@ -534,9 +1572,9 @@ void WiFiManager::handleApiCalibrate_(AsyncWebServerRequest* request, JsonVarian
         float zeroMv = obj["zero_mv"] | DEFAULT_CURRENT_ZERO_MV;
         float sensMv = obj["sens_mv_a"] | DEFAULT_CURRENT_SENS_MV_A;
         float scale = obj["input_scale"] | DEFAULT_CURRENT_INPUT_SCALE;
-        if (DEVICE) DEVICE->setCurrentCalibration(zeroMv, sensMv, scale);
-        if (DEVICE) DEVICE->notifyCommand();
-        request->send(200, CT_APP_JSON, "{\"ok\":true}");
+        const bool ok = DEVICE && DEVICE->setCurrentCalibration(ch, zeroMv, sensMv, scale);
+        if (ok) DEVICE->notifyCommand();
+        request->send(ok ? 200 : 400, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"error\":\"bad_channel\"}");
         return;
     }
 
@@ -579,39 +1617,916 @@ void WiFiManager::handleApiRtc_(AsyncWebServerRequest* request, JsonVariant& jso
 void WiFiManager::handleApiRunTimer_(AsyncWebServerRequest* request, JsonVariant& json) {
     // Marche temporisee (secondes).
     uint32_t seconds = json["seconds"] | 0;
+    uint32_t waitMs = json["wait_ms"] | CMD_WAIT_DEFAULT_MS;
+    if (waitMs > CMD_WAIT_MAX_MS) waitMs = CMD_WAIT_MAX_MS;
+    const uint8_t ch = channelParam_(json["channel"], 0);
+    uint32_t id = 0;
     DeviceTransport* transport = DEVTRAN;
-    bool ok = transport ? transport->timedRun(seconds) : false;
+    bool ok = transport ? transport->timedRun(ch, seconds, &id) : false;
     if (ok && DEVICE) DEVICE->notifyCommand();
-    request->send(200, CT_APP_JSON, ok ? "{\"ok\":true}" : "{\"ok\":false}");
+    sendCommandReply_(request, ok, id, waitMs);
 }
 
+// Flux /api/sessions : sessions lues par lots (fichier), plus recente d'abord.
+class SessionsStream : public JsonStream {
+public:
+    SessionsStream(const SessionHistory* sessions, uint32_t first, uint32_t last,
+                   uint32_t lo, uint32_t hi, uint32_t maxN, uint32_t from, uint32_t to)
+        : sessions_(sessions), firstSeq_(first), lastSeq_(last), lo_(lo), scan_(hi), cursor_(hi),
+          left_(maxN), from_(from), to_(to) {
+        // Profils conserves : copie unique (pas de PROFILES->find par ligne).
+        nProfiles_ = PROFILES ? PROFILES->list(profiles_, PROFILE_MAX_FILES) : 0;
+    }
+
+protected:
+    bool next(Print& out) override {
+        switch (phase_) {
+            case 0:
+                out.printf("{\"total\":%lu,\"seq_first\":%lu,\"seq_end\":%lu,\"sessions\":[",
+                           static_cast<unsigned long>((lastSeq_ >= firstSeq_ && firstSeq_) ? lastSeq_ - firstSeq_ + 1 : 0),
+                           static_cast<unsigned long>(firstSeq_), static_cast<unsigned long>(lastSeq_));
+                phase_ = 1;
+                return true;
+            case 1:
+                for (uint32_t scanned = 0;; ++scanned) {
+                    // Filtre tres selectif : reprise au rappel suivant.
+                    if (scanned >= JSON_STREAM_SCAN_MAX) return true;
+                    if (left_ > 0 && pos_ == count_) {
+                        // Lot suivant (plus ancien), jusqu'a la borne lo_.
+                        count_ = (scan_ > lo_) ? sessions_->getBefore(scan_, batch_, JSON_STREAM_BATCH) : 0;
+                        pos_ = 0;
+                        if (count_ == 0) cursor_ = lo_;  // tout parcouru
+                        else scan_ = batch_[count_ - 1].seq;
+                    }
+                    if (left_ == 0 || count_ == 0) {
+                        out.print("]");
+                        // Page suivante (plus ancienne) : before=next_before.
+                        if (read_ && cursor_ > lo_) {
+                            out.printf(",\"next_before\":%lu", static_cast<unsigned long>(cursor_));
+                        }
+                        out.print("}");
+                        phase_ = 2;
+                        return true;
+                    }
+                    const SessionHistory::Entry& e = batch_[pos_++];
+                    if (e.seq < lo_) {
+                        pos_ = count_;
+                        scan_ = lo_;
+                        continue;
+                    }
+                    // Ordre d'ajout = ordre de fin : filtre sur la date de debut.
+                    if (!SessionHistory::startsIn(e, from_, to_)) continue;
+                    left_--;
+                    DynamicJsonDocument doc(384);
+                    doc["seq"] = e.seq;
+                    doc["start_epoch"] = e.start_epoch;
+                    doc["end_epoch"] = e.end_epoch;
+                    doc["duration_s"] = e.duration_s;
+                    doc["energy_wh"] = e.energy_wh;
+                    doc["peak_power_w"] = e.peak_power_w;
+                    doc["peak_current_a"] = e.peak_current_a;
+                    doc["success"] = e.success;
+                    doc["last_error"] = e.last_error;
+                    doc["channel"] = e.channel;
+                    // Courbe de la session (/api/session_profile?id=), si conservee.
+                    const SessionProfile::Info* info = findProfile_(e.channel, e.start_epoch);
+                    if (info) doc["profile"] = info->id;
+                    cursor_ = e.seq;
+                    read_ = true;
+                    item(out, doc);
+                    return true;
+                }
+            default:
+                return false;
+        }
+    }
+
+private:
+    const SessionProfile::Info* findProfile_(uint8_t ch, uint32_t startEpoch) const {
+        // Debut inconnu (RTC invalide) : pas de correspondance fiable.
+        if (startEpoch == 0) return nullptr;
+        for (size_t i = 0; i < nProfiles_; ++i) {
+            if (profiles_[i].channel == ch && profiles_[i].start_epoch == startEpoch) return &profiles_[i];
+        }
+        return nullptr;
+    }
+
+    const SessionHistory* sessions_;
+    SessionHistory::Entry batch_[JSON_STREAM_BATCH];
+    SessionProfile::Info profiles_[PROFILE_MAX_FILES];
+    size_t nProfiles_ = 0;
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t firstSeq_;
+    uint32_t lastSeq_;
+    uint32_t lo_;
+    uint32_t scan_;      // prochaine lecture : sequences < scan_
+    uint32_t cursor_;    // derniere session ecrite (next_before)
+    uint32_t left_;
+    uint32_t from_;
+    uint32_t to_;
+    bool read_ = false;
+    uint8_t phase_ = 0;
+};
+
 void WiFiManager::handleApiSessions_(AsyncWebServerRequest* request) {
-    // Historique des sessions (SPIFFS -> RAM -> JSON).
+    // Historique des sessions (SPIFFS -> JSON en flux), du plus recent au
+    // plus ancien, au plus max (session_max). Filtres cumulables :
+    // - since=SEQ : sessions plus recentes que SEQ (rien si rien de neuf) ;
+    // - before=SEQ : curseur de page (next_before de la reponse precedente) ;
+    // - from=&to= (epoch) : sessions commencees dans [from, to[.
     if (!sessions_) {
         request->send(503, CT_APP_JSON, "{\"error\":\"no_sessions\"}");
         return;
     }
 
-    const uint16_t count = sessions_->getCount();
-    const size_t cap = 512 + (count * 96);
-    DynamicJsonDocument doc(cap);
-    JsonArray arr = doc.createNestedArray("sessions");
+    uint32_t firstSeq = 0;
+    uint32_t lastSeq = 0;
+    sessions_->getSeqRange(firstSeq, lastSeq);
 
-    for (uint16_t i = 0; i < count; ++i) {
-        SessionHistory::Entry e;
-        if (!sessions_->getEntry(i, e)) continue;
+    // Sequences retenues : [lo, hi[.
+    uint32_t lo = firstSeq;
+    uint32_t hi = lastSeq + 1;
+    if (request->hasParam("since")) {
+        const uint32_t since = static_cast<uint32_t>(request->getParam("since")->value().toInt());
+        if (since + 1 > lo) lo = since + 1;
+    }
+    if (request->hasParam("before")) {
+        const uint32_t before = static_cast<uint32_t>(request->getParam("before")->value().toInt());
+        if (before < hi) hi = before;
+    }
+    // from / to : fenetre sur la date de debut, filtree par le flux ; from
+    // borne aussi les sequences (seqFrom). Pas de borne pour to : une
+    // session commencee avant peut avoir ete ajoutee (finie) bien apres.
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    if (request->hasParam("from")) {
+        from = static_cast<uint32_t>(request->getParam("from")->value().toInt());
+        const uint32_t s = sessions_->seqFrom(from);
+        if (s > lo) lo = s;
+    }
+    if (request->hasParam("to")) to = static_cast<uint32_t>(request->getParam("to")->value().toInt());
+    const uint32_t limit = CONF->GetCfg<CfgId::SessMax>();
+    uint32_t maxN = limit;
+    if (request->hasParam("max")) maxN = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+    if (maxN == 0 || maxN > limit) maxN = limit;
+    if (hi <= lo || !firstSeq) maxN = 0;
+
+    JsonStream::send(request, new SessionsStream(sessions_, firstSeq, lastSeq, lo, hi, maxN, from, to));
+}
+
+void WiFiManager::handleApiSessionStats_(AsyncWebServerRequest* request) {
+    // Agregats de sessions par jour / semaine / mois (tenus a jour a chaque
+    // ajout, aucune lecture fichier), du plus recent au plus ancien.
+    if (!sessions_) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_sessions\"}");
+        return;
+    }
+
+    SessionHistory::Period period = SessionHistory::Period::Day;
+    const char* name = "day";
+    if (request->hasParam("period")) {
+        const String p = request->getParam("period")->value();
+        if (p == "week") {
+            period = SessionHistory::Period::Week;
+            name = "week";
+        } else if (p == "month") {
+            period = SessionHistory::Period::Month;
+            name = "month";
+        } else if (p != "day") {
+            request->send(400, CT_APP_JSON, "{\"error\":\"bad_period\"}");
+            return;
+        }
+    }
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint32_t maxN = 31;
+    if (request->hasParam("from")) from = static_cast<uint32_t>(request->getParam("from")->value().toInt());
+    if (request->hasParam("to")) to = static_cast<uint32_t>(request->getParam("to")->value().toInt());
+    if (request->hasParam("max")) maxN = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+    if (maxN == 0 || maxN > SESS_AGG_DAYS) maxN = SESS_AGG_DAYS;
+
+    SessionHistory::Aggregate* buf = new SessionHistory::Aggregate[maxN];
+    uint32_t undated = 0;
+    const size_t n = sessions_->getAggregates(period, from, to, buf, maxN, undated);
+
+    DynamicJsonDocument doc(256 + n * 112);
+    doc["period"] = name;
+    doc["undated"] = undated;
+    JsonArray arr = doc.createNestedArray("buckets");
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t y;
+        uint8_t m, d;
+        SessionHistory::dateOf(buf[i].day, y, m, d);
+        char date[11];
+        snprintf(date, sizeof(date), "%04u-%02u-%02u", static_cast<unsigned>(y), static_cast<unsigned>(m),
+                 static_cast<unsigned>(d));
         JsonObject o = arr.createNestedObject();
-        o["start_epoch"] = e.start_epoch;
-        o["end_epoch"] = e.end_epoch;
-        o["duration_s"] = e.duration_s;
-        o["energy_wh"] = e.energy_wh;
-        o["peak_power_w"] = e.peak_power_w;
-        o["peak_current_a"] = e.peak_current_a;
-        o["success"] = e.success;
-        o["last_error"] = e.last_error;
+        o["date"] = date;
+        o["sessions"] = buf[i].sessions;
+        o["faults"] = buf[i].faults;
+        o["run_s"] = buf[i].run_s;
+        o["energy_wh"] = buf[i].energy_wh;
     }
+    delete[] buf;
 
     String out;
     serializeJson(doc, out);
     request->send(200, CT_APP_JSON, out);
 }
+
+void WiFiManager::handleApiSessionProfile_(AsyncWebServerRequest* request) {
+    // Courbe d'une session : ?id= (ou ?channel=&start=<epoch>), points
+    // regroupes par ?step= (secondes), a partir de ?offset=, au plus ?max=.
+    // Sans identifiant : liste des profils conserves.
+    SessionProfile* prof = PROFILES;
+    SessionProfile::Info info;
+    bool found = false;
+    if (request->hasParam("id")) {
+        found = prof->getInfo(static_cast<uint32_t>(request->getParam("id")->value().toInt()), info);
+    } else if (request->hasParam("start")) {
+        const uint8_t ch = request->hasParam("channel")
+                               ? static_cast<uint8_t>(request->getParam("channel")->value().toInt()) : 0;
+        found = prof->find(ch, static_cast<uint32_t>(request->getParam("start")->value().toInt()), info);
+    } else {
+        SessionProfile::Info list[PROFILE_MAX_FILES];
+        const size_t n = prof->list(list, PROFILE_MAX_FILES);
+        DynamicJsonDocument doc(256 + n * 96);
+        JsonArray arr = doc.createNestedArray("profiles");
+        for (size_t i = 0; i < n; ++i) {
+            JsonObject o = arr.createNestedObject();
+            o["id"] = list[i].id;
+            o["channel"] = list[i].channel;
+            o["start_epoch"] = list[i].start_epoch;
+            o["bytes"] = list[i].bytes;
+        }
+        String out;
+        serializeJson(doc, out);
+        request->send(200, CT_APP_JSON, out);
+        return;
+    }
+    if (!found) {
+        request->send(404, CT_APP_JSON, "{\"error\":\"not_found\"}");
+        return;
+    }
+
+    uint32_t offset = 0;
+    uint32_t step = 1;
+    uint32_t maxPts = PROFILE_API_MAX_POINTS;
+    if (request->hasParam("offset")) offset = static_cast<uint32_t>(request->getParam("offset")->value().toInt());
+    if (request->hasParam("step")) step = static_cast<uint32_t>(request->getParam("step")->value().toInt());
+    if (request->hasParam("max")) maxPts = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+    if (step < 1) step = 1;
+    if (step > 3600) step = 3600;
+    if (maxPts < 1 || maxPts > PROFILE_API_MAX_POINTS) maxPts = PROFILE_API_MAX_POINTS;
+
+    SessionProfile::Point* pts = new SessionProfile::Point[maxPts];
+    size_t n = 0;
+    uint32_t total = 0;
+    const bool ok = prof->read(info.id, offset, static_cast<uint16_t>(step), pts, maxPts, n, total);
+    if (!ok) {
+        delete[] pts;
+        request->send(404, CT_APP_JSON, "{\"error\":\"not_found\"}");
+        return;
+    }
+
+    // [courant min, moyen, max (A), temperature moteur (C)] par point.
+    DynamicJsonDocument doc(512 + n * 96);
+    doc["id"] = info.id;
+    doc["channel"] = info.channel;
+    doc["start_epoch"] = info.start_epoch;
+    doc["period_s"] = (PROFILE_PERIOD_MS * step) / 1000U;
+    doc["offset"] = offset;
+    doc["total"] = total;
+    JsonArray arr = doc.createNestedArray("points");
+    for (size_t i = 0; i < n; ++i) {
+        JsonArray p = arr.createNestedArray();
+        p.add(pts[i].current_min);
+        p.add(pts[i].current_mean);
+        p.add(pts[i].current_max);
+        p.add(pts[i].motor_c);
+    }
+    delete[] pts;
+
+    String out;
+    serializeJson(doc, out);
+    request->send(200, CT_APP_JSON, out);
+}
+
+// Flux /api/archive : cumuls lus par lots dans les segments du jour.
+class ArchiveStream : public JsonStream {
+public:
+    ArchiveStream(TimeArchive::Res res, uint8_t ch, uint32_t from, uint32_t to, uint32_t maxN)
+        : res_(res), ch_(ch), cursor_(from), to_(to), left_(maxN) {}
+
+protected:
+    bool next(Print& out) override {
+        switch (phase_) {
+            case 0:
+                out.printf("{\"res\":\"%s\",\"ch\":%u,\"period_s\":%lu,\"rollups\":[",
+                           (res_ == TimeArchive::Res::Hour) ? "hour" : "minute",
+                           static_cast<unsigned>(ch_),
+                           static_cast<unsigned long>((res_ == TimeArchive::Res::Hour) ? 3600UL : 60UL));
+                phase_ = 1;
+                return true;
+            case 1:
+                if (pos_ == count_) {
+                    const uint32_t want = (left_ < kBatch) ? left_ : kBatch;
+                    uint32_t resume = 0;
+                    count_ = (want && cursor_) ? ARCHIVE->query(res_, ch_, cursor_, to_, batch_, want, resume) : 0;
+                    pos_ = 0;
+                    left_ -= count_;
+                    if (count_ == 0) {
+                        if (want) cursor_ = 0;
+                        // next : from de la requete suivante (0 : tout est lu).
+                        out.printf("],\"next\":%lu}", static_cast<unsigned long>(cursor_));
+                        phase_ = 2;
+                        return true;
+                    }
+                    cursor_ = resume;
+                }
+                {
+                    const TimeArchive::Rollup& r = batch_[pos_++];
+                    DynamicJsonDocument doc(384);
+                    doc["t"] = r.t;
+                    doc["cov"] = r.coverage;
+                    doc["i_min"] = r.current_min;
+                    doc["i_mean"] = r.current_mean;
+                    doc["i_max"] = r.current_max;
+                    doc["wh"] = r.energy_wh;
+                    if (!isnan(r.motor_c)) doc["motor_c"] = r.motor_c;
+                    if (!isnan(r.board_c)) doc["board_c"] = r.board_c;
+                    doc["duty"] = r.duty;
+                    item(out, doc);
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    static constexpr uint32_t kBatch = 32;  // Rollup : 40 octets
+    TimeArchive::Rollup batch_[kBatch];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    TimeArchive::Res res_;
+    uint8_t ch_;
+    uint32_t cursor_;          // 0 : plus rien a lire
+    uint32_t to_;
+    uint32_t left_;
+    uint8_t phase_ = 0;
+};
+
+void WiFiManager::handleApiArchive_(AsyncWebServerRequest* request) {
+    // Cumuls longue duree : ?res=minute|hour, ?ch=, ?from= / ?to= (epoch,
+    // defaut : 6 h de minutes ou 7 jours d'heures jusqu'a maintenant),
+    // au plus ?max= ; reprise avec from = next.
+    TimeArchive::Res res = TimeArchive::Res::Minute;
+    if (request->hasParam("res")) {
+        const String r = request->getParam("res")->value();
+        if (r == "hour") {
+            res = TimeArchive::Res::Hour;
+        } else if (r != "minute") {
+            request->send(400, CT_APP_JSON, "{\"error\":\"bad_res\"}");
+            return;
+        }
+    }
+
+    uint32_t ch = 0;
+    if (request->hasParam("ch")) ch = request->getParam("ch")->value().toInt();
+    if (ch >= DEVICE_CHANNELS) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_channel\"}");
+        return;
+    }
+
+    const uint32_t now = static_cast<uint32_t>(rtc_ ? rtc_->getUnixTime() : 0);
+    uint32_t to = now;
+    if (request->hasParam("to")) to = static_cast<uint32_t>(request->getParam("to")->value().toInt());
+    const uint32_t span = (res == TimeArchive::Res::Hour) ? 7UL * 86400UL : 6UL * 3600UL;
+    uint32_t from = (to > span) ? to - span : 0;
+    if (request->hasParam("from")) from = static_cast<uint32_t>(request->getParam("from")->value().toInt());
+    if (from < ARCHIVE_MIN_EPOCH) from = ARCHIVE_MIN_EPOCH;
+    if (to < from) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_range\"}");
+        return;
+    }
+
+    uint32_t maxN = ARCHIVE_API_MAX_POINTS;
+    if (request->hasParam("max")) maxN = request->getParam("max")->value().toInt();
+    if (maxN < 1 || maxN > ARCHIVE_API_MAX_POINTS) maxN = ARCHIVE_API_MAX_POINTS;
+
+    JsonStream::send(request, new ArchiveStream(res, static_cast<uint8_t>(ch), from, to, maxN));
+}
+
+// Type d'un fichier persistant telechargeable (nullptr : non expose, ex.
+// UI web, temporaires "~" / ".tmp" / ".bak"). name avec ou sans '/'.
+static const char* downloadKind(const char* name, const SessionHistory* sessions,
+                                const EventLog* events) {
+    if (name[0] == '/') name++;
+    auto same = [name](const char* path) {
+        if (path[0] == '/') path++;
+        return strcmp(name, path) == 0;
+    };
+    // "<base>.<nombre>" (segments, profils, archive).
+    auto numbered = [name](const char* base) {
+        if (base[0] == '/') base++;
+        const size_t n = strlen(base);
+        if (strncmp(name, base, n) != 0 || name[n] != '.' || name[n + 1] == 0) return false;
+        for (const char* p = name + n + 1; *p; ++p) {
+            if (*p < '0' || *p > '9') return false;
+        }
+        return true;
+    };
+
+    if (sessions && (same(sessions->currentPath().c_str()) || same(sessions->oldPath().c_str()))) {
+        return "sessions";
+    }
+    if (events && numbered(events->segmentBase().c_str())) return "events";
+    if (numbered(PROFILE_FILE_BASE)) return "profile";
+    if (numbered(ARCHIVE_MINUTE_BASE)) return "archive_minute";
+    if (numbered(ARCHIVE_HOUR_BASE)) return "archive_hour";
+    if (same(POWERTRACKER_HISTORY_FILE)) return "power";
+    return nullptr;
+}
+
+// Flux /api/files : parcours du repertoire, un fichier par morceau.
+class FilesStream : public JsonStream {
+public:
+    FilesStream(const SessionHistory* sessions, const EventLog* events)
+        : sessions_(sessions), events_(events) {}
+
+protected:
+    bool next(Print& out) override {
+        switch (phase_) {
+            case 0:
+                out.print("{\"files\":[");
+                dir_ = STORAGE->open("/");
+                phase_ = 1;
+                return true;
+            case 1:
+                for (File f = dir_ ? dir_.openNextFile() : File(); f; f = dir_.openNextFile()) {
+                    const char* kind = downloadKind(f.name(), sessions_, events_);
+                    if (!kind) continue;
+                    const char* name = f.name();
+                    if (name[0] == '/') name++;
+                    DynamicJsonDocument doc(192);
+                    doc["name"] = name;
+                    doc["kind"] = kind;
+                    doc["size"] = static_cast<uint32_t>(f.size());
+                    item(out, doc);
+                    return true;
+                }
+                if (dir_) dir_.close();
+                out.print("]}");
+                phase_ = 2;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    const SessionHistory* sessions_;
+    const EventLog* events_;
+    File dir_;
+    uint8_t phase_ = 0;
+};
+
+void WiFiManager::handleApiFiles_(AsyncWebServerRequest* request) {
+    // Fichiers telechargeables (name, kind, size), envoyes en flux.
+    JsonStream::send(request, new FilesStream(sessions_, events_));
+}
+
+void WiFiManager::handleApiDownload_(AsyncWebServerRequest* request) {
+    // Fichier binaire ?name= (voir /api/files), avec Range / ETag.
+    if (!request->hasParam("name")) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"missing_name\"}");
+        return;
+    }
+    const String& name = request->getParam("name")->value();
+    if (name.length() > 32 || !downloadKind(name.c_str(), sessions_, events_)) {
+        request->send(404, CT_APP_JSON, "{\"error\":\"not_found\"}");
+        return;
+    }
+    char path[40];
+    snprintf(path, sizeof(path), "%s%s", name.c_str()[0] == '/' ? "" : "/", name.c_str());
+    FileDownload::send(request, path);
+}
+
+// -----------------------------------------------------------------------------
+// Export CSV (/api/export/*) : une ligne par appel de next(), lots lus
+// dans la source comme les flux JSON.
+// -----------------------------------------------------------------------------
+static const char* const kHistoryCols[] = {"seq", "ts_ms", "current_a", "motor_c", "bme_c", "bme_pa"};
+
+class HistoryCsv : public CsvStream {
+public:
+    HistoryCsv(uint32_t since, uint32_t maxN, uint8_t ch, uint32_t fromMs, uint32_t toMs)
+        : CsvStream(kHistoryCols, sizeof(kHistoryCols) / sizeof(kHistoryCols[0])),
+          seq_(since), left_(maxN), fromMs_(fromMs), toMs_(toMs), ch_(ch) {}
+
+protected:
+    bool next(Print& out) override {
+        if (!headerDone_) {
+            header(out);
+            headerDone_ = true;
+            return true;
+        }
+        for (uint32_t scanned = 0;; ++scanned) {
+            // max : lignes ecrites ; au plus un ring buffer parcouru (les
+            // echantillons arrivent pendant l'envoi).
+            if (left_ == 0) return false;
+            // Filtre from_ms : reprise au rappel suivant.
+            if (scanned >= JSON_STREAM_SCAN_MAX) return true;
+            if (pos_ == count_) {
+                const uint32_t want = (scan_ < JSON_STREAM_BATCH) ? scan_ : JSON_STREAM_BATCH;
+                count_ = want ? BUS_SAMPLER->getHistorySince(seq_, batch_, want, seq_) : 0;
+                pos_ = 0;
+                scan_ -= count_;
+                if (count_ == 0) return false;
+            }
+            // seq_ pointe apres le lot : numero de l'echantillon pos_.
+            const uint32_t seq = seq_ - static_cast<uint32_t>(count_ - pos_);
+            const BusSampler::Sample& e = batch_[pos_++];
+            if (e.ts_ms > toMs_) return false;  // ts_ms croissant
+            if (e.ts_ms < fromMs_) continue;
+            left_--;
+            for (uint8_t i = 0; i < nCols_; ++i) {
+                switch (cols_[i]) {
+                    case 0: row_.u32(seq); break;
+                    case 1: row_.u32(e.ts_ms); break;
+                    case 2: row_.fixed(e.current_a[ch_], 3); break;
+                    case 3: row_.fixed(e.motor_c[ch_], 2); break;
+                    case 4: row_.fixed(e.bme_c, 2); break;
+                    default: row_.fixed(e.bme_pa, 0); break;
+                }
+            }
+            row_.end(out);
+            return true;
+        }
+    }
+
+private:
+    BusSampler::Sample batch_[JSON_STREAM_BATCH];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t seq_;
+    uint32_t left_;
+    uint32_t scan_ = BUS_SAMPLER_HISTORY_SIZE;
+    uint32_t fromMs_;
+    uint32_t toMs_;
+    uint8_t ch_;
+    bool headerDone_ = false;
+};
+
+static const char* const kArchiveCols[] = {"t", "coverage", "current_min", "current_mean", "current_max",
+                                           "energy_wh", "motor_c", "board_c", "duty"};
+
+// Historique persistant (?res=minute|hour) : cumuls TimeArchive lus par le
+// meme curseur que /api/archive (query + reprise), sans limite de page.
+class ArchiveCsv : public CsvStream {
+public:
+    ArchiveCsv(TimeArchive::Res res, uint8_t ch, uint32_t from, uint32_t to, uint32_t maxN)
+        : CsvStream(kArchiveCols, sizeof(kArchiveCols) / sizeof(kArchiveCols[0])),
+          res_(res), ch_(ch), cursor_(from), to_(to), left_(maxN) {}
+
+protected:
+    bool next(Print& out) override {
+        if (!headerDone_) {
+            header(out);
+            headerDone_ = true;
+            return true;
+        }
+        if (pos_ == count_) {
+            const uint32_t want = (left_ < kBatch) ? left_ : kBatch;
+            uint32_t resume = 0;
+            count_ = (want && cursor_) ? ARCHIVE->query(res_, ch_, cursor_, to_, batch_, want, resume) : 0;
+            pos_ = 0;
+            left_ -= count_;
+            cursor_ = resume;
+            if (count_ == 0) return false;
+        }
+        const TimeArchive::Rollup& r = batch_[pos_++];
+        for (uint8_t i = 0; i < nCols_; ++i) {
+            switch (cols_[i]) {
+                case 0: row_.u32(r.t); break;
+                case 1: row_.u32(r.coverage); break;
+                case 2: row_.fixed(r.current_min, 3); break;
+                case 3: row_.fixed(r.current_mean, 3); break;
+                case 4: row_.fixed(r.current_max, 3); break;
+                case 5: row_.fixed(r.energy_wh, 4); break;
+                case 6: row_.fixed(r.motor_c, 2); break;
+                case 7: row_.fixed(r.board_c, 2); break;
+                default: row_.fixed(r.duty, 3); break;
+            }
+        }
+        row_.end(out);
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kBatch = 32;  // Rollup : 40 octets
+    TimeArchive::Rollup batch_[kBatch];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    TimeArchive::Res res_;
+    uint8_t ch_;
+    uint32_t cursor_;          // 0 : plus rien a lire
+    uint32_t to_;
+    uint32_t left_;
+    bool headerDone_ = false;
+};
+
+static const char* const kSessionCols[] = {"seq", "start_epoch", "end_epoch", "duration_s", "energy_wh",
+                                           "peak_power_w", "peak_current_a", "success", "last_error",
+                                           "channel"};
+
+class SessionsCsv : public CsvStream {
+public:
+    SessionsCsv(const SessionHistory* sessions, uint32_t lo, uint32_t maxN, uint32_t from, uint32_t to)
+        : CsvStream(kSessionCols, sizeof(kSessionCols) / sizeof(kSessionCols[0])),
+          sessions_(sessions), cursor_(lo), left_(maxN), from_(from), to_(to) {}
+
+protected:
+    bool next(Print& out) override {
+        if (!headerDone_) {
+            header(out);
+            headerDone_ = true;
+            return true;
+        }
+        const SessionHistory::Entry* e = nullptr;
+        for (uint32_t scanned = 0; !e; ++scanned) {
+            if (left_ == 0) return false;
+            // Filtre from/to : reprise au rappel suivant.
+            if (scanned >= JSON_STREAM_SCAN_MAX) return true;
+            if (pos_ == count_) {
+                count_ = sessions_->getFrom(cursor_, batch_, JSON_STREAM_BATCH);
+                pos_ = 0;
+                if (count_ == 0) return false;
+            }
+            const SessionHistory::Entry& c = batch_[pos_++];
+            cursor_ = c.seq + 1;
+            // Ordre d'ajout = ordre de fin : filtre sur la date de debut.
+            if (SessionHistory::startsIn(c, from_, to_)) e = &c;
+        }
+        left_--;
+        for (uint8_t i = 0; i < nCols_; ++i) {
+            switch (cols_[i]) {
+                case 0: row_.u32(e->seq); break;
+                case 1: row_.u32(e->start_epoch); break;
+                case 2: row_.u32(e->end_epoch); break;
+                case 3: row_.u32(e->duration_s); break;
+                case 4: row_.fixed(e->energy_wh, 4); break;
+                case 5: row_.fixed(e->peak_power_w, 2); break;
+                case 6: row_.fixed(e->peak_current_a, 3); break;
+                case 7: row_.u32(e->success ? 1 : 0); break;
+                case 8: row_.u32(e->last_error); break;
+                default: row_.u32(e->channel); break;
+            }
+        }
+        row_.end(out);
+        return true;
+    }
+
+private:
+    const SessionHistory* sessions_;
+    SessionHistory::Entry batch_[JSON_STREAM_BATCH];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t cursor_;
+    uint32_t left_;
+    uint32_t from_;
+    uint32_t to_;
+    bool headerDone_ = false;
+};
+
+static const char* const kEventCols[] = {"seq", "ts_ms", "first_ms", "count", "level", "code",
+                                         "message", "source", "arg"};
+
+class EventsCsv : public CsvStream {
+public:
+    EventsCsv(const EventLog* log, uint32_t since, uint32_t maxN, uint32_t scan,
+              uint32_t fromMs, uint32_t toMs)
+        : CsvStream(kEventCols, sizeof(kEventCols) / sizeof(kEventCols[0])),
+          log_(log), seq_(since), left_(maxN), scan_(scan), fromMs_(fromMs), toMs_(toMs) {}
+
+protected:
+    bool next(Print& out) override {
+        if (!headerDone_) {
+            header(out);
+            headerDone_ = true;
+            return true;
+        }
+        for (uint32_t scanned = 0;; ++scanned) {
+            if (left_ == 0) return false;
+            // Filtre from_ms/to_ms : reprise au rappel suivant.
+            if (scanned >= JSON_STREAM_SCAN_MAX) return true;
+            if (pos_ == count_) {
+                pos_ = 0;
+                // Segments flash d'abord (tout le journal conserve), puis
+                // ring buffer (evenements pas encore ecrits par Persist) :
+                // au plus un ring buffer parcouru.
+                count_ = stored_ ? log_->getStoredSince(seq_, batch_, kBatch, seq_) : 0;
+                if (count_ == 0) {
+                    stored_ = false;
+                    const uint32_t want = (scan_ < kBatch) ? scan_ : kBatch;
+                    count_ = want ? log_->getSince(seq_, batch_, want, seq_) : 0;
+                    scan_ -= count_;
+                }
+                if (count_ == 0) return false;
+            }
+            const EventLog::Entry& e = batch_[pos_++];
+            if (e.ts_ms < fromMs_ || e.ts_ms > toMs_) continue;
+            left_--;
+            char text[64];
+            for (uint8_t i = 0; i < nCols_; ++i) {
+                switch (cols_[i]) {
+                    case 0: row_.u32(e.seq); break;
+                    case 1: row_.u32(e.ts_ms); break;
+                    case 2: row_.u32(e.first_ms); break;
+                    case 3: row_.u32(e.count); break;
+                    case 4: row_.u32(static_cast<uint32_t>(e.level)); break;
+                    case 5: row_.u32(e.code); break;
+                    case 6:
+                        EventLog::formatMessage(e, text, sizeof(text));
+                        row_.text(text);
+                        break;
+                    case 7:
+                        EventLog::formatSource(e, text, sizeof(text));
+                        row_.text(text);
+                        break;
+                    default: row_.fixed(e.arg, 2); break;
+                }
+            }
+            row_.end(out);
+            return true;
+        }
+    }
+
+private:
+    static constexpr uint32_t kBatch = 16;  // Entry : 28 octets
+    const EventLog* log_;
+    EventLog::Entry batch_[kBatch];
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    uint32_t seq_;
+    uint32_t left_;
+    uint32_t scan_;
+    uint32_t fromMs_;
+    uint32_t toMs_;
+    bool stored_ = true;       // lecture des segments flash en cours
+    bool headerDone_ = false;
+};
+
+// Fenetre ?from_ms= / ?to_ms= (millis, meme horloge que ts_ms).
+static void msRange(AsyncWebServerRequest* request, uint32_t& fromMs, uint32_t& toMs) {
+    fromMs = 0;
+    toMs = UINT32_MAX;
+    if (request->hasParam("from_ms")) fromMs = static_cast<uint32_t>(request->getParam("from_ms")->value().toInt());
+    if (request->hasParam("to_ms")) toMs = static_cast<uint32_t>(request->getParam("to_ms")->value().toInt());
+}
+
+void WiFiManager::handleApiExportHistory_(AsyncWebServerRequest* request) {
+    // Historique en CSV. ?res=minute|hour : archive persistante (TimeArchive),
+    // ?from=/?to= (epoch, defaut : toute l'archive), ?ch=, ?max=, ?cols=.
+    // Sinon echantillons BusSampler (RAM) : ?ch=, ?since= (seq),
+    // ?from_ms=/?to_ms=, ?max=, ?cols=.
+    if (request->hasParam("res")) {
+        handleApiExportArchive_(request);
+        return;
+    }
+    if (!BUS_SAMPLER) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_sampler\"}");
+        return;
+    }
+    uint32_t since = 0;
+    uint32_t maxN = BUS_SAMPLER_HISTORY_SIZE;
+    uint32_t ch = 0;
+    if (request->hasParam("since")) since = request->getParam("since")->value().toInt();
+    if (request->hasParam("max")) maxN = request->getParam("max")->value().toInt();
+    if (request->hasParam("ch")) ch = request->getParam("ch")->value().toInt();
+    if (maxN > BUS_SAMPLER_HISTORY_SIZE) maxN = BUS_SAMPLER_HISTORY_SIZE;
+    if (ch >= DEVICE_CHANNELS) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_channel\"}");
+        return;
+    }
+    uint32_t fromMs = 0;
+    uint32_t toMs = 0;
+    msRange(request, fromMs, toMs);
+
+    HistoryCsv* csv = new HistoryCsv(since, maxN, static_cast<uint8_t>(ch), fromMs, toMs);
+    if (!csv->selectColumns(request)) {
+        delete csv;
+        return;
+    }
+    CsvStream::send(request, csv, "history.csv");
+}
+
+void WiFiManager::handleApiExportArchive_(AsyncWebServerRequest* request) {
+    // Memes parametres que /api/archive, toute l'archive par defaut.
+    const String r = request->getParam("res")->value();
+    TimeArchive::Res res = TimeArchive::Res::Minute;
+    if (r == "hour") {
+        res = TimeArchive::Res::Hour;
+    } else if (r != "minute") {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_res\"}");
+        return;
+    }
+    uint32_t ch = 0;
+    if (request->hasParam("ch")) ch = request->getParam("ch")->value().toInt();
+    if (ch >= DEVICE_CHANNELS) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_channel\"}");
+        return;
+    }
+    uint32_t from = ARCHIVE_MIN_EPOCH;
+    uint32_t to = static_cast<uint32_t>(rtc_ ? rtc_->getUnixTime() : 0);
+    if (request->hasParam("from")) from = static_cast<uint32_t>(request->getParam("from")->value().toInt());
+    if (request->hasParam("to")) to = static_cast<uint32_t>(request->getParam("to")->value().toInt());
+    if (from < ARCHIVE_MIN_EPOCH) from = ARCHIVE_MIN_EPOCH;
+    if (to < from) {
+        request->send(400, CT_APP_JSON, "{\"error\":\"bad_range\"}");
+        return;
+    }
+    uint32_t maxN = UINT32_MAX;
+    if (request->hasParam("max")) {
+        const uint32_t m = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+        if (m) maxN = m;
+    }
+
+    ArchiveCsv* csv = new ArchiveCsv(res, static_cast<uint8_t>(ch), from, to, maxN);
+    if (!csv->selectColumns(request)) {
+        delete csv;
+        return;
+    }
+    CsvStream::send(request, csv, (res == TimeArchive::Res::Hour) ? "archive_hour.csv" : "archive_minute.csv");
+}
+
+void WiFiManager::handleApiExportSessions_(AsyncWebServerRequest* request) {
+    // Sessions en CSV, de la plus ancienne a la plus recente : ?since= (seq),
+    // ?from=/?to= (epoch de debut, [from, to[), ?max= (defaut : toutes), ?cols=.
+    if (!sessions_) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_sessions\"}");
+        return;
+    }
+    uint32_t firstSeq = 0;
+    uint32_t lastSeq = 0;
+    sessions_->getSeqRange(firstSeq, lastSeq);
+
+    // Sequences retenues : [lo, hi[.
+    uint32_t lo = firstSeq;
+    uint32_t hi = lastSeq + 1;
+    if (request->hasParam("since")) {
+        const uint32_t since = static_cast<uint32_t>(request->getParam("since")->value().toInt());
+        if (since + 1 > lo) lo = since + 1;
+    }
+    // Meme fenetre que /api/sessions : from borne les sequences, le flux
+    // filtre sur la date de debut.
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    if (request->hasParam("from")) {
+        from = static_cast<uint32_t>(request->getParam("from")->value().toInt());
+        const uint32_t s = sessions_->seqFrom(from);
+        if (s > lo) lo = s;
+    }
+    if (request->hasParam("to")) to = static_cast<uint32_t>(request->getParam("to")->value().toInt());
+    uint32_t count = (hi > lo && firstSeq) ? UINT32_MAX : 0;
+    if (request->hasParam("max")) {
+        const uint32_t maxN = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+        if (maxN && maxN < count) count = maxN;
+    }
+
+    SessionsCsv* csv = new SessionsCsv(sessions_, lo, count, from, to);
+    if (!csv->selectColumns(request)) {
+        delete csv;
+        return;
+    }
+    CsvStream::send(request, csv, "sessions.csv");
+}
+
+void WiFiManager::handleApiExportEvents_(AsyncWebServerRequest* request) {
+    // Journal en CSV (segments flash puis ring buffer) : ?since= (seq),
+    // ?from_ms=/?to_ms=, ?max= (defaut : tout), ?cols=.
+    if (!events_) {
+        request->send(503, CT_APP_JSON, "{\"error\":\"no_events\"}");
+        return;
+    }
+    uint32_t since = 0;
+    const uint32_t limit = CONF->GetCfg<CfgId::EventMax>();
+    uint32_t maxN = UINT32_MAX;
+    if (request->hasParam("since")) since = request->getParam("since")->value().toInt();
+    if (request->hasParam("max")) {
+        const uint32_t m = static_cast<uint32_t>(request->getParam("max")->value().toInt());
+        if (m) maxN = m;
+    }
+    uint32_t fromMs = 0;
+    uint32_t toMs = 0;
+    msRange(request, fromMs, toMs);
+
+    EventsCsv* csv = new EventsCsv(events_, since, maxN, limit, fromMs, toMs);
+    if (!csv->selectColumns(request)) {
+        delete csv;
+        return;
+    }
+    CsvStream::send(request, csv, "events.csv");
+}
@@ -7,6 +7,12 @@
  *  - Si wifi_mode = AP, on demarre directement en AP.
  *  - Publie un serveur HTTP (ESPAsyncWebServer) pour l'UI / API JSON.
  *  - Active mDNS avec hostname fixe : contro.local
+ *  - Push SSE (/api/live) : snapshot, echantillons, evenements et
+ *    nouvelles sessions serialises une fois pour tous par la tache worker
+ *    dans une file commune ; les envois et fermetures se font dans la
+ *    tache AsyncTCP (poll de chaque abonne), seule a toucher aux clients.
+ *    Reconnexion : evenements manques renvoyes depuis EventLog
+ *    (Last-Event-ID). L'UI garde le polling si le flux est coupe.
  *
  *  Securite :
  *  - Les endpoints de config/controle/calibration sont proteges par
@@ -20,6 +26,7 @@
 #include <ESPmDNS.h>
 #include <ESPAsyncWebServer.h>
 #include <Config.hpp>
+#include <WiFiEndpoints.hpp>
 #include <DeviceTransport.hpp>
 #include <BusSampler.hpp>
 #include <SessionHistory.hpp>
@@ -75,6 +82,72 @@ private:
     void handleApiRtc_(AsyncWebServerRequest* request, JsonVariant& json);
     void handleApiRunTimer_(AsyncWebServerRequest* request, JsonVariant& json);
     void handleApiSessions_(AsyncWebServerRequest* request);
+    void handleApiSessionProfile_(AsyncWebServerRequest* request);
+    void handleApiSessionStats_(AsyncWebServerRequest* request);
+    void handleApiArchive_(AsyncWebServerRequest* request);
+    void handleApiFiles_(AsyncWebServerRequest* request);
+    void handleApiDownload_(AsyncWebServerRequest* request);
+    void handleApiExportHistory_(AsyncWebServerRequest* request);
+    void handleApiExportArchive_(AsyncWebServerRequest* request);
+    void handleApiExportSessions_(AsyncWebServerRequest* request);
+    void handleApiExportEvents_(AsyncWebServerRequest* request);
+    void handleApiCommand_(AsyncWebServerRequest* request);
+    void handleApiDiagLatency_(AsyncWebServerRequest* request);
+    void handleApiDiagNvs_(AsyncWebServerRequest* request);
+    void handleApiDiagStorageGet_(AsyncWebServerRequest* request);
+    void handleApiDiagStoragePost_(AsyncWebServerRequest* request, JsonVariant& json);
+    void handleApiDiagPersist_(AsyncWebServerRequest* request);
+    void handleApiDiagArchive_(AsyncWebServerRequest* request);
+    void handleApiDiagLive_(AsyncWebServerRequest* request);
+    void handleApiDiagReset_(AsyncWebServerRequest* request, JsonVariant& json);
+    void handleApiScheduleGet_(AsyncWebServerRequest* request);
+    void handleApiSchedulePost_(AsyncWebServerRequest* request, JsonVariant& json);
+
+    // Reponse commande en JSON ; encore en attente : reponse differee
+    // jusqu'au resultat ou waitMs (sans bloquer AsyncTCP).
+    void sendCommandReply_(AsyncWebServerRequest* request, bool ok, uint32_t id, uint32_t waitMs);
+
+    // Snapshot -> JSON (/api/status et push "status").
+    void buildStatus_(const SystemSnapshot& snap, String& out);
+
+    // -------------------- Push SSE (/api/live) --------------------
+
+    // Abonne : file d'attente surveillee (client lent).
+    struct LiveClient {
+        AsyncEventSourceClient* client = nullptr;
+        uint32_t congestedMs = 0;  // debut du retard (0 : file normale)
+        uint32_t sentN = 0;        // dernier message de la file traite
+    };
+
+    // Message en file (worker -> AsyncTCP), id SSE = dernier seq d'evenement.
+    struct LiveMsg {
+        const char* event = nullptr;
+        String payload;
+        uint32_t n = 0;
+        uint32_t id = 0;
+        bool droppable = false;
+    };
+
+    struct LiveStats {
+        uint32_t connects = 0;
+        uint32_t refused = 0;      // plus de LIVE_MAX_CLIENTS abonnes
+        uint32_t messages = 0;     // payloads serialises
+        uint32_t skipped = 0;      // status / history sautes (client lent)
+        uint32_t closed = 0;       // clients fermes (retard durable, file debordee)
+        uint32_t replayed = 0;     // evenements renvoyes a la reconnexion
+        uint32_t max_queue = 0;    // plus longue file d'un abonne
+    };
+
+    void setupLive_();
+    // Tache worker : nouveautes depuis le dernier envoi, une fois par periode.
+    void pushLive_();
+    // Mise en file (payload deplace) ; droppable : saute pour les clients
+    // en retard (remplace au prochain envoi).
+    void liveSend_(const char* event, String& payload, bool droppable);
+    // Tache AsyncTCP : envoi de la file a un abonne / reprise a l'abonnement.
+    void liveDeliver_(AsyncEventSourceClient* client);
+    void liveReplay_(AsyncEventSourceClient* client);
+    static void buildLiveEvents_(const EventLog::Entry* batch, size_t n, uint32_t seqEnd, String& out);
 
     // Dependances (non possedees)
     SessionHistory* sessions_ = nullptr;
@@ -84,6 +157,20 @@ private:
     AsyncWebServer server_{80};
     TaskHandle_t workerTaskHandle_ = nullptr;
 
+    AsyncEventSource live_{EP_API_LIVE};
+    LiveClient liveClients_[LIVE_MAX_CLIENTS];
+    LiveMsg liveOutbox_[LIVE_OUTBOX_LEN];
+    LiveStats liveStats_;
+    // Recursif : close() peut rappeler onDisconnect dans la meme tache.
+    SemaphoreHandle_t liveMutex_ = nullptr;
+    uint8_t liveCount_ = 0;        // abonnes (lu par le worker)
+    uint32_t liveN_ = 0;           // numero du dernier message mis en file
+    uint32_t liveDeferred_ = 0;    // polls sans envoi (verrou pris) ; AsyncTCP seule
+    uint32_t liveStatusSeq_ = 0;
+    uint32_t liveSampleSeq_ = 0;
+    uint32_t liveEventSeq_ = 0;
+    uint32_t liveSessionSeq_ = 0;
+
     static WiFiManager* inst_;
 };
 
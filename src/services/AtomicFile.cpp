@@ -0,0 +1,185 @@
+#include <AtomicFile.hpp>
+#include <StorageManager.hpp>
+#include <Utils.hpp>
+#include <esp_rom_crc.h>
+
+// Pied (16 octets, little-endian) en fin de fichier.
+struct __attribute__((packed)) AtomicFooter {
+    uint32_t magic;     // kAtomicMagic
+    uint32_t length;    // octets de contenu (avant le pied)
+    uint32_t gen;       // generation (croissante a chaque commit)
+    uint32_t crc;       // CRC32 du contenu
+};
+static constexpr uint32_t kAtomicMagic = 0x31465441;  // "ATF1"
+static_assert(sizeof(AtomicFooter) == 16, "AtomicFooter: taille fixe");
+
+static String tmpPath_(const char* path) { return String(path) + ".tmp"; }
+static String bakPath_(const char* path) { return String(path) + ".bak"; }
+
+// Pied d'un fichier (sans verifier le CRC) ; false si absent.
+static bool readFooter_(File& f, AtomicFooter& out) {
+    const size_t size = f.size();
+    if (size < sizeof(AtomicFooter)) return false;
+    if (!f.seek(size - sizeof(AtomicFooter)) ||
+        f.read(reinterpret_cast<uint8_t*>(&out), sizeof(out)) != sizeof(out)) {
+        return false;
+    }
+    return out.magic == kAtomicMagic && out.length == size - sizeof(AtomicFooter);
+}
+
+// Version complete : pied present et CRC du contenu correct.
+static bool verify_(const String& path, uint32_t& gen) {
+    File f = STORAGE->open(path, "r");
+    if (!f) return false;
+    AtomicFooter ft;
+    bool ok = readFooter_(f, ft) && f.seek(0);
+    uint32_t crc = 0;
+    uint8_t buf[256];
+    for (uint32_t left = ft.length; ok && left > 0;) {
+        const size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+        ok = f.read(buf, chunk) == chunk;
+        crc = esp_rom_crc32_le(crc, buf, chunk);
+        left -= chunk;
+    }
+    f.close();
+    if (!ok || crc != ft.crc) return false;
+    gen = ft.gen;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Writer
+// -----------------------------------------------------------------------------
+AtomicFile::Writer::Writer(const char* path) : path_(path) {
+    // Generation suivante (pieds des versions presentes, sans relecture).
+    uint32_t gen = 0;
+    const String cands[3] = {path_, tmpPath_(path), bakPath_(path)};
+    for (const String& c : cands) {
+        File f = STORAGE->open(c, "r");
+        if (!f) continue;
+        AtomicFooter ft;
+        if (readFooter_(f, ft) && ft.gen > gen) gen = ft.gen;
+        f.close();
+    }
+    gen_ = gen + 1;
+
+    f_ = STORAGE->open(tmpPath_(path), "w");
+    ok_ = static_cast<bool>(f_);
+}
+
+AtomicFile::Writer::~Writer() {
+    if (done_) return;
+    // Abandon : la version en place reste.
+    if (f_) f_.close();
+    STORAGE->remove(tmpPath_(path_.c_str()));
+}
+
+size_t AtomicFile::Writer::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t AtomicFile::Writer::write(const uint8_t* buf, size_t n) {
+    if (!ok_ || done_) return 0;
+    const size_t w = f_.write(buf, n);
+    crc_ = esp_rom_crc32_le(crc_, buf, w);
+    len_ += w;
+    if (w != n) ok_ = false;
+    return w;
+}
+
+bool AtomicFile::Writer::commit() {
+    if (done_) return false;
+    done_ = true;
+    const String tmp = tmpPath_(path_.c_str());
+    if (ok_) {
+        AtomicFooter ft;
+        ft.magic = kAtomicMagic;
+        ft.length = len_;
+        ft.gen = gen_;
+        ft.crc = crc_;
+        ok_ = f_.write(reinterpret_cast<const uint8_t*>(&ft), sizeof(ft)) == sizeof(ft);
+    }
+    if (f_) f_.close();
+    if (!ok_) {
+        STORAGE->remove(tmp);
+        STORAGE->noteCommit(false);
+        return false;
+    }
+
+    // Bascule : a tout instant, une version complete existe (.tmp, actuel
+    // ou .bak) ; Reader prend la plus recente.
+    const String bak = bakPath_(path_.c_str());
+    STORAGE->remove(bak);
+    if (STORAGE->exists(path_)) STORAGE->rename(path_, bak);
+    ok_ = STORAGE->rename(tmp, path_);
+    STORAGE->noteCommit(ok_);
+    return ok_;
+}
+
+// -----------------------------------------------------------------------------
+// Reader
+// -----------------------------------------------------------------------------
+AtomicFile::Reader::Reader(const char* path, bool legacy) {
+    const uint32_t t0 = micros();
+    const String cands[3] = {String(path), tmpPath_(path), bakPath_(path)};
+    int best = -1;
+    uint32_t bestGen = 0;
+    for (int i = 0; i < 3; ++i) {
+        uint32_t gen = 0;
+        if (!STORAGE->exists(cands[i]) || !verify_(cands[i], gen)) continue;
+        if (best < 0 || gen > bestGen) {
+            best = i;
+            bestGen = gen;
+        }
+    }
+
+    if (best >= 0) {
+        f_ = STORAGE->open(cands[best], "r");
+        AtomicFooter ft;
+        if (f_ && readFooter_(f_, ft) && f_.seek(0)) {
+            size_ = ft.length;
+            ok_ = true;
+        }
+        fallback_ = best != 0;
+        if (fallback_) DEBUG_PRINTF("[AtomicFile] %s : version %s relue\n", path, cands[best].c_str());
+    } else if (legacy && STORAGE->exists(path)) {
+        // Ancien format (sans pied) : contenu entier, a valider par l'appelant.
+        f_ = STORAGE->open(path, "r");
+        AtomicFooter ft;
+        if (f_ && !readFooter_(f_, ft) && f_.seek(0)) {
+            size_ = static_cast<uint32_t>(f_.size());
+            ok_ = true;
+        }
+    }
+    if (!ok_ && f_) f_.close();
+    left_ = ok_ ? size_ : 0;
+
+    // Pas de fichier du tout : premier demarrage, pas un echec.
+    const bool none = best < 0 && !STORAGE->exists(path);
+    if (!none) STORAGE->noteLoad(ok_, fallback_, micros() - t0);
+}
+
+AtomicFile::Reader::~Reader() {
+    if (f_) f_.close();
+}
+
+int AtomicFile::Reader::available() {
+    return static_cast<int>(left_);
+}
+
+int AtomicFile::Reader::read() {
+    if (left_ == 0) return -1;
+    const int c = f_.read();
+    if (c >= 0) left_--;
+    return c;
+}
+
+int AtomicFile::Reader::peek() {
+    return left_ ? f_.peek() : -1;
+}
+
+void AtomicFile::remove(const char* path) {
+    STORAGE->remove(path);
+    STORAGE->remove(tmpPath_(path));
+    STORAGE->remove(bakPath_(path));
+}
@@ -0,0 +1,81 @@
+/**************************************************************
+ *  AtomicFile - fichier reecrit en entier, coherent apres coupure
+ *
+ *  Probleme :
+ *  - Reecrire un fichier sur place ("w") : une coupure pendant l'ecriture
+ *    laisse un fichier tronque, relu au boot comme des donnees abimees.
+ *
+ *  Ecriture (Writer) :
+ *  - Tout va dans "<path>.tmp" ; commit() ajoute un pied de 16 octets
+ *    (magic, longueur, generation, CRC32 du contenu), ferme, puis bascule :
+ *    "<path>" -> "<path>.bak", "<path>.tmp" -> "<path>".
+ *  - Sans commit() (erreur, destruction), le fichier en place est intact.
+ *
+ *  Lecture (Reader) :
+ *  - Candidats "<path>", "<path>.tmp", "<path>.bak" : la version complete
+ *    (pied + CRC) de plus grande generation est relue. Une coupure a
+ *    n'importe quel moment laisse donc l'ancienne ou la nouvelle version.
+ *  - Reprise bornee : au plus trois fichiers verifies (une lecture chacun),
+ *    duree mesuree (Storage::noteLoad, GET /api/diag/storage).
+ *  - legacy : fichier principal sans pied (ancien firmware) accepte tel
+ *    quel si aucune version valide.
+ **************************************************************/
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+class AtomicFile {
+public:
+    class Writer : public Print {
+    public:
+        explicit Writer(const char* path);
+        ~Writer();
+
+        bool ok() const { return ok_; }
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buf, size_t n) override;
+
+        // Pied + bascule ; false : fichier en place inchange (ou version
+        // ".tmp" complete, relue par Reader).
+        bool commit();
+
+    private:
+        String path_;
+        File f_;
+        uint32_t crc_ = 0;
+        uint32_t len_ = 0;
+        uint32_t gen_ = 1;
+        bool ok_ = false;
+        bool done_ = false;
+    };
+
+    class Reader : public Stream {
+    public:
+        explicit Reader(const char* path, bool legacy = false);
+        ~Reader();
+
+        bool ok() const { return ok_; }
+        // Version relue autre que "<path>" (coupure pendant un commit).
+        bool fallback() const { return fallback_; }
+        uint32_t size() const { return size_; }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t) override { return 0; }
+
+    private:
+        File f_;
+        uint32_t size_ = 0;
+        uint32_t left_ = 0;
+        bool ok_ = false;
+        bool fallback_ = false;
+    };
+
+    // Supprime toutes les versions.
+    static void remove(const char* path);
+};
+
+#endif // ATOMIC_FILE_H
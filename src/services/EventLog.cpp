@@ -1,52 +1,249 @@
 #include <EventLog.hpp>
-#include <FS.h>
-#include <SPIFFS.h>
+#include <StorageManager.hpp>
+#include <esp_rom_crc.h>
+
+// Enregistrement persistant (32 octets, little-endian). crc = CRC32 de
+// tout ce qui precede ; un enregistrement tronque ou efface est rejete.
+struct __attribute__((packed)) EventRecord {
+    uint32_t seq;
+    uint32_t ts_ms;
+    uint32_t first_ms;
+    uint32_t count;
+    uint16_t code;
+    uint8_t level;
+    uint8_t format;
+    uint8_t msg;
+    uint8_t src;
+    uint8_t channel;
+    uint8_t reserved;
+    float arg;
+    uint32_t crc;
+};
+static constexpr uint8_t kRecordFormat = 2;
+static_assert(sizeof(EventRecord) == 32, "EventRecord: taille fixe");
+static_assert(sizeof(EventLog::Entry) * EVTLOG_MAX_ENTRIES <= EVTLOG_RAM_BUDGET_BYTES,
+              "EVTLOG_MAX_ENTRIES depasse EVTLOG_RAM_BUDGET_BYTES");
+
+// Tables de textes (ordre de EvtMsg / EvtSrc).
+struct EvtMsgText {
+    const char* text;
+    const char* argFmt;
+};
+#define EVT_X_MSG(id, text, argFmt) {text, argFmt},
+#define EVT_X_SRC(id, text) text,
+static constexpr EvtMsgText kMsgText[] = { EVT_MESSAGES(EVT_X_MSG) };
+static constexpr const char* kSrcText[] = { EVT_SOURCES(EVT_X_SRC) };
+#undef EVT_X_MSG
+#undef EVT_X_SRC
+static_assert(sizeof(kMsgText) / sizeof(kMsgText[0]) == static_cast<size_t>(EvtMsg::Count),
+              "EVT_MESSAGES incomplet");
+static_assert(sizeof(kSrcText) / sizeof(kSrcText[0]) == static_cast<size_t>(EvtSrc::Count),
+              "EVT_SOURCES incomplet");
+static_assert(static_cast<size_t>(EvtMsg::Count) <= 256 && static_cast<size_t>(EvtSrc::Count) <= 256,
+              "ids sur un octet");
+
+static uint32_t recordCrc_(const EventRecord& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r),
+                            sizeof(r) - sizeof(r.crc));
+}
+
+static void toRecord_(const EventLog::Entry& e, EventRecord& r) {
+    memset(&r, 0, sizeof(r));
+    r.seq = e.seq;
+    r.ts_ms = e.ts_ms;
+    r.first_ms = e.first_ms;
+    r.count = e.count;
+    r.code = e.code;
+    r.level = static_cast<uint8_t>(e.level);
+    r.format = kRecordFormat;
+    r.msg = static_cast<uint8_t>(e.msg);
+    r.src = static_cast<uint8_t>(e.src);
+    r.channel = e.channel;
+    r.arg = e.arg;
+    r.crc = recordCrc_(r);
+}
+
+static void fromRecord_(const EventRecord& r, EventLog::Entry& e) {
+    e.seq = r.seq;
+    e.ts_ms = r.ts_ms;
+    e.first_ms = r.first_ms;
+    e.count = r.count;
+    e.level = static_cast<EventLevel>(r.level);
+    e.code = r.code;
+    // Id inconnu (firmware plus recent) : texte vide, code conserve.
+    e.msg = r.msg < static_cast<uint8_t>(EvtMsg::Count) ? static_cast<EvtMsg>(r.msg) : EvtMsg::None;
+    e.src = r.src < static_cast<uint8_t>(EvtSrc::Count) ? static_cast<EvtSrc>(r.src) : EvtSrc::None;
+    e.channel = r.channel;
+    e.arg = r.arg;
+}
+
+// Import des anciens textes : message / source -> ids (+ argument, canal).
+// Texte inconnu : EvtMsg::None (le code reste affiche par l'UI).
+static void fromText_(const char* message, const char* source, EventLog::Entry& e) {
+    e.msg = EvtMsg::None;
+    for (size_t i = 1; i < static_cast<size_t>(EvtMsg::Count); ++i) {
+        if (strcmp(message, kMsgText[i].text) == 0) {
+            e.msg = static_cast<EvtMsg>(i);
+            break;
+        }
+    }
+    unsigned id = 0;
+    char reason[12] = {0};
+    unsigned long writes = 0;
+    if (e.msg == EvtMsg::None &&
+        sscanf(message, "Schedule %u skipped (%11[a-z])", &id, reason) == 2) {
+        if (strcmp(reason, "fault") == 0) e.msg = EvtMsg::SchedFault;
+        else if (strcmp(reason, "running") == 0) e.msg = EvtMsg::SchedRunning;
+        else e.msg = EvtMsg::SchedQueue;
+        e.arg = static_cast<float>(id);
+    } else if (e.msg == EvtMsg::None &&
+               sscanf(message, "NVS key %*s %lu writes/h", &writes) == 1) {
+        e.msg = EvtMsg::NvsWear;
+        e.arg = static_cast<float>(writes);
+    }
+
+    // Source : "<base>" ou "<base>.<canal>".
+    char base[16];
+    snprintf(base, sizeof(base), "%s", source);
+    char* dot = strchr(base, '.');
+    e.channel = 0;
+    if (dot) {
+        *dot = 0;
+        e.channel = static_cast<uint8_t>(strtoul(dot + 1, nullptr, 10));
+    }
+    e.src = EvtSrc::None;
+    for (size_t i = 1; i < static_cast<size_t>(EvtSrc::Count); ++i) {
+        if (strcmp(base, kSrcText[i]) == 0) {
+            e.src = static_cast<EvtSrc>(i);
+            break;
+        }
+    }
+}
+
+void EventLog::formatMessage(const Entry& e, char* buf, size_t len) {
+    if (!buf || len == 0) return;
+    const size_t i = static_cast<size_t>(e.msg);
+    const EvtMsgText& t = kMsgText[i < static_cast<size_t>(EvtMsg::Count) ? i : 0];
+    int n = snprintf(buf, len, "%s", t.text);
+    if (n < 0 || static_cast<size_t>(n) >= len || t.argFmt[0] == 0 || isnan(e.arg)) return;
+    snprintf(buf + n, len - n, t.argFmt, static_cast<double>(e.arg));
+}
+
+void EventLog::formatSource(const Entry& e, char* buf, size_t len) {
+    if (!buf || len == 0) return;
+    const size_t i = static_cast<size_t>(e.src);
+    const char* base = kSrcText[i < static_cast<size_t>(EvtSrc::Count) ? i : 0];
+    if (e.channel == 0) snprintf(buf, len, "%s", base);
+    else snprintf(buf, len, "%s.%u", base, static_cast<unsigned>(e.channel));
+}
 
 void EventLog::begin() {
     if (!mutex_) {
         // Mutex pour proteger entries_ / head_ / count_ / seq_ (tache + HTTP).
         mutex_ = xSemaphoreCreateMutex();
     }
+    if (!ioMutex_) {
+        ioMutex_ = xSemaphoreCreateMutex();
+    }
 
     // Parametres persistants (NVS)
-    maxEntries_ = static_cast<uint16_t>(CONF->GetUInt(KEY_EVENT_MAX, DEFAULT_EVENTLOG_MAX_ENTRIES));
+    maxEntries_ = static_cast<uint16_t>(CONF->GetCfg<CfgId::EventMax>());
     if (maxEntries_ == 0) maxEntries_ = DEFAULT_EVENTLOG_MAX_ENTRIES;
+    if (maxEntries_ > EVTLOG_MAX_ENTRIES) maxEntries_ = EVTLOG_MAX_ENTRIES;
 
-    filePath_ = CONF->GetString(KEY_SPIFFS_EVT, DEFAULT_SPIFFS_EVT_FILE);
+    filePath_ = CONF->GetCfg<CfgId::SpiffsEvt>();
     if (filePath_.length() == 0) filePath_ = DEFAULT_SPIFFS_EVT_FILE;
 
+    // Base des segments : chemin sans extension, court (nom SPIFFS <= 31
+    // caracteres avec ".<id>").
+    segBase_ = filePath_;
+    const int dot = segBase_.lastIndexOf('.');
+    if (dot > segBase_.lastIndexOf('/')) segBase_ = segBase_.substring(0, dot);
+    if (segBase_.length() > 20) segBase_ = segBase_.substring(0, 20);
+
+    // Segments complets conserves : de quoi remplir le ring buffer, plus
+    // le segment courant.
+    segsKeep_ = static_cast<uint16_t>((maxEntries_ + EVTLOG_SEG_RECORDS - 1) / EVTLOG_SEG_RECORDS + 1);
+
     if (!entries_) {
         // Allocation RAM du ring buffer (taille maxEntries_).
         entries_ = new Entry[maxEntries_];
     }
 
-    // Recharge depuis SPIFFS (si le fichier existe).
-    loadFromFile_();
+    // Recharge depuis SPIFFS (segments, ou ancien fichier JSON) ; borne :
+    // les segments necessaires au ring buffer seulement.
+    const uint32_t t0 = micros();
+    const uint32_t skipped = loadSegments_();
+    STORAGE->noteRecovery("events", micros() - t0, skipped);
 }
 
-void EventLog::append(EventLevel level, uint16_t code, const char* message, const char* source) {
-    if (!entries_) return;
+void EventLog::append(EventLevel level, uint16_t code, EvtMsg msg, EvtSrc src,
+                      uint8_t channel, float arg, uint32_t count, uint32_t firstMs) {
+    if (!entries_ || !ioMutex_) return;
 
-    // Construit une entree complete (copies dans des buffers fixes).
+    // Construit une entree complete (ids : aucune copie de texte).
     Entry e;
-    e.seq = ++seq_;
     e.ts_ms = millis();
+    e.first_ms = firstMs ? firstMs : e.ts_ms;
+    e.count = count ? count : 1;
     e.level = level;
     e.code = code;
-    snprintf(e.message, sizeof(e.message), "%s", message ? message : "");
-    snprintf(e.source, sizeof(e.source), "%s", source ? source : "");
+    e.msg = msg;
+    e.src = src;
+    e.channel = channel;
+    e.arg = arg;
+
+    // seq, ring buffer et depot sous le meme mutex : les seq restent
+    // croissants dans la voie, donc dans les segments.
+    // Erreur (protection declenchee) : attente plus longue, un lecteur HTTP
+    // qui tient le mutex quelques ms ne la fait pas perdre.
+    if (!lock_(level == EventLevel::Error ? EVTLOG_ERROR_LOCK_MS : 10)) {
+        dropped_++;
+        return;
+    }
+    e.seq = ++seq_;
+    pushLocked_(e);
+    EventRecord r;
+    toRecord_(e, r);
+    const bool queued = PERSIST->submit(Persist::Lane::Low, &EventLog::writeBatch_, this, &r, sizeof(r));
+    unlock_();
+    if (queued) return;
+
+    // Tache Persist pas encore demarree (boot) : ecriture directe.
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
+    File f;
+    writeRecord_(r, f);
+    if (f) f.close();
+    xSemaphoreGive(ioMutex_);
+}
 
+void EventLog::writeBatch_(void* ctx, const Persist::Job* jobs, size_t n) {
+    // Tache Persist : un seul open/close pour les enregistrements du lot
+    // qui tombent dans le meme segment.
+    EventLog* self = static_cast<EventLog*>(ctx);
+    xSemaphoreTake(self->ioMutex_, portMAX_DELAY);
+    File f;
+    for (size_t i = 0; i < n; ++i) {
+        EventRecord r;
+        memcpy(&r, jobs[i].data, sizeof(r));
+        self->writeRecord_(r, f);
+    }
+    if (f) f.close();
+    xSemaphoreGive(self->ioMutex_);
+}
+
+void EventLog::push_(const Entry& e) {
     if (lock_()) {
-        // Ecriture dans le ring buffer (head_ pointe la prochaine case a ecrire).
-        entries_[head_] = e;
-        head_ = (head_ + 1) % maxEntries_;
-        if (count_ < maxEntries_) count_++;
+        pushLocked_(e);
         unlock_();
     }
+}
 
-    // Persistence "simple" : on reecrit le JSON entier.
-    // Pour un petit log (200-500 entries), c'est acceptable et robuste.
-    saveToFile_();
+void EventLog::pushLocked_(const Entry& e) {
+    // Ecriture dans le ring buffer (head_ pointe la prochaine case a ecrire).
+    entries_[head_] = e;
+    head_ = (head_ + 1) % maxEntries_;
+    if (count_ < maxEntries_) count_++;
 }
 
 uint16_t EventLog::getCount() const {
@@ -108,76 +305,220 @@ size_t EventLog::getSince(uint32_t sinceSeq, Entry* out, size_t maxOut, uint32_t
     return written;
 }
 
-void EventLog::loadFromFile_() {
-    // Format JSON :
+size_t EventLog::getStoredSince(uint32_t sinceSeq, Entry* out, size_t maxOut, uint32_t& newSeq) const {
+    newSeq = sinceSeq;
+    if (!out || maxOut == 0 || !ioMutex_) return 0;
+
+    size_t n = 0;
+    char path[40];
+    EventRecord r;
+    auto valid = [&r]() { return r.format == kRecordFormat && recordCrc_(r) == r.crc; };
+    // Pas de retention ni d'ajout pendant la lecture (comme TimeArchive).
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
+    for (uint32_t id = firstSeg_; id <= curSeg_ && n < maxOut; ++id) {
+        segPath_(id, path, sizeof(path));
+        File f = STORAGE->open(path, "r");
+        if (!f) continue;
+        const size_t records = f.size() / sizeof(r);
+        if (records && f.seek((records - 1) * sizeof(r)) &&
+            f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) == sizeof(r) &&
+            valid() && r.seq <= newSeq) {
+            f.close();
+            continue;
+        }
+        f.seek(0);
+        while (n < maxOut && f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) == sizeof(r)) {
+            if (!valid() || r.seq <= newSeq) continue;
+            fromRecord_(r, out[n++]);
+            newSeq = r.seq;
+        }
+        f.close();
+    }
+    xSemaphoreGive(ioMutex_);
+    return n;
+}
+
+void EventLog::segPath_(uint32_t id, char* buf, size_t len) const {
+    snprintf(buf, len, "%s.%lu", segBase_.c_str(), static_cast<unsigned long>(id));
+}
+
+uint32_t EventLog::loadSegments_() {
+    // 1) Segments presents : plus ancien et plus recent id (liste SPIFFS).
+    // Selon la version du core, name() inclut ou non le '/' initial.
+    const char* base = segBase_.c_str();
+    if (base[0] == '/') base++;
+    const size_t baseLen = strlen(base);
+
+    bool found = false;
+    uint32_t minId = 0;
+    uint32_t maxId = 0;
+    File dir = STORAGE->open("/");
+    if (dir) {
+        for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+            const char* name = f.name();
+            if (name[0] == '/') name++;
+            f.close();
+            if (strncmp(name, base, baseLen) != 0 || name[baseLen] != '.') continue;
+            const char* digits = name + baseLen + 1;
+            char* end = nullptr;
+            const unsigned long id = strtoul(digits, &end, 10);
+            if (end == digits || *end != 0) continue;
+            if (!found || id < minId) minId = static_cast<uint32_t>(id);
+            if (!found || id > maxId) maxId = static_cast<uint32_t>(id);
+            found = true;
+        }
+        dir.close();
+    }
+
+    if (!found) {
+        // Premier boot apres migration : import JSON puis reecriture binaire.
+        curSeg_ = 1;
+        firstSeg_ = 1;
+        curCount_ = 0;
+        if (loadLegacy_()) {
+            rewrite_();
+            STORAGE->remove(filePath_);
+        }
+        return 0;
+    }
+
+    // 2) Du plus recent au plus ancien : segments necessaires pour remplir
+    // le ring buffer (taille du fichier / taille d'un enregistrement).
+    char path[40];
+    uint32_t startSeg = maxId;
+    uint32_t records = 0;
+    for (uint32_t id = maxId;; --id) {
+        segPath_(id, path, sizeof(path));
+        File f = STORAGE->open(path, "r");
+        if (f) {
+            records += f.size() / sizeof(EventRecord);
+            f.close();
+        }
+        startSeg = id;
+        if (records >= maxEntries_ || id == minId) break;
+    }
+
+    // 3) Relecture dans l'ordre ; un enregistrement invalide est ignore.
+    // Queue du dernier segment invalide (coupure) : nouveau segment.
+    bool tailOk = true;
+    uint16_t tailCount = 0;
+    uint32_t skipped = 0;
+    for (uint32_t id = startSeg; id <= maxId; ++id) {
+        segPath_(id, path, sizeof(path));
+        File f = STORAGE->open(path, "r");
+        if (!f) continue;
+        const size_t size = f.size();
+        EventRecord r;
+        while (f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) == sizeof(r)) {
+            const bool ok = r.format == kRecordFormat && recordCrc_(r) == r.crc;
+            if (id == maxId) {
+                if (ok) tailCount++;
+                else tailOk = false;
+            }
+            if (!ok) {
+                skipped++;
+                continue;
+            }
+
+            Entry e;
+            fromRecord_(r, e);
+            push_(e);
+            if (e.seq > seq_) seq_ = e.seq;
+        }
+        if (id == maxId && size % sizeof(EventRecord) != 0) tailOk = false;
+        f.close();
+    }
+
+    firstSeg_ = minId;
+    curSeg_ = maxId;
+    curCount_ = tailCount;
+    // Segment suivant a la prochaine ecriture (queue abimee ou plein).
+    if (!tailOk) curCount_ = EVTLOG_SEG_RECORDS;
+    return skipped;
+}
+
+void EventLog::rewrite_() {
+    // Boot (avant Persist) : ecriture directe, du plus ancien au plus recent.
+    const uint16_t total = count_;
+    const uint16_t start = (count_ == maxEntries_) ? head_ : 0;
+    File f;
+    for (uint16_t i = 0; i < total; ++i) {
+        EventRecord r;
+        toRecord_(entries_[(start + i) % maxEntries_], r);
+        writeRecord_(r, f);
+    }
+    if (f) f.close();
+}
+
+bool EventLog::writeRecord_(const EventRecord& r, File& f) {
+    // Appele avec ioMutex_ pris.
+    char path[40];
+    if (curCount_ >= EVTLOG_SEG_RECORDS) {
+        if (f) f.close();
+        curSeg_++;
+        curCount_ = 0;
+        // Retention : suppression des segments entiers les plus anciens.
+        while (curSeg_ - firstSeg_ + 1 > segsKeep_) {
+            segPath_(firstSeg_++, path, sizeof(path));
+            STORAGE->remove(path);
+        }
+    }
+
+    if (!f) {
+        segPath_(curSeg_, path, sizeof(path));
+        f = STORAGE->open(path, "a");
+        if (!f) return false;
+    }
+    const size_t n = f.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r));
+    if (n != sizeof(r)) {
+        f.close();
+        // Ecriture partielle : les suivants iront dans un nouveau segment
+        // (alignement des enregistrements conserve).
+        curCount_ = EVTLOG_SEG_RECORDS;
+        return false;
+    }
+    curCount_++;
+    return true;
+}
+
+bool EventLog::loadLegacy_() {
+    // Ancien format JSON :
     // {"events":[{"seq":..,"ts_ms":..,"level":..,"code":..,"message":"..","source":".."}, ...]}
-    if (!SPIFFS.exists(filePath_)) return;
+    if (!STORAGE->exists(filePath_)) return false;
 
-    File f = SPIFFS.open(filePath_, "r");
-    if (!f) return;
+    File f = STORAGE->open(filePath_, "r");
+    if (!f) return false;
 
     // Document JSON dynamique (ArduinoJson v7).
     JsonDocument doc;
     DeserializationError err = deserializeJson(doc, f);
     f.close();
 
-    if (err) return;
+    if (err) return false;
 
     JsonArray arr = doc["events"].as<JsonArray>();
-    if (arr.isNull()) return;
+    if (arr.isNull()) return false;
 
     // Recharge dans le ring buffer RAM.
     for (JsonObject obj : arr) {
         Entry e;
         e.seq = obj["seq"] | 0;
         e.ts_ms = obj["ts_ms"] | 0;
+        e.first_ms = obj["first_ms"] | e.ts_ms;
+        e.count = obj["count"] | 1;
         e.level = static_cast<EventLevel>((int)(obj["level"] | (int)EventLevel::Warning));
         e.code = obj["code"] | 0;
-        const char* msg = obj["message"] | "";
-        const char* src = obj["source"] | "";
-        snprintf(e.message, sizeof(e.message), "%s", msg);
-        snprintf(e.source, sizeof(e.source), "%s", src);
-
-        entries_[head_] = e;
-        head_ = (head_ + 1) % maxEntries_;
-        if (count_ < maxEntries_) count_++;
-        if (e.seq > seq_) seq_ = e.seq;
-    }
-}
-
-void EventLog::saveToFile_() const {
-    if (!entries_) return;
-
-    // Reecriture complete du fichier JSON (simple et robuste).
-    File f = SPIFFS.open(filePath_, "w");
-    if (!f) return;
-
-    JsonDocument doc;
-    JsonArray arr = doc["events"].to<JsonArray>();
+        fromText_(obj["message"] | "", obj["source"] | "", e);
 
-    // Ecriture du plus ancien au plus recent (ordre chronologique).
-    uint16_t total = count_;
-    uint16_t start = (count_ == maxEntries_) ? head_ : 0;
-
-    for (uint16_t i = 0; i < total; ++i) {
-        uint16_t idx = (start + i) % maxEntries_;
-        const Entry& e = entries_[idx];
-        JsonObject obj = arr.add<JsonObject>();
-        obj["seq"] = e.seq;
-        obj["ts_ms"] = e.ts_ms;
-        obj["level"] = (int)e.level;
-        obj["code"] = e.code;
-        obj["message"] = e.message;
-        obj["source"] = e.source;
+        push_(e);
+        if (e.seq > seq_) seq_ = e.seq;
     }
-
-    serializeJson(doc, f);
-    f.close();
+    return true;
 }
 
-bool EventLog::lock_() const {
+bool EventLog::lock_(uint32_t waitMs) const {
     if (!mutex_) return false;
-    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(10)) == pdTRUE;
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(waitMs)) == pdTRUE;
 }
 
 void EventLog::unlock_() const {
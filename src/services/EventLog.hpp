@@ -2,17 +2,40 @@
  *  EventLog - warnings/erreurs persistants
  *
  *  Objectif :
- *  - Conserver un journal des avertissements / erreurs dans SPIFFS
- *    (fichier JSON), separatement de l'historique de sessions.
+ *  - Conserver un journal des avertissements / erreurs en flash
+ *    (segments binaires "<base>.N", enregistrements de 32 octets),
+ *    separatement de l'historique de sessions.
  *  - L'UI peut "poll" /api/events?since=... pour recuperer uniquement
  *    les nouveaux evenements.
  *
  *  Structure :
  *  - On garde un ring buffer en RAM (entries_) pour acces rapide.
- *  - On persiste regulierement en JSON dans SPIFFS.
+ *  - Textes internes : message et source sont des identifiants d'un
+ *    octet (tables EVT_MESSAGES / EVT_SOURCES), plus un canal et un
+ *    argument numerique optionnel (courant au declenchement, id de
+ *    regle...). Le texte n'est reconstruit qu'a la serialisation JSON
+ *    (formatMessage / formatSource) : ~28 octets par evenement en RAM
+ *    comme sur flash, au lieu de ~100.
+ *  - Persistance en ajout seul : un enregistrement binaire de taille
+ *    fixe (CRC32) par evenement, ecrit a la fin du segment courant
+ *    ("/events.7" pour "/events.json"). Cout constant, quelle que soit
+ *    la taille du journal.
+ *  - Segment plein (EVTLOG_SEG_RECORDS) : segment suivant ; retention =
+ *    suppression des segments entiers les plus anciens (assez pour
+ *    remplir le ring buffer).
+ *  - Boot : seuls les derniers segments necessaires sont relus ; un
+ *    enregistrement invalide (coupure pendant l'ecriture) est ignore et
+ *    les ajouts reprennent dans un nouveau segment. Un ancien fichier
+ *    JSON est importe une fois puis reecrit.
  *
  *  Concurrence :
- *  - Un mutex protege le ring buffer (tache Device + HTTP).
+ *  - Un mutex protege le ring buffer (tache Device + HTTP). append()
+ *    l'attend 10 ms (EVTLOG_ERROR_LOCK_MS pour une erreur) ; au-dela,
+ *    l'evenement est perdu et compte (droppedCount(), /api/diag/persist).
+ *  - seq attribue et enregistrement depose (Persist) sous ce mutex :
+ *    ordre des seq conserve dans les segments.
+ *  - Un second mutex protege l'etat des segments (tache Persist ; boot)
+ *    sans bloquer les lecteurs ni append() pendant l'acces fichier.
  **************************************************************/
 #ifndef EVENT_LOG_H
 #define EVENT_LOG_H
@@ -21,6 +44,46 @@
 #include <ArduinoJson.h>
 #include <Config.hpp>
 #include <NVSManager.hpp>
+#include <PersistWorker.hpp>
+#include <FS.h>
+
+struct EventRecord;
+
+// Messages : id, texte, suffixe printf de l'argument (float, "" si aucun).
+// Ajouter un message = une ligne ici (a la fin : les ids sont persistes).
+#define EVT_MESSAGES(X) \
+    X(None,         "",                         "") \
+    X(AuthFail,     "Auth fail",                "") \
+    X(ClientGone,   "Client disconnect",        "") \
+    X(SchedFault,   "Schedule skipped (fault)", " #%.0f") \
+    X(SchedRunning, "Schedule skipped (running)", " #%.0f") \
+    X(SchedQueue,   "Schedule skipped (queue)", " #%.0f") \
+    X(NvsWear,      "NVS key over budget",      ": %.0f writes/h") \
+    X(BmeMissing,   "BME absent",               "") \
+    X(BmeCache,     "BME cache",                "") \
+    X(AdcSat,       "ADC saturation",           " (%.2f A)") \
+    X(OvcLatch,     "OVC latch",                " (%.2f A)") \
+    X(OverTemp,     "Overtemp",                 " (%.1f C)") \
+    X(TempTrend,    "Temp trend",               " (%.1f C)") \
+    X(Ds18Missing,  "DS18 absent",              "") \
+    X(Ds18Cache,    "DS18 cache",               "")
+
+// Sources : id, texte ; canal > 0 => suffixe ".N" (ex: "ds18.1").
+#define EVT_SOURCES(X) \
+    X(None,    "") \
+    X(Http,    "http") \
+    X(Wifi,    "wifi") \
+    X(Sched,   "sched") \
+    X(Nvs,     "nvs") \
+    X(Bme,     "bme") \
+    X(Current, "current") \
+    X(Temp,    "temp") \
+    X(Ds18,    "ds18")
+
+#define EVT_X_ID(id, ...) id,
+enum class EvtMsg : uint8_t { EVT_MESSAGES(EVT_X_ID) Count };
+enum class EvtSrc : uint8_t { EVT_SOURCES(EVT_X_ID) Count };
+#undef EVT_X_ID
 
 class EventLog {
 public:
@@ -30,17 +93,33 @@ public:
         // ts_ms : horodatage relatif (millis()). Pour un horodatage absolu,
         // l'UI peut aussi utiliser RTCManager si besoin.
         uint32_t ts_ms = 0;
+        // Alerte repetee (coalescence Device) : premiere occurrence et
+        // nombre d'occurrences resumees par cette entree (ts_ms = derniere).
+        uint32_t first_ms = 0;
+        uint32_t count = 1;
         EventLevel level = EventLevel::Warning;
+        EvtMsg msg = EvtMsg::None;
+        EvtSrc src = EvtSrc::None;
+        uint8_t channel = 0;
         uint16_t code = 0;
-        char message[64] = {0};
-        char source[16] = {0};
+        // Argument du message (NAN : aucun).
+        float arg = NAN;
     };
 
     // Initialise la RAM (ring buffer) et charge depuis SPIFFS.
     void begin();
 
-    // Ajoute un evenement et persiste en SPIFFS.
-    void append(EventLevel level, uint16_t code, const char* message, const char* source);
+    // Ajoute un evenement (ring buffer) ; l'ecriture a la fin du segment
+    // courant est faite par la tache Persist (voie Low), sans attente.
+    // channel : suffixe de la source ; arg : valeur du message (NAN : aucune).
+    // count/firstMs : resume d'occurrences repetees (firstMs 0 => maintenant).
+    void append(EventLevel level, uint16_t code, EvtMsg msg, EvtSrc src,
+                uint8_t channel = 0, float arg = NAN,
+                uint32_t count = 1, uint32_t firstMs = 0);
+
+    // Textes reconstruits (serialisation JSON).
+    static void formatMessage(const Entry& e, char* buf, size_t len);
+    static void formatSource(const Entry& e, char* buf, size_t len);
 
     // Lecture "liste" (du plus recent au plus ancien).
     uint16_t getCount() const;
@@ -49,13 +128,37 @@ public:
     // Lecture "stream" : renvoie les evenements dont seq > sinceSeq.
     // newSeq = dernier seq renvoye (a reutiliser au prochain appel).
     size_t getSince(uint32_t sinceSeq, Entry* out, size_t maxOut, uint32_t& newSeq) const;
+    // Idem depuis les segments flash (export) : evenements deja ecrits,
+    // y compris plus anciens que le ring buffer. Un segment entierement
+    // <= sinceSeq est saute sur son dernier enregistrement.
+    size_t getStoredSince(uint32_t sinceSeq, Entry* out, size_t maxOut, uint32_t& newSeq) const;
+
+    // Evenements perdus depuis le boot (mutex non obtenu dans append()).
+    uint32_t droppedCount() const { return dropped_; }
+
+    // Prefixe des segments "<base>.N" (telechargement /api/download).
+    const String& segmentBase() const { return segBase_; }
 
 private:
-    void loadFromFile_();
-    void saveToFile_() const;
+    // Segments : nom, relecture au boot, ajout d'un enregistrement.
+    void segPath_(uint32_t id, char* buf, size_t len) const;
+    // Retourne le nombre d'enregistrements abimes ignores.
+    uint32_t loadSegments_();
+    // Anciens segments a textes : import (ring buffer) ; enregistrements
+    // abimes ignores ajoutes a skipped.
+    bool loadLegacy_();
+    // Reecrit le ring buffer dans des segments neufs (apres import).
+    void rewrite_();
+    void push_(const Entry& e);
+    void pushLocked_(const Entry& e);
+    // Ecrit r dans le segment courant (f ouvert au besoin, ferme a la
+    // rotation) ; appele avec ioMutex_ pris.
+    bool writeRecord_(const EventRecord& r, File& f);
+    // Lot de la tache Persist (enregistrements deja construits).
+    static void writeBatch_(void* ctx, const Persist::Job* jobs, size_t n);
 
-    // Mutex interne (thread-safe).
-    bool lock_() const;
+    // Mutex interne (thread-safe) ; attente bornee a waitMs.
+    bool lock_(uint32_t waitMs = 10) const;
     void unlock_() const;
 
     Entry* entries_ = nullptr; // Ring buffer RAM
@@ -63,9 +166,18 @@ private:
     uint16_t count_ = 0;
     uint16_t head_ = 0;
     uint32_t seq_ = 0; // seq global monotone
+    volatile uint32_t dropped_ = 0;
 
     String filePath_ = DEFAULT_SPIFFS_EVT_FILE;
+    // Segments : base du nom (filePath_ sans extension), plus ancien
+    // segment conserve, segment courant et ses enregistrements.
+    String segBase_;
+    uint32_t firstSeg_ = 0;
+    uint32_t curSeg_ = 0;
+    uint16_t curCount_ = 0;
+    uint16_t segsKeep_ = 1;
     mutable SemaphoreHandle_t mutex_ = nullptr;
+    SemaphoreHandle_t ioMutex_ = nullptr;
 };
 
 #endif // EVENT_LOG_H
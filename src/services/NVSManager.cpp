@@ -1,5 +1,9 @@
 #include <NVSManager.hpp>
+#include <EventLog.hpp>
+#include <PersistWorker.hpp>
+#include <nvs.h>
 #include <esp_err.h>
+#include <esp_rom_crc.h>
 #include <esp_sleep.h>
 #include <esp_task_wdt.h>
 // -----------------------------------------------------------------------------
@@ -7,6 +11,8 @@
 //  - Centraliser les parametres persistants (Preferences / NVS ESP32)
 //  - Garantir un acces thread-safe pour les ecritures (mutex recursif)
 //  - S'assurer que les cles necessaires existent (valeurs par defaut au boot)
+//  - Servir les lectures depuis un miroir RAM et regrouper les ecritures
+//    (tache Persist, periode NVS_FLUSH_MS ; Flush() pour forcer)
 //
 // IMPORTANT (convention d'architecture):
 //  - Device est le seul module qui doit ecrire dans NVS (config).
@@ -34,6 +40,13 @@ NVS* NVS::Get() {
 // -----------------------------------------------------------------------------
 NVS::NVS() {
     mutex_ = xSemaphoreCreateRecursiveMutex();
+    ioMutex_ = xSemaphoreCreateMutex();
+    // Defauts du schema jusqu'au chargement (begin).
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+            cfg_[i][ch] = cfgDefault(static_cast<CfgId>(i));
+        }
+    }
 }
 
 NVS::~NVS() {
@@ -89,91 +102,37 @@ void NVS::ensureDefaults_() {
     // Cree uniquement les cles manquantes:
     // - ne remplace pas une config existante
     // - permet d'ajouter de nouvelles cles lors d'une mise a jour firmware
+    // Valeurs en attente ecrites d'abord (Flush prend ioMutex_ avant mutex_).
+    Flush();
     lock_();
     ensureOpenRW_();
 
-    auto ensureBool = [&](const char* key, bool value) {
-        if (!preferences.isKey(key)) preferences.putBool(key, value);
-    };
-    auto ensureInt = [&](const char* key, int value) {
-        if (!preferences.isKey(key)) preferences.putInt(key, value);
-    };
-    auto ensureUInt = [&](const char* key, unsigned int value) {
-        if (!preferences.isKey(key)) preferences.putUInt(key, value);
-    };
-    auto ensureULong64 = [&](const char* key, uint64_t value) {
-        if (!preferences.isKey(key)) preferences.putULong64(key, value);
-    };
-    auto ensureFloat = [&](const char* key, float value) {
-        if (!preferences.isKey(key)) preferences.putFloat(key, value);
-    };
-    auto ensureString = [&](const char* key, const String& value) {
-        if (!preferences.isKey(key)) preferences.putString(key, value);
-    };
+    // Une entree par parametre du schema (et par canal si par canal).
+    char k[8];
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        const uint8_t chans = (p.scope == CfgScope::Channel) ? DEVICE_CHANNELS : 1;
+        for (uint8_t ch = 0; ch < chans; ++ch) {
+            const char* key = cfgKey_(p.id, ch, k);
+            if (preferences.isKey(key)) continue;
 
-    // Identite
-    ensureString(KEY_DEV_ID, buildDeviceId_());
-    ensureString(KEY_DEV_NAME, DEFAULT_DEVICE_NAME);
-    ensureString(KEY_DEV_SW, DEVICE_SW_VERSION);
-    ensureString(KEY_DEV_HW, DEVICE_HW_VERSION);
-
-    // Wi-Fi
-    ensureString(KEY_STA_SSID, DEFAULT_STA_SSID);
-    ensureString(KEY_STA_PASS, DEFAULT_STA_PASS);
-    ensureString(KEY_AP_SSID, DEFAULT_AP_SSID);
-    ensureString(KEY_AP_PASS, DEFAULT_AP_PASS);
-    ensureInt(KEY_WIFI_MODE, static_cast<int>(WiFiModeSetting::Sta));
-
-    // Courant / ADC
-    ensureFloat(KEY_CUR_ZERO, DEFAULT_CURRENT_ZERO_MV);
-    ensureFloat(KEY_CUR_SENS, DEFAULT_CURRENT_SENS_MV_A);
-    ensureFloat(KEY_CUR_SCALE, DEFAULT_CURRENT_INPUT_SCALE);
-    ensureFloat(KEY_ADC_REF, DEFAULT_ADC_REF_V);
-    ensureInt(KEY_ADC_MAX, DEFAULT_ADC_MAX);
-
-    // OVC
-    ensureFloat(KEY_LIM_CUR, DEFAULT_LIMIT_CURRENT_A);
-    ensureInt(KEY_OVC_MODE, static_cast<int>(OvcMode::Latch));
-    ensureUInt(KEY_OVC_MIN, DEFAULT_OVC_MIN_DURATION_MS);
-    ensureUInt(KEY_OVC_RTRY, DEFAULT_OVC_RETRY_DELAY_MS);
-
-    // Temperatures
-    ensureFloat(KEY_TEMP_MOTOR, DEFAULT_TEMP_MOTOR_C);
-    ensureFloat(KEY_TEMP_BOARD, DEFAULT_TEMP_BOARD_C);
-    ensureFloat(KEY_TEMP_AMB, DEFAULT_TEMP_AMBIENT_C);
-    ensureFloat(KEY_TEMP_HYST, DEFAULT_TEMP_HYST_C);
-    ensureBool(KEY_LATCH_TEMP, DEFAULT_LATCH_OVERTEMP);
-
-    // Exploitation
-    ensureBool(KEY_RELAY_LAST, false);
-    ensureBool(KEY_RESET_FLAG, true);
-    ensureUInt(KEY_SAMPLING_HZ, DEFAULT_SAMPLING_HZ);
-    ensureFloat(KEY_MOTOR_VCC, DEFAULT_MOTOR_VCC_V);
-    ensureBool(KEY_BUZZ_EN, DEFAULT_BUZZER_ENABLED);
-
-    // RTC / NTP
-    ensureULong64(KEY_RTC_EPOCH, 0ULL);
-    ensureString(KEY_TZ, DEFAULT_TZ_NAME);
-    ensureInt(KEY_TZ_MIN, DEFAULT_TZ_OFFSET_MIN);
-    ensureString(KEY_NTP_SERVER, DEFAULT_NTP_SERVER);
-    ensureUInt(KEY_NTP_SYNC, DEFAULT_NTP_SYNC_INTERVAL_S);
-
-    // Auth
-    ensureString(KEY_AUTH_MODE, DEFAULT_AUTH_MODE);
-    ensureString(KEY_AUTH_USER, DEFAULT_AUTH_USER);
-    ensureString(KEY_AUTH_PASS, DEFAULT_AUTH_PASS);
-    ensureString(KEY_AUTH_TOKEN, "");
-
-    // Marche temporisee
-    ensureUInt(KEY_RUN_DEFAULT, DEFAULT_RUN_DEFAULT_S);
-    ensureUInt(KEY_RUN_MAX, DEFAULT_RUN_MAX_S);
-
-    // Stockage SPIFFS
-    ensureUInt(KEY_EVENT_MAX, DEFAULT_EVENTLOG_MAX_ENTRIES);
-    ensureUInt(KEY_SESS_MAX, DEFAULT_SESSION_MAX_ENTRIES);
-    ensureString(KEY_SPIFFS_SESS, DEFAULT_SPIFFS_SESS_FILE);
-    ensureString(KEY_SPIFFS_EVT, DEFAULT_SPIFFS_EVT_FILE);
+            const CfgValue v = cfgDefault(p.id);
+            switch (p.type) {
+                case CfgType::Bool:    preferences.putBool(key, v.b); break;
+                case CfgType::Int:     preferences.putInt(key, v.i); break;
+                case CfgType::UInt:    preferences.putUInt(key, v.u); break;
+                case CfgType::ULong64: preferences.putULong64(key, v.u64); break;
+                case CfgType::Float:   preferences.putFloat(key, v.f); break;
+                case CfgType::String:
+                    // Seul DevId n'a pas de defaut fixe (derive du MAC).
+                    preferences.putString(key, p.defStr ? String(p.defStr) : buildDeviceId_());
+                    break;
+            }
+        }
+    }
 
+    // Ecritures directes ci-dessus : le miroir est relu a la demande.
+    resetMirror_();
     unlock_();
 }
 
@@ -186,18 +145,39 @@ void NVS::begin() {
     ensureOpenRW_();
     unlock_();
 
-    bool resetFlag = GetBool(KEY_RESET_FLAG, true);
+    const uint32_t t0 = micros();
+    const bool fromBlob = NVS_CONFIG_BLOB && loadBlob_();
+    // Parametres State : hors blob, toujours lus cle par cle.
+    if (fromBlob) loadCfg_(true);
+
+    bool resetFlag = fromBlob ? GetCfg<CfgId::ResetFlag>() : GetBool(KEY_RESET_FLAG, true);
     if (resetFlag) {
          DEBUG_PRINTLN("[NVS]  setting defaults");
         ensureDefaults_();
-        PutBool(KEY_RESET_FLAG, false);
+        PutCfg<CfgId::ResetFlag>(false);
         RestartSysDelayDown(3000);
         
     };
+
+    if (!fromBlob) {
+        loadCfg_();
+        // Blob absent, corrompu ou d'un autre schema : reecrit au prochain Flush.
+        if (NVS_CONFIG_BLOB) {
+            lock_();
+            blobDirty_ = true;
+            pending_ = true;
+            unlock_();
+        }
+    }
+    DEBUG_PRINT(fromBlob ? "[NVS] Config (blob) chargee en " : "[NVS] Config (cles) chargee en ");
+    DEBUG_PRINT(static_cast<uint32_t>(micros() - t0));
+    DEBUG_PRINTLN(" us");
      DEBUG_PRINTLN("[NVS] Use default!");
 }
 
 void NVS::end() {
+    Flush();
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
     lock_();
     if (is_open_) {
         preferences.end();
@@ -205,84 +185,767 @@ void NVS::end() {
         open_rw_ = false;
     }
     unlock_();
+    xSemaphoreGive(ioMutex_);
 }
 
 // -----------------------------------------------------------------------------
-// Ecritures
+// Miroir RAM
 // -----------------------------------------------------------------------------
-void NVS::PutBool(const char* key, bool value) {
-    lock_();
+NVS::Entry* NVS::slot_(const char* key, bool* created) {
+    // Hachage FNV-1a de la cle, puis sondage lineaire.
+    uint32_t h = 2166136261UL;
+    for (const char* p = key; *p; ++p) {
+        h = (h ^ static_cast<uint8_t>(*p)) * 16777619UL;
+    }
+    for (uint32_t n = 0; n < NVS_MIRROR_SLOTS; ++n) {
+        Entry& e = mirror_[(h + n) % NVS_MIRROR_SLOTS];
+        if (e.key[0] == 0) {
+            strncpy(e.key, key, sizeof(e.key) - 1);
+            e.key[sizeof(e.key) - 1] = 0;
+            *created = true;
+            return &e;
+        }
+        if (strncmp(e.key, key, sizeof(e.key)) == 0) {
+            *created = false;
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+NVS::Entry* NVS::fetch_(const char* key, Type type) {
+    bool created = false;
+    Entry* e = slot_(key, &created);
+    if (e && created) load_(*e, type);
+    return e;
+}
+
+void NVS::seed_(const char* key, Type type, const Value& v, const void* data, size_t len) {
+    // Une valeur en attente d'ecriture est plus recente que le blob.
+    bool created = false;
+    Entry* e = slot_(key, &created);
+    if (!e || (!created && e->dirty)) return;
+    e->type = type;
+    e->present = true;
+    e->dirty = false;
+    e->v = v;
+    setData_(*e, data, len);
+}
+
+NVS::Entry* NVS::lookup_(const char* key, Type type, Entry& scratch) {
+    Entry* e = fetch_(key, type);
+    if (e) return e;
+    // Table pleine : lecture directe dans une entree temporaire.
+    strncpy(scratch.key, key, sizeof(scratch.key) - 1);
+    load_(scratch, type);
+    return &scratch;
+}
+
+void NVS::load_(Entry& e, Type type) {
+    // Seul acces flash en lecture pour cette cle (type du premier acces).
     ensureOpenRW_();
-    preferences.putBool(key, value);
+    e.type = type;
+    e.dirty = false;
+    e.present = preferences.isKey(e.key);
+    e.v.u64 = 0;
+    if (!e.present) return;
+
+    switch (type) {
+        case Type::Bool:    e.v.b = preferences.getBool(e.key, false); break;
+        case Type::Int:     e.v.i = preferences.getInt(e.key, 0); break;
+        case Type::UInt:    e.v.u = preferences.getUInt(e.key, 0); break;
+        case Type::ULong64: e.v.u64 = preferences.getULong64(e.key, 0); break;
+        case Type::Float:   e.v.f = preferences.getFloat(e.key, 0.0f); break;
+        case Type::String: {
+            const String str = preferences.getString(e.key, "");
+            setData_(e, str.c_str(), str.length() + 1);
+            break;
+        }
+        case Type::Bytes: {
+            const size_t len = preferences.getBytesLength(e.key);
+            setData_(e, nullptr, len);
+            if (e.data) preferences.getBytes(e.key, e.data, e.len);
+            break;
+        }
+        default: break;
+    }
+}
+
+void NVS::setData_(Entry& e, const void* data, size_t len) {
+    free(e.data);
+    e.data = nullptr;
+    e.len = 0;
+    if (len == 0 || len > 0xFFFF) return;
+    e.data = static_cast<uint8_t*>(malloc(len));
+    if (!e.data) return;
+    if (data) memcpy(e.data, data, len);
+    e.len = static_cast<uint16_t>(len);
+}
+
+bool NVS::write_(Entry& e) {
+    // Appele sous lock_() (ou sur une copie sous ioMutex_, Flush) ;
+    // l'entree reste sale si l'ecriture echoue.
+    ensureOpenRW_();
+    if (!e.present) {
+        return !preferences.isKey(e.key) || preferences.remove(e.key);
+    }
+    switch (e.type) {
+        case Type::Bool:    return preferences.putBool(e.key, e.v.b) > 0;
+        case Type::Int:     return preferences.putInt(e.key, e.v.i) > 0;
+        case Type::UInt:    return preferences.putUInt(e.key, e.v.u) > 0;
+        case Type::ULong64: return preferences.putULong64(e.key, e.v.u64) > 0;
+        case Type::Float:   return preferences.putFloat(e.key, e.v.f) > 0;
+        case Type::String:
+            // putString renvoie 0 pour une chaine vide : pas une erreur.
+            return preferences.putString(e.key, e.data ? reinterpret_cast<const char*>(e.data) : "") > 0 ||
+                   !e.data || e.data[0] == 0;
+        case Type::Bytes:
+            return e.len == 0 || preferences.putBytes(e.key, e.data, e.len) == e.len;
+        default:
+            return true;
+    }
+}
+
+bool NVS::getValue_(const char* key, Type type, Value& out) {
+    Entry scratch = {};
+    lock_();
+    const Entry* e = lookup_(key, type, scratch);
+    // Type different du stockage : meme semantique que NVS (defaut).
+    const bool ok = e->present && e->type == type;
+    if (ok) out = e->v;
     unlock_();
+    return ok;
 }
 
-void NVS::PutInt(const char* key, int value) {
+bool NVS::putValue_(const char* key, Type type, const Value& v) {
+    bool changed = true;
     lock_();
-    ensureOpenRW_();
-    preferences.putInt(key, value);
+    wear_.puts++;
+    Entry* e = fetch_(key, type);
+    if (!e) {
+        // Table pleine : ecriture directe.
+        Entry tmp = {};
+        strncpy(tmp.key, key, sizeof(tmp.key) - 1);
+        tmp.type = type;
+        tmp.present = true;
+        tmp.v = v;
+        if (write_(tmp)) countWrite_(tmp, true);
+    } else if (!e->present || e->type != type || memcmp(&e->v, &v, sizeof(Value)) != 0) {
+        if (e->type != type) setData_(*e, nullptr, 0);
+        e->type = type;
+        e->present = true;
+        e->v = v;
+        e->dirty = true;
+        pending_ = true;
+    } else {
+        changed = false;
+    }
+    if (e) e->puts++;
+    if (!changed) wear_.elided++;
     unlock_();
+    return changed;
 }
 
-void NVS::PutUInt(const char* key, unsigned int value) {
+bool NVS::putData_(const char* key, Type type, const void* data, size_t len) {
+    bool changed = true;
     lock_();
-    ensureOpenRW_();
-    preferences.putUInt(key, value);
+    wear_.puts++;
+    Entry* e = fetch_(key, type);
+    if (!e) {
+        Entry tmp = {};
+        strncpy(tmp.key, key, sizeof(tmp.key) - 1);
+        tmp.type = type;
+        tmp.present = true;
+        tmp.data = static_cast<uint8_t*>(const_cast<void*>(data));
+        tmp.len = static_cast<uint16_t>(len);
+        if (write_(tmp)) countWrite_(tmp, true);
+    } else if (!e->present || e->type != type || e->len != len ||
+               (len > 0 && memcmp(e->data, data, len) != 0)) {
+        e->type = type;
+        e->present = true;
+        setData_(*e, data, len);
+        e->dirty = true;
+        pending_ = true;
+    } else {
+        changed = false;
+    }
+    if (e) e->puts++;
+    if (!changed) wear_.elided++;
     unlock_();
+    return changed;
 }
 
-void NVS::PutULong64(const char* key, uint64_t value) {
+size_t NVS::Flush() {
+    // Ecritures flash hors mutex : un Put* / Get* concurrent n'attend
+    // jamais un effacement de page. Copie de l'entree sous lock_(), ecriture
+    // sous ioMutex_ seul (un seul ecrivain flash a la fois).
+    size_t written = 0;
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
     lock_();
-    ensureOpenRW_();
-    preferences.putULong64(key, value);
+    // Blob reconstruit avant le lot : ecrit dans la meme passe.
+    if (NVS_CONFIG_BLOB && blobDirty_) {
+        blobDirty_ = false;
+        saveBlob_();
+    }
+    const bool pending = pending_;
+    pending_ = false;
     unlock_();
+    if (!pending) {
+        xSemaphoreGive(ioMutex_);
+        return 0;
+    }
+
+    // Premiere cle hors budget du lot : journalisee hors mutex.
+    char overKey[8] = {0};
+    uint32_t overWrites = 0;
+    for (uint32_t i = 0; i < NVS_MIRROR_SLOTS; ++i) {
+        lock_();
+        Entry& e = mirror_[i];
+        if (e.key[0] == 0 || !e.dirty) {
+            unlock_();
+            continue;
+        }
+        // Copie (donnees comprises) : l'entree peut changer pendant
+        // l'ecriture ; elle est alors de nouveau sale (prochain Flush).
+        Entry snap = e;
+        snap.data = nullptr;
+        snap.len = 0;
+        if (e.len > 0) {
+            snap.data = static_cast<uint8_t*>(malloc(e.len));
+            if (snap.data) {
+                memcpy(snap.data, e.data, e.len);
+                snap.len = e.len;
+            }
+        }
+        const bool copied = e.len == 0 || snap.data;
+        if (copied) e.dirty = false;
+        else pending_ = true;
+        ensureOpenRW_();
+        unlock_();
+        if (!copied) continue;
+
+        const bool ok = write_(snap);
+        free(snap.data);
+
+        lock_();
+        if (strncmp(e.key, snap.key, sizeof(e.key)) == 0) {
+            if (ok) {
+                written++;
+                if (countWrite_(e, false) && overKey[0] == 0) {
+                    memcpy(overKey, e.key, sizeof(overKey));
+                    overWrites = e.hourWrites;
+                }
+            } else {
+                e.dirty = true;
+                pending_ = true;
+                DEBUG_PRINT("[NVS] Ecriture echouee: ");
+                DEBUG_PRINTLN(e.key);
+            }
+        }
+        unlock_();
+    }
+    xSemaphoreGive(ioMutex_);
+
+    if (overKey[0] != 0) {
+        // Nom de la cle : log serie et /api/diag/nvs ; le journal garde le debit.
+        DEBUG_PRINT("[NVS] Budget d'ecriture depasse: ");
+        DEBUG_PRINTLN(overKey);
+        if (events_) {
+            events_->append(EventLevel::Warning,
+                            static_cast<uint16_t>(WarnCode::W12_NvsWear),
+                            EvtMsg::NvsWear,
+                            EvtSrc::Nvs,
+                            0,
+                            static_cast<float>(overWrites));
+        }
+    }
+    return written;
 }
 
-void NVS::PutFloat(const char* key, float value) {
+// -----------------------------------------------------------------------------
+// Usure de la flash
+// -----------------------------------------------------------------------------
+// Entrees NVS (32 octets) consommees par une ecriture : 1 pour un scalaire,
+// en-tete + donnees pour une chaine ou un blob (approximation : l'index
+// d'un blob multi-pages est ignore). Une suppression n'en consomme pas.
+static uint32_t nvsEntries_(bool present, bool variable, size_t len) {
+    if (!present) return 0;
+    return variable ? 1U + static_cast<uint32_t>((len + 31U) / 32U) : 1U;
+}
+
+bool NVS::countWrite_(Entry& e, bool direct) {
+    // Appele sous lock_().
+    size_t len = 0;
+    switch (e.type) {
+        case Type::Bool:    len = 1; break;
+        case Type::Int:
+        case Type::UInt:
+        case Type::Float:   len = 4; break;
+        case Type::ULong64: len = 8; break;
+        case Type::String:
+        case Type::Bytes:   len = e.len; break;
+        default: break;
+    }
+    if (!e.present) len = 0;
+    const uint32_t entries =
+        nvsEntries_(e.present, e.type == Type::String || e.type == Type::Bytes, len);
+
+    const uint32_t now = millis();
+    if (wearStartMs_ == 0) wearStartMs_ = now ? now : 1;
+    wear_.writes++;
+    wear_.bytes += len;
+    wear_.entries += entries;
+    if (direct) wear_.direct++;
+
+    // Tranche courante du debit glissant (reinitialisee si perimee) ;
+    // numero + 1 : 0 = tranche jamais utilisee.
+    const uint32_t slot = now / (NVS_RATE_WINDOW_MS / NVS_RATE_BUCKETS) + 1U;
+    const uint32_t b = slot % NVS_RATE_BUCKETS;
+    if (rateSlot_[b] != slot) {
+        rateSlot_[b] = slot;
+        rateWrites_[b] = 0;
+        rateEntries_[b] = 0;
+    }
+    rateWrites_[b]++;
+    rateEntries_[b] += entries;
+
+    e.writes++;
+    e.bytes += len;
+    if (e.hourWrites == 0 || (now - e.hourStart) >= NVS_RATE_WINDOW_MS) {
+        e.hourStart = now;
+        e.hourWrites = 0;
+        e.warned = false;
+    }
+    if (e.hourWrites < 0xFFFF) e.hourWrites++;
+    if (direct || NVS_WRITE_BUDGET_H == 0 || e.warned ||
+        e.hourWrites <= NVS_WRITE_BUDGET_H) {
+        return false;
+    }
+    e.warned = true;
+    return true;
+}
+
+void NVS::setEventLog(EventLog* events) {
     lock_();
-    ensureOpenRW_();
-    preferences.putFloat(key, value);
+    events_ = events;
     unlock_();
 }
 
-void NVS::PutString(const char* key, const String& value) {
+void NVS::GetWearStats(WearStats& out) {
     lock_();
-    ensureOpenRW_();
-    preferences.putString(key, value);
+    out = wear_;
+    const uint32_t now = millis();
+    const uint32_t slot = now / (NVS_RATE_WINDOW_MS / NVS_RATE_BUCKETS) + 1U;
+    for (uint32_t b = 0; b < NVS_RATE_BUCKETS; ++b) {
+        if (rateSlot_[b] == 0 || slot - rateSlot_[b] >= NVS_RATE_BUCKETS) continue;
+        out.window_writes += rateWrites_[b];
+        out.window_entries += rateEntries_[b];
+    }
+    uint32_t span = wearStartMs_ ? (now - wearStartMs_) : 0;
+    if (span > NVS_RATE_WINDOW_MS) span = NVS_RATE_WINDOW_MS;
+    unlock_();
+
+    // Debit horaire : extrapole tant que moins d'une heure est couverte
+    // (au moins une minute, pour ne pas amplifier la rafale du boot).
+    out.window_s = span / 1000U;
+    const float hours = static_cast<float>(span < 60000U ? 60000U : span) / 3600000.0f;
+    if (out.writes > 0) {
+        out.writes_per_h = out.window_writes / hours;
+        out.entries_per_h = out.window_entries / hours;
+    }
+
+    nvs_stats_t st;
+    if (nvs_get_stats(nullptr, &st) == ESP_OK) {
+        out.part_ok = true;
+        out.used_entries = st.used_entries;
+        out.free_entries = st.free_entries;
+        out.total_entries = st.total_entries;
+        out.namespaces = st.namespace_count;
+        // Chaque entree de la partition supporte NVS_FLASH_CYCLES
+        // reecritures (effacement de page) ; usure passee inconnue.
+        if (out.entries_per_h > 0.0f && st.total_entries > 0) {
+            out.endurance_years = static_cast<float>(st.total_entries) * NVS_FLASH_CYCLES /
+                                  out.entries_per_h / 8760.0f;
+        }
+    }
+}
+
+size_t NVS::GetKeyWear(KeyWear* out, size_t max) {
+    if (!out || max == 0) return 0;
+    size_t n = 0;
+    lock_();
+    const uint32_t now = millis();
+    for (uint32_t i = 0; i < NVS_MIRROR_SLOTS; ++i) {
+        const Entry& e = mirror_[i];
+        if (e.key[0] == 0 || (e.puts == 0 && e.writes == 0)) continue;
+
+        KeyWear k;
+        memcpy(k.key, e.key, sizeof(k.key));
+        k.puts = e.puts;
+        k.writes = e.writes;
+        k.bytes = e.bytes;
+        k.hour_writes = (e.hourWrites && (now - e.hourStart) < NVS_RATE_WINDOW_MS) ? e.hourWrites : 0;
+        k.over_budget = NVS_WRITE_BUDGET_H > 0 && k.hour_writes > NVS_WRITE_BUDGET_H;
+
+        // Insertion triee (ecritures decroissantes) ; la derniere sort si plein.
+        size_t pos = (n < max) ? n++ : max;
+        while (pos > 0 && out[pos - 1].writes < k.writes) {
+            if (pos < max) out[pos] = out[pos - 1];
+            pos--;
+        }
+        if (pos < max) out[pos] = k;
+    }
     unlock_();
+    return n;
+}
+
+void NVS::ResetWearStats() {
+    lock_();
+    wear_ = WearStats();
+    wearStartMs_ = 0;
+    memset(rateSlot_, 0, sizeof(rateSlot_));
+    memset(rateWrites_, 0, sizeof(rateWrites_));
+    memset(rateEntries_, 0, sizeof(rateEntries_));
+    for (uint32_t i = 0; i < NVS_MIRROR_SLOTS; ++i) {
+        Entry& e = mirror_[i];
+        e.puts = 0;
+        e.writes = 0;
+        e.bytes = 0;
+        e.hourWrites = 0;
+        e.warned = false;
+    }
+    unlock_();
+}
+
+// -----------------------------------------------------------------------------
+// Ecritures
+// -----------------------------------------------------------------------------
+void NVS::PutBool(const char* key, bool value) {
+    Value v;
+    v.u64 = 0;
+    v.b = value;
+    putValue_(key, Type::Bool, v);
+}
+
+void NVS::PutInt(const char* key, int value) {
+    Value v;
+    v.u64 = 0;
+    v.i = value;
+    putValue_(key, Type::Int, v);
+}
+
+void NVS::PutUInt(const char* key, unsigned int value) {
+    Value v;
+    v.u64 = 0;
+    v.u = value;
+    putValue_(key, Type::UInt, v);
+}
+
+void NVS::PutULong64(const char* key, uint64_t value) {
+    Value v;
+    v.u64 = 0;
+    v.u64 = value;
+    putValue_(key, Type::ULong64, v);
+}
+
+void NVS::PutFloat(const char* key, float value) {
+    Value v;
+    v.u64 = 0;
+    v.f = value;
+    putValue_(key, Type::Float, v);
+}
+
+void NVS::PutString(const char* key, const String& value) {
+    putData_(key, Type::String, value.c_str(), value.length() + 1);
+}
+
+void NVS::PutBytes(const char* key, const void* data, size_t len) {
+    putData_(key, Type::Bytes, data, len);
 }
 
 // -----------------------------------------------------------------------------
 // Lectures
 // -----------------------------------------------------------------------------
 bool NVS::GetBool(const char* key, bool defaultValue) {
-    ensureOpenRW_();
-    return preferences.getBool(key, defaultValue);
+    Value v;
+    return getValue_(key, Type::Bool, v) ? v.b : defaultValue;
 }
 
 int NVS::GetInt(const char* key, int defaultValue) {
-    ensureOpenRW_();
-    return preferences.getInt(key, defaultValue);
+    Value v;
+    return getValue_(key, Type::Int, v) ? v.i : defaultValue;
 }
 
 uint32_t NVS::GetUInt(const char* key, uint32_t defaultValue) {
-    ensureOpenRW_();
-    return preferences.getUInt(key, defaultValue);
+    Value v;
+    return getValue_(key, Type::UInt, v) ? v.u : defaultValue;
 }
 
 uint64_t NVS::GetULong64(const char* key, uint64_t defaultValue) {
-    ensureOpenRW_();
-    return preferences.getULong64(key, defaultValue);
+    Value v;
+    return getValue_(key, Type::ULong64, v) ? v.u64 : defaultValue;
 }
 
 float NVS::GetFloat(const char* key, float defaultValue) {
-    ensureOpenRW_();
-    return preferences.getFloat(key, defaultValue);
+    Value v;
+    return getValue_(key, Type::Float, v) ? v.f : defaultValue;
 }
 
 String NVS::GetString(const char* key, const String& defaultValue) {
+    Entry scratch = {};
+    lock_();
+    const Entry* e = lookup_(key, Type::String, scratch);
+    String out = (e->present && e->type == Type::String && e->data)
+                     ? String(reinterpret_cast<const char*>(e->data))
+                     : defaultValue;
+    unlock_();
+    free(scratch.data);
+    return out;
+}
+
+size_t NVS::GetChars(const char* key, char* out, size_t len, const char* defaultValue) {
+    if (!out || len == 0) return 0;
+    Entry scratch = {};
+    lock_();
+    const Entry* e = lookup_(key, Type::String, scratch);
+    const char* src = (e->present && e->type == Type::String && e->data)
+                          ? reinterpret_cast<const char*>(e->data)
+                          : (defaultValue ? defaultValue : "");
+    strncpy(out, src, len - 1);
+    out[len - 1] = 0;
+    unlock_();
+    free(scratch.data);
+    return strlen(out);
+}
+
+size_t NVS::GetBytes(const char* key, void* out, size_t len) {
+    Entry scratch = {};
+    lock_();
+    const Entry* e = lookup_(key, Type::Bytes, scratch);
+    size_t n = 0;
+    if (e->present && e->type == Type::Bytes && e->data) {
+        n = (e->len < len) ? e->len : len;
+        memcpy(out, e->data, n);
+    }
+    unlock_();
+    free(scratch.data);
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+// Schema (ConfigSchema.hpp)
+// -----------------------------------------------------------------------------
+NVS::Type NVS::typeOf_(CfgType t) {
+    switch (t) {
+        case CfgType::Bool:    return Type::Bool;
+        case CfgType::Int:     return Type::Int;
+        case CfgType::UInt:    return Type::UInt;
+        case CfgType::ULong64: return Type::ULong64;
+        case CfgType::Float:   return Type::Float;
+        case CfgType::String:  return Type::String;
+    }
+    return Type::None;
+}
+
+const char* NVS::cfgKey_(CfgId id, uint8_t ch, char* buf) {
+    const CfgParam& p = cfgParam(id);
+    return ChannelKey(p.key, (p.scope == CfgScope::Channel) ? ch : 0, buf);
+}
+
+void NVS::loadCfg_(bool stateOnly) {
+    // Seule lecture "par cle" des parametres numeriques : ensuite, acces
+    // tableau. Valeur hors bornes (ancienne version, flash corrompue) :
+    // defaut du schema.
+    char k[8];
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        if (p.type == CfgType::String || (stateOnly && cfgInBlob(p))) continue;
+        const uint8_t chans = (p.scope == CfgScope::Channel) ? DEVICE_CHANNELS : 1;
+        for (uint8_t ch = 0; ch < chans; ++ch) {
+            const char* key = cfgKey_(p.id, ch, k);
+            const CfgValue def = cfgDefault(p.id);
+            Value v = {};
+            if (!getValue_(key, typeOf_(p.type), v) ||
+                !cfgInRange(p.id, v)) {
+                v = def;
+            }
+            lock_();
+            cfg_[i][ch] = v;
+            unlock_();
+        }
+    }
+}
+
+CfgValue NVS::GetCfgValue(CfgId id, uint8_t ch) {
+    const CfgParam& p = cfgParam(id);
+    if (p.scope == CfgScope::Global) ch = 0;
+    if (ch >= DEVICE_CHANNELS || p.type == CfgType::String) return cfgDefault(id);
+    lock_();
+    const CfgValue v = cfg_[static_cast<size_t>(id)][ch];
+    unlock_();
+    return v;
+}
+
+bool NVS::PutCfgValue(CfgId id, uint8_t ch, const CfgValue& value) {
+    const CfgParam& p = cfgParam(id);
+    if (p.scope == CfgScope::Global) ch = 0;
+    if (ch >= DEVICE_CHANNELS || !cfgInRange(id, value)) return false;
+
+    char k[8];
+    lock_();
+    cfg_[static_cast<size_t>(id)][ch] = value;
+    // State : cle seule (le blob n'est pas reecrit a chaque changement).
+    if (putValue_(cfgKey_(id, ch, k), typeOf_(p.type), value) && cfgInBlob(p)) blobDirty_ = true;
+    unlock_();
+    return true;
+}
+
+String NVS::GetCfgString(CfgId id) {
+    const CfgParam& p = cfgParam(id);
+    return GetString(p.key, p.defStr ? p.defStr : "");
+}
+
+size_t NVS::GetCfgChars(CfgId id, char* out, size_t len) {
+    const CfgParam& p = cfgParam(id);
+    return GetChars(p.key, out, len, p.defStr ? p.defStr : "");
+}
+
+bool NVS::PutCfgString(CfgId id, const String& value) {
+    if (!cfgInRange(id, value)) return false;
+    lock_();
+    if (putData_(cfgParam(id).key, Type::String, value.c_str(), value.length() + 1) &&
+        cfgInBlob(cfgParam(id))) {
+        blobDirty_ = true;
+    }
+    unlock_();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Blob de configuration
+// -----------------------------------------------------------------------------
+// En-tete (little-endian) puis parametres dans l'ordre du schema.
+struct __attribute__((packed)) CfgBlobHeader {
+    uint16_t magic;     // kBlobMagic
+    uint8_t format;     // disposition du blob (kBlobFormat)
+    uint8_t channels;   // DEVICE_CHANNELS a l'ecriture
+    uint32_t schema;    // CFG_SCHEMA_HASH a l'ecriture
+    uint16_t len;       // octets apres l'en-tete
+    uint32_t crc;       // CRC32 des octets apres l'en-tete
+};
+static constexpr uint16_t kBlobMagic = 0xC0F6;
+static constexpr uint8_t kBlobFormat = 2;  // 2 : parametres State exclus
+static constexpr size_t kBlobMax = sizeof(CfgBlobHeader) + CFG_BLOB_MAX;
+
+bool NVS::loadBlob_() {
+    uint8_t* buf = new uint8_t[kBlobMax];
+    lock_();
     ensureOpenRW_();
-    return preferences.getString(key, defaultValue);
+    // Un seul acces flash pour toute la configuration.
+    const size_t len = preferences.getBytes(KEY_CFG_BLOB, buf, kBlobMax);
+    CfgBlobHeader h;
+    bool ok = len >= sizeof(h);
+    if (ok) {
+        memcpy(&h, buf, sizeof(h));
+        ok = h.magic == kBlobMagic && h.format == kBlobFormat &&
+             h.channels == DEVICE_CHANNELS && h.schema == CFG_SCHEMA_HASH &&
+             h.len == len - sizeof(h) &&
+             esp_rom_crc32_le(0, buf + sizeof(h), h.len) == h.crc;
+    }
+
+    // Decodage dans une copie : un blob tronque ne laisse rien a moitie.
+    CfgValue vals[CFG_COUNT][DEVICE_CHANNELS] = {};
+    size_t off = sizeof(h);
+    for (size_t i = 0; ok && i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        if (!cfgInBlob(p)) continue;
+        if (p.type == CfgType::String) {
+            ok = off < len && off + 1 + buf[off] <= len;
+            if (ok) off += 1 + buf[off];
+            continue;
+        }
+        const size_t sz = cfgTypeSize(p.type);
+        const uint8_t chans = (p.scope == CfgScope::Channel) ? DEVICE_CHANNELS : 1;
+        for (uint8_t ch = 0; ok && ch < chans; ++ch) {
+            ok = off + sz <= len;
+            if (!ok) break;
+            memcpy(&vals[i][ch], buf + off, sz);
+            if (!cfgInRange(p.id, vals[i][ch])) vals[i][ch] = cfgDefault(p.id);
+            off += sz;
+        }
+    }
+
+    if (ok) {
+        // Tableau + miroir (cles individuelles) remplis sans lecture flash.
+        char k[8];
+        char text[256];
+        off = sizeof(h);
+        for (size_t i = 0; i < CFG_COUNT; ++i) {
+            const CfgParam& p = kCfgSchema[i];
+            if (!cfgInBlob(p)) continue;
+            if (p.type == CfgType::String) {
+                const uint8_t n = buf[off++];
+                memcpy(text, buf + off, n);
+                text[n] = 0;
+                off += n;
+                seed_(p.key, Type::String, Value{}, text, n + 1U);
+                continue;
+            }
+            const uint8_t chans = (p.scope == CfgScope::Channel) ? DEVICE_CHANNELS : 1;
+            for (uint8_t ch = 0; ch < chans; ++ch) {
+                cfg_[i][ch] = vals[i][ch];
+                seed_(cfgKey_(p.id, ch, k), typeOf_(p.type), vals[i][ch], nullptr, 0);
+                off += cfgTypeSize(p.type);
+            }
+        }
+        seed_(KEY_CFG_BLOB, Type::Bytes, Value{}, buf, len);
+    }
+    unlock_();
+    delete[] buf;
+    return ok;
+}
+
+void NVS::saveBlob_() {
+    // Appele sous lock_() par Flush().
+    uint8_t* buf = new uint8_t[kBlobMax];
+    size_t off = sizeof(CfgBlobHeader);
+    for (size_t i = 0; i < CFG_COUNT; ++i) {
+        const CfgParam& p = kCfgSchema[i];
+        if (!cfgInBlob(p)) continue;
+        if (p.type == CfgType::String) {
+            char text[256];
+            const size_t n = GetChars(p.key, text, static_cast<size_t>(p.max) + 1,
+                                      p.defStr ? p.defStr : "");
+            buf[off++] = static_cast<uint8_t>(n);
+            memcpy(buf + off, text, n);
+            off += n;
+            continue;
+        }
+        const size_t sz = cfgTypeSize(p.type);
+        const uint8_t chans = (p.scope == CfgScope::Channel) ? DEVICE_CHANNELS : 1;
+        for (uint8_t ch = 0; ch < chans; ++ch) {
+            memcpy(buf + off, &cfg_[i][ch], sz);
+            off += sz;
+        }
+    }
+
+    CfgBlobHeader h;
+    h.magic = kBlobMagic;
+    h.format = kBlobFormat;
+    h.channels = DEVICE_CHANNELS;
+    h.schema = CFG_SCHEMA_HASH;
+    h.len = static_cast<uint16_t>(off - sizeof(h));
+    h.crc = esp_rom_crc32_le(0, buf + sizeof(h), h.len);
+    memcpy(buf, &h, sizeof(h));
+
+    putData_(KEY_CFG_BLOB, Type::Bytes, buf, off);
+    delete[] buf;
+}
+
+const char* NVS::ChannelKey(const char* base, uint8_t ch, char* buf) {
+    if (ch == 0) return base;
+    snprintf(buf, 8, "%.5s%u", base, static_cast<unsigned>(ch % DEVICE_MAX_CHANNELS));
+    return buf;
 }
 
 // -----------------------------------------------------------------------------
@@ -290,18 +953,38 @@ String NVS::GetString(const char* key, const String& defaultValue) {
 // -----------------------------------------------------------------------------
 void NVS::RemoveKey(const char* key) {
     lock_();
-    ensureOpenRW_();
-    if (preferences.isKey(key)) {
-        preferences.remove(key);
+    Entry* e = fetch_(key, Type::None);
+    if (!e) {
+        ensureOpenRW_();
+        if (preferences.isKey(key)) preferences.remove(key);
+    } else if (e->present) {
+        // Suppression differee, comme une ecriture.
+        e->present = false;
+        setData_(*e, nullptr, 0);
+        e->dirty = true;
+        pending_ = true;
     }
     unlock_();
 }
 
 void NVS::ClearAll() {
+    // Pas d'ecriture Flush en cours pendant l'effacement.
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
     lock_();
     ensureOpenRW_();
     preferences.clear();
+    resetMirror_();
     unlock_();
+    xSemaphoreGive(ioMutex_);
+}
+
+void NVS::resetMirror_() {
+    // Appele sous lock_() : le miroir sera relu depuis la flash.
+    for (uint32_t i = 0; i < NVS_MIRROR_SLOTS; ++i) {
+        free(mirror_[i].data);
+        mirror_[i] = Entry{};
+    }
+    pending_ = false;
 }
 inline void NVS::sleepMs_(uint32_t ms) {
     if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
@@ -346,7 +1029,8 @@ void NVS::RestartSysDelay(unsigned long delayTime) {
     }
     DEBUG_PRINTLN();
     DEBUG_PRINTLN("[NVS] Restarting now...");
-    
+    // Journal, sessions et NVS en attente (Persist) ecrits avant reboot.
+    PERSIST->flush();
     ESP.restart();
 }
 
@@ -368,6 +1052,9 @@ void NVS::CountdownDelay(unsigned long delayTime) {
 }
 
 void NVS::simulatePowerDown() {
+    // Valeurs en attente ecrites avant la coupure (ex: KEY_RESET_FLAG),
+    // avec les ecritures en file de Persist.
+    PERSIST->flush();
     esp_sleep_enable_timer_wakeup(1000000); // 1s
     esp_deep_sleep_start();
 }
@@ -1,6 +1,44 @@
 /**************************************************************
  *  Gestion NVS (Preferences) - ecritures protegees
  *
+ *  Miroir RAM + ecriture differee :
+ *  - Chaque cle est lue une seule fois en flash (premier acces), puis
+ *    servie depuis une table RAM (NVS_MIRROR_SLOTS entrees, hachage).
+ *  - Put* ignore une valeur identique ; sinon l'entree est marquee
+ *    "sale" et ecrite par la tache Persist toutes les NVS_FLUSH_MS
+ *    (plusieurs ecritures rapprochees => une seule ecriture flash).
+ *  - L'ecriture se fait sur une copie de l'entree, hors mutex : Put* et
+ *    Get* n'attendent jamais un effacement flash.
+ *  - Flush() ecrit immediatement (valeurs critiques, avant reboot ou
+ *    sommeil profond). Table pleine => acces direct a Preferences.
+ *
+ *  Parametres du schema (ConfigSchema.hpp) :
+ *  - Valeurs numeriques chargees et validees au boot dans un tableau
+ *    indexe par CfgId (et canal) : GetCfg<Id>(ch) = un acces tableau.
+ *  - PutCfg<Id>(v, ch) valide les bornes, met a jour le tableau et ecrit
+ *    la cle NVS (ecriture differee ci-dessus).
+ *  - Une cle du schema ne doit pas etre ecrite par Put*(cle) (tableau
+ *    non mis a jour).
+ *
+ *  Blob de configuration (NVS_CONFIG_BLOB) :
+ *  - Les parametres du schema sont aussi ranges dans une seule cle
+ *    (KEY_CFG_BLOB : en-tete + empreinte du schema + CRC32), reecrite par
+ *    Flush() apres une modification. Au boot, un seul getBytes() remplit
+ *    le tableau et le miroir.
+ *  - Sauf les parametres State (relais, epoch RTC, drapeau de reset) :
+ *    ecrits souvent, ils restent en cles seules (lues au boot) et ne
+ *    reecrivent jamais le blob.
+ *  - Les cles individuelles restent ecrites et font reference : blob
+ *    absent, corrompu ou ecrit par un autre schema (firmware) => import
+ *    cle par cle (nouveaux parametres au defaut), puis blob reecrit.
+ *
+ *  Usure de la flash (diagnostic /api/diag/nvs) :
+ *  - Par cle : Put* recus, ecritures flash reelles, octets ecrits.
+ *  - Global : debit glissant sur une heure, entrees NVS utilisees/libres
+ *    (nvs_get_stats) et duree de vie estimee au debit courant.
+ *  - Une cle ecrite plus de NVS_WRITE_BUDGET_H fois en une heure produit
+ *    un warning W12 (EventLog), une fois par heure et par cle.
+ *
  *  Commentaires en francais, ASCII uniquement.
  **************************************************************/
 #ifndef NVS_MANAGER_H
@@ -8,10 +46,44 @@
 
 #include <Preferences.h>
 #include <Config.hpp>
+#include <ConfigSchema.hpp>
 #include <Utils.hpp>
 
+class EventLog;
+
 class NVS {
 public:
+    // Compteurs d'usure d'une cle (depuis le boot ou le dernier reset).
+    struct KeyWear {
+        char key[8];
+        uint32_t puts;       // Put* recus (y compris valeur identique)
+        uint32_t writes;     // ecritures flash reelles
+        uint32_t bytes;      // octets de donnees ecrits
+        uint32_t hour_writes; // ecritures dans l'heure en cours (budget)
+        bool over_budget;
+    };
+
+    // Vue globale de l'usure.
+    struct WearStats {
+        uint32_t puts = 0;
+        uint32_t elided = 0;       // Put* ignores (valeur identique)
+        uint32_t writes = 0;       // ecritures flash (toutes cles)
+        uint32_t direct = 0;       // dont hors miroir (table pleine)
+        uint32_t bytes = 0;
+        uint32_t entries = 0;      // entrees NVS de 32 octets consommees
+        uint32_t window_s = 0;     // duree couverte par le debit (<= 1 h)
+        uint32_t window_writes = 0;
+        uint32_t window_entries = 0;
+        float writes_per_h = 0.0f; // extrapole si window_s < 1 h
+        float entries_per_h = 0.0f;
+        bool part_ok = false;      // nvs_get_stats() a repondu
+        uint32_t used_entries = 0;
+        uint32_t free_entries = 0;
+        uint32_t total_entries = 0;
+        uint32_t namespaces = 0;
+        float endurance_years = -1.0f; // -1 : pas d'ecriture, inconnu
+    };
+
     // Singleton
     static void Init();
     static NVS* Get();
@@ -26,7 +98,7 @@ public:
     // end(): ferme Preferences (optionnel, rarement necessaire)
     void end();
 
-    // Ecriture
+    // Ecriture (differee, voir Flush)
     // NOTE: dans l'architecture cible, Device est le seul ecrivain logique.
     // Ici on fournit l'API generique, mais la convention d'usage est importante.
     void PutBool   (const char* key, bool value);
@@ -35,15 +107,54 @@ public:
     void PutULong64(const char* key, uint64_t value);
     void PutFloat  (const char* key, float value);
     void PutString (const char* key, const String& value);
+    void PutBytes  (const char* key, const void* data, size_t len);
+
+    // Ecrit en flash toutes les valeurs en attente ; retourne le nombre
+    // de cles ecrites. Appele par la tache Persist et avant un reboot.
+    size_t Flush();
 
-    // Lecture
-    // Lectures sans semaphore, Preferences reste ouverte en RW.
+    // Lecture (depuis le miroir RAM, sans acces flash apres le premier)
     bool     GetBool   (const char* key, bool defaultValue);
     int      GetInt    (const char* key, int defaultValue);
     uint32_t GetUInt   (const char* key, uint32_t defaultValue);
     uint64_t GetULong64(const char* key, uint64_t defaultValue);
     float    GetFloat  (const char* key, float defaultValue);
     String   GetString (const char* key, const String& defaultValue);
+    // GetBytes: copie au plus len octets, retourne la taille lue (0 si absente).
+    size_t   GetBytes  (const char* key, void* out, size_t len);
+    // GetChars: chaine copiee dans out (tronquee, toujours terminee),
+    // sans allocation ; defaultValue si absente. Retourne la longueur copiee.
+    size_t   GetChars  (const char* key, char* out, size_t len, const char* defaultValue);
+
+    // Acces types aux parametres du schema (type verifie a la compilation).
+    // ch ignore pour un parametre global ; canal invalide => defaut / refus.
+    template <CfgId Id>
+    typename CfgOf<Id>::type GetCfg(uint8_t ch = 0) {
+        return getCfg_(Id, ch, static_cast<typename CfgOf<Id>::type*>(nullptr));
+    }
+    template <CfgId Id>
+    bool PutCfg(const typename CfgOf<Id>::type& value, uint8_t ch = 0) {
+        return putCfg_(Id, ch, value);
+    }
+
+    // Acces par identifiant a l'execution (boucles sur le schema).
+    // PutCfgValue / PutCfgString : false si hors bornes ou canal invalide.
+    CfgValue GetCfgValue(CfgId id, uint8_t ch = 0);
+    bool     PutCfgValue(CfgId id, uint8_t ch, const CfgValue& value);
+    String   GetCfgString(CfgId id);
+    size_t   GetCfgChars(CfgId id, char* out, size_t len);
+    bool     PutCfgString(CfgId id, const String& value);
+
+    // Cle par canal : canal 0 => base (compatibilite), canal N => base + "N".
+    // buf doit contenir au moins 8 octets ; retourne la cle a utiliser.
+    static const char* ChannelKey(const char* base, uint8_t ch, char* buf);
+
+    // Usure : journal pour les warnings W12 (optionnel, apres EventLog).
+    void setEventLog(EventLog* events);
+    void GetWearStats(WearStats& out);
+    // Cles les plus ecrites (tri decroissant) ; retourne le nombre copie.
+    size_t GetKeyWear(KeyWear* out, size_t max);
+    void ResetWearStats();
 
     // Maintenance
     // RemoveKey: supprime une cle (attention: perte de persistance).
@@ -64,17 +175,95 @@ private:
     NVS(const NVS&) = delete;
     NVS& operator=(const NVS&) = delete;
 
+    enum class Type : uint8_t { None = 0, Bool, Int, UInt, ULong64, Float, String, Bytes };
+
+    typedef CfgValue Value;
+
+    // Entree du miroir. Slot libre : key[0] == 0. Une cle absente (ou
+    // supprimee) garde son slot avec present=false (sondage lineaire).
+    struct Entry {
+        char key[8];
+        Type type;
+        bool present;
+        bool dirty;
+        Value v;
+        uint8_t* data;  // String (avec '\0') ou Bytes, alloue
+        uint16_t len;
+        // Usure (voir KeyWear) ; fenetre budget = heure depuis hourStart.
+        uint32_t puts;
+        uint32_t writes;
+        uint32_t bytes;
+        uint32_t hourStart;
+        uint16_t hourWrites;
+        bool warned;
+    };
+
     void ensureDefaults_();
     void ensureOpenRW_();
     void lock_();
     void unlock_();
 
+    // Schema : cle NVS du parametre (canal), chargement du tableau.
+    static const char* cfgKey_(CfgId id, uint8_t ch, char* buf);
+    static Type typeOf_(CfgType t);
+    // stateOnly : parametres hors blob seulement (apres loadBlob_).
+    void loadCfg_(bool stateOnly = false);
+    // Blob : lecture au boot (false => import cle par cle), ecriture.
+    bool loadBlob_();
+    void saveBlob_();
+
+    template <typename T>
+    T getCfg_(CfgId id, uint8_t ch, T*) { return CfgConv<T>::get(GetCfgValue(id, ch)); }
+    String getCfg_(CfgId id, uint8_t, String*) { return GetCfgString(id); }
+    template <typename T>
+    bool putCfg_(CfgId id, uint8_t ch, const T& v) { return PutCfgValue(id, ch, CfgConv<T>::make(v)); }
+    bool putCfg_(CfgId id, uint8_t, const String& v) { return PutCfgString(id, v); }
+
+    // Entree de la cle (chargee depuis la flash au premier acces),
+    // nullptr si table pleine. Appele sous lock_().
+    Entry* fetch_(const char* key, Type type);
+    // Slot de la cle (cree vide si absent, *created = true).
+    Entry* slot_(const char* key, bool* created);
+    // Remplit une entree sans lecture flash (valeur issue du blob).
+    void seed_(const char* key, Type type, const Value& v, const void* data, size_t len);
+    // Comme fetch_, mais table pleine => lecture flash dans scratch.
+    Entry* lookup_(const char* key, Type type, Entry& scratch);
+    void resetMirror_();
+    void load_(Entry& e, Type type);
+    void setData_(Entry& e, const void* data, size_t len);
+    bool write_(Entry& e);
+    // Comptabilise une ecriture flash reussie de e (direct : entree
+    // temporaire hors miroir). true si la cle vient de depasser son budget.
+    bool countWrite_(Entry& e, bool direct);
+
+    // put*_ : true si la valeur a change (ecriture planifiee).
+    bool getValue_(const char* key, Type type, Value& out);
+    bool putValue_(const char* key, Type type, const Value& v);
+    bool putData_(const char* key, Type type, const void* data, size_t len);
+
     Preferences preferences;
     const char* namespaceName = CONFIG_PARTITION;
     bool is_open_ = false;
     bool open_rw_ = false;
     SemaphoreHandle_t mutex_ = nullptr;
 
+    Entry mirror_[NVS_MIRROR_SLOTS] = {};
+    // Valeurs numeriques du schema, [CfgId][canal] (colonne 0 si global).
+    CfgValue cfg_[CFG_COUNT][DEVICE_CHANNELS] = {};
+    // Parametre modifie depuis la derniere ecriture du blob.
+    bool blobDirty_ = false;
+    bool pending_ = false;
+    // Flush : un seul ecrivain flash, ecritures hors mutex_.
+    SemaphoreHandle_t ioMutex_ = nullptr;
+
+    // Usure globale + debit glissant (tranche = NVS_RATE_WINDOW_MS / N).
+    EventLog* events_ = nullptr;
+    WearStats wear_;
+    uint32_t wearStartMs_ = 0;
+    uint32_t rateSlot_[NVS_RATE_BUCKETS] = {};
+    uint32_t rateWrites_[NVS_RATE_BUCKETS] = {};
+    uint32_t rateEntries_[NVS_RATE_BUCKETS] = {};
+
     static NVS* s_instance;
 };
 
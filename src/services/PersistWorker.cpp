@@ -0,0 +1,260 @@
+#include <PersistWorker.hpp>
+#include <NVSManager.hpp>
+#include <esp_system.h>
+
+// -----------------------------------------------------------------------------
+// Singleton
+// -----------------------------------------------------------------------------
+Persist* Persist::s_instance = nullptr;
+
+void Persist::Init() {
+    (void)PERSIST;
+}
+
+Persist* Persist::Get() {
+    if (!s_instance) {
+        s_instance = new Persist();
+    }
+    return s_instance;
+}
+
+Persist::Persist() {
+    mutex_ = xSemaphoreCreateMutex();
+    ioMutex_ = xSemaphoreCreateMutex();
+    JobLane& high = lanes_[static_cast<uint8_t>(Lane::High)];
+    high.buf = highBuf_;
+    high.cap = PERSIST_HIGH_LEN;
+    highPending_.buf = highPendBuf_;
+    highPending_.cap = PERSIST_HIGH_PENDING;
+    JobLane& low = lanes_[static_cast<uint8_t>(Lane::Low)];
+    low.buf = lowBuf_;
+    low.cap = PERSIST_LOW_LEN;
+}
+
+void Persist::begin() {
+    if (task_) return;
+    // Pile : les ecritures passent par le FS (SPIFFS / LittleFS) et NVS.
+    if (xTaskCreate(taskThunk_, "Persist", 4096, this, 1, &task_) != pdPASS) {
+        task_ = nullptr;
+        DEBUG_PRINTLN("[Persist] Tache non creee : ecritures directes");
+        return;
+    }
+    // ESP.restart() : voies et NVS ecrites avant le redemarrage.
+    esp_register_shutdown_handler(shutdownHook_);
+}
+
+// -----------------------------------------------------------------------------
+// Depot (taches Device / HTTP : jamais d'acces flash)
+// -----------------------------------------------------------------------------
+bool Persist::submit(Lane lane, BatchFn fn, void* ctx, const void* data, size_t len) {
+    const uint8_t i = static_cast<uint8_t>(lane);
+    const bool ok = task_ && fn && i < static_cast<uint8_t>(Lane::Count) &&
+                    len <= PERSIST_JOB_BYTES;
+    if (!lock_()) return false;
+    if (!ok) {
+        stats_.refused++;
+        unlock_();
+        return false;
+    }
+
+    JobLane& l = lanes_[i];
+    if (lane == Lane::High && (l.count >= l.cap || highPending_.count)) {
+        // Sessions : pas d'attente ni d'ecriture ici (tache Device). Reserve
+        // RAM reprise par la tache ; tant qu'elle n'est pas vide, les
+        // suivants la rejoignent (ordre conserve).
+        if (highPending_.count >= highPending_.cap) {
+            stats_.high_lost++;
+            unlock_();
+            DEBUG_PRINTLN("[Persist] Voie high et reserve pleines : session perdue");
+            xTaskNotifyGive(task_);
+            return false;
+        }
+        push_(highPending_, fn, ctx, data, len);
+        stats_.high_overflow++;
+        if (highPending_.count > stats_.high_pending_max) stats_.high_pending_max = highPending_.count;
+        l.accepted++;
+        unlock_();
+        xTaskNotifyGive(task_);
+        return true;
+    }
+    if (l.count >= l.cap) {
+        // Voie basse pleine : le plus ancien cede la place (tache bloquee ?).
+        l.head = (l.head + 1) % l.cap;
+        l.count--;
+        l.dropped++;
+    }
+    push_(l, fn, ctx, data, len);
+    l.accepted++;
+    unlock_();
+
+    xTaskNotifyGive(task_);
+    return true;
+}
+
+void Persist::push_(JobLane& l, BatchFn fn, void* ctx, const void* data, size_t len) {
+    Job& j = l.buf[(l.head + l.count) % l.cap];
+    j.fn = fn;
+    j.ctx = ctx;
+    j.len = static_cast<uint16_t>(len);
+    if (len) memcpy(j.data, data, len);
+    l.count++;
+    if (l.count > l.maxDepth) l.maxDepth = l.count;
+}
+
+size_t Persist::take_(JobLane& l, size_t n) {
+    size_t taken = 0;
+    while (l.count && n + taken < PERSIST_BATCH_MAX) {
+        batch_[n + taken++] = l.buf[l.head];
+        l.head = (l.head + 1) % l.cap;
+        l.count--;
+    }
+    return taken;
+}
+
+// -----------------------------------------------------------------------------
+// Ecriture
+// -----------------------------------------------------------------------------
+void Persist::taskThunk_(void* arg) {
+    Persist* self = static_cast<Persist*>(arg);
+    TickType_t lastNvs = xTaskGetTickCount();
+    for (;;) {
+        // Reveil par submit(), sinon periode NVS.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NVS_FLUSH_MS));
+        xSemaphoreTake(self->ioMutex_, portMAX_DELAY);
+        self->drain_(false);
+        if (xTaskGetTickCount() - lastNvs >= pdMS_TO_TICKS(NVS_FLUSH_MS)) {
+            lastNvs = xTaskGetTickCount();
+            self->flushNvs_();
+        }
+        xSemaphoreGive(self->ioMutex_);
+    }
+}
+
+void Persist::drain_(bool inlined) {
+    // Appele sous ioMutex_ : copie d'un lot (High d'abord) sous mutex_,
+    // ecriture hors mutex_ (submit() reste libre).
+    for (;;) {
+        size_t n = 0;
+        uint8_t perLane[static_cast<uint8_t>(Lane::Count)] = {};
+        lock_();
+        for (uint8_t i = 0; i < static_cast<uint8_t>(Lane::Count); ++i) {
+            perLane[i] = static_cast<uint8_t>(take_(lanes_[i], n));
+            n += perLane[i];
+            // Reserve High : apres High, avant Low.
+            if (i == static_cast<uint8_t>(Lane::High)) {
+                const size_t k = take_(highPending_, n);
+                perLane[i] += static_cast<uint8_t>(k);
+                n += k;
+            }
+        }
+        unlock_();
+        if (n == 0) return;
+
+        // Travaux consecutifs de meme destinataire : un seul appel.
+        for (size_t i = 0; i < n;) {
+            size_t j = i + 1;
+            while (j < n && batch_[j].fn == batch_[i].fn && batch_[j].ctx == batch_[i].ctx) j++;
+            const uint32_t t0 = micros();
+            batch_[i].fn(batch_[i].ctx, &batch_[i], j - i);
+            const uint32_t us = micros() - t0;
+
+            lock_();
+            stats_.batches++;
+            if (j - i > stats_.max_batch) stats_.max_batch = static_cast<uint8_t>(j - i);
+            if (us > stats_.max_us) stats_.max_us = us;
+            batchUs_ += us;
+            if (inlined) stats_.inline_writes += static_cast<uint32_t>(j - i);
+            unlock_();
+            i = j;
+        }
+
+        lock_();
+        for (uint8_t i = 0; i < static_cast<uint8_t>(Lane::Count); ++i) {
+            lanes_[i].written += perLane[i];
+        }
+        unlock_();
+    }
+}
+
+void Persist::flushNvs_() {
+    // Appele sous ioMutex_.
+    const uint32_t t0 = micros();
+    const size_t keys = CONF->Flush();
+    const uint32_t us = micros() - t0;
+    if (keys == 0) return;
+    lock_();
+    stats_.nvs_flushes++;
+    stats_.nvs_keys += static_cast<uint32_t>(keys);
+    if (us > stats_.nvs_max_us) stats_.nvs_max_us = us;
+    unlock_();
+}
+
+bool Persist::flush(uint32_t timeoutMs) {
+    // Attend la fin du lot en cours, puis ecrit le reste ici.
+    if (!ioMutex_ || xSemaphoreTake(ioMutex_, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+        DEBUG_PRINTLN("[Persist] flush: timeout");
+        return false;
+    }
+    drain_(true);
+    flushNvs_();
+    // NVS a pu journaliser un warning (W12) pendant son ecriture.
+    drain_(true);
+    xSemaphoreGive(ioMutex_);
+    return true;
+}
+
+void Persist::shutdownHook_() {
+    if (s_instance) s_instance->flush();
+}
+
+// -----------------------------------------------------------------------------
+// Diagnostic
+// -----------------------------------------------------------------------------
+bool Persist::getLaneStats(Lane lane, LaneStats& out) const {
+    const uint8_t i = static_cast<uint8_t>(lane);
+    if (i >= static_cast<uint8_t>(Lane::Count) || !lock_()) return false;
+
+    const JobLane& l = lanes_[i];
+    out.depth = l.count;
+    out.capacity = l.cap;
+    out.max_depth = l.maxDepth;
+    out.accepted = l.accepted;
+    out.dropped = l.dropped;
+    out.written = l.written;
+    unlock_();
+    return true;
+}
+
+void Persist::getStats(Stats& out) const {
+    if (!lock_()) return;
+    out = stats_;
+    out.running = task_ != nullptr;
+    out.avg_us = stats_.batches ? static_cast<uint32_t>(batchUs_ / stats_.batches) : 0;
+    out.high_pending = highPending_.count;
+    unlock_();
+}
+
+void Persist::resetStats() {
+    if (!lock_()) return;
+    stats_ = Stats();
+    stats_.high_pending_max = highPending_.count;
+    batchUs_ = 0;
+    for (JobLane& l : lanes_) {
+        l.maxDepth = l.count;
+        l.accepted = 0;
+        l.dropped = 0;
+        l.written = 0;
+    }
+    unlock_();
+}
+
+bool Persist::lock_() const {
+    // Jamais tenu pendant un acces flash (drain_ copie puis relache) :
+    // attente de quelques copies de travaux, d'ou portMAX_DELAY.
+    if (!mutex_) return false;
+    return xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE;
+}
+
+void Persist::unlock_() const {
+    if (mutex_) xSemaphoreGive(mutex_);
+}
@@ -0,0 +1,151 @@
+/**************************************************************
+ *  Persist - tache unique d'ecriture flash (persistance asynchrone)
+ *
+ *  But :
+ *  - Aucune tache de controle (Device) ni HTTP (AsyncTCP) n'attend un
+ *    effacement flash : SessionHistory et EventLog deposent un travail
+ *    (enregistrement deja construit) dans une voie, sans attente ; la
+ *    tache Persist l'ecrit ensuite.
+ *  - La meme tache ecrit les valeurs NVS en attente (NVS::Flush) toutes
+ *    les NVS_FLUSH_MS : un seul ecrivain flash.
+ *
+ *  Voies :
+ *  - High (sessions) videe avant Low (journal). Ordre conserve dans une
+ *    voie.
+ *  - Low pleine => le plus ancien travail est abandonne (compte).
+ *  - High pleine => travail range dans une reserve RAM
+ *    (PERSIST_HIGH_PENDING), ecrite par la tache juste apres High (ordre
+ *    conserve), compte (high_overflow). submit() n'attend ni n'ecrit
+ *    jamais ; reserve pleine aussi => false, travail perdu (high_lost).
+ *  - Lot : travaux consecutifs de meme destinataire ecrits en un appel
+ *    (un seul open/close du fichier).
+ *
+ *  Arret :
+ *  - flush() ecrit tout (voies + NVS) dans la tache appelante : avant
+ *    sommeil profond. Un hook esp_register_shutdown_handler fait de meme
+ *    pour ESP.restart().
+ *  - Tache non demarree : submit() renvoie false, l'appelant ecrit
+ *    lui-meme (boot).
+ *
+ *  Diagnostic : GET /api/diag/persist (profondeur, abandons, lots, duree).
+ **************************************************************/
+#ifndef PERSIST_WORKER_H
+#define PERSIST_WORKER_H
+
+#include <Arduino.h>
+#include <Config.hpp>
+
+class Persist {
+public:
+    // Voies (priorite decroissante).
+    enum class Lane : uint8_t { High = 0, Low, Count };
+
+    // Travail : donnees copiees, ecrites par fn dans la tache Persist.
+    struct Job;
+    // Ecrit n travaux consecutifs de meme (fn, ctx).
+    typedef void (*BatchFn)(void* ctx, const Job* jobs, size_t n);
+    struct Job {
+        BatchFn fn;
+        void* ctx;
+        uint16_t len;
+        uint8_t data[PERSIST_JOB_BYTES];
+    };
+
+    // Statistiques d'une voie.
+    struct LaneStats {
+        uint8_t depth = 0;        // travaux en attente
+        uint8_t capacity = 0;
+        uint8_t max_depth = 0;    // profondeur max observee
+        uint32_t accepted = 0;    // travaux mis en file
+        uint32_t dropped = 0;     // abandonnes (Low pleine, plus ancien)
+        uint32_t written = 0;     // travaux ecrits
+    };
+
+    struct Stats {
+        bool running = false;
+        uint32_t batches = 0;     // appels BatchFn
+        uint8_t max_batch = 0;
+        uint32_t avg_us = 0;      // duree d'un lot (ecriture flash)
+        uint32_t max_us = 0;
+        uint32_t nvs_flushes = 0; // NVS::Flush ayant ecrit au moins une cle
+        uint32_t nvs_keys = 0;
+        uint32_t nvs_max_us = 0;
+        uint32_t inline_writes = 0; // ecrits par l'appelant (flush, arret)
+        uint8_t high_pending = 0;   // travaux dans la reserve High
+        uint8_t high_pending_max = 0;
+        uint32_t high_overflow = 0; // submit() sur High pleine (mis en reserve)
+        uint32_t high_lost = 0;     // High et reserve pleines (perdus)
+        uint32_t refused = 0;     // submit() hors tache (boot) ou trop gros
+    };
+
+    // Singleton
+    static void Init();
+    static Persist* Get();
+
+    // Demarre la tache (apres NVS, Storage, EventLog, SessionHistory).
+    void begin();
+    bool running() const { return task_ != nullptr; }
+
+    // Non bloquant, jamais d'acces flash. false : tache absente ou travail
+    // trop gros (ecrire directement), ou High et reserve pleines (perdu).
+    bool submit(Lane lane, BatchFn fn, void* ctx, const void* data, size_t len);
+
+    // Ecrit tout (voies + NVS) dans la tache appelante, apres le lot en
+    // cours. false si timeout.
+    bool flush(uint32_t timeoutMs = PERSIST_FLUSH_TIMEOUT_MS);
+
+    bool getLaneStats(Lane lane, LaneStats& out) const;
+    void getStats(Stats& out) const;
+    void resetStats();
+
+private:
+    Persist();
+    Persist(const Persist&) = delete;
+    Persist& operator=(const Persist&) = delete;
+
+    struct JobLane {
+        Job* buf = nullptr;
+        uint8_t cap = 0;
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint8_t maxDepth = 0;
+        uint32_t accepted = 0;
+        uint32_t dropped = 0;
+        uint32_t written = 0;
+    };
+
+    static void taskThunk_(void* arg);
+    static void shutdownHook_();
+    // Vide les voies (appele sous ioMutex_) ; inlined : tache appelante.
+    void drain_(bool inlined);
+    void flushNvs_();
+
+    bool lock_() const;
+    void unlock_() const;
+
+    // Met un travail en fin de file (l.count < l.cap, sous mutex_).
+    static void push_(JobLane& l, BatchFn fn, void* ctx, const void* data, size_t len);
+    // Copie au plus max - n travaux de l dans batch_ (sous mutex_).
+    size_t take_(JobLane& l, size_t n);
+
+    Job highBuf_[PERSIST_HIGH_LEN];
+    Job highPendBuf_[PERSIST_HIGH_PENDING];
+    Job lowBuf_[PERSIST_LOW_LEN];
+    JobLane lanes_[static_cast<uint8_t>(Lane::Count)];
+    // Reserve de la voie High (High pleine) : toujours plus recente que High.
+    JobLane highPending_;
+    // Lot en cours d'ecriture (sous ioMutex_).
+    Job batch_[PERSIST_BATCH_MAX];
+    Stats stats_;
+    uint64_t batchUs_ = 0;
+
+    TaskHandle_t task_ = nullptr;
+    mutable SemaphoreHandle_t mutex_ = nullptr;  // voies + stats
+    SemaphoreHandle_t ioMutex_ = nullptr;        // ecriture en cours
+
+    static Persist* s_instance;
+};
+
+#define PERSIST Persist::Get()
+
+#endif // PERSIST_WORKER_H
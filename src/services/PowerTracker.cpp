@@ -1,7 +1,8 @@
 #include <PowerTracker.hpp>
 
 #include <FS.h>
-#include <SPIFFS.h>
+#include <StorageManager.hpp>
+#include <AtomicFile.hpp>
 #include <ArduinoJson.h>
 #include <math.h>
 #include <BusSampler.hpp>
@@ -9,7 +10,8 @@
 // -----------------------------------------------------------------------------
 // PowerTracker (RAM uniquement) :
 // - Totaux et derniere session sont en RAM (reset au reboot).
-// - Historique des sessions persiste en SPIFFS (JSON).
+// - Historique des sessions persiste en SPIFFS (JSON, AtomicFile : une
+//   coupure pendant la sauvegarde laisse la version precedente).
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 // Helpers historique (ring buffer en RAM + SPIFFS)
@@ -30,15 +32,14 @@ void PowerTracker::appendHistoryEntry(const HistoryEntry& e) {
 }
 
 bool PowerTracker::saveHistoryToFile() const {
-    // On suppose SPIFFS.begin(...) deja appele dans setup().
-    if (!SPIFFS.begin(false)) {
-        DEBUG_PRINTLN("[PowerTracker] SPIFFS not mounted; cannot save history.");
+    // Stockage monte dans setup() (STORAGE->begin()).
+    if (!STORAGE->mounted()) {
+        DEBUG_PRINTLN("[PowerTracker] Storage not mounted; cannot save history.");
         return false;
     }
 
-    const char* tmpPath = "/History.tmp";
-    File f = SPIFFS.open(tmpPath, "w");
-    if (!f) {
+    AtomicFile::Writer f(POWERTRACKER_HISTORY_FILE);
+    if (!f.ok()) {
         DEBUG_PRINTLN("[PowerTracker] Failed to open temp history file for write.");
         return false;
     }
@@ -66,18 +67,14 @@ bool PowerTracker::saveHistoryToFile() const {
         }
     }
 
-    if (serializeJson(doc, f) == 0) {
+    // Echec : le destructeur abandonne le temporaire.
+    if (serializeJson(doc, f) == 0 || !f.ok()) {
         DEBUG_PRINTLN("[PowerTracker] Failed to serialize history JSON.");
-        f.close();
-        SPIFFS.remove(tmpPath);
         return false;
     }
 
-    f.close();
-
-    SPIFFS.remove(POWERTRACKER_HISTORY_FILE);
-    if (!SPIFFS.rename(tmpPath, POWERTRACKER_HISTORY_FILE)) {
-        DEBUG_PRINTLN("[PowerTracker] Failed to rename history temp file.");
+    if (!f.commit()) {
+        DEBUG_PRINTLN("[PowerTracker] Failed to commit history file.");
         return false;
     }
 
@@ -89,25 +86,21 @@ void PowerTracker::loadHistoryFromFile() {
     _historyHead = 0;
     _historyCount = 0;
 
-    if (!SPIFFS.begin(false)) {
-        DEBUG_PRINTLN("[PowerTracker] SPIFFS not mounted; no history loaded.");
+    if (!STORAGE->mounted()) {
+        DEBUG_PRINTLN("[PowerTracker] Storage not mounted; no history loaded.");
         return;
     }
 
-    if (!SPIFFS.exists(POWERTRACKER_HISTORY_FILE)) {
-        DEBUG_PRINTLN("[PowerTracker] No existing /History.json, starting empty.");
-        return;
-    }
-
-    File f = SPIFFS.open(POWERTRACKER_HISTORY_FILE, "r");
-    if (!f) {
-        DEBUG_PRINTLN("[PowerTracker] Failed to open /History.json.");
+    const uint32_t t0 = micros();
+    // Version complete la plus recente (ancien fichier sans pied accepte).
+    AtomicFile::Reader f(POWERTRACKER_HISTORY_FILE, true);
+    if (!f.ok()) {
+        DEBUG_PRINTLN("[PowerTracker] No valid /History.json, starting empty.");
         return;
     }
 
     DynamicJsonDocument doc(32768);
     DeserializationError err = deserializeJson(doc, f);
-    f.close();
 
     if (err) {
         DEBUG_PRINT("[PowerTracker] Failed to parse /History.json: ");
@@ -137,8 +130,9 @@ void PowerTracker::loadHistoryFromFile() {
         appendHistoryEntry(e);
     }
 
-    DEBUG_PRINTF("[PowerTracker] Loaded %u history entries from SPIFFS.\n",
+    DEBUG_PRINTF("[PowerTracker] Loaded %u history entries from storage.\n",
                  (unsigned)_historyCount);
+    STORAGE->noteRecovery("power", micros() - t0, f.fallback() ? 1U : 0U);
 }
 
 bool PowerTracker::getHistoryEntry(uint16_t indexFromNewest, HistoryEntry& out) const {
@@ -160,9 +154,7 @@ void PowerTracker::clearHistory() {
     _historyHead  = 0;
     _historyCount = 0;
 
-    if (SPIFFS.begin(false)) {
-        SPIFFS.remove(POWERTRACKER_HISTORY_FILE);
-    }
+    AtomicFile::remove(POWERTRACKER_HISTORY_FILE);
 
     DEBUG_PRINTLN("[PowerTracker] History cleared.");
 }
@@ -217,7 +209,7 @@ void PowerTracker::update(CurrentSensor& cs) {
             usedBusHistory = true;
             for (size_t i = 0; i < n; ++i) {
                 const uint32_t ts = buf[i].ts_ms;
-                float I = fabsf(buf[i].current_a);
+                float I = fabsf(buf[i].current_a[0]);
 
                 if (!isfinite(I)) continue;
                 if (ts < _startMs) { _lastSampleTsMs = 0; continue; }
@@ -8,8 +8,8 @@ static void applyTimezone_() {
     // - Si KEY_TZ contient un nom TZ valide (ex: "CET-1CEST,M3.5.0,M10.5.0/3"),
     //   on l'applique via setenv("TZ", ...).
     // - Sinon on utilise un format simplifie "UTC+H" base sur KEY_TZ_MIN.
-    String tz = CONF->GetString(KEY_TZ, DEFAULT_TZ_NAME);
-    int offsetMin = CONF->GetInt(KEY_TZ_MIN, DEFAULT_TZ_OFFSET_MIN);
+    String tz = CONF->GetCfg<CfgId::Tz>();
+    int offsetMin = CONF->GetCfg<CfgId::TzMin>();
 
     if (tz.length() > 0 && tz != DEFAULT_TZ_NAME) {
         setenv("TZ", tz.c_str(), 1);
@@ -45,7 +45,7 @@ RTCManager::RTCManager() {
     applyTimezone_();
 
     // Restaure l'epoch sauvegarde en NVS (si disponible).
-    uint64_t saved = CONF->GetULong64(KEY_RTC_EPOCH, DEFAULT_RTC_EPOCH);
+    uint64_t saved = CONF->GetCfg<CfgId::RtcEpoch>();
     if (saved > 0) {
         setUnixTime(saved);
     } else {
@@ -66,7 +66,7 @@ void RTCManager::setUnixTime(uint64_t epoch) {
         settimeofday(&tv, nullptr);
 
         // Persist en NVS pour redemarrage.
-        CONF->PutULong64(KEY_RTC_EPOCH, epoch);
+        CONF->PutCfg<CfgId::RtcEpoch>(epoch);
 
         // Met a jour les chaines cachees.
         update();
@@ -0,0 +1,345 @@
+#include <RunScheduler.hpp>
+#include <RTCManager.hpp>
+#include <EventLog.hpp>
+#include <NVSManager.hpp>
+#include <DeviceTransport.hpp>
+#include <time.h>
+
+RunScheduler* RunScheduler::inst_ = nullptr;
+
+// Version du blob NVS (en-tete : version + nombre de regles).
+// v1 : regles de 11 octets sans canal (relues sur le canal 0).
+static constexpr uint8_t kBlobVersion = 2;
+static constexpr size_t kRuleSizeV1 = 11;
+
+void RunScheduler::Init(RTCManager* rtc, EventLog* events) {
+    if (!inst_) {
+        inst_ = new RunScheduler(rtc, events);
+    }
+}
+
+RunScheduler* RunScheduler::Get() {
+    return inst_;
+}
+
+RunScheduler::RunScheduler(RTCManager* rtc, EventLog* events)
+    : rtc_(rtc),
+      events_(events) {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+void RunScheduler::begin() {
+    load_();
+
+    // Echeances + rattrapage d'une marche interrompue par le reboot.
+    const uint32_t now = rtc_ ? static_cast<uint32_t>(rtc_->getUnixTime()) : 0;
+    if (now > 0) rebuild_(now, true);
+    lastNow_ = now;
+
+    if (!task_) {
+        xTaskCreate(taskThunk_, "RunSched", 4096, this, 1, &task_);
+    }
+}
+
+void RunScheduler::taskThunk_(void* arg) {
+    auto* self = static_cast<RunScheduler*>(arg);
+    for (;;) {
+        self->tick_();
+        vTaskDelay(pdMS_TO_TICKS(SCHED_TICK_MS));
+    }
+}
+
+void RunScheduler::tick_() {
+    if (!rtc_) return;
+    const uint32_t now = static_cast<uint32_t>(rtc_->getUnixTime());
+    if (now == 0) return;
+
+    // Horloge reglee (API /api/rtc, NTP) ou saut : echeances recalculees.
+    if (lastNow_ == 0 || now < lastNow_ || (now - lastNow_) > SCHED_CLOCK_JUMP_S) {
+        rebuild_(now, true);
+    }
+    lastNow_ = now;
+
+    // Seule la racine du tas est consultee ; une regle due est replacee
+    // a sa prochaine occurrence (strictement apres now).
+    for (;;) {
+        if (!lock_()) return;
+        if (heapSize_ == 0 || heap_[0].at > now) {
+            unlock_();
+            return;
+        }
+        const Rule r = rules_[heap_[0].idx];
+        const uint32_t next = nextOccurrence_(r, now + 1);
+        if (next) {
+            heap_[0].at = next;
+            siftDown_(0);
+        } else {
+            heapPopRoot_();
+        }
+        unlock_();
+
+        fire_(r, r.duration_s);
+    }
+}
+
+uint32_t RunScheduler::nextOccurrence_(const Rule& r, uint32_t after) {
+    if (!r.enabled || (r.days & 0x7F) == 0) return 0;
+
+    time_t a = static_cast<time_t>(after);
+    struct tm base;
+    localtime_r(&a, &base);
+
+    // Longueur de la fenetre (minutes) ; end < start => passe minuit.
+    const uint32_t windowMin = (r.end_min + 1440U - r.start_min) % 1440U;
+    const uint32_t step = r.period_min * 60U;
+
+    // On part de la veille : une fenetre commencee hier peut etre ouverte.
+    for (int d = -1; d <= 7; ++d) {
+        struct tm t = base;
+        t.tm_mday += d;
+        t.tm_hour = r.start_min / 60;
+        t.tm_min = r.start_min % 60;
+        t.tm_sec = 0;
+        t.tm_isdst = -1;
+        const time_t start = mktime(&t);  // normalise aussi tm_wday
+        if (start <= 0) continue;
+        if (!(r.days & (1U << t.tm_wday))) continue;
+
+        if (static_cast<uint32_t>(start) >= after) return static_cast<uint32_t>(start);
+        if (step == 0 || windowMin == 0) continue;
+
+        const uint32_t k = (after - static_cast<uint32_t>(start) + step - 1) / step;
+        if (k * r.period_min < windowMin) return static_cast<uint32_t>(start) + k * step;
+    }
+    return 0;
+}
+
+void RunScheduler::rebuild_(uint32_t now, bool catchUp) {
+    // Reprise : au plus une marche par canal (la plus longue restante).
+    uint32_t resumeS[DEVICE_CHANNELS] = {0};
+    Rule resumeRule[DEVICE_CHANNELS];
+
+    if (!lock_()) return;
+    buildHeap_(now, catchUp, resumeS, resumeRule);
+    unlock_();
+
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        if (resumeS[ch] > 0) fire_(resumeRule[ch], resumeS[ch]);
+    }
+}
+
+void RunScheduler::buildHeap_(uint32_t now, bool catchUp, uint32_t* resumeS, Rule* resumeRule) {
+    heapSize_ = 0;
+    for (uint8_t i = 0; i < count_; ++i) {
+        const Rule& r = rules_[i];
+
+        // Marche qui aurait du demarrer dans ]now - duree, now] : reprise.
+        if (catchUp && r.duration_s > 0) {
+            const uint32_t t = nextOccurrence_(r, now - r.duration_s + 1);
+            const uint8_t ch = r.channel;
+            if (t && t <= now && (t + r.duration_s - now) > resumeS[ch]) {
+                resumeS[ch] = t + r.duration_s - now;
+                resumeRule[ch] = r;
+            }
+        }
+
+        HeapEntry e;
+        e.at = nextOccurrence_(r, catchUp ? now + 1 : now);
+        e.idx = i;
+        if (e.at) heapPush_(e);
+    }
+}
+
+void RunScheduler::heapPush_(const HeapEntry& e) {
+    if (heapSize_ >= SCHED_MAX_RULES) return;
+    uint8_t i = heapSize_++;
+    heap_[i] = e;
+    while (i > 0) {
+        const uint8_t parent = (i - 1) / 2;
+        if (heap_[parent].at <= heap_[i].at) break;
+        const HeapEntry tmp = heap_[parent];
+        heap_[parent] = heap_[i];
+        heap_[i] = tmp;
+        i = parent;
+    }
+}
+
+void RunScheduler::heapPopRoot_() {
+    if (heapSize_ == 0) return;
+    heap_[0] = heap_[--heapSize_];
+    siftDown_(0);
+}
+
+void RunScheduler::siftDown_(uint8_t i) {
+    for (;;) {
+        const uint8_t l = 2 * i + 1;
+        const uint8_t r = l + 1;
+        uint8_t m = i;
+        if (l < heapSize_ && heap_[l].at < heap_[m].at) m = l;
+        if (r < heapSize_ && heap_[r].at < heap_[m].at) m = r;
+        if (m == i) return;
+        const HeapEntry tmp = heap_[m];
+        heap_[m] = heap_[i];
+        heap_[i] = tmp;
+        i = m;
+    }
+}
+
+void RunScheduler::fire_(const Rule& r, uint32_t durationS) {
+    DeviceTransport* transport = DEVTRAN;
+    SystemSnapshot s;
+    if (!transport || !transport->getSnapshot(s)) return;
+
+    // TimedRun acquitterait un defaut latch : une regle ne doit jamais le faire.
+    // Moteur deja en marche : la commande manuelle reste prioritaire.
+    const ChannelSnapshot& c = s.ch[r.channel];
+    EvtMsg reason = EvtMsg::None;
+    if (c.fault_latched || c.state == DeviceState::Fault) reason = EvtMsg::SchedFault;
+    else if (c.state == DeviceState::Running) reason = EvtMsg::SchedRunning;
+    else if (!transport->timedRun(r.channel, durationS)) reason = EvtMsg::SchedQueue;
+
+    if (reason == EvtMsg::None) {
+        fired_++;
+        return;
+    }
+
+    skipped_++;
+    if (events_) {
+        // Argument : id de la regle.
+        events_->append(EventLevel::Warning,
+                        static_cast<uint16_t>(WarnCode::W11_SchedSkip),
+                        reason,
+                        EvtSrc::Sched,
+                        r.channel,
+                        static_cast<float>(r.id));
+    }
+}
+
+bool RunScheduler::isValid(const Rule& r) {
+    const uint32_t runMax = CONF->GetCfg<CfgId::RunMax>();
+    if (r.channel >= DEVICE_CHANNELS) return false;
+    if (r.start_min >= 1440 || r.end_min >= 1440) return false;
+    if (r.period_min > 1440) return false;
+    if ((r.days & 0x7F) == 0) return false;
+    if (r.duration_s == 0 || r.duration_s > runMax) return false;
+    return true;
+}
+
+bool RunScheduler::setRule(Rule& r) {
+    if (!isValid(r)) return false;
+    r.enabled = r.enabled ? 1 : 0;
+    r.days &= 0x7F;
+
+    // Heure lue hors verrou (RTC sur I2C).
+    const uint32_t now = rtc_ ? static_cast<uint32_t>(rtc_->getUnixTime()) : 0;
+    if (!lock_()) return false;
+    int8_t slot = -1;
+    if (r.id == 0) {
+        // Nouvel id : plus petit id libre.
+        for (uint16_t id = 1; id <= 255 && r.id == 0; ++id) {
+            bool used = false;
+            for (uint8_t i = 0; i < count_; ++i) {
+                if (rules_[i].id == id) used = true;
+            }
+            if (!used) r.id = static_cast<uint8_t>(id);
+        }
+    } else {
+        for (uint8_t i = 0; i < count_; ++i) {
+            if (rules_[i].id == r.id) slot = i;
+        }
+    }
+    if (slot < 0) {
+        if (count_ >= SCHED_MAX_RULES || r.id == 0) {
+            unlock_();
+            return false;
+        }
+        slot = count_++;
+    }
+    rules_[slot] = r;
+    // Tas reconstruit dans la meme section : tick_() ne voit jamais un idx
+    // qui designe une autre regle.
+    if (rtc_) buildHeap_(now, false, nullptr, nullptr);
+    unlock_();
+
+    save_();
+    return true;
+}
+
+bool RunScheduler::removeRule(uint8_t id) {
+    const uint32_t now = rtc_ ? static_cast<uint32_t>(rtc_->getUnixTime()) : 0;
+    if (!lock_()) return false;
+    bool found = false;
+    for (uint8_t i = 0; i < count_; ++i) {
+        if (rules_[i].id != id) continue;
+        // Compactage (ordre conserve).
+        for (uint8_t j = i + 1; j < count_; ++j) rules_[j - 1] = rules_[j];
+        count_--;
+        found = true;
+        break;
+    }
+    if (found && rtc_) buildHeap_(now, false, nullptr, nullptr);
+    unlock_();
+    if (!found) return false;
+
+    save_();
+    return true;
+}
+
+uint8_t RunScheduler::getRules(Rule* out, uint32_t* nextEpoch, uint8_t max) const {
+    if (!lock_()) return 0;
+    const uint8_t n = (count_ < max) ? count_ : max;
+    for (uint8_t i = 0; i < n; ++i) {
+        out[i] = rules_[i];
+        if (nextEpoch) {
+            nextEpoch[i] = 0;
+            for (uint8_t h = 0; h < heapSize_; ++h) {
+                if (heap_[h].idx == i) nextEpoch[i] = heap_[h].at;
+            }
+        }
+    }
+    unlock_();
+    return n;
+}
+
+void RunScheduler::load_() {
+    // Blob : [version][count][Rule x count]
+    uint8_t buf[2 + SCHED_MAX_RULES * sizeof(Rule)];
+    const size_t len = CONF->GetBytes(KEY_SCHED_RULES, buf, sizeof(buf));
+    if (len < 2 || (buf[0] != kBlobVersion && buf[0] != 1)) return;
+
+    // v1 : meme disposition sans l'octet canal (canal 0 par defaut).
+    const size_t recSize = (buf[0] == 1) ? kRuleSizeV1 : sizeof(Rule);
+    uint8_t n = buf[1];
+    if (n > SCHED_MAX_RULES) n = SCHED_MAX_RULES;
+    if (len < 2 + n * recSize) return;
+
+    if (!lock_()) return;
+    count_ = 0;
+    for (uint8_t i = 0; i < n; ++i) {
+        Rule r;
+        memcpy(&r, buf + 2 + i * recSize, recSize);
+        if (r.id != 0 && isValid(r)) rules_[count_++] = r;
+    }
+    unlock_();
+}
+
+void RunScheduler::save_() {
+    uint8_t buf[2 + SCHED_MAX_RULES * sizeof(Rule)];
+    if (!lock_()) return;
+    buf[0] = kBlobVersion;
+    buf[1] = count_;
+    memcpy(buf + 2, rules_, count_ * sizeof(Rule));
+    const size_t len = 2 + count_ * sizeof(Rule);
+    unlock_();
+
+    CONF->PutBytes(KEY_SCHED_RULES, buf, len);
+}
+
+bool RunScheduler::lock_() const {
+    if (!mutex_) return false;
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(10)) == pdTRUE;
+}
+
+void RunScheduler::unlock_() const {
+    if (mutex_) xSemaphoreGive(mutex_);
+}
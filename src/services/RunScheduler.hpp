@@ -0,0 +1,125 @@
+/**************************************************************
+ *  RunScheduler - marches recurrentes planifiees (heure RTC)
+ *
+ *  But :
+ *  - Remplacer les marches "one-shot" (TimedRun) par des regles
+ *    recurrentes, ex: "pompe 10 min toutes les 2 h entre 06:00 et 22:00",
+ *    evaluees sur l'heure locale de RTCManager.
+ *  - Regles persistantes (NVS, un seul blob compact) et gerees via l'API.
+ *
+ *  Principe :
+ *  - Chaque regle a une prochaine echeance (epoch). Les echeances sont
+ *    rangees dans un tas binaire (min-heap) : un tick ne regarde que la
+ *    racine, O(1) quel que soit le nombre de regles ; un declenchement
+ *    coute O(log n) pour replacer la regle.
+ *  - Une marche = DeviceTransport::timedRun(canal, duree). Pas de marche si
+ *    un defaut est verrouille sur le canal (TimedRun l'acquitterait) ou si
+ *    son moteur tourne deja (commande manuelle prioritaire) : warning W11.
+ *
+ *  Rattrapage (boot / saut d'horloge > SCHED_CLOCK_JUMP_S) :
+ *  - Si l'heure courante tombe dans une marche qui aurait du etre en cours,
+ *    on la reprend pour la duree restante.
+ *  - Les marches entierement passees ne sont pas rejouees (pas de rafale
+ *    de marches apres une coupure).
+ *
+ *  Concurrence :
+ *  - Tache dediee (tick SCHED_TICK_MS) ; un mutex protege regles + tas
+ *    (API HTTP depuis la tache web).
+ **************************************************************/
+#ifndef RUN_SCHEDULER_H
+#define RUN_SCHEDULER_H
+
+#include <Arduino.h>
+#include <Config.hpp>
+
+class RTCManager;
+class EventLog;
+
+class RunScheduler {
+public:
+    // Regle persistante (format NVS v2, 12 octets ; v1 = sans canal).
+    struct __attribute__((packed)) Rule {
+        uint8_t id = 0;           // 1..255 (0 = a attribuer)
+        uint8_t enabled = 1;
+        uint8_t days = 0x7F;      // bit i = jour tm_wday i (0 = dimanche)
+        uint16_t start_min = 0;   // debut de fenetre (minutes depuis minuit)
+        uint16_t end_min = 0;     // fin de fenetre (exclue) ; == start : 1 marche
+        uint16_t period_min = 0;  // 0 = une seule marche par fenetre
+        uint16_t duration_s = 0;  // duree de chaque marche
+        uint8_t channel = 0;      // canal pilote (< DEVICE_CHANNELS)
+    };
+
+    // Singleton : dependances injectees une seule fois pendant setup().
+    static void Init(RTCManager* rtc, EventLog* events);
+    static RunScheduler* Get();
+
+    // Charge les regles (NVS), rattrape une marche en cours, lance la tache.
+    void begin();
+
+    // Ajout/modification (id 0 => nouvel id, renvoye dans r.id).
+    // false si invalide ou table pleine.
+    bool setRule(Rule& r);
+    bool removeRule(uint8_t id);
+
+    // Copie des regles + prochaine echeance (epoch, 0 si aucune).
+    uint8_t getRules(Rule* out, uint32_t* nextEpoch, uint8_t max) const;
+
+    // Compteurs (diagnostic).
+    uint32_t firedCount() const { return fired_; }
+    uint32_t skippedCount() const { return skipped_; }
+
+    // Validation d'une regle (bornes, duree <= RUN_MAX).
+    static bool isValid(const Rule& r);
+
+private:
+    RunScheduler(RTCManager* rtc, EventLog* events);
+
+    struct HeapEntry {
+        uint32_t at;   // echeance (epoch)
+        uint8_t idx;   // index dans rules_
+    };
+
+    static void taskThunk_(void* arg);
+    void tick_();
+
+    // Premiere occurrence >= after (0 si aucune dans les 8 jours).
+    static uint32_t nextOccurrence_(const Rule& r, uint32_t after);
+
+    // Reconstruit le tas ; catchUp => reprend une marche en cours.
+    void rebuild_(uint32_t now, bool catchUp);
+    // Remplit le tas (appele sous lock_()) ; resumeS / resumeRule : marche
+    // a reprendre par canal si catchUp.
+    void buildHeap_(uint32_t now, bool catchUp, uint32_t* resumeS, Rule* resumeRule);
+    void heapPush_(const HeapEntry& e);
+    void heapPopRoot_();
+    void siftDown_(uint8_t i);
+
+    void fire_(const Rule& r, uint32_t durationS);
+    void load_();
+    void save_();
+
+    bool lock_() const;
+    void unlock_() const;
+
+    static RunScheduler* inst_;
+
+    RTCManager* rtc_ = nullptr;
+    EventLog* events_ = nullptr;
+
+    Rule rules_[SCHED_MAX_RULES];
+    uint8_t count_ = 0;
+
+    HeapEntry heap_[SCHED_MAX_RULES];
+    uint8_t heapSize_ = 0;
+
+    uint32_t lastNow_ = 0;
+    uint32_t fired_ = 0;
+    uint32_t skipped_ = 0;
+
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+    TaskHandle_t task_ = nullptr;
+};
+
+#define SCHED RunScheduler::Get()
+
+#endif // RUN_SCHEDULER_H
@@ -1,79 +1,595 @@
 #include <SessionHistory.hpp>
-#include <FS.h>
-#include <SPIFFS.h>
+#include <StorageManager.hpp>
+#include <esp_rom_crc.h>
+#include <time.h>
+
+// En-tete du fichier (16 octets, little-endian).
+struct __attribute__((packed)) SessFileHeader {
+    uint32_t magic;     // kSessMagic
+    uint16_t format;    // kSessFormat
+    uint16_t recSize;   // sizeof(SessRecord)
+    uint32_t seqBase;   // sessions avant ce fichier (0 : ancien firmware)
+    uint32_t crc;       // CRC32 des 12 octets precedents
+};
+
+// Enregistrement (32 octets). crc = CRC32 de tout ce qui precede.
+struct __attribute__((packed)) SessRecord {
+    uint32_t start_epoch;
+    uint32_t end_epoch;
+    uint32_t duration_s;
+    float energy_wh;
+    float peak_power_w;
+    float peak_current_a;
+    uint16_t last_error;
+    uint8_t channel;
+    uint8_t flags;      // bit 0 : success
+    uint32_t crc;
+};
+static constexpr uint32_t kSessMagic = 0x53455331;  // "SES1"
+static constexpr uint16_t kSessFormat = 1;
+static_assert(sizeof(SessFileHeader) == 16, "SessFileHeader: taille fixe");
+static_assert(sizeof(SessRecord) == 32, "SessRecord: taille fixe");
+
+template <typename T>
+static uint32_t crcOf_(const T& v) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&v), sizeof(v) - sizeof(uint32_t));
+}
+
+static void toRecord_(const SessionHistory::Entry& e, SessRecord& r) {
+    r.start_epoch = e.start_epoch;
+    r.end_epoch = e.end_epoch;
+    r.duration_s = e.duration_s;
+    r.energy_wh = e.energy_wh;
+    r.peak_power_w = e.peak_power_w;
+    r.peak_current_a = e.peak_current_a;
+    r.last_error = e.last_error;
+    r.channel = e.channel;
+    r.flags = e.success ? 1 : 0;
+    r.crc = crcOf_(r);
+}
+
+static bool fromRecord_(const SessRecord& r, SessionHistory::Entry& e) {
+    if (crcOf_(r) != r.crc) return false;
+    e.start_epoch = r.start_epoch;
+    e.end_epoch = r.end_epoch;
+    e.duration_s = r.duration_s;
+    e.energy_wh = r.energy_wh;
+    e.peak_power_w = r.peak_power_w;
+    e.peak_current_a = r.peak_current_a;
+    e.last_error = r.last_error;
+    e.channel = r.channel;
+    e.success = (r.flags & 1U) != 0;
+    return true;
+}
 
 void SessionHistory::begin() {
     if (!mutex_) {
-        // Mutex pour proteger entries_ / head_ / count_.
+        // Mutex pour proteger les compteurs et l'acces aux fichiers.
         mutex_ = xSemaphoreCreateMutex();
     }
 
-    // Taille max et chemin fichier depuis NVS (avec fallback par defaut).
-    maxEntries_ = static_cast<uint16_t>(CONF->GetUInt(KEY_SESS_MAX, DEFAULT_SESSION_MAX_ENTRIES));
-    if (maxEntries_ == 0) maxEntries_ = DEFAULT_SESSION_MAX_ENTRIES;
-
-    filePath_ = CONF->GetString(KEY_SPIFFS_SESS, DEFAULT_SPIFFS_SESS_FILE);
+    filePath_ = CONF->GetCfg<CfgId::SpiffsSess>();
     if (filePath_.length() == 0) filePath_ = DEFAULT_SPIFFS_SESS_FILE;
 
-    if (!entries_) {
-        // Allocation RAM du ring buffer.
-        entries_ = new Entry[maxEntries_];
-    }
+    // Chemins derives : base (sans extension) + ".bin" / ".old".
+    String base = filePath_;
+    const int dot = base.lastIndexOf('.');
+    if (dot > base.lastIndexOf('/')) base = base.substring(0, dot);
+    if (base.length() > 24) base = base.substring(0, 24);
+    curPath_ = base + ".bin";
+    oldPath_ = base + ".old";
 
-    // Recharge depuis SPIFFS (si present).
-    loadFromFile_();
+    // Enregistrements par fichier : la moitie de la part de la partition.
+    const uint32_t share = static_cast<uint32_t>(STORAGE->totalBytes() / 100U * SESS_SPIFFS_PCT);
+    fileMax_ = share / 2U / sizeof(SessRecord);
+    if (fileMax_ < SESS_FILE_MIN_RECORDS) fileMax_ = SESS_FILE_MIN_RECORDS;
+
+    if (lock_()) {
+        // Reprise bornee : en-tetes, au plus une recopie du fichier courant
+        // (queue partielle), agregats des SESS_AGG_DAYS derniers jours.
+        const uint32_t t0 = micros();
+        repaired_ = 0;
+        openFiles_();
+        loadOrder_();
+        rebuildAggregates_();
+        const uint32_t us = micros() - t0;
+        const uint32_t repaired = repaired_;
+        unlock_();
+        STORAGE->noteRecovery("sessions", us, repaired);
+    }
 }
 
 void SessionHistory::append(const Entry& e) {
-    if (!entries_) return;
+    SessRecord r;
+    toRecord_(e, r);
+    if (PERSIST->submit(Persist::Lane::High, &SessionHistory::writeBatch_, this, &r, sizeof(r))) return;
+    // Tache en marche : jamais d'ecriture flash ici (tache Device) ; refus
+    // = voie et reserve pleines, deja compte (high_lost).
+    if (PERSIST->running()) return;
 
+    // Tache Persist absente : ecriture directe.
+    if (!lock_()) return;
+    File f;
+    writeRecord_(r, f);
+    if (f) f.close();
+    unlock_();
+}
+
+void SessionHistory::writeBatch_(void* ctx, const Persist::Job* jobs, size_t n) {
+    // Tache Persist : attente sans limite (un lecteur HTTP peut tenir le
+    // mutex le temps d'une lecture), un seul open/close par lot.
+    SessionHistory* self = static_cast<SessionHistory*>(ctx);
+    if (!self->mutex_) return;
+    xSemaphoreTake(self->mutex_, portMAX_DELAY);
+    File f;
+    for (size_t i = 0; i < n; ++i) {
+        SessRecord r;
+        memcpy(&r, jobs[i].data, sizeof(r));
+        self->writeRecord_(r, f);
+    }
+    if (f) f.close();
+    self->unlock_();
+}
+
+uint32_t SessionHistory::getCount() const {
+    uint32_t v = 0;
     if (lock_()) {
-        // Ajout ring buffer
-        entries_[head_] = e;
-        head_ = (head_ + 1) % maxEntries_;
-        if (count_ < maxEntries_) count_++;
+        v = oldCount_ + curCount_;
         unlock_();
     }
+    return v;
+}
 
-    // Persistence complete du fichier JSON.
-    saveToFile_();
+bool SessionHistory::getEntry(uint32_t indexFromNewest, Entry& out) const {
+    return getEntries(indexFromNewest, &out, 1) == 1;
 }
 
-uint16_t SessionHistory::getCount() const {
-    uint16_t v = count_;
+size_t SessionHistory::getEntries(uint32_t indexFromNewest, Entry* out, size_t maxOut) const {
+    if (!out || maxOut == 0) return 0;
+    size_t n = 0;
     if (lock_()) {
-        v = count_;
+        const uint32_t total = oldCount_ + curCount_;
+        if (indexFromNewest < total) {
+            const uint32_t avail = total - indexFromNewest;
+            if (maxOut > avail) maxOut = avail;
+            n = readRun_(total - 1 - indexFromNewest, out, maxOut, true);
+        }
         unlock_();
     }
-    return v;
+    return n;
 }
 
-bool SessionHistory::getEntry(uint16_t indexFromNewest, Entry& out) const {
-    if (!entries_) return false;
+void SessionHistory::getSeqRange(uint32_t& first, uint32_t& last) const {
+    first = 0;
+    last = 0;
+    if (!lock_()) return;
+    const uint32_t total = oldCount_ + curCount_;
+    if (total) {
+        first = seqBase_ + 1;
+        last = seqBase_ + total;
+    }
+    unlock_();
+}
 
-    bool ok = false;
+size_t SessionHistory::getBefore(uint32_t beforeSeq, Entry* out, size_t maxOut) const {
+    // Sequence s = indice absolu s - seqBase_ - 1.
+    if (!out || maxOut == 0) return 0;
+    size_t n = 0;
     if (lock_()) {
-        if (indexFromNewest < count_) {
-            // indexFromNewest=0 -> dernier element ecrit (head_-1).
-            int idx = static_cast<int>(head_) - 1 - indexFromNewest;
-            if (idx < 0) idx += maxEntries_;
-            out = entries_[idx];
-            ok = true;
+        const uint32_t total = oldCount_ + curCount_;
+        if (total && beforeSeq > seqBase_ + 1) {
+            uint32_t index = beforeSeq - seqBase_ - 2;
+            if (index >= total) index = total - 1;
+            if (maxOut > index + 1) maxOut = index + 1;
+            n = readRun_(index, out, maxOut, true);
         }
         unlock_();
     }
-    return ok;
+    return n;
 }
 
-void SessionHistory::loadFromFile_() {
-    // Format JSON :
+size_t SessionHistory::getFrom(uint32_t fromSeq, Entry* out, size_t maxOut) const {
+    if (!out || maxOut == 0) return 0;
+    size_t n = 0;
+    if (lock_()) {
+        const uint32_t total = oldCount_ + curCount_;
+        const uint32_t index = (fromSeq > seqBase_ + 1) ? fromSeq - seqBase_ - 1 : 0;
+        if (index < total) n = readRun_(index, out, maxOut, false);
+        unlock_();
+    }
+    return n;
+}
+
+uint32_t SessionHistory::seqFrom(uint32_t epoch) const {
+    if (!lock_()) return 0;
+    const uint32_t seq = seqBase_ + lowerBound_(epoch) + 1;
+    unlock_();
+    return seq;
+}
+
+uint32_t SessionHistory::lowerBound_(uint32_t epoch) const {
+    // Une session commencee a epoch ou apres finit a epoch ou apres : les
+    // indices dont end_epoch < epoch sont exclus. end_epoch croit a partir
+    // de orderSeq_ ; avant, parcours complet si la date peut s'y trouver.
+    const uint32_t total = oldCount_ + curCount_;
+    uint32_t split = (orderSeq_ > seqBase_ + 1) ? orderSeq_ - seqBase_ - 1 : 0;
+    if (split > total) split = total;
+    if (split > 0 && epoch <= prefixMaxEnd_) return 0;
+
+    // Un enregistrement illisible compte comme anterieur.
+    uint32_t lo = split;
+    uint32_t hi = total;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        Entry e;
+        if (!readAt_(mid, e) || e.end_epoch < epoch) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void SessionHistory::loadOrder_() {
+    // Appele sous lock_() au boot, apres openFiles_().
+    uint32_t blob[2] = {0, 0};
+    if (CONF->GetBytes(KEY_SESS_ORDER, blob, sizeof(blob)) == sizeof(blob)) {
+        orderSeq_ = blob[0];
+        prefixMaxEnd_ = blob[1];
+    }
+    const uint32_t total = oldCount_ + curCount_;
+    Entry last;
+    lastEnd_ = (total && readAt_(total - 1, last)) ? last.end_epoch : 0;
+}
+
+void SessionHistory::noteOrder_(const SessRecord& r) {
+    // Appele sous lock_() avant l'ecriture de r : end_epoch plus petit que
+    // le precedent (session sans date, RTC recule) => la partie ordonnee
+    // recommence a r. Note persistee (et videe) avant l'enregistrement.
+    const uint32_t total = oldCount_ + curCount_;
+    if (total && r.end_epoch < lastEnd_) {
+        if (lastEnd_ > prefixMaxEnd_) prefixMaxEnd_ = lastEnd_;
+        orderSeq_ = seqBase_ + total + 1;
+        const uint32_t blob[2] = {orderSeq_, prefixMaxEnd_};
+        CONF->PutBytes(KEY_SESS_ORDER, blob, sizeof(blob));
+        CONF->Flush();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Agregats
+// -----------------------------------------------------------------------------
+static int32_t daysFromCivil_(int32_t y, uint32_t m, uint32_t d) {
+    // Jours depuis 1970-01-01 (calendrier gregorien proleptique).
+    y -= (m <= 2) ? 1 : 0;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+    const uint32_t doy = (153U * (m > 2 ? m - 3 : m + 9) + 2U) / 5U + d - 1U;
+    const uint32_t doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+uint32_t SessionHistory::dayOf(uint32_t epoch) {
+    // Jour local (timezone appliquee par RTCManager).
+    const time_t t = static_cast<time_t>(epoch);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    const int32_t day = daysFromCivil_(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    return day > 0 ? static_cast<uint32_t>(day) : 0;
+}
+
+void SessionHistory::dateOf(uint32_t day, uint16_t& year, uint8_t& month, uint8_t& mday) {
+    const uint32_t z = day + 719468U;
+    const uint32_t era = z / 146097U;
+    const uint32_t doe = z - era * 146097U;
+    const uint32_t yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+    const uint32_t doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+    const uint32_t mp = (5U * doy + 2U) / 153U;
+    mday = static_cast<uint8_t>(doy - (153U * mp + 2U) / 5U + 1U);
+    month = static_cast<uint8_t>(mp < 10U ? mp + 3U : mp - 9U);
+    year = static_cast<uint16_t>(yoe + era * 400U + (month <= 2 ? 1U : 0U));
+}
+
+static uint32_t periodStart_(SessionHistory::Period p, uint32_t day) {
+    switch (p) {
+        case SessionHistory::Period::Week:
+            // 1970-01-01 est un jeudi : semaines du lundi.
+            return day >= (day + 3U) % 7U ? day - (day + 3U) % 7U : 0;
+        case SessionHistory::Period::Month: {
+            uint16_t y;
+            uint8_t m, d;
+            SessionHistory::dateOf(day, y, m, d);
+            return day - (d - 1U);
+        }
+        default:
+            return day;
+    }
+}
+
+void SessionHistory::addAggregate_(const Entry& e) {
+    // Appele sous lock_() (session ecrite ou relue au boot).
+    if (e.start_epoch == 0) {
+        undated_++;
+        return;
+    }
+    const uint32_t day = dayOf(e.start_epoch);
+
+    // Jours croissants ; en general le dernier (ou un nouveau jour).
+    uint16_t pos = dayCount_;
+    while (pos > 0 && days_[pos - 1].day > day) pos--;
+    if (pos == 0 || days_[pos - 1].day != day) {
+        if (dayCount_ == SESS_AGG_DAYS) {
+            // Table pleine : le jour le plus ancien sort.
+            if (pos == 0) return;
+            memmove(&days_[0], &days_[1], (pos - 1) * sizeof(Aggregate));
+            pos--;
+        } else {
+            memmove(&days_[pos + 1], &days_[pos], (dayCount_ - pos) * sizeof(Aggregate));
+            dayCount_++;
+        }
+        days_[pos] = Aggregate();
+        days_[pos].day = day;
+        pos++;
+    }
+
+    Aggregate& a = days_[pos - 1];
+    a.energy_wh += e.energy_wh;
+    a.run_s += e.duration_s;
+    if (a.sessions < UINT16_MAX) a.sessions++;
+    if (!e.success && a.faults < UINT16_MAX) a.faults++;
+}
+
+void SessionHistory::rebuildAggregates_() {
+    // Appele sous lock_() au boot : sessions des SESS_AGG_DAYS derniers
+    // jours (par rapport a la plus recente), relues par lots.
+    dayCount_ = 0;
+    undated_ = 0;
+    const uint32_t total = oldCount_ + curCount_;
+    if (total == 0) return;
+
+    // Fenetre relative a la fin la plus tardive (sessions plus anciennes
+    // eventuellement relues : addAggregate_ les place ou les ignore).
+    uint32_t index = 0;
+    const uint32_t window = SESS_AGG_DAYS * 86400U;
+    const uint32_t latest = (lastEnd_ > prefixMaxEnd_) ? lastEnd_ : prefixMaxEnd_;
+    if (latest > window) index = lowerBound_(latest - window);
+
+    Entry batch[16];
+    while (index < total) {
+        const uint32_t want = (total - index < 16) ? total - index : 16;
+        const size_t n = readRun_(index, batch, want, false);
+        if (n == 0) {
+            // Enregistrement illisible : ignore.
+            index++;
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) addAggregate_(batch[i]);
+        index += static_cast<uint32_t>(n);
+    }
+}
+
+size_t SessionHistory::getAggregates(Period p, uint32_t fromEpoch, uint32_t toEpoch,
+                                     Aggregate* out, size_t maxOut, uint32_t& undated) const {
+    // Jours de [from, to[ regroupes par periode, du plus recent au plus ancien.
+    undated = 0;
+    if (!out || maxOut == 0) return 0;
+    const uint32_t fromDay = fromEpoch ? dayOf(fromEpoch) : 0;
+    const uint32_t toDay = toEpoch ? dayOf(toEpoch) : UINT32_MAX;
+
+    size_t n = 0;
+    if (!lock_()) return 0;
+    undated = undated_;
+    for (uint16_t i = dayCount_; i > 0; --i) {
+        const Aggregate& d = days_[i - 1];
+        if (d.day >= toDay) continue;
+        if (d.day < fromDay) break;
+        const uint32_t key = periodStart_(p, d.day);
+        if (n == 0 || out[n - 1].day != key) {
+            if (n == maxOut) break;
+            out[n] = Aggregate();
+            out[n].day = key;
+            n++;
+        }
+        Aggregate& a = out[n - 1];
+        a.energy_wh += d.energy_wh;
+        a.run_s += d.run_s;
+        a.sessions = static_cast<uint16_t>(a.sessions + d.sessions < UINT16_MAX ? a.sessions + d.sessions : UINT16_MAX);
+        a.faults = static_cast<uint16_t>(a.faults + d.faults < UINT16_MAX ? a.faults + d.faults : UINT16_MAX);
+    }
+    unlock_();
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+// Fichiers
+// -----------------------------------------------------------------------------
+bool SessionHistory::createFile_(const char* path, uint32_t seqBase) {
+    SessFileHeader h;
+    h.magic = kSessMagic;
+    h.format = kSessFormat;
+    h.recSize = sizeof(SessRecord);
+    h.seqBase = seqBase;
+    h.crc = crcOf_(h);
+
+    File f = STORAGE->open(path, "w");
+    if (!f) return false;
+    const size_t n = f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h));
+    f.close();
+    return n == sizeof(h);
+}
+
+bool SessionHistory::checkFile_(const char* path, uint32_t& records, uint32_t& seqBase) {
+    // Valide l'en-tete et compte les enregistrements complets. Queue
+    // partielle (coupure pendant un ajout) : enregistrements complets
+    // recopies dans un nouveau fichier (les ajouts restent alignes).
+    records = 0;
+    seqBase = 0;
+    File f = STORAGE->open(path, "r");
+    if (!f) return false;
+    SessFileHeader h;
+    const bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+                    h.magic == kSessMagic && h.format == kSessFormat &&
+                    h.recSize == sizeof(SessRecord) && crcOf_(h) == h.crc;
+    const size_t size = f.size();
+    f.close();
+    if (!ok) return false;
+
+    seqBase = h.seqBase;
+    records = static_cast<uint32_t>((size - sizeof(h)) / sizeof(SessRecord));
+    if ((size - sizeof(h)) % sizeof(SessRecord) == 0) return true;
+
+    // Copie complete dans "~" puis remplacement : une coupure entre les deux
+    // est reprise par recoverTmp_() au boot suivant.
+    repaired_++;
+    const String tmp = String(path) + "~";
+    File in = STORAGE->open(path, "r");
+    File out = STORAGE->open(tmp, "w");
+    bool copied = in && out;
+    if (copied) {
+        uint8_t buf[sizeof(SessRecord) * 8];
+        size_t left = sizeof(h) + records * sizeof(SessRecord);
+        while (copied && left > 0) {
+            const size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+            copied = in.read(buf, chunk) == chunk && out.write(buf, chunk) == chunk;
+            left -= chunk;
+        }
+    }
+    if (in) in.close();
+    if (out) out.close();
+    if (copied) copied = STORAGE->remove(path) && STORAGE->rename(tmp, path);
+    if (!copied) STORAGE->remove(tmp);
+    return copied;
+}
+
+void SessionHistory::recoverTmp_(const String& path) {
+    // Reparation interrompue : "~" est complet des que l'original a ete
+    // supprime ; sinon l'original fait foi et la reparation est refaite.
+    const String tmp = path + "~";
+    if (!STORAGE->exists(tmp)) return;
+    repaired_++;
+    if (STORAGE->exists(path)) STORAGE->remove(tmp);
+    else STORAGE->rename(tmp, path);
+}
+
+void SessionHistory::openFiles_() {
+    // Appele sous lock_() au boot.
+    recoverTmp_(oldPath_);
+    recoverTmp_(curPath_);
+    uint32_t oldBase = 0;
+    uint32_t curBase = 0;
+    if (!checkFile_(oldPath_.c_str(), oldCount_, oldBase)) {
+        if (STORAGE->exists(oldPath_)) STORAGE->remove(oldPath_);
+        oldCount_ = 0;
+    }
+    if (!checkFile_(curPath_.c_str(), curCount_, curBase)) {
+        // Absent ou illisible : nouveau fichier (ancien JSON importe).
+        if (STORAGE->exists(curPath_)) STORAGE->remove(curPath_);
+        curCount_ = 0;
+        curBase = oldBase + oldCount_;
+        createFile_(curPath_.c_str(), curBase);
+        seqBase_ = oldBase;
+        importLegacy_();
+        return;
+    }
+    // Fichier courant d'un ancien firmware (base 0) : numerotation a
+    // partir du ".old".
+    seqBase_ = (curBase >= oldCount_) ? curBase - oldCount_ : 0;
+}
+
+void SessionHistory::rotate_() {
+    // Appele sous lock_() : fichier courant plein => ".old".
+    const uint32_t next = seqBase_ + oldCount_ + curCount_;
+    STORAGE->remove(oldPath_);
+    if (STORAGE->rename(curPath_, oldPath_)) {
+        seqBase_ += oldCount_;
+        oldCount_ = curCount_;
+    } else {
+        STORAGE->remove(curPath_);
+        seqBase_ = next;
+        oldCount_ = 0;
+    }
+    curCount_ = 0;
+    createFile_(curPath_.c_str(), next);
+}
+
+bool SessionHistory::writeRecord_(const SessRecord& r, File& f) {
+    // Appele sous lock_().
+    if (curCount_ >= fileMax_) {
+        if (f) f.close();
+        rotate_();
+    }
+    if (!f) {
+        f = STORAGE->open(curPath_, "a");
+        if (!f) return false;
+    }
+    noteOrder_(r);
+    const size_t n = f.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r));
+    if (n != sizeof(r)) {
+        f.close();
+        // Queue partielle : realignement avant le prochain ajout.
+        uint32_t base = 0;
+        if (!checkFile_(curPath_.c_str(), curCount_, base)) rotate_();
+        return false;
+    }
+    curCount_++;
+    lastEnd_ = r.end_epoch;
+
+    Entry e;
+    fromRecord_(r, e);
+    addAggregate_(e);
+    return true;
+}
+
+bool SessionHistory::readAt_(uint32_t index, Entry& out) const {
+    return readRun_(index, &out, 1, false) == 1;
+}
+
+size_t SessionHistory::readRun_(uint32_t index, Entry* out, size_t n, bool backward) const {
+    // Appele sous lock_() ; un fichier ouvert par segment parcouru.
+    size_t done = 0;
+    while (done < n) {
+        const bool inOld = index < oldCount_;
+        const uint32_t local = inOld ? index : index - oldCount_;
+        const uint32_t inFile = inOld ? oldCount_ : curCount_;
+        if (local >= inFile) break;
+
+        File f = STORAGE->open(inOld ? oldPath_ : curPath_, "r");
+        if (!f) break;
+        // Enregistrements de ce fichier dans le sens demande.
+        const uint32_t span = backward ? local + 1 : inFile - local;
+        const uint32_t firstSeq = seqBase_ + (inOld ? 0 : oldCount_) + 1;
+        uint32_t k = 0;
+        for (; k < span && done < n; ++k) {
+            const uint32_t i = backward ? local - k : local + k;
+            SessRecord r;
+            if (!f.seek(sizeof(SessFileHeader) + i * sizeof(SessRecord)) ||
+                f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) != sizeof(r) ||
+                !fromRecord_(r, out[done])) {
+                f.close();
+                return done;
+            }
+            out[done].seq = firstSeq + i;
+            done++;
+        }
+        f.close();
+        if (done >= n) break;
+        if (backward) {
+            // Suite dans ".old" (fichier precedent).
+            if (inOld || oldCount_ == 0) break;
+            index = oldCount_ - 1;
+        } else {
+            index += k;
+        }
+    }
+    return done;
+}
+
+void SessionHistory::importLegacy_() {
+    // Ancien format JSON :
     // {"sessions":[{"start_epoch":..,"end_epoch":..,"duration_s":..,"energy_wh":.., ...}, ...]}
-    if (!SPIFFS.exists(filePath_)) return;
+    if (!STORAGE->exists(filePath_) || filePath_ == curPath_) return;
 
-    File f = SPIFFS.open(filePath_, "r");
+    File f = STORAGE->open(filePath_, "r");
     if (!f) return;
 
-    // Taille raisonnable pour ~200 sessions (depend du contenu).
     DynamicJsonDocument doc(16384);
     DeserializationError err = deserializeJson(doc, f);
     f.close();
@@ -83,7 +599,7 @@ void SessionHistory::loadFromFile_() {
     JsonArray arr = doc["sessions"].as<JsonArray>();
     if (arr.isNull()) return;
 
-    // Recharge dans le ring buffer RAM.
+    File out;
     for (JsonObject obj : arr) {
         Entry e;
         e.start_epoch = obj["start_epoch"] | 0;
@@ -94,49 +610,19 @@ void SessionHistory::loadFromFile_() {
         e.peak_current_a = obj["peak_current_a"] | 0.0f;
         e.success = obj["success"] | false;
         e.last_error = obj["last_error"] | 0;
-
-        // Ajout sans sauvegarde immediate (on sauvera uniquement lors de append()).
-        entries_[head_] = e;
-        head_ = (head_ + 1) % maxEntries_;
-        if (count_ < maxEntries_) count_++;
+        e.channel = obj["channel"] | 0;
+        SessRecord r;
+        toRecord_(e, r);
+        writeRecord_(r, out);
     }
-}
-
-void SessionHistory::saveToFile_() const {
-    if (!entries_) return;
-
-    // Reecriture complete du fichier JSON (simple et robuste).
-    File f = SPIFFS.open(filePath_, "w");
-    if (!f) return;
-
-    DynamicJsonDocument doc(16384);
-    JsonArray arr = doc.createNestedArray("sessions");
-
-    // Ecriture du plus ancien au plus recent
-    uint16_t total = count_;
-    uint16_t start = (count_ == maxEntries_) ? head_ : 0;
-
-    for (uint16_t i = 0; i < total; ++i) {
-        uint16_t idx = (start + i) % maxEntries_;
-        const Entry& e = entries_[idx];
-        JsonObject obj = arr.createNestedObject();
-        obj["start_epoch"] = e.start_epoch;
-        obj["end_epoch"] = e.end_epoch;
-        obj["duration_s"] = e.duration_s;
-        obj["energy_wh"] = e.energy_wh;
-        obj["peak_power_w"] = e.peak_power_w;
-        obj["peak_current_a"] = e.peak_current_a;
-        obj["success"] = e.success;
-        obj["last_error"] = e.last_error;
-    }
-
-    serializeJson(doc, f);
-    f.close();
+    if (out) out.close();
+    STORAGE->remove(filePath_);
 }
 
 bool SessionHistory::lock_() const {
     if (!mutex_) return false;
-    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(10)) == pdTRUE;
+    // Acces fichier sous mutex : attente plus longue qu'un simple acces RAM.
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(1000)) == pdTRUE;
 }
 
 void SessionHistory::unlock_() const {
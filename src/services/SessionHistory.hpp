@@ -1,5 +1,5 @@
 /**************************************************************
- *  SessionHistory - stockage JSON dans SPIFFS
+ *  SessionHistory - stockage binaire indexe dans SPIFFS
  *
  *  Objectif :
  *  - Conserver l'historique des "sessions" (periodes moteur ON) :
@@ -7,11 +7,31 @@
  *  - Le stockage est independant du EventLog (warnings/erreurs).
  *
  *  Implementation :
- *  - Ring buffer en RAM (entries_) pour acces rapide.
- *  - Persistence en JSON dans SPIFFS (fichier /sessions.json par defaut).
+ *  - Fichier "/sessions.bin" (base de spiffs.sessions_file) : en-tete de
+ *    16 octets puis enregistrements de 32 octets (CRC32), en ajout seul.
+ *    L'index est implicite : session i = en-tete + i * 32.
+ *  - append() = une ecriture ; getEntry(i) = un seek + une lecture.
+ *  - Recherche par date : les sessions sont ajoutees a leur fin, donc
+ *    end_epoch suit l'ordre d'ajout, pas start_epoch (canaux entrelaces).
+ *    Dichotomie sur end_epoch ; une rupture (session sans date, RTC qui
+ *    recule) est notee en NVS (KEY_SESS_ORDER) : la partie anterieure est
+ *    parcourue si elle peut contenir la date. Les lecteurs filtrent
+ *    ensuite sur start_epoch.
+ *  - Fichier plein (part SESS_SPIFFS_PCT du SPIFFS) : renomme en ".old"
+ *    (l'ancien ".old" est supprime) ; les deux fichiers forment une seule
+ *    suite. Capacite : quelques dizaines de milliers de sessions.
+ *  - Pas de copie en RAM : seuls les compteurs d'enregistrements.
+ *  - Numero de sequence : 1 pour la premiere session jamais enregistree,
+ *    stable (rotation comprise) ; base du fichier courant dans l'en-tete.
+ *    Lecture incrementale (since) et par curseur (before).
+ *  - Agregats par jour local (energie, marche, defauts) sur les
+ *    SESS_AGG_DAYS derniers jours, mis a jour a chaque ajout ecrit et
+ *    recalcules au boot ; semaine / mois = somme des jours.
+ *  - Un ancien "/sessions.json" est importe une fois puis supprime.
  *
  *  Concurrence :
- *  - Mutex interne car acces depuis Device + HTTP.
+ *  - Mutex interne car acces depuis Device + HTTP (acces fichier compris).
+ *  - Ecriture par la tache Persist : Device ne touche jamais la flash.
  **************************************************************/
 #ifndef SESSION_HISTORY_H
 #define SESSION_HISTORY_H
@@ -20,6 +40,10 @@
 #include <ArduinoJson.h>
 #include <Config.hpp>
 #include <NVSManager.hpp>
+#include <PersistWorker.hpp>
+#include <FS.h>
+
+struct SessRecord;
 
 class SessionHistory {
 public:
@@ -41,32 +65,125 @@ public:
 
         // Dernier code erreur associe (si success=false typiquement).
         uint16_t last_error = 0;
+
+        // Canal (relais) de la session.
+        uint8_t channel = 0;
+
+        // Numero de sequence (lecture seule, ignore par append()).
+        uint32_t seq = 0;
+    };
+
+    // Periode d'agregation (jour local, semaine du lundi, mois civil).
+    enum class Period : uint8_t { Day = 0, Week, Month };
+
+    // Agregat d'une periode.
+    struct Aggregate {
+        uint32_t day = 0;        // premier jour (jours depuis 1970-01-01, local)
+        float energy_wh = 0.0f;
+        uint32_t run_s = 0;      // somme des durees
+        uint16_t sessions = 0;
+        uint16_t faults = 0;     // sessions terminees en defaut
     };
 
-    // Initialise la RAM + charge depuis SPIFFS.
+    // Ouvre (ou cree) le fichier et compte les sessions.
     void begin();
 
-    // Ajoute une session et persiste en SPIFFS.
+    // Ajoute une session : enregistrement depose dans la voie High de
+    // Persist (une ecriture en fin de fichier, hors tache appelante).
+    // Visible en lecture une fois ecrit (quelques ms).
     void append(const Entry& e);
 
     // Lecture (du plus recent au plus ancien).
-    uint16_t getCount() const;
-    bool getEntry(uint16_t indexFromNewest, Entry& out) const;
+    uint32_t getCount() const;
+    bool getEntry(uint32_t indexFromNewest, Entry& out) const;
+    // Lecture groupee (un seul acces fichier) : out[0] = indexFromNewest,
+    // puis les plus anciennes. Retourne le nombre lu (CRC invalide => arret).
+    size_t getEntries(uint32_t indexFromNewest, Entry* out, size_t maxOut) const;
+
+    // Sequences conservees : first..last (0, 0 si vide).
+    void getSeqRange(uint32_t& first, uint32_t& last) const;
+    // Lecture par curseur : sessions de sequence < beforeSeq, de la plus
+    // recente a la plus ancienne (seq renseigne). Retourne le nombre lu.
+    size_t getBefore(uint32_t beforeSeq, Entry* out, size_t maxOut) const;
+    // Lecture en avant : sessions de sequence >= fromSeq, de la plus
+    // ancienne a la plus recente (export). Retourne le nombre lu.
+    size_t getFrom(uint32_t fromSeq, Entry* out, size_t maxOut) const;
+
+    // Borne basse des sessions commencees a epoch ou apres : aucune n'a
+    // une sequence < seqFrom(epoch) ; last + 1 si aucune. Les sequences
+    // suivantes ne sont pas toutes dans l'intervalle (filtrer avec
+    // startsIn()).
+    uint32_t seqFrom(uint32_t epoch) const;
+    // Session commencee dans [from, to[.
+    static bool startsIn(const Entry& e, uint32_t from, uint32_t to) {
+        return e.start_epoch >= from && e.start_epoch < to;
+    }
+
+    // Agregats des periodes commencant dans [fromEpoch, toEpoch[ (0 : pas
+    // de borne), de la plus recente a la plus ancienne ; retourne le nombre
+    // copie. undated : sessions sans date (RTC invalide), non agregees.
+    size_t getAggregates(Period p, uint32_t fromEpoch, uint32_t toEpoch,
+                         Aggregate* out, size_t maxOut, uint32_t& undated) const;
+    // Jour local d'un epoch (jours depuis 1970-01-01) et date civile d'un jour.
+    static uint32_t dayOf(uint32_t epoch);
+    static void dateOf(uint32_t day, uint16_t& year, uint8_t& month, uint8_t& mday);
+
+    // Fichiers binaires courant / precedent (telechargement /api/download).
+    const String& currentPath() const { return curPath_; }
+    const String& oldPath() const { return oldPath_; }
 
 private:
-    void loadFromFile_();
-    void saveToFile_() const;
+    void openFiles_();
+    // Reparation de queue interrompue ("<fichier>~") : reprise au boot.
+    void recoverTmp_(const String& path);
+    bool checkFile_(const char* path, uint32_t& records, uint32_t& seqBase);
+    bool createFile_(const char* path, uint32_t seqBase);
+    void rotate_();
+    void importLegacy_();
+    // Enregistrement d'indice absolu (0 = plus ancien).
+    bool readAt_(uint32_t index, Entry& out) const;
+    // Premier indice pouvant avoir end_epoch >= epoch (dichotomie sur la
+    // partie ordonnee) ; appele sous lock_().
+    uint32_t lowerBound_(uint32_t epoch) const;
+    // Ordre des end_epoch : derniere rupture (NVS) et fin du dernier ajout.
+    void loadOrder_();
+    void noteOrder_(const SessRecord& r);
+    size_t readRun_(uint32_t index, Entry* out, size_t n, bool backward) const;
+    // Ecrit r en fin de fichier courant (f ouvert au besoin, ferme a la
+    // rotation) ; appele sous lock_().
+    bool writeRecord_(const SessRecord& r, File& f);
+    // Lot de la tache Persist (enregistrements deja construits).
+    static void writeBatch_(void* ctx, const Persist::Job* jobs, size_t n);
+    // Agregats : session ecrite / recalcul au boot ; appeles sous lock_().
+    void addAggregate_(const Entry& e);
+    void rebuildAggregates_();
 
     // Mutex interne (thread-safe).
     bool lock_() const;
     void unlock_() const;
 
-    Entry* entries_ = nullptr; // Ring buffer RAM
-    uint16_t maxEntries_ = DEFAULT_SESSION_MAX_ENTRIES;
-    uint16_t count_ = 0;
-    uint16_t head_ = 0; // index prochaine ecriture
+    // Enregistrements dans ".old" puis dans le fichier courant.
+    uint32_t oldCount_ = 0;
+    uint32_t curCount_ = 0;
+    uint32_t fileMax_ = SESS_FILE_MIN_RECORDS;
+    // Reparations au dernier boot (diagnostic).
+    uint32_t repaired_ = 0;
+    // Sequence de l'indice absolu 0, moins 1 (sessions supprimees).
+    uint32_t seqBase_ = 0;
+    // end_epoch croissant a partir de la sequence orderSeq_ ; avant elle,
+    // au plus prefixMaxEnd_. lastEnd_ : fin du dernier enregistrement.
+    uint32_t orderSeq_ = 0;
+    uint32_t prefixMaxEnd_ = 0;
+    uint32_t lastEnd_ = 0;
+
+    // Agregats journaliers, jour croissant (days_[0] = plus ancien).
+    Aggregate days_[SESS_AGG_DAYS];
+    uint16_t dayCount_ = 0;
+    uint32_t undated_ = 0;
 
     String filePath_ = DEFAULT_SPIFFS_SESS_FILE;
+    String curPath_;
+    String oldPath_;
     mutable SemaphoreHandle_t mutex_ = nullptr;
 };
 
@@ -0,0 +1,654 @@
+#include <SessionProfile.hpp>
+#include <StorageManager.hpp>
+#include <esp_rom_crc.h>
+#include <Utils.hpp>
+
+// En-tete du fichier (20 octets, little-endian).
+struct __attribute__((packed)) ProfFileHeader {
+    uint32_t magic;       // kProfMagic
+    uint8_t format;       // kProfFormat
+    uint8_t channel;
+    uint16_t period_ms;   // PROFILE_PERIOD_MS a l'ecriture
+    uint32_t id;
+    uint32_t start_epoch;
+    uint32_t crc;         // CRC32 des 16 octets precedents
+};
+
+// En-tete de bloc (20 octets ; 16 sans first en format 1), suivi des
+// deltas puis d'un CRC16.
+// Series : 0 courant min, 1 courant moyen, 2 courant max, 3 temperature.
+struct __attribute__((packed)) ProfBlockHeader {
+    uint16_t len;         // taille du bloc (en-tete et CRC compris)
+    uint8_t count;        // points du bloc (1..PROFILE_BLOCK_POINTS)
+    uint8_t reserved;
+    int16_t base[4];      // premier point
+    uint8_t width[4];     // bits par delta zigzag (0..17)
+    uint32_t first;       // indice (periodes depuis le debut) du premier point
+};
+
+// Travaux Persist (tache Device -> tache Persist), sans bourrage.
+enum : uint8_t { kJobOpen = 1, kJobBlock = 2 };
+struct ProfJobHead {
+    uint8_t op;
+    uint8_t channel;
+    uint8_t count;
+    uint8_t reserved;
+    uint32_t id;
+    uint32_t first;       // bloc : indice du premier point
+};
+struct ProfOpenJob {
+    ProfJobHead h;
+    uint32_t start_epoch;
+};
+struct ProfBlockJob {
+    ProfJobHead h;
+    int16_t pts[PROFILE_BLOCK_POINTS][4];
+};
+
+static constexpr uint32_t kProfMagic = 0x50524631;  // "PRF1"
+// Format 2 : indice du premier point dans chaque bloc (trou = bloc perdu).
+// Format 1 (sans indice, blocs supposes contigus) encore relu.
+static constexpr uint8_t kProfFormat = 2;
+static constexpr size_t kBlockHeaderV1 = 16;
+static constexpr int16_t kNoTemp = INT16_MIN;
+// Pire cas : deltas de 17 bits sur les 4 series.
+static constexpr size_t kBlockMax =
+    sizeof(ProfBlockHeader) + (4 * (PROFILE_BLOCK_POINTS - 1) * 17 + 7) / 8 + 2;
+static_assert(sizeof(ProfFileHeader) == 20, "ProfFileHeader: taille fixe");
+static_assert(sizeof(ProfBlockHeader) == 20, "ProfBlockHeader: taille fixe");
+static_assert(sizeof(ProfJobHead) == 12 && sizeof(ProfBlockJob) == 12 + PROFILE_BLOCK_POINTS * 8,
+              "Travaux profil: pas de bourrage");
+static_assert(sizeof(ProfBlockJob) <= PERSIST_JOB_BYTES, "PROFILE_BLOCK_POINTS trop grand pour un travail Persist");
+static_assert(PROFILE_BLOCK_POINTS >= 1 && PROFILE_BLOCK_POINTS <= 255, "PROFILE_BLOCK_POINTS hors limites");
+
+// -----------------------------------------------------------------------------
+// Codage
+// -----------------------------------------------------------------------------
+static uint32_t zigzag_(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static int32_t unzigzag_(uint32_t z) {
+    return static_cast<int32_t>(z >> 1) ^ -static_cast<int32_t>(z & 1U);
+}
+
+static uint8_t bitsFor_(uint32_t v) {
+    uint8_t n = 0;
+    while (v) {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static uint16_t crc16_(const uint8_t* p, size_t len) {
+    return static_cast<uint16_t>(esp_rom_crc32_le(0, p, len) & 0xFFFFU);
+}
+
+static int16_t quant_(float v, float scale) {
+    const float q = roundf(v * scale);
+    if (q > 32767.0f) return 32767;
+    if (q < -32767.0f) return -32767;
+    return static_cast<int16_t>(q);
+}
+
+// Bloc complet dans out (kBlockMax octets) ; retourne sa taille.
+static size_t encodeBlock_(const int16_t (*pts)[4], uint8_t n, uint32_t first, uint8_t* out) {
+    ProfBlockHeader h;
+    h.count = n;
+    h.reserved = 0;
+    h.first = first;
+    for (uint8_t c = 0; c < 4; ++c) {
+        h.base[c] = pts[0][c];
+        uint32_t maxZ = 0;
+        for (uint8_t k = 1; k < n; ++k) {
+            const uint32_t z = zigzag_(static_cast<int32_t>(pts[k][c]) - pts[k - 1][c]);
+            if (z > maxZ) maxZ = z;
+        }
+        h.width[c] = bitsFor_(maxZ);
+    }
+
+    // Deltas, bits de poids faible d'abord.
+    uint8_t* p = out + sizeof(h);
+    uint64_t acc = 0;
+    uint8_t nbits = 0;
+    for (uint8_t c = 0; c < 4; ++c) {
+        if (h.width[c] == 0) continue;
+        for (uint8_t k = 1; k < n; ++k) {
+            acc |= static_cast<uint64_t>(zigzag_(static_cast<int32_t>(pts[k][c]) - pts[k - 1][c])) << nbits;
+            nbits += h.width[c];
+            while (nbits >= 8) {
+                *p++ = static_cast<uint8_t>(acc);
+                acc >>= 8;
+                nbits -= 8;
+            }
+        }
+    }
+    if (nbits) *p++ = static_cast<uint8_t>(acc);
+
+    const size_t len = static_cast<size_t>(p - out) + 2;
+    h.len = static_cast<uint16_t>(len);
+    memcpy(out, &h, sizeof(h));
+    const uint16_t crc = crc16_(out, len - 2);
+    p[0] = static_cast<uint8_t>(crc);
+    p[1] = static_cast<uint8_t>(crc >> 8);
+    return len;
+}
+
+// Bloc lu (len octets, en-tete de hdr octets) -> pts ; false si CRC ou
+// tailles invalides. first : indice du premier point (format 1 : inconnu,
+// laisse tel quel).
+static bool decodeBlock_(const uint8_t* in, size_t len, size_t hdr, int16_t (*pts)[4],
+                         uint8_t& n, uint32_t& first) {
+    ProfBlockHeader h;
+    if (len < hdr + 2) return false;
+    memcpy(&h, in, hdr);
+    if (h.len != len || h.count == 0 || h.count > PROFILE_BLOCK_POINTS) return false;
+    if (crc16_(in, len - 2) != static_cast<uint16_t>(in[len - 2] | (in[len - 1] << 8))) return false;
+
+    uint32_t bits = 0;
+    for (uint8_t c = 0; c < 4; ++c) {
+        if (h.width[c] > 17) return false;
+        bits += static_cast<uint32_t>(h.width[c]) * (h.count - 1);
+    }
+    if (hdr + (bits + 7) / 8 + 2 != len) return false;
+
+    const uint8_t* p = in + hdr;
+    uint64_t acc = 0;
+    uint8_t nbits = 0;
+    for (uint8_t c = 0; c < 4; ++c) {
+        pts[0][c] = h.base[c];
+        const uint8_t w = h.width[c];
+        for (uint8_t k = 1; k < h.count; ++k) {
+            uint32_t z = 0;
+            if (w) {
+                while (nbits < w) {
+                    acc |= static_cast<uint64_t>(*p++) << nbits;
+                    nbits += 8;
+                }
+                z = static_cast<uint32_t>(acc & ((1ULL << w) - 1));
+                acc >>= w;
+                nbits -= w;
+            }
+            pts[k][c] = static_cast<int16_t>(pts[k - 1][c] + unzigzag_(z));
+        }
+    }
+    n = h.count;
+    if (hdr == sizeof(h)) first = h.first;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Singleton
+// -----------------------------------------------------------------------------
+SessionProfile* SessionProfile::s_instance = nullptr;
+
+void SessionProfile::Init() {
+    (void)PROFILES;
+}
+
+SessionProfile* SessionProfile::Get() {
+    if (!s_instance) {
+        s_instance = new SessionProfile();
+    }
+    return s_instance;
+}
+
+SessionProfile::SessionProfile() {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+void SessionProfile::path_(uint32_t id, char* buf, size_t len) const {
+    snprintf(buf, len, "%s.%lu", PROFILE_FILE_BASE, static_cast<unsigned long>(id));
+}
+
+void SessionProfile::begin() {
+    const uint32_t t0 = micros();
+    budget_ = static_cast<uint32_t>(STORAGE->totalBytes() / 100U * PROFILE_STORAGE_PCT);
+
+    // Index : en-tete de chaque "/prof.<id>" (name() avec ou sans '/').
+    const char* base = PROFILE_FILE_BASE;
+    if (base[0] == '/') base++;
+    const size_t baseLen = strlen(base);
+
+    if (!lock_()) return;
+    count_ = 0;
+    File dir = STORAGE->open("/");
+    if (dir) {
+        for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+            const char* name = f.name();
+            if (name[0] == '/') name++;
+            if (strncmp(name, base, baseLen) != 0 || name[baseLen] != '.') {
+                f.close();
+                continue;
+            }
+            ProfFileHeader h;
+            const bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+                            h.magic == kProfMagic && (h.format == kProfFormat || h.format == 1) &&
+                            esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h) - 4) == h.crc;
+            Info info;
+            info.id = h.id;
+            info.start_epoch = h.start_epoch;
+            info.channel = h.channel;
+            info.bytes = static_cast<uint32_t>(f.size());
+            f.close();
+            if (!ok) continue;
+            if (info.id >= nextId_) nextId_ = info.id + 1;
+
+            // Tri par id croissant ; table pleine => le plus ancien sort.
+            uint16_t pos = count_;
+            while (pos > 0 && index_[pos - 1].id > info.id) pos--;
+            if (count_ == PROFILE_MAX_FILES) {
+                if (pos == 0) continue;
+                memmove(&index_[0], &index_[1], (pos - 1) * sizeof(Info));
+                index_[pos - 1] = info;
+                continue;
+            }
+            memmove(&index_[pos + 1], &index_[pos], (count_ - pos) * sizeof(Info));
+            index_[pos] = info;
+            count_++;
+        }
+        dir.close();
+    }
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < count_; ++i) total += index_[i].bytes;
+    unlock_();
+
+    // Fichiers hors index (en-tete abime, au-dela de la table) : supprimes
+    // apres le parcours.
+    uint32_t orphans[8];
+    size_t nOrphans = 0;
+    dir = STORAGE->open("/");
+    if (dir) {
+        for (File f = dir.openNextFile(); f && nOrphans < 8; f = dir.openNextFile()) {
+            const char* name = f.name();
+            if (name[0] == '/') name++;
+            f.close();
+            if (strncmp(name, base, baseLen) != 0 || name[baseLen] != '.') continue;
+            char* end = nullptr;
+            const unsigned long id = strtoul(name + baseLen + 1, &end, 10);
+            Info info;
+            if (*end == 0 && !getInfo(static_cast<uint32_t>(id), info)) {
+                orphans[nOrphans++] = static_cast<uint32_t>(id);
+            }
+        }
+        dir.close();
+    }
+    char path[32];
+    for (size_t i = 0; i < nOrphans; ++i) {
+        path_(orphans[i], path, sizeof(path));
+        STORAGE->remove(path);
+    }
+    DEBUG_PRINTF("[Profile] %u profils, %lu octets\n", static_cast<unsigned>(count_),
+                 static_cast<unsigned long>(total));
+    STORAGE->noteRecovery("profiles", micros() - t0, static_cast<uint32_t>(nOrphans));
+}
+
+// -----------------------------------------------------------------------------
+// Tache Device
+// -----------------------------------------------------------------------------
+void SessionProfile::start(uint8_t ch, uint32_t startEpoch) {
+    if (ch >= DEVICE_CHANNELS) return;
+    Acc& a = acc_[ch];
+    if (a.active) stop(ch);
+
+    if (!lock_()) return;
+    const uint32_t id = nextId_++;
+    unlock_();
+
+    ProfOpenJob job;
+    job.h.op = kJobOpen;
+    job.h.channel = ch;
+    job.h.count = 0;
+    job.h.reserved = 0;
+    job.h.id = id;
+    job.h.first = 0;
+    job.start_epoch = startEpoch;
+    // Persist absent : pas de profil pour cette session.
+    if (!PERSIST->submit(Persist::Lane::Low, &SessionProfile::writeBatch_, this, &job, sizeof(job))) return;
+
+    a.active = true;
+    a.id = id;
+    a.periodStartMs = millis();
+    a.n = 0;
+    a.count = 0;
+    a.next = 0;
+    a.motorC = NAN;
+}
+
+void SessionProfile::sample(uint8_t ch, float currentA, float motorC) {
+    if (ch >= DEVICE_CHANNELS) return;
+    Acc& a = acc_[ch];
+    if (!a.active) return;
+
+    const uint32_t now = millis();
+    if (a.n && now - a.periodStartMs >= PROFILE_PERIOD_MS) {
+        closePeriod_(a);
+        if (a.count >= PROFILE_BLOCK_POINTS) submitBlock_(ch, a);
+        // Retard de plus d'une periode : la suivante part de maintenant ;
+        // periodes sautees = trou (bloc en cours ferme, blocs contigus).
+        const uint32_t late = now - a.periodStartMs;
+        if (late >= 2U * PROFILE_PERIOD_MS) {
+            if (a.count) submitBlock_(ch, a);
+            a.next += late / PROFILE_PERIOD_MS - 1U;
+            a.periodStartMs = now;
+        } else {
+            a.periodStartMs += PROFILE_PERIOD_MS;
+        }
+    }
+    // Profil complet (PROFILE_MAX_POINTS) : la session continue sans courbe.
+    if (a.next >= PROFILE_MAX_POINTS) {
+        if (a.count) submitBlock_(ch, a);
+        return;
+    }
+
+    if (a.n == 0 || currentA < a.min) a.min = currentA;
+    if (a.n == 0 || currentA > a.max) a.max = currentA;
+    a.sum = (a.n == 0) ? currentA : a.sum + currentA;
+    a.n++;
+    if (!isnan(motorC)) a.motorC = motorC;
+}
+
+void SessionProfile::stop(uint8_t ch) {
+    if (ch >= DEVICE_CHANNELS) return;
+    Acc& a = acc_[ch];
+    if (!a.active) return;
+    if (a.n) closePeriod_(a);
+    if (a.count) submitBlock_(ch, a);
+    a.active = false;
+}
+
+void SessionProfile::closePeriod_(Acc& a) {
+    if (a.count == 0) a.first = a.next;
+    a.next++;
+    int16_t* p = a.pts[a.count];
+    p[0] = quant_(a.min, 100.0f);
+    p[1] = quant_(a.sum / a.n, 100.0f);
+    p[2] = quant_(a.max, 100.0f);
+    p[3] = isnan(a.motorC) ? kNoTemp : quant_(a.motorC, 10.0f);
+    a.count++;
+    a.n = 0;
+}
+
+void SessionProfile::submitBlock_(uint8_t ch, Acc& a) {
+    ProfBlockJob job;
+    job.h.op = kJobBlock;
+    job.h.channel = ch;
+    job.h.count = a.count;
+    job.h.reserved = 0;
+    job.h.id = a.id;
+    job.h.first = a.first;
+    memcpy(job.pts, a.pts, sizeof(job.pts[0]) * a.count);
+    // Voie pleine : Persist abandonne le plus ancien travail (compte) ; le
+    // bloc suivant porte son indice, la lecture voit le trou.
+    PERSIST->submit(Persist::Lane::Low, &SessionProfile::writeBatch_, this, &job,
+                    sizeof(job.h) + sizeof(job.pts[0]) * a.count);
+    a.count = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Tache Persist
+// -----------------------------------------------------------------------------
+void SessionProfile::writeBatch_(void* ctx, const Persist::Job* jobs, size_t n) {
+    SessionProfile* self = static_cast<SessionProfile*>(ctx);
+    char path[32];
+    uint8_t buf[kBlockMax];
+    for (size_t i = 0; i < n; ++i) {
+        ProfJobHead h;
+        memcpy(&h, jobs[i].data, sizeof(h));
+        if (h.op == kJobOpen) {
+            ProfOpenJob job;
+            memcpy(&job, jobs[i].data, sizeof(job));
+            self->create_(h.id, h.channel, job.start_epoch);
+            continue;
+        }
+
+        ProfBlockJob job;
+        memcpy(&job, jobs[i].data, jobs[i].len);
+        if (h.count == 0 || h.count > PROFILE_BLOCK_POINTS) continue;
+        const size_t len = encodeBlock_(job.pts, h.count, h.first, buf);
+
+        // Profil supprime (retention) ou jamais cree : bloc ignore.
+        if (!self->lock_()) continue;
+        Info* info = nullptr;
+        for (uint16_t k = 0; k < self->count_; ++k) {
+            if (self->index_[k].id == h.id) info = &self->index_[k];
+        }
+        self->unlock_();
+        if (!info) continue;
+
+        self->path_(h.id, path, sizeof(path));
+        File f = STORAGE->open(path, "a");
+        if (!f) continue;
+        const size_t written = f.write(buf, len);
+        f.close();
+
+        if (self->lock_()) {
+            // L'index a pu bouger (retention) : recherche a nouveau.
+            for (uint16_t k = 0; k < self->count_; ++k) {
+                if (self->index_[k].id == h.id) self->index_[k].bytes += static_cast<uint32_t>(written);
+            }
+            self->unlock_();
+        }
+        self->evict_(0);
+    }
+}
+
+void SessionProfile::create_(uint32_t id, uint8_t ch, uint32_t startEpoch) {
+    // Place pour le nouveau fichier (nombre et octets).
+    evict_(sizeof(ProfFileHeader) + kBlockMax);
+
+    ProfFileHeader h;
+    h.magic = kProfMagic;
+    h.format = kProfFormat;
+    h.channel = ch;
+    h.period_ms = PROFILE_PERIOD_MS;
+    h.id = id;
+    h.start_epoch = startEpoch;
+    h.crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h) - 4);
+
+    char path[32];
+    path_(id, path, sizeof(path));
+    File f = STORAGE->open(path, "w");
+    if (!f) return;
+    const bool ok = f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) == sizeof(h);
+    f.close();
+    if (!ok) {
+        STORAGE->remove(path);
+        return;
+    }
+
+    if (!lock_()) return;
+    if (count_ == PROFILE_MAX_FILES) {
+        memmove(&index_[0], &index_[1], (count_ - 1) * sizeof(Info));
+        count_--;
+    }
+    Info& info = index_[count_++];
+    info.id = id;
+    info.start_epoch = startEpoch;
+    info.channel = ch;
+    info.bytes = sizeof(h);
+    unlock_();
+}
+
+void SessionProfile::evict_(uint32_t keepBytes) {
+    // Supprime les plus anciens profils tant que la table est pleine ou que
+    // le total (plus keepBytes) depasse le budget ; le plus recent reste.
+    char path[32];
+    for (;;) {
+        if (!lock_()) return;
+        uint32_t total = keepBytes;
+        for (uint16_t i = 0; i < count_; ++i) total += index_[i].bytes;
+        const bool full = keepBytes > 0 && count_ >= PROFILE_MAX_FILES;
+        if (count_ == 0 || (!full && (total <= budget_ || count_ == 1))) {
+            unlock_();
+            return;
+        }
+        const uint32_t id = index_[0].id;
+        memmove(&index_[0], &index_[1], (count_ - 1) * sizeof(Info));
+        count_--;
+        unlock_();
+
+        path_(id, path, sizeof(path));
+        STORAGE->remove(path);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Lecture (HTTP)
+// -----------------------------------------------------------------------------
+bool SessionProfile::find(uint8_t ch, uint32_t startEpoch, Info& out) const {
+    // Debut inconnu (RTC invalide) : pas de correspondance fiable.
+    if (startEpoch == 0 || !lock_()) return false;
+    bool ok = false;
+    for (uint16_t i = count_; i-- > 0;) {
+        if (index_[i].channel == ch && index_[i].start_epoch == startEpoch) {
+            out = index_[i];
+            ok = true;
+            break;
+        }
+    }
+    unlock_();
+    return ok;
+}
+
+bool SessionProfile::getInfo(uint32_t id, Info& out) const {
+    if (!lock_()) return false;
+    bool ok = false;
+    for (uint16_t i = 0; i < count_; ++i) {
+        if (index_[i].id == id) {
+            out = index_[i];
+            ok = true;
+            break;
+        }
+    }
+    unlock_();
+    return ok;
+}
+
+size_t SessionProfile::list(Info* out, size_t max) const {
+    if (!out || !lock_()) return 0;
+    size_t n = 0;
+    for (uint16_t i = count_; i-- > 0 && n < max;) out[n++] = index_[i];
+    unlock_();
+    return n;
+}
+
+bool SessionProfile::read(uint32_t id, uint32_t offset, uint16_t step, Point* out, size_t maxOut,
+                          size_t& outCount, uint32_t& total) const {
+    outCount = 0;
+    total = 0;
+    Info info;
+    if (!getInfo(id, info)) return false;
+    if (step == 0) step = 1;
+
+    char path[32];
+    path_(id, path, sizeof(path));
+    File f = STORAGE->open(path, "r");
+    if (!f) return false;
+    ProfFileHeader h;
+    if (f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) != sizeof(h) || h.magic != kProfMagic) {
+        f.close();
+        return false;
+    }
+
+    // Groupe de step points en cours ; point perdu (bloc abandonne,
+    // retard) : compte dans le groupe, sans valeur (NAN si tout le groupe).
+    Point g;
+    uint16_t gn = 0;
+    uint16_t meanN = 0;
+    float meanSum = 0.0f;
+    auto emit = [&]() {
+        if (total >= offset && outCount < maxOut) {
+            g.current_mean = meanN ? meanSum / meanN : NAN;
+            out[outCount++] = g;
+        }
+        total++;
+        gn = 0;
+    };
+    auto add = [&](const int16_t* pt) {
+        if (gn == 0) {
+            g.current_min = NAN;
+            g.current_max = NAN;
+            g.motor_c = NAN;
+            meanSum = 0.0f;
+            meanN = 0;
+        }
+        if (pt) {
+            const float cmin = pt[0] / 100.0f;
+            const float cmax = pt[2] / 100.0f;
+            if (isnan(g.current_min) || cmin < g.current_min) g.current_min = cmin;
+            if (isnan(g.current_max) || cmax > g.current_max) g.current_max = cmax;
+            meanSum += pt[1] / 100.0f;
+            meanN++;
+            if (pt[3] != kNoTemp) g.motor_c = pt[3] / 10.0f;
+        }
+        if (++gn >= step) emit();
+    };
+
+    // Trou de k points : groupes entiers comptes sans boucle par point
+    // (seuls ceux de la page sont produits).
+    auto gap = [&](uint32_t k) {
+        while (k && gn) {
+            add(nullptr);
+            k--;
+        }
+        uint32_t whole = k / step;
+        if (whole && total < offset) {
+            const uint32_t skip = (offset - total < whole) ? offset - total : whole;
+            total += skip;
+            whole -= skip;
+        }
+        while (whole && outCount < maxOut) {
+            for (uint16_t i = 0; i < step; ++i) add(nullptr);
+            whole--;
+        }
+        total += whole;
+        for (k %= step; k; --k) add(nullptr);
+    };
+
+    const size_t hdr = (h.format == 1) ? kBlockHeaderV1 : sizeof(ProfBlockHeader);
+    // Premier point utile : blocs entierement avant sautes sans decodage.
+    const uint64_t target = static_cast<uint64_t>(offset) * step;
+    uint8_t buf[kBlockMax];
+    int16_t pts[PROFILE_BLOCK_POINTS][4];
+    uint32_t next = 0;  // indice du prochain point attendu
+    uint32_t done = 0;  // points deja comptes dans les groupes
+    for (;;) {
+        // Bloc tronque ou abime (coupure) : fin de la lecture.
+        if (f.read(buf, hdr) != hdr) break;
+        const size_t len = static_cast<size_t>(buf[0] | (buf[1] << 8));
+        const uint8_t count = buf[2];
+        if (len < hdr + 2 || len > kBlockMax || count == 0 || count > PROFILE_BLOCK_POINTS) break;
+        uint32_t first = next;
+        if (hdr == sizeof(ProfBlockHeader)) memcpy(&first, buf + offsetof(ProfBlockHeader, first), 4);
+        // Indice qui recule ou hors bornes : fichier incoherent, fin.
+        if (first < next || first + count > PROFILE_MAX_POINTS) break;
+        if (first + count <= target && done == 0) {
+            if (!f.seek(len - hdr, SeekCur)) break;
+            next = first + count;
+            continue;
+        }
+        if (f.read(buf + hdr, len - hdr) != len - hdr) break;
+        uint8_t n = 0;
+        if (!decodeBlock_(buf, len, hdr, pts, n, first)) break;
+        gap(first - done);
+        for (uint8_t k = 0; k < n; ++k) add(pts[k]);
+        next = first + n;
+        done = next;
+    }
+    f.close();
+    // Fichier entierement avant offset : groupes comptes.
+    if (next > done) gap(next - done);
+    if (gn) emit();
+    return true;
+}
+
+bool SessionProfile::lock_() const {
+    if (!mutex_) return false;
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+void SessionProfile::unlock_() const {
+    if (mutex_) xSemaphoreGive(mutex_);
+}
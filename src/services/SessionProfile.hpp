@@ -0,0 +1,133 @@
+/**************************************************************
+ *  SessionProfile - courbe compressee de chaque session moteur
+ *
+ *  Objectif :
+ *  - SessionHistory ne garde que les totaux / pics ; le BusSampler ne
+ *    garde que les derniers echantillons. Ici, chaque session garde sa
+ *    courbe : un point toutes les PROFILE_PERIOD_MS (courant min / moyen
+ *    / max, temperature moteur) pour comparer une session a une autre
+ *    des semaines plus tard.
+ *
+ *  Format ("/prof.<id>", ajout seul) :
+ *  - En-tete de 20 octets (id, canal, debut epoch, periode, CRC).
+ *  - Blocs de PROFILE_BLOCK_POINTS points au plus : indice du premier
+ *    point (periodes depuis le debut), valeurs entieres (0.01 A, 0.1 C ;
+ *    INT16_MIN = temperature absente), premier point en clair puis deltas
+ *    zigzag sur une largeur de bits fixe par serie (largeur du plus grand
+ *    delta du bloc), CRC16 en fin de bloc. Typiquement 3 a 4 octets par
+ *    seconde de session.
+ *  - Bloc abime (coupure) ou indice hors PROFILE_MAX_POINTS : la lecture
+ *    s'arrete au dernier bloc valide.
+ *  - Lecture paginee : les blocs entierement avant offset sont sautes sur
+ *    leur en-tete (indice + nombre de points), sans decodage.
+ *  - Bloc perdu (voie Persist pleine) ou periodes sautees (retard) : trou
+ *    d'indice, relu comme points sans valeur ; l'axe du temps reste juste.
+ *    Format 1 (sans indice) relu avec des blocs supposes contigus.
+ *
+ *  Ecriture :
+ *  - sample() (tache Device) agrege en RAM ; un bloc plein (ou la fin de
+ *    session) est depose tel quel dans Persist (voie Low) qui le compresse
+ *    et l'ajoute au fichier. Rien n'est ecrit depuis la tache Device.
+ *  - Retention : PROFILE_MAX_FILES fichiers et PROFILE_STORAGE_PCT % du
+ *    stockage au plus ; les plus anciens sont supprimes.
+ *
+ *  Concurrence :
+ *  - start/sample/stop : tache Device uniquement.
+ *  - Index (id, canal, debut, taille) sous mutex (Persist + HTTP).
+ **************************************************************/
+#ifndef SESSION_PROFILE_H
+#define SESSION_PROFILE_H
+
+#include <Arduino.h>
+#include <Config.hpp>
+#include <PersistWorker.hpp>
+
+class SessionProfile {
+public:
+    // Profil conserve.
+    struct Info {
+        uint32_t id = 0;
+        uint32_t start_epoch = 0;  // 0 si RTC invalide au debut
+        uint32_t bytes = 0;        // taille du fichier
+        uint8_t channel = 0;
+    };
+
+    // Point decode (NAN : temperature absente).
+    struct Point {
+        float current_min = 0.0f;
+        float current_mean = 0.0f;
+        float current_max = 0.0f;
+        float motor_c = NAN;
+    };
+
+    // Singleton
+    static void Init();
+    static SessionProfile* Get();
+
+    // Relit l'index des fichiers (apres Storage).
+    void begin();
+
+    // Tache Device : debut, mesure a chaque cycle, fin de session.
+    void start(uint8_t ch, uint32_t startEpoch);
+    void sample(uint8_t ch, float currentA, float motorC);
+    void stop(uint8_t ch);
+
+    // Index : profil d'une session (canal + debut), ou par id.
+    bool find(uint8_t ch, uint32_t startEpoch, Info& out) const;
+    bool getInfo(uint32_t id, Info& out) const;
+    // Profils conserves, du plus recent au plus ancien ; retourne le nombre copie.
+    size_t list(Info* out, size_t max) const;
+
+    // Lecture : points regroupes par step (min des min, moyenne des
+    // moyennes, max des max, derniere temperature), a partir du groupe
+    // offset, au plus maxOut. total = nombre de groupes. Groupe sans point
+    // (trou) : valeurs NAN. false si absent.
+    bool read(uint32_t id, uint32_t offset, uint16_t step, Point* out, size_t maxOut,
+              size_t& outCount, uint32_t& total) const;
+
+private:
+    SessionProfile();
+    SessionProfile(const SessionProfile&) = delete;
+    SessionProfile& operator=(const SessionProfile&) = delete;
+
+    // Accumulateur d'un canal (tache Device).
+    struct Acc {
+        bool active = false;
+        uint32_t id = 0;
+        uint32_t periodStartMs = 0;
+        float min = 0.0f;
+        float max = 0.0f;
+        float sum = 0.0f;
+        uint16_t n = 0;
+        float motorC = NAN;
+        int16_t pts[PROFILE_BLOCK_POINTS][4];
+        uint8_t count = 0;
+        uint32_t first = 0;        // indice du premier point du bloc
+        uint32_t next = 0;         // indice du prochain point
+    };
+
+    void closePeriod_(Acc& a);
+    void submitBlock_(uint8_t ch, Acc& a);
+
+    // Tache Persist : creation du fichier / ajout d'un bloc.
+    static void writeBatch_(void* ctx, const Persist::Job* jobs, size_t n);
+    void create_(uint32_t id, uint8_t ch, uint32_t startEpoch);
+    void evict_(uint32_t keepBytes);
+    void path_(uint32_t id, char* buf, size_t len) const;
+
+    bool lock_() const;
+    void unlock_() const;
+
+    Acc acc_[DEVICE_CHANNELS];
+    Info index_[PROFILE_MAX_FILES];
+    uint16_t count_ = 0;       // index_[0] = plus ancien
+    uint32_t nextId_ = 1;
+    uint32_t budget_ = 0;      // octets max pour tous les profils
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+
+    static SessionProfile* s_instance;
+};
+
+#define PROFILES SessionProfile::Get()
+
+#endif // SESSION_PROFILE_H
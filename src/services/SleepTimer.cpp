@@ -10,6 +10,8 @@
 #include <SleepTimer.hpp>
 #include <Config.hpp>
 #include <DeviceTransport.hpp>
+#include <NVSManager.hpp>
+#include <PersistWorker.hpp>
 #include <Utils.hpp>
 #include <esp_sleep.h>
 #include <WiFi.h>
@@ -109,9 +111,20 @@ void SleepTimer::goToSleep() {
         DEBUG_PRINTLN("[SLEEP] Inactivity timeout reached. Preparing to sleep...");
     }
 
-    // Couper le relais/moteur si possible (via DeviceTransport)
-    if (DEVTRAN) {
-        DEVTRAN->stop();
+    // Couper tous les relais/moteurs si possible (via DeviceTransport).
+    // Stop asynchrone : attendre qu'il soit traite (RelayLast et fin de
+    // session deposes) pour que le flush ci-dessous les ecrive.
+    uint32_t stopId = 0;
+    if (DEVTRAN && DEVTRAN->stop(CHANNEL_ALL, &stopId)) {
+        const uint32_t t0 = millis();
+        Device::CommandResult r;
+        while (millis() - t0 < PERSIST_STOP_WAIT_MS) {
+            if (!DEVTRAN->getResult(stopId, r) ||
+                r.status != Device::CommandResult::Status::Pending) {
+                break;
+            }
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
     }
 
     // Desactiver WiFi pour economiser l'energie
@@ -122,6 +135,10 @@ void SleepTimer::goToSleep() {
     const uint64_t wakeMask = (1ULL << PIN_BUTTON);
     esp_sleep_enable_ext1_wakeup(wakeMask, ESP_EXT1_WAKEUP_ANY_LOW);
 
+    // Ecritures en attente (etat relais, calibrations, journal, sessions)
+    // avant coupure.
+    PERSIST->flush();
+
     DEBUG_PRINTLN("[SLEEP] Entering deep sleep (wake on button)...");
     esp_deep_sleep_start();
 }
@@ -0,0 +1,439 @@
+#include <StorageManager.hpp>
+#include <SPIFFS.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <Utils.hpp>
+// -----------------------------------------------------------------------------
+// Backend principal (STORAGE_BACKEND) et autre format (migration)
+// -----------------------------------------------------------------------------
+#if STORAGE_BACKEND == STORAGE_LITTLEFS
+static bool mainBegin_(bool format) {
+    return LittleFS.begin(format, "/littlefs", STORAGE_MAX_OPEN_FILES, STORAGE_PARTITION);
+}
+static fs::FS& mainFs_() { return LittleFS; }
+static size_t mainTotal_() { return LittleFS.totalBytes(); }
+static size_t mainUsed_() { return LittleFS.usedBytes(); }
+static bool otherBegin_() {
+    return SPIFFS.begin(false, "/spiffs", STORAGE_MAX_OPEN_FILES, STORAGE_PARTITION);
+}
+static fs::FS& otherFs_() { return SPIFFS; }
+static void otherEnd_() { SPIFFS.end(); }
+static const char* const kBackendName = "littlefs";
+#else
+static bool mainBegin_(bool format) {
+    return SPIFFS.begin(format, "/spiffs", STORAGE_MAX_OPEN_FILES, STORAGE_PARTITION);
+}
+static fs::FS& mainFs_() { return SPIFFS; }
+static size_t mainTotal_() { return SPIFFS.totalBytes(); }
+static size_t mainUsed_() { return SPIFFS.usedBytes(); }
+static bool otherBegin_() {
+    return LittleFS.begin(false, "/littlefs", STORAGE_MAX_OPEN_FILES, STORAGE_PARTITION);
+}
+static fs::FS& otherFs_() { return LittleFS; }
+static void otherEnd_() { LittleFS.end(); }
+static const char* const kBackendName = "spiffs";
+#endif
+
+// -----------------------------------------------------------------------------
+// Singleton
+// -----------------------------------------------------------------------------
+Storage* Storage::s_instance = nullptr;
+
+void Storage::Init() {
+    (void)STORAGE;
+}
+
+Storage* Storage::Get() {
+    if (!s_instance) {
+        s_instance = new Storage();
+    }
+    return s_instance;
+}
+
+Storage::Storage() {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+// -----------------------------------------------------------------------------
+// Montage
+// -----------------------------------------------------------------------------
+bool Storage::begin() {
+    if (mounted_) return true;
+    if (migrateMark_()) {
+        // Coupure entre formatage et fin de reecriture au boot precedent.
+        DEBUG_PRINTLN("[Storage] Migration precedente interrompue : fichiers non reecrits perdus");
+        migration_.state = Migration::Interrupted;
+        setMigrateMark_(false);
+    }
+    if (mainBegin_(false)) {
+        mounted_ = true;
+    } else {
+        migrate_();
+        if (migration_.state == Migration::Aborted) {
+            DEBUG_PRINTLN("[Storage] Migration abandonnee : partition intacte, non montee");
+        } else if (!mounted_) {
+            // Ni l'un ni l'autre format : partition vierge ou corrompue.
+            DEBUG_PRINTLN("[Storage] Formatage de la partition");
+            mounted_ = mainBegin_(true);
+        }
+    }
+    DEBUG_PRINTF("[Storage] %s %s (%u / %u octets)\n", kBackendName,
+                 mounted_ ? "monte" : "ECHEC",
+                 static_cast<unsigned>(mounted_ ? mainUsed_() : 0),
+                 static_cast<unsigned>(mounted_ ? mainTotal_() : 0));
+    return mounted_;
+}
+
+void Storage::migrate_() {
+    if (!otherBegin_()) return;
+    DEBUG_PRINTLN("[Storage] Autre format detecte : migration des fichiers");
+
+    // 1) Copie en RAM (PSRAM de preference) des fichiers de la racine ; un
+    //    seul echec => abandon, rien n'est formate.
+    struct Staged {
+        char path[48];
+        uint8_t* data;
+        size_t len;
+    };
+    Staged* files = new Staged[STORAGE_MIGRATE_MAX_FILES];
+    size_t n = 0;
+    bool staged = true;
+    File dir = otherFs_().open("/");
+    if (!dir) staged = false;
+    for (File f = staged ? dir.openNextFile() : File(); f; f = dir.openNextFile()) {
+        // name() sans '/' initial selon la version du core.
+        const char* name = f.name();
+        const size_t len = f.size();
+        uint8_t* data = nullptr;
+        bool ok = !f.isDirectory() && n < STORAGE_MIGRATE_MAX_FILES &&
+                  strlen(name) + 2 <= sizeof(files[0].path);
+        if (ok && len) {
+            data = static_cast<uint8_t*>(heap_caps_malloc(len, MALLOC_CAP_SPIRAM));
+            if (!data) data = static_cast<uint8_t*>(malloc(len));
+            ok = data && f.read(data, len) == len;
+        }
+        if (!ok) {
+            DEBUG_PRINT("[Storage] Fichier non copiable: ");
+            DEBUG_PRINTLN(name);
+            free(data);
+            f.close();
+            staged = false;
+            break;
+        }
+        snprintf(files[n].path, sizeof(files[n].path), "%s%s", name[0] == '/' ? "" : "/", name);
+        files[n].data = data;
+        files[n].len = len;
+        n++;
+        f.close();
+    }
+    if (dir) dir.close();
+    otherEnd_();
+    migration_.files = static_cast<uint16_t>(n);
+
+    // 2) Marqueur pose, formatage au nouveau format puis reecriture.
+    size_t written = 0;
+    if (staged) {
+        setMigrateMark_(true);
+        mounted_ = mainBegin_(true);
+        for (size_t i = 0; mounted_ && i < n; ++i) {
+            File f = mainFs_().open(files[i].path, "w");
+            if (f) {
+                if (f.write(files[i].data, files[i].len) == files[i].len) written++;
+                f.close();
+            }
+        }
+        if (mounted_) setMigrateMark_(false);
+    }
+    for (size_t i = 0; i < n; ++i) free(files[i].data);
+    delete[] files;
+
+    migration_.written = static_cast<uint16_t>(written);
+    if (!staged) migration_.state = Migration::Aborted;
+    else migration_.state = (mounted_ && written == n) ? Migration::Done : Migration::Failed;
+    DEBUG_PRINTF("[Storage] Migration %s : %u / %u fichiers\n", migrationName(migration_.state),
+                 static_cast<unsigned>(written), static_cast<unsigned>(n));
+}
+
+bool Storage::migrateMark_() {
+    Preferences p;
+    if (!p.begin(STORAGE_NVS_NAMESPACE, true)) return false;
+    const bool on = p.getBool(STORAGE_NVS_MIGRATE_KEY, false);
+    p.end();
+    return on;
+}
+
+void Storage::setMigrateMark_(bool on) {
+    // Ecriture directe (NVSManager pas encore demarre).
+    Preferences p;
+    if (!p.begin(STORAGE_NVS_NAMESPACE, false)) return;
+    if (on) p.putBool(STORAGE_NVS_MIGRATE_KEY, true);
+    else p.remove(STORAGE_NVS_MIGRATE_KEY);
+    p.end();
+}
+
+const char* Storage::migrationName(Migration m) {
+    switch (m) {
+        case Migration::Done:        return "done";
+        case Migration::Aborted:     return "aborted";
+        case Migration::Failed:      return "failed";
+        case Migration::Interrupted: return "interrupted";
+        default:                     return "none";
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Acces fichiers
+// -----------------------------------------------------------------------------
+const char* Storage::backendName() const {
+    return kBackendName;
+}
+
+fs::FS& Storage::fs() {
+    return mainFs_();
+}
+
+File Storage::open(const char* path, const char* mode) {
+    if (!mounted_) return File();
+    return mainFs_().open(path, mode);
+}
+
+bool Storage::exists(const char* path) {
+    return mounted_ && mainFs_().exists(path);
+}
+
+bool Storage::remove(const char* path) {
+    return mounted_ && mainFs_().remove(path);
+}
+
+bool Storage::rename(const char* from, const char* to) {
+    return mounted_ && mainFs_().rename(from, to);
+}
+
+size_t Storage::totalBytes() {
+    return mounted_ ? mainTotal_() : 0;
+}
+
+size_t Storage::usedBytes() {
+    return mounted_ ? mainUsed_() : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Banc de mesure
+// -----------------------------------------------------------------------------
+bool Storage::startBench(bool fill) {
+    if (!lock_()) return false;
+    const bool busy = bench_.running || !mounted_;
+    if (!busy) {
+        bench_.running = true;
+        benchFill_ = fill;
+    }
+    unlock_();
+    if (busy) return false;
+
+    if (xTaskCreate(benchThunk_, "StoreBench", 4096, this, 1, nullptr) != pdPASS) {
+        lock_();
+        bench_.running = false;
+        unlock_();
+        return false;
+    }
+    return true;
+}
+
+void Storage::getBench(BenchResult& out) const {
+    if (!lock_()) return;
+    out = bench_;
+    unlock_();
+}
+
+void Storage::benchThunk_(void* arg) {
+    Storage* self = static_cast<Storage*>(arg);
+    self->runBench_(self->benchFill_);
+    vTaskDelete(nullptr);
+}
+
+namespace {
+// Cumul d'un type d'operation (moyenne calculee a la fin).
+struct BenchAcc {
+    uint64_t sum = 0;
+    Storage::OpStats s;
+    void add(uint32_t us, bool ok) {
+        s.count++;
+        sum += us;
+        if (us > s.max_us) s.max_us = us;
+        if (!ok) s.failed++;
+    }
+    Storage::OpStats done() {
+        if (s.count) s.avg_us = static_cast<uint32_t>(sum / s.count);
+        return s;
+    }
+};
+}
+
+void Storage::runBench_(bool fill) {
+    // Fichiers temporaires a la racine (noms courts, compatibles SPIFFS).
+    static const char* const kData = "/bench.dat";
+    static const char* const kMissing = "/bench.none";
+    static const char* const kRenA = "/bench.a";
+    static const char* const kRenB = "/bench.b";
+    static const char* const kFill = "/bench.fill";
+
+    const uint32_t t0 = millis();
+    BenchAcc opens, exist, appends, reads, renames, fills;
+    uint8_t rec[32];
+    memset(rec, 0xA5, sizeof(rec));
+
+    fs::FS& f = mainFs_();
+    f.remove(kData);
+
+    // Ajout : ouverture + 32 octets + fermeture (cas EventLog / sessions).
+    for (uint32_t i = 0; i < STORAGE_BENCH_OPS; ++i) {
+        const uint32_t t = micros();
+        File h = f.open(kData, "a");
+        const bool ok = h && h.write(rec, sizeof(rec)) == sizeof(rec);
+        if (h) h.close();
+        appends.add(micros() - t, ok);
+        if ((i & 15U) == 15U) vTaskDelay(1);
+    }
+
+    for (uint32_t i = 0; i < STORAGE_BENCH_OPS / 4; ++i) {
+        uint32_t t = micros();
+        File h = f.open(kData, "r");
+        const bool ok = static_cast<bool>(h);
+        if (h) h.close();
+        opens.add(micros() - t, ok);
+
+        t = micros();
+        const bool present = f.exists((i & 1U) ? kMissing : kData);
+        exist.add(micros() - t, present == !(i & 1U));
+        if ((i & 15U) == 15U) vTaskDelay(1);
+    }
+
+    // Lecture : seek aleatoire + 32 octets (cas getEntry d'une session).
+    File h = f.open(kData, "r");
+    const uint32_t records = h ? static_cast<uint32_t>(h.size() / sizeof(rec)) : 0;
+    for (uint32_t i = 0; h && records && i < STORAGE_BENCH_OPS; ++i) {
+        const uint32_t t = micros();
+        const bool ok = h.seek((esp_random() % records) * sizeof(rec)) &&
+                        h.read(rec, sizeof(rec)) == sizeof(rec);
+        reads.add(micros() - t, ok);
+        if ((i & 15U) == 15U) vTaskDelay(1);
+    }
+    if (h) h.close();
+
+    // Renommage (rotation de fichiers, commits atomiques).
+    File a = f.open(kRenA, "w");
+    if (a) {
+        a.write(rec, sizeof(rec));
+        a.close();
+    }
+    for (uint32_t i = 0; i < STORAGE_BENCH_OPS / 10; ++i) {
+        const uint32_t t = micros();
+        const bool ok = (i & 1U) ? f.rename(kRenB, kRenA) : f.rename(kRenA, kRenB);
+        renames.add(micros() - t, ok);
+    }
+
+    // Remplissage : pires pauses (ramasse-miettes) quand la partition se
+    // remplit. Borne a 2 minutes.
+    uint32_t fillBytes = 0;
+    if (fill) {
+        const size_t target = mainTotal_() / 100U * STORAGE_BENCH_FILL_PCT;
+        uint8_t* chunk = static_cast<uint8_t*>(malloc(4096));
+        File w = chunk ? f.open(kFill, "w") : File();
+        const uint32_t start = millis();
+        while (w && mainUsed_() < target && (millis() - start) < 120000UL) {
+            memset(chunk, static_cast<int>(fillBytes >> 12), 4096);
+            const uint32_t t = micros();
+            const bool ok = w.write(chunk, 4096) == 4096;
+            fills.add(micros() - t, ok);
+            if (!ok) break;
+            fillBytes += 4096;
+            vTaskDelay(1);
+        }
+        if (w) w.close();
+        free(chunk);
+        f.remove(kFill);
+    }
+
+    f.remove(kData);
+    f.remove(kRenA);
+    f.remove(kRenB);
+
+    // Resultat publie quoi qu'il arrive (sinon "running" resterait vrai).
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bench_.open = opens.done();
+    bench_.exists = exist.done();
+    bench_.append = appends.done();
+    bench_.read = reads.done();
+    bench_.rename = renames.done();
+    bench_.fill_write = fills.done();
+    bench_.fill = fill;
+    bench_.fill_kb = fillBytes / 1024U;
+    bench_.ts_ms = millis();
+    bench_.duration_ms = bench_.ts_ms - t0;
+    bench_.valid = true;
+    bench_.running = false;
+    unlock_();
+}
+
+// -----------------------------------------------------------------------------
+// Coherence (AtomicFile, reprise au boot)
+// -----------------------------------------------------------------------------
+void Storage::noteCommit(bool ok) {
+    if (!lock_()) return;
+    if (ok) atomic_.commits++;
+    else atomic_.commit_failed++;
+    unlock_();
+}
+
+void Storage::noteLoad(bool ok, bool fallback, uint32_t us) {
+    if (!lock_()) return;
+    atomic_.loads++;
+    if (fallback) atomic_.fallbacks++;
+    if (!ok) atomic_.load_failed++;
+    if (us > atomic_.max_load_us) atomic_.max_load_us = us;
+    unlock_();
+}
+
+void Storage::noteRecovery(const char* store, uint32_t us, uint32_t repaired) {
+    DEBUG_PRINTF("[Storage] Reprise %s : %lu us, %lu repare(s)\n", store,
+                 static_cast<unsigned long>(us), static_cast<unsigned long>(repaired));
+    if (!lock_()) return;
+    // Meme module relu (begin() rappele) : entree remplacee.
+    uint8_t i = 0;
+    while (i < recoveryCount_ && strcmp(recovery_[i].store, store) != 0) i++;
+    if (i == recoveryCount_) {
+        if (recoveryCount_ == STORAGE_RECOVERY_SLOTS) {
+            unlock_();
+            return;
+        }
+        recoveryCount_++;
+    }
+    recovery_[i].store = store;
+    recovery_[i].us = us;
+    recovery_[i].repaired = repaired;
+    unlock_();
+}
+
+void Storage::getAtomicStats(AtomicStats& out) const {
+    if (!lock_()) return;
+    out = atomic_;
+    unlock_();
+}
+
+size_t Storage::getRecovery(Recovery* out, size_t max) const {
+    if (!out || !lock_()) return 0;
+    size_t n = recoveryCount_ < max ? recoveryCount_ : max;
+    for (size_t i = 0; i < n; ++i) out[i] = recovery_[i];
+    unlock_();
+    return n;
+}
+
+bool Storage::lock_() const {
+    if (!mutex_) return false;
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+void Storage::unlock_() const {
+    if (mutex_) xSemaphoreGive(mutex_);
+}
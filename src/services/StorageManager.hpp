@@ -0,0 +1,169 @@
+/**************************************************************
+ *  Storage - systeme de fichiers de persistance (SPIFFS / LittleFS)
+ *
+ *  But :
+ *  - Un seul point d'acces aux fichiers pour EventLog, SessionHistory,
+ *    PowerTracker et l'UI web (serveStatic) : le backend est choisi a la
+ *    compilation (STORAGE_BACKEND), sur la partition STORAGE_PARTITION.
+ *  - LittleFS : vrais repertoires, open/exists rapides, pas de pause de
+ *    ramasse-miettes quand la partition est presque pleine.
+ *
+ *  Migration :
+ *  - Au montage, si la partition contient l'autre format (changement de
+ *    backend), ses fichiers sont copies en RAM (PSRAM si dispo), la
+ *    partition est formatee puis les fichiers reecrits.
+ *  - Un fichier non copiable (plus de STORAGE_MIGRATE_MAX_FILES, memoire,
+ *    lecture) ou un repertoire : migration abandonnee AVANT formatage,
+ *    partition intacte et non montee (begin() echoue).
+ *  - Marqueur NVS (espace STORAGE_NVS_NAMESPACE) pose avant le formatage,
+ *    efface une fois tout reecrit : encore present au boot suivant =
+ *    migration interrompue (fichiers non reecrits perdus), signalee dans
+ *    /api/diag/storage puis efface.
+ *  - L'image de l'UI web doit etre construite pour le meme backend
+ *    (board_build.filesystem = spiffs / littlefs).
+ *
+ *  Banc de mesure :
+ *  - startBench() lance une tache qui mesure open, exists, ajout, lecture,
+ *    renommage (moyenne / pire cas en us) et, en option, les pauses en
+ *    remplissant la partition jusqu'a STORAGE_BENCH_FILL_PCT %.
+ *    Resultat : GET /api/diag/storage.
+ *
+ *  Coherence :
+ *  - Fichiers reecrits en entier : AtomicFile (temporaire + pied CRC +
+ *    renommage, version precedente gardee). Compteurs ici.
+ *  - Chaque module note la duree de sa reprise au boot (noteRecovery).
+ **************************************************************/
+#ifndef STORAGE_MANAGER_H
+#define STORAGE_MANAGER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <Config.hpp>
+
+class Storage {
+public:
+    // Mesure d'un type d'operation (us).
+    struct OpStats {
+        uint32_t count = 0;
+        uint32_t avg_us = 0;
+        uint32_t max_us = 0;
+        uint32_t failed = 0;
+    };
+
+    struct BenchResult {
+        bool valid = false;      // au moins un banc termine
+        bool running = false;
+        bool fill = false;       // phase de remplissage executee
+        uint32_t ts_ms = 0;      // fin du dernier banc (millis)
+        uint32_t duration_ms = 0;
+        OpStats open;            // open("r") + close d'un fichier existant
+        OpStats exists;          // exists() (fichier present puis absent)
+        OpStats append;          // open("a") + 32 octets + close
+        OpStats read;            // seek aleatoire + lecture de 32 octets
+        OpStats rename;
+        OpStats fill_write;      // ecritures de 4 Ko pendant le remplissage
+        uint32_t fill_kb = 0;
+    };
+
+    // Ecritures atomiques (AtomicFile).
+    struct AtomicStats {
+        uint32_t commits = 0;
+        uint32_t commit_failed = 0;
+        uint32_t loads = 0;
+        uint32_t fallbacks = 0;    // version ".tmp" / ".bak" relue
+        uint32_t load_failed = 0;  // aucune version valide
+        uint32_t max_load_us = 0;  // choix + verification CRC
+    };
+
+    // Reprise au boot d'un module (relecture, reparation).
+    struct Recovery {
+        const char* store = nullptr;
+        uint32_t us = 0;
+        uint32_t repaired = 0;     // elements repares ou ignores
+    };
+
+    // Derniere migration de backend (ce boot).
+    enum class Migration : uint8_t {
+        None = 0,       // pas d'autre format
+        Done,           // tous les fichiers reecrits
+        Aborted,        // copie impossible : partition intacte, non montee
+        Failed,         // formatee, reecriture incomplete
+        Interrupted     // marqueur trouve au boot : coupure pendant la migration
+    };
+
+    struct MigrationInfo {
+        Migration state = Migration::None;
+        uint16_t files = 0;       // fichiers a migrer (copies en RAM)
+        uint16_t written = 0;     // reecrits
+    };
+
+    // Singleton
+    static void Init();
+    static Storage* Get();
+
+    // Monte le backend (migration / formatage si illisible). false si
+    // migration abandonnee (partition laissee intacte).
+    bool begin();
+    bool mounted() const { return mounted_; }
+    const char* backendName() const;
+
+    // Systeme de fichiers du backend (serveStatic, parcours de repertoire).
+    fs::FS& fs();
+
+    File open(const char* path, const char* mode = "r");
+    File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+    size_t totalBytes();
+    size_t usedBytes();
+
+    // Banc de mesure (tache de fond) ; false si deja en cours ou non monte.
+    bool startBench(bool fill);
+    void getBench(BenchResult& out) const;
+
+    // Compteurs AtomicFile / reprise au boot (store : chaine constante).
+    void noteCommit(bool ok);
+    void noteLoad(bool ok, bool fallback, uint32_t us);
+    void noteRecovery(const char* store, uint32_t us, uint32_t repaired);
+    void getAtomicStats(AtomicStats& out) const;
+    size_t getRecovery(Recovery* out, size_t max) const;
+    void getMigration(MigrationInfo& out) const { out = migration_; }
+    static const char* migrationName(Migration m);
+
+private:
+    Storage();
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    // Copie les fichiers de l'autre format puis formate (voir Migration) ;
+    // migration_.state indique l'issue.
+    void migrate_();
+    // Marqueur de migration en cours (NVS, hors NVSManager).
+    static bool migrateMark_();
+    static void setMigrateMark_(bool on);
+
+    static void benchThunk_(void* arg);
+    void runBench_(bool fill);
+
+    bool lock_() const;
+    void unlock_() const;
+
+    bool mounted_ = false;
+    MigrationInfo migration_;
+    BenchResult bench_;
+    bool benchFill_ = false;
+    AtomicStats atomic_;
+    Recovery recovery_[STORAGE_RECOVERY_SLOTS];
+    uint8_t recoveryCount_ = 0;
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+
+    static Storage* s_instance;
+};
+
+#define STORAGE Storage::Get()
+
+#endif // STORAGE_MANAGER_H
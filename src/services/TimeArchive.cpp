@@ -0,0 +1,619 @@
+#include <TimeArchive.hpp>
+#include <StorageManager.hpp>
+#include <NVSManager.hpp>
+#include <esp_rom_crc.h>
+#include <Utils.hpp>
+
+// En-tete de segment (16 octets, little-endian).
+struct __attribute__((packed)) ArchFileHeader {
+    uint32_t magic;       // kArchMagic
+    uint8_t format;       // kArchFormat
+    uint8_t res;          // TimeArchive::Res
+    uint16_t recSize;     // sizeof(ArchRecord)
+    uint32_t day;         // jour UTC du segment
+    uint32_t crc;         // CRC32 des 12 octets precedents
+};
+
+// Cumul persistant (24 octets). Courants en 0.01 A, temperatures en
+// 0.1 C (kNoTemp : absente), duty en 0.01 %.
+struct __attribute__((packed)) ArchRecord {
+    uint32_t t;
+    uint8_t channel;
+    uint8_t coverage;
+    int16_t cur_min;
+    int16_t cur_mean;
+    int16_t cur_max;
+    int16_t motor_c;
+    int16_t board_c;
+    uint16_t duty;
+    float energy_wh;
+    uint16_t crc;         // CRC16 des 22 octets precedents
+};
+
+// Travail Persist : resolution + cumul.
+struct ArchJob {
+    uint8_t res;
+    uint8_t reserved[3];
+    ArchRecord rec;
+};
+
+static constexpr uint32_t kArchMagic = 0x31415354;  // "TSA1"
+static constexpr uint8_t kArchFormat = 1;
+static constexpr int16_t kNoTemp = INT16_MIN;
+static constexpr uint32_t kDayS = 86400U;
+static const char* const kBase[] = {ARCHIVE_MINUTE_BASE, ARCHIVE_HOUR_BASE};
+static_assert(sizeof(ArchFileHeader) == 16, "ArchFileHeader: taille fixe");
+static_assert(sizeof(ArchRecord) == 24, "ArchRecord: taille fixe");
+static_assert(sizeof(ArchJob) <= PERSIST_JOB_BYTES, "ArchJob trop grand pour un travail Persist");
+static_assert(ARCHIVE_MAX_SEGMENTS >= cfgParam(CfgId::ArchMinuteDays).max + cfgParam(CfgId::ArchHourDays).max + 2,
+              "ARCHIVE_MAX_SEGMENTS < retention max");
+
+static uint16_t crc16_(const uint8_t* p, size_t len) {
+    return static_cast<uint16_t>(esp_rom_crc32_le(0, p, len) & 0xFFFFU);
+}
+
+static bool recordOk_(const ArchRecord& r) {
+    return crc16_(reinterpret_cast<const uint8_t*>(&r), sizeof(r) - sizeof(r.crc)) == r.crc;
+}
+
+static int16_t quant_(float v, float scale) {
+    const float q = roundf(v * scale);
+    if (q > 32767.0f) return 32767;
+    if (q < -32767.0f) return -32767;
+    return static_cast<int16_t>(q);
+}
+
+static uint32_t segBytes_(uint16_t records) {
+    return sizeof(ArchFileHeader) + static_cast<uint32_t>(records) * sizeof(ArchRecord);
+}
+
+// -----------------------------------------------------------------------------
+// Singleton
+// -----------------------------------------------------------------------------
+TimeArchive* TimeArchive::s_instance = nullptr;
+
+void TimeArchive::Init() {
+    (void)ARCHIVE;
+}
+
+TimeArchive* TimeArchive::Get() {
+    if (!s_instance) {
+        s_instance = new TimeArchive();
+    }
+    return s_instance;
+}
+
+TimeArchive::TimeArchive() {
+    mutex_ = xSemaphoreCreateMutex();
+    ioMutex_ = xSemaphoreCreateMutex();
+}
+
+void TimeArchive::path_(Res res, uint32_t day, char* buf, size_t len) const {
+    snprintf(buf, len, "%s.%lu", kBase[static_cast<uint8_t>(res)], static_cast<unsigned long>(day));
+}
+
+// Segment abime : enregistrements complets recopies dans "~" puis
+// remplacement (coupure entre les deux : reprise au boot suivant).
+static bool truncate_(const char* path, uint16_t records) {
+    const String tmp = String(path) + "~";
+    File in = STORAGE->open(path, "r");
+    File out = STORAGE->open(tmp, "w");
+    bool copied = in && out;
+    if (copied) {
+        uint8_t buf[sizeof(ArchRecord) * 8];
+        size_t left = segBytes_(records);
+        while (copied && left > 0) {
+            const size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+            copied = in.read(buf, chunk) == chunk && out.write(buf, chunk) == chunk;
+            left -= chunk;
+        }
+    }
+    if (in) in.close();
+    if (out) out.close();
+    if (copied) copied = STORAGE->remove(path) && STORAGE->rename(tmp, path);
+    if (!copied) STORAGE->remove(tmp);
+    return copied;
+}
+
+void TimeArchive::begin() {
+    const uint32_t t0 = micros();
+    budget_ = static_cast<uint32_t>(STORAGE->totalBytes() / 100U * ARCHIVE_STORAGE_PCT);
+
+    // Index : nom et taille de chaque segment (aucune lecture de contenu).
+    // Reparation interrompue ("~") reprise ; queue partielle recopiee.
+    uint32_t repaired = 0;
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
+    if (!lock_()) {
+        xSemaphoreGive(ioMutex_);
+        return;
+    }
+    Segment partial[4];
+    size_t nPartial = 0;
+    char tmps[4][24];
+    size_t nTmp = 0;
+    char path[32];
+    // Second passage seulement si une reparation "~" a ete reprise.
+    for (uint8_t pass = 0; pass < 2; ++pass) {
+        count_ = 0;
+        nPartial = 0;
+        nTmp = 0;
+        File dir = STORAGE->open("/");
+        if (dir) {
+            for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+                const char* name = f.name();
+                if (name[0] == '/') name++;
+                const size_t size = f.size();
+                f.close();
+
+                uint8_t r = 0;
+                size_t baseLen = 0;
+                for (; r < static_cast<uint8_t>(Res::Count); ++r) {
+                    const char* base = kBase[r] + 1;
+                    baseLen = strlen(base);
+                    if (strncmp(name, base, baseLen) == 0 && name[baseLen] == '.') break;
+                }
+                if (r == static_cast<uint8_t>(Res::Count)) continue;
+                char* end = nullptr;
+                const unsigned long day = strtoul(name + baseLen + 1, &end, 10);
+                if (end == name + baseLen + 1) continue;
+                if (*end == '~' && end[1] == 0) {
+                    if (nTmp < 4) snprintf(tmps[nTmp++], sizeof(tmps[0]), "/%s", name);
+                    continue;
+                }
+                if (*end != 0 || size < sizeof(ArchFileHeader)) continue;
+
+                Segment s;
+                s.day = static_cast<uint32_t>(day);
+                s.res = static_cast<Res>(r);
+                const size_t recs = (size - sizeof(ArchFileHeader)) / sizeof(ArchRecord);
+                s.records = static_cast<uint16_t>(recs > UINT16_MAX ? UINT16_MAX : recs);
+                if ((size - sizeof(ArchFileHeader)) % sizeof(ArchRecord) != 0 && nPartial < 4) {
+                    partial[nPartial++] = s;
+                }
+
+                // Table pleine : segments suivants ignores (retention).
+                bool found = false;
+                const uint16_t pos = find_(s.res, s.day, found);
+                if (found || count_ == ARCHIVE_MAX_SEGMENTS) continue;
+                memmove(&index_[pos + 1], &index_[pos], (count_ - pos) * sizeof(Segment));
+                index_[pos] = s;
+                count_++;
+            }
+            dir.close();
+        }
+        if (nTmp == 0) break;
+
+        // Reparation interrompue : "~" complet des que l'original a ete
+        // supprime ; sinon l'original fait foi.
+        for (size_t i = 0; i < nTmp; ++i) {
+            repaired++;
+            const String t(tmps[i]);
+            const String orig = t.substring(0, t.length() - 1);
+            if (STORAGE->exists(orig)) STORAGE->remove(tmps[i]);
+            else STORAGE->rename(tmps[i], orig);
+        }
+    }
+    unlock_();
+
+    for (size_t i = 0; i < nPartial; ++i) {
+        repaired++;
+        path_(partial[i].res, partial[i].day, path, sizeof(path));
+        truncate_(path, partial[i].records);
+    }
+
+    // Dernier t ecrit par resolution : dernier enregistrement du segment
+    // le plus recent (ordre des ajouts).
+    for (uint8_t r = 0; r < static_cast<uint8_t>(Res::Count); ++r) {
+        lock_();
+        Segment last;
+        bool have = false;
+        for (uint16_t i = count_; i-- > 0;) {
+            if (index_[i].res == static_cast<Res>(r) && index_[i].records) {
+                last = index_[i];
+                have = true;
+                break;
+            }
+        }
+        unlock_();
+        if (!have) continue;
+        path_(last.res, last.day, path, sizeof(path));
+        File f = STORAGE->open(path, "r");
+        ArchRecord rec;
+        if (f && f.seek(segBytes_(last.records - 1)) &&
+            f.read(reinterpret_cast<uint8_t*>(&rec), sizeof(rec)) == sizeof(rec) && recordOk_(rec)) {
+            lastT_[r] = rec.t;
+        } else {
+            lastT_[r] = last.day * kDayS;
+        }
+        if (f) f.close();
+    }
+
+    evict_(0);
+    xSemaphoreGive(ioMutex_);
+
+    DEBUG_PRINTF("[Archive] %u segments, %lu octets\n", static_cast<unsigned>(count_),
+                 static_cast<unsigned long>(totalBytes_()));
+    STORAGE->noteRecovery("archive", micros() - t0, repaired);
+}
+
+// -----------------------------------------------------------------------------
+// Tache Device
+// -----------------------------------------------------------------------------
+void TimeArchive::sample(uint8_t ch, uint32_t epoch, float currentA, float powerW,
+                         float motorC, float boardC, bool relayOn) {
+    if (ch >= DEVICE_CHANNELS) return;
+
+    // Duree couverte par cette mesure (trou plus long : non mesure).
+    const uint32_t now = millis();
+    uint32_t dt = lastMs_[ch] ? now - lastMs_[ch] : 0;
+    if (dt > ARCHIVE_MAX_GAP_MS) dt = 0;
+    lastMs_[ch] = now;
+
+    // RTC non reglee : periode inconnue.
+    if (epoch < ARCHIVE_MIN_EPOCH) return;
+
+    const uint32_t minuteT = epoch - epoch % 60U;
+    Acc& m = minute_[ch];
+    if (m.t && m.t != minuteT) closeMinute_(ch);
+    if (hour_[ch].t && hour_[ch].t != epoch - epoch % 3600U) closeHour_(ch);
+    if (m.t == 0) {
+        m = Acc();
+        m.t = minuteT;
+    }
+
+    if (m.n == 0 || currentA < m.min) m.min = currentA;
+    if (m.n == 0 || currentA > m.max) m.max = currentA;
+    m.sum += currentA;
+    m.n++;
+    m.ms += dt;
+    if (relayOn) {
+        m.onMs += dt;
+        m.energyWh += powerW * dt / 3600000.0f;
+    }
+    if (!isnan(motorC)) {
+        m.motorSum += motorC;
+        m.motorN++;
+    }
+    if (!isnan(boardC)) {
+        m.boardSum += boardC;
+        m.boardN++;
+    }
+}
+
+void TimeArchive::closeMinute_(uint8_t ch) {
+    Acc& m = minute_[ch];
+    if (m.n) submit_(Res::Minute, ch, m, 60U);
+
+    // Cumul de l'heure : somme des minutes.
+    Acc& h = hour_[ch];
+    const uint32_t hourT = m.t - m.t % 3600U;
+    if (h.t && h.t != hourT) closeHour_(ch);
+    if (h.t == 0) {
+        h = Acc();
+        h.t = hourT;
+    }
+    if (m.n) {
+        if (h.n == 0 || m.min < h.min) h.min = m.min;
+        if (h.n == 0 || m.max > h.max) h.max = m.max;
+        h.sum += m.sum;
+        h.n += m.n;
+        h.energyWh += m.energyWh;
+        h.ms += m.ms;
+        h.onMs += m.onMs;
+        h.motorSum += m.motorSum;
+        h.motorN += m.motorN;
+        h.boardSum += m.boardSum;
+        h.boardN += m.boardN;
+    }
+    m = Acc();
+}
+
+void TimeArchive::closeHour_(uint8_t ch) {
+    Acc& h = hour_[ch];
+    if (h.n) submit_(Res::Hour, ch, h, 3600U);
+    h = Acc();
+}
+
+void TimeArchive::submit_(Res res, uint8_t ch, const Acc& a, uint32_t periodS) {
+    ArchJob job;
+    memset(&job, 0, sizeof(job));
+    job.res = static_cast<uint8_t>(res);
+    ArchRecord& r = job.rec;
+    r.t = a.t;
+    r.channel = ch;
+    const uint32_t cov = a.ms / (periodS * 10U);
+    r.coverage = static_cast<uint8_t>(cov > 100U ? 100U : cov);
+    r.cur_min = quant_(a.min, 100.0f);
+    r.cur_mean = quant_(a.sum / a.n, 100.0f);
+    r.cur_max = quant_(a.max, 100.0f);
+    r.motor_c = a.motorN ? quant_(a.motorSum / a.motorN, 10.0f) : kNoTemp;
+    r.board_c = a.boardN ? quant_(a.boardSum / a.boardN, 10.0f) : kNoTemp;
+    r.duty = static_cast<uint16_t>(a.ms ? (static_cast<uint64_t>(a.onMs) * 10000U) / a.ms : 0U);
+    r.energy_wh = a.energyWh;
+    r.crc = crc16_(reinterpret_cast<const uint8_t*>(&r), sizeof(r) - sizeof(r.crc));
+    // Voie pleine : Persist abandonne le plus ancien travail (compte).
+    PERSIST->submit(Persist::Lane::Low, &TimeArchive::writeBatch_, this, &job, sizeof(job));
+}
+
+// -----------------------------------------------------------------------------
+// Tache Persist
+// -----------------------------------------------------------------------------
+void TimeArchive::writeBatch_(void* ctx, const Persist::Job* jobs, size_t n) {
+    TimeArchive* self = static_cast<TimeArchive*>(ctx);
+    xSemaphoreTake(self->ioMutex_, portMAX_DELAY);
+    for (size_t i = 0; i < n; ++i) {
+        ArchJob job;
+        memcpy(&job, jobs[i].data, sizeof(job));
+        if (job.res >= static_cast<uint8_t>(Res::Count)) continue;
+        self->append_(static_cast<Res>(job.res), reinterpret_cast<const uint8_t*>(&job.rec));
+    }
+    xSemaphoreGive(self->ioMutex_);
+}
+
+bool TimeArchive::append_(Res res, const uint8_t* rec) {
+    // Appele avec ioMutex_ pris.
+    ArchRecord r;
+    memcpy(&r, rec, sizeof(r));
+    const uint8_t ri = static_cast<uint8_t>(res);
+    const uint32_t day = r.t / kDayS;
+    char path[32];
+    path_(res, day, path, sizeof(path));
+
+    if (!lock_()) return false;
+    // Horloge reculee : l'ordre des segments (recherche par t) prime.
+    if (r.t < lastT_[ri]) {
+        stats_.dropped++;
+        unlock_();
+        return false;
+    }
+    bool found = false;
+    uint16_t pos = find_(res, day, found);
+    uint16_t records = found ? index_[pos].records : 0;
+    unlock_();
+
+    if (!found) {
+        // Nouveau jour : retention d'abord (le nouveau segment reste).
+        lastT_[ri] = r.t;
+        evict_(segBytes_(1));
+        ArchFileHeader h;
+        h.magic = kArchMagic;
+        h.format = kArchFormat;
+        h.res = ri;
+        h.recSize = sizeof(ArchRecord);
+        h.day = day;
+        h.crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h) - 4);
+        File f = STORAGE->open(path, "w");
+        const bool ok = f && f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) == sizeof(h);
+        if (f) f.close();
+        if (!lock_()) return false;
+        if (!ok || count_ == ARCHIVE_MAX_SEGMENTS) {
+            stats_.dropped++;
+            unlock_();
+            STORAGE->remove(path);
+            return false;
+        }
+        pos = find_(res, day, found);
+        memmove(&index_[pos + 1], &index_[pos], (count_ - pos) * sizeof(Segment));
+        index_[pos].day = day;
+        index_[pos].res = res;
+        index_[pos].records = 0;
+        count_++;
+        unlock_();
+    }
+
+    File f = STORAGE->open(path, "a");
+    const size_t written = f ? f.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r)) : 0;
+    if (f) f.close();
+    // Ecriture partielle : queue recopiee (ajouts suivants alignes).
+    if (written != sizeof(r) && written != 0) truncate_(path, records);
+
+    if (!lock_()) return false;
+    pos = find_(res, day, found);
+    if (written == sizeof(r) && found && index_[pos].records < UINT16_MAX) {
+        index_[pos].records++;
+        lastT_[ri] = r.t;
+        stats_.written++;
+        unlock_();
+        return true;
+    }
+    stats_.dropped++;
+    unlock_();
+    return false;
+}
+
+void TimeArchive::evict_(uint32_t keepBytes) {
+    // Appele avec ioMutex_ pris. Supprime : segments hors retention (jours
+    // comptes depuis le dernier t ecrit), puis, tant que le budget (plus
+    // keepBytes) est depasse, le plus ancien segment de minutes, sinon
+    // d'heures. Le segment le plus recent de chaque resolution reste.
+    const uint32_t keepDays[] = {CONF->GetCfg<CfgId::ArchMinuteDays>(), CONF->GetCfg<CfgId::ArchHourDays>()};
+    char path[32];
+    for (;;) {
+        if (!lock_()) return;
+        int victim = -1;
+        for (uint8_t r = 0; r < static_cast<uint8_t>(Res::Count) && victim < 0; ++r) {
+            const uint32_t today = lastT_[r] / kDayS;
+            for (uint16_t i = 0; i < count_; ++i) {
+                if (index_[i].res != static_cast<Res>(r)) continue;
+                if (index_[i].day + keepDays[r] <= today) victim = i;
+                break;
+            }
+        }
+        if (victim < 0 && totalBytes_() + keepBytes > budget_) {
+            for (uint8_t r = 0; r < static_cast<uint8_t>(Res::Count) && victim < 0; ++r) {
+                uint16_t first = count_;
+                uint16_t n = 0;
+                for (uint16_t i = 0; i < count_; ++i) {
+                    if (index_[i].res != static_cast<Res>(r)) continue;
+                    if (first == count_) first = i;
+                    n++;
+                }
+                if (n > 1) victim = first;
+            }
+        }
+        if (victim < 0) {
+            unlock_();
+            return;
+        }
+        const Segment s = index_[victim];
+        memmove(&index_[victim], &index_[victim + 1], (count_ - victim - 1) * sizeof(Segment));
+        count_--;
+        stats_.evicted++;
+        unlock_();
+
+        path_(s.res, s.day, path, sizeof(path));
+        STORAGE->remove(path);
+    }
+}
+
+uint16_t TimeArchive::find_(Res res, uint32_t day, bool& found) const {
+    // Index trie par (resolution, jour) ; sous mutex.
+    uint16_t lo = 0;
+    uint16_t hi = count_;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        const Segment& s = index_[mid];
+        if (s.res < res || (s.res == res && s.day < day)) lo = mid + 1;
+        else hi = mid;
+    }
+    found = lo < count_ && index_[lo].res == res && index_[lo].day == day;
+    return lo;
+}
+
+uint32_t TimeArchive::totalBytes_() const {
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < count_; ++i) total += segBytes_(index_[i].records);
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+// Lecture (HTTP)
+// -----------------------------------------------------------------------------
+size_t TimeArchive::query(Res res, uint8_t ch, uint32_t from, uint32_t to,
+                          Rollup* out, size_t maxOut, uint32_t& next) const {
+    next = 0;
+    if (!out || maxOut == 0 || from > to || res >= Res::Count) return 0;
+
+    size_t n = 0;
+    uint32_t day = from / kDayS;
+    const uint32_t lastDay = to / kDayS;
+    char path[32];
+    // Pas de suppression / ajout pendant la lecture d'un segment.
+    xSemaphoreTake(ioMutex_, portMAX_DELAY);
+    while (day <= lastDay) {
+        // Premier segment de la resolution a partir de day.
+        if (!lock_()) break;
+        bool found = false;
+        const uint16_t pos = find_(res, day, found);
+        Segment s;
+        const bool have = pos < count_ && index_[pos].res == res && index_[pos].day <= lastDay;
+        if (have) s = index_[pos];
+        unlock_();
+        if (!have) break;
+        day = s.day + 1;
+        if (s.records == 0) continue;
+
+        path_(res, s.day, path, sizeof(path));
+        File f = STORAGE->open(path, "r");
+        if (!f) continue;
+        ArchFileHeader h;
+        const bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+                        h.magic == kArchMagic && h.format == kArchFormat &&
+                        h.recSize == sizeof(ArchRecord) &&
+                        esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h) - 4) == h.crc;
+        if (!ok) {
+            f.close();
+            continue;
+        }
+
+        // Premier enregistrement avec t >= from (t croissant dans le segment).
+        ArchRecord r;
+        uint32_t lo = 0;
+        uint32_t hi = s.records;
+        while (lo < hi) {
+            const uint32_t mid = (lo + hi) / 2;
+            if (!f.seek(segBytes_(mid)) ||
+                f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) != sizeof(r)) {
+                hi = mid;
+                continue;
+            }
+            if (r.t < from) lo = mid + 1;
+            else hi = mid;
+        }
+
+        f.seek(segBytes_(lo));
+        for (uint32_t i = lo; i < s.records; ++i) {
+            if (f.read(reinterpret_cast<uint8_t*>(&r), sizeof(r)) != sizeof(r)) break;
+            if (!recordOk_(r) || r.channel != ch || r.t < from) continue;
+            if (r.t > to) break;
+            if (n == maxOut) {
+                // Plein : reprise a ce cumul (t unique par canal).
+                next = r.t;
+                break;
+            }
+            Rollup& o = out[n++];
+            o.t = r.t;
+            o.channel = r.channel;
+            o.coverage = r.coverage;
+            o.current_min = r.cur_min / 100.0f;
+            o.current_mean = r.cur_mean / 100.0f;
+            o.current_max = r.cur_max / 100.0f;
+            o.energy_wh = r.energy_wh;
+            o.motor_c = (r.motor_c == kNoTemp) ? NAN : r.motor_c / 10.0f;
+            o.board_c = (r.board_c == kNoTemp) ? NAN : r.board_c / 10.0f;
+            o.duty = r.duty / 10000.0f;
+        }
+        f.close();
+        if (next) break;
+        // Plein en fin de segment : reprise au segment suivant.
+        if (n == maxOut) {
+            if (day <= lastDay) next = day * kDayS;
+            break;
+        }
+    }
+    xSemaphoreGive(ioMutex_);
+    return n;
+}
+
+size_t TimeArchive::listSegments(Segment* out, size_t max) const {
+    if (!out || !lock_()) return 0;
+    size_t n = 0;
+    for (uint16_t i = 0; i < count_ && n < max; ++i) out[n++] = index_[i];
+    unlock_();
+    return n;
+}
+
+void TimeArchive::getStats(Stats& out) const {
+    if (!lock_()) return;
+    out = stats_;
+    for (uint8_t r = 0; r < static_cast<uint8_t>(Res::Count); ++r) {
+        out.segments[r] = 0;
+        out.first_day[r] = 0;
+        out.last_day[r] = 0;
+    }
+    for (uint16_t i = 0; i < count_; ++i) {
+        const uint8_t r = static_cast<uint8_t>(index_[i].res);
+        if (out.segments[r]++ == 0) out.first_day[r] = index_[i].day;
+        out.last_day[r] = index_[i].day;
+    }
+    out.bytes = totalBytes_();
+    out.budget = budget_;
+    unlock_();
+}
+
+void TimeArchive::resetStats() {
+    if (!lock_()) return;
+    stats_.written = 0;
+    stats_.dropped = 0;
+    stats_.evicted = 0;
+    unlock_();
+}
+
+bool TimeArchive::lock_() const {
+    if (!mutex_) return false;
+    return xSemaphoreTake(mutex_, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+void TimeArchive::unlock_() const {
+    if (mutex_) xSemaphoreGive(mutex_);
+}
@@ -0,0 +1,157 @@
+/**************************************************************
+ *  TimeArchive - archive longue duree des mesures (cumuls 1 min / 1 h)
+ *
+ *  Objectif :
+ *  - Le BusSampler ne garde que BUS_SAMPLER_HISTORY_SIZE echantillons en
+ *    RAM et SessionProfile seulement les sessions. Ici, chaque canal garde
+ *    des cumuls par minute et par heure (courant min / moyen / max,
+ *    energie, temperatures moteur et carte, part du temps relais ON) sur
+ *    des mois, meme moteur arrete.
+ *
+ *  Format :
+ *  - Segments journaliers (jour UTC = epoch / 86400) : "/tsm.<jour>"
+ *    (cumuls 1 min) et "/tsh.<jour>" (cumuls 1 h). En-tete de 16 octets
+ *    (CRC32) puis enregistrements fixes de 24 octets (CRC16), par t
+ *    croissant : recherche dichotomique dans un segment.
+ *  - Index des segments (jour, resolution, enregistrements) en RAM,
+ *    reconstruit au boot depuis la liste des fichiers (taille / 24).
+ *  - Une requete ne lit que les segments du jour de from au jour de to.
+ *
+ *  Ecriture :
+ *  - sample() (tache Device) cumule en RAM ; une minute / heure close
+ *    (horloge RTC) est deposee dans Persist (voie Low) qui l'ajoute au
+ *    segment du jour. Rien n'est ecrit depuis la tache Device.
+ *  - RTC non reglee (avant ARCHIVE_MIN_EPOCH) : rien n'est archive.
+ *    Horloge reculee : cumuls anterieurs au dernier ecrit ignores (ordre
+ *    des segments conserve), comptes dans dropped.
+ *  - Retention : archive_minute_days / archive_hour_days (NVS, /api/config)
+ *    et ARCHIVE_STORAGE_PCT % du stockage (minutes supprimees d'abord).
+ *
+ *  Concurrence :
+ *  - sample : tache Device uniquement.
+ *  - Index sous mutex ; ajout (Persist) et lecture (HTTP) d'un segment
+ *    sous ioMutex_ (pas de suppression pendant une lecture).
+ **************************************************************/
+#ifndef TIME_ARCHIVE_H
+#define TIME_ARCHIVE_H
+
+#include <Arduino.h>
+#include <Config.hpp>
+#include <PersistWorker.hpp>
+
+class TimeArchive {
+public:
+    enum class Res : uint8_t { Minute = 0, Hour, Count };
+
+    // Cumul d'une periode (un canal).
+    struct Rollup {
+        uint32_t t = 0;            // debut de periode (epoch)
+        uint8_t channel = 0;
+        uint8_t coverage = 0;      // % de la periode mesuree (boot, RTC)
+        float current_min = 0.0f;
+        float current_mean = 0.0f;
+        float current_max = 0.0f;
+        float energy_wh = 0.0f;
+        float motor_c = NAN;       // moyenne ; NAN : sonde absente
+        float board_c = NAN;
+        float duty = 0.0f;         // part du temps relais ON (0..1)
+    };
+
+    // Segment conserve.
+    struct Segment {
+        uint32_t day = 0;          // jour UTC (epoch / 86400)
+        uint16_t records = 0;
+        Res res = Res::Minute;
+    };
+
+    struct Stats {
+        uint16_t segments[static_cast<uint8_t>(Res::Count)] = {};
+        uint32_t first_day[static_cast<uint8_t>(Res::Count)] = {};
+        uint32_t last_day[static_cast<uint8_t>(Res::Count)] = {};
+        uint32_t bytes = 0;
+        uint32_t budget = 0;
+        uint32_t written = 0;      // cumuls ecrits
+        uint32_t dropped = 0;      // horloge reculee / ecriture echouee
+        uint32_t evicted = 0;      // segments supprimes (retention)
+    };
+
+    // Singleton
+    static void Init();
+    static TimeArchive* Get();
+
+    // Relit l'index des segments (apres Storage).
+    void begin();
+
+    // Tache Device : une mesure par canal et par cycle (epoch RTC du cycle).
+    // currentA / powerW : 0 moteur arrete ; motorC / boardC : NAN si absentes.
+    void sample(uint8_t ch, uint32_t epoch, float currentA, float powerW,
+                float motorC, float boardC, bool relayOn);
+
+    // Lecture : cumuls du canal ch avec t dans [from, to], par t croissant,
+    // au plus maxOut. next : t de reprise (0 si tout est lu).
+    size_t query(Res res, uint8_t ch, uint32_t from, uint32_t to,
+                 Rollup* out, size_t maxOut, uint32_t& next) const;
+
+    // Segments conserves, du plus ancien au plus recent.
+    size_t listSegments(Segment* out, size_t max) const;
+
+    void getStats(Stats& out) const;
+    void resetStats();
+
+private:
+    TimeArchive();
+    TimeArchive(const TimeArchive&) = delete;
+    TimeArchive& operator=(const TimeArchive&) = delete;
+
+    // Cumul en cours (tache Device).
+    struct Acc {
+        uint32_t t = 0;            // debut de periode, 0 : aucun
+        uint32_t n = 0;            // mesures de courant
+        float min = 0.0f;
+        float max = 0.0f;
+        float sum = 0.0f;
+        float energyWh = 0.0f;
+        uint32_t ms = 0;           // duree mesuree
+        uint32_t onMs = 0;         // dont relais ON
+        float motorSum = 0.0f;
+        uint32_t motorN = 0;
+        float boardSum = 0.0f;
+        uint32_t boardN = 0;
+    };
+
+    void closeMinute_(uint8_t ch);
+    void closeHour_(uint8_t ch);
+    void submit_(Res res, uint8_t ch, const Acc& a, uint32_t periodS);
+
+    // Tache Persist : ajout au segment du jour (cree au besoin).
+    static void writeBatch_(void* ctx, const Persist::Job* jobs, size_t n);
+    bool append_(Res res, const uint8_t* rec);
+    // Retention (jours, budget) ; appele avec ioMutex_ pris.
+    void evict_(uint32_t keepBytes);
+    void path_(Res res, uint32_t day, char* buf, size_t len) const;
+    // Position dans l'index (segment ou insertion) ; sous mutex.
+    uint16_t find_(Res res, uint32_t day, bool& found) const;
+    uint32_t totalBytes_() const;
+
+    bool lock_() const;
+    void unlock_() const;
+
+    Acc minute_[DEVICE_CHANNELS];
+    Acc hour_[DEVICE_CHANNELS];
+    uint32_t lastMs_[DEVICE_CHANNELS] = {};
+
+    Segment index_[ARCHIVE_MAX_SEGMENTS];
+    uint16_t count_ = 0;       // tri par (resolution, jour)
+    // Dernier t ecrit par resolution (ordre des segments).
+    uint32_t lastT_[static_cast<uint8_t>(Res::Count)] = {};
+    uint32_t budget_ = 0;
+    Stats stats_;
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+    mutable SemaphoreHandle_t ioMutex_ = nullptr;
+
+    static TimeArchive* s_instance;
+};
+
+#define ARCHIVE TimeArchive::Get()
+
+#endif // TIME_ARCHIVE_H
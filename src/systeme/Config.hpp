@@ -35,6 +35,16 @@
 // Bouton Boot/User (marche/arret + reset long)
 #define PIN_BUTTON           3     // GPIO bouton
 
+// Tables par canal (relais + ADC courant), canal 0 = PIN_RELAY / PIN_CURRENT_ADC.
+// Les ADC doivent rester sur ADC1 (GPIO1..10) : ADC2 est inutilisable quand
+// le Wi-Fi est actif. Surcharge possible via -D (liste entre accolades).
+#ifndef PIN_RELAY_CHANNELS
+#define PIN_RELAY_CHANNELS        { PIN_RELAY, 11, 12, 13 }
+#endif
+#ifndef PIN_CURRENT_ADC_CHANNELS
+#define PIN_CURRENT_ADC_CHANNELS  { PIN_CURRENT_ADC, 2, 8, 9 }
+#endif
+
 // Polarite du relais:
 // - true  : HIGH = ON,  LOW = OFF
 // - false : LOW  = ON,  HIGH = OFF
@@ -73,6 +83,45 @@
 // Periode de rafraichissement du snapshot systeme (ms)
 #define DEFAULT_SNAPSHOT_PERIOD_MS 250U
 
+// -----------------------------------------------------------------------------
+// Canaux (relais + capteur courant + sonde DS18 moteur par canal)
+// -----------------------------------------------------------------------------
+// Nombre de canaux pilotes (1 = carte d'origine). Surcharge : -DDEVICE_CHANNELS=4
+#ifndef DEVICE_CHANNELS
+#define DEVICE_CHANNELS             1U
+#endif
+// Limite : les cles NVS par canal sont suffixees d'un seul chiffre
+#define DEVICE_MAX_CHANNELS         8U
+// Canal "tous" (Stop / ClearFault / mise a jour de config)
+#define CHANNEL_ALL                 0xFF
+
+static_assert(DEVICE_CHANNELS >= 1 && DEVICE_CHANNELS <= DEVICE_MAX_CHANNELS,
+              "DEVICE_CHANNELS hors limites");
+
+// -----------------------------------------------------------------------------
+// Commandes Device (file + suivi d'execution)
+// -----------------------------------------------------------------------------
+// Profondeur de la voie normale (bouton + HTTP)
+#define DEVICE_CMD_QUEUE_LEN        10U
+// Profondeur de la voie express (Stop / ClearFault, traitee en premier)
+#define DEVICE_CMD_EXPRESS_LEN      4U
+// Nombre de resultats de commandes conserves (consultables par id)
+#define DEVICE_CMD_RESULT_SLOTS     16U
+// Attente par defaut / max d'un resultat cote HTTP (ms) : reponse differee,
+// AsyncTCP n'est jamais bloque
+#define CMD_WAIT_DEFAULT_MS         250U
+#define CMD_WAIT_MAX_MS             2000U
+
+// -----------------------------------------------------------------------------
+// Coalescence des alertes (Device -> EventLog)
+// -----------------------------------------------------------------------------
+// Nombre d'alertes distinctes (niveau + code + source) suivies en meme temps
+#define ALERT_COALESCE_SLOTS        12U
+// Une alerte qui se repete produit au plus une entree par intervalle (ms)
+#define ALERT_FLUSH_MS              60000U
+// Alerte non repetee depuis ce delai (ms) : terminee (entree finale + slot libre)
+#define ALERT_IDLE_MS               10000U
+
 // -----------------------------------------------------------------------------
 // Seuils et comportements par defaut
 // -----------------------------------------------------------------------------
@@ -92,6 +141,15 @@
 // true: surchauffe verrouillee (reset/clear_fault requis)
 #define DEFAULT_LATCH_OVERTEMP       true
 
+// Surchauffe predictive (tendance temperature, filtre alpha-beta)
+// Fenetre equivalente (nombre de lectures) et periode d'alimentation (ms)
+#define DEFAULT_TREND_WINDOW         30U
+#define TREND_UPDATE_PERIOD_MS       1000U
+// Horizon de prediction (s) : alerte si le seuil est atteint avant
+#define DEFAULT_TREND_HORIZON_S      60U
+// Action sur croisement prevu (voir TrendAction)
+#define DEFAULT_TREND_ACTION         0
+
 // Tension moteur (V) utilisee pour calculer la puissance: P = V * I
 #define DEFAULT_MOTOR_VCC_V          12.0f
 
@@ -113,6 +171,13 @@
 #define DEFAULT_RUN_DEFAULT_S        60U
 #define DEFAULT_RUN_MAX_S            3600U
 
+// Planificateur de marches recurrentes (voir RunScheduler)
+// Nombre max de regles et periode d'evaluation (ms)
+#define SCHED_MAX_RULES              16U
+#define SCHED_TICK_MS                1000U
+// Saut d'horloge (s) au-dela duquel les prochaines echeances sont recalculees
+#define SCHED_CLOCK_JUMP_S           120U
+
 // NTP / timezone
 // Serveur NTP et periode de resync (secondes)
 #define DEFAULT_NTP_SERVER           "pool.ntp.org"
@@ -124,6 +189,48 @@
 #define DEFAULT_TZ_OFFSET_MIN        0
 #define DEFAULT_TZ_NAME              "UTC"
 
+// -----------------------------------------------------------------------------
+// Reponses en flux (JsonStream : /api/history, /api/events, /api/sessions ;
+// CsvStream : /api/export/*)
+// -----------------------------------------------------------------------------
+// Tampon d'un morceau (en-tete, un element, pied) : taille max d'un element
+#define JSON_STREAM_PIECE_BYTES     512U
+// Elements lus par acces a la source (ring buffer / fichier)
+#define JSON_STREAM_BATCH           16U
+// Elements examines (filtres compris) par appel de next() : au-dela, morceau
+// vide et reprise au rappel AsyncTCP suivant
+#define JSON_STREAM_SCAN_MAX        256U
+// Export CSV (CsvStream) : ligne formatee max, colonnes selectionnables max
+#define CSV_ROW_BYTES               256U
+#define CSV_MAX_COLUMNS             16U
+
+// -----------------------------------------------------------------------------
+// Push SSE (/api/live)
+// -----------------------------------------------------------------------------
+// Periode de la tache worker : un envoi par type au plus par periode
+#define LIVE_TICK_MS                500U
+// Abonnes simultanes max (au-dela : connexion fermee, l'UI reste en polling)
+#define LIVE_MAX_CLIENTS            4U
+// Echantillons / evenements max par envoi (le reste part a la periode suivante)
+#define LIVE_SAMPLES_MAX            64U
+#define LIVE_EVENTS_MAX             16U
+// Messages en attente d'un abonne au-dela desquels status / history sont sautes
+#define LIVE_SLOW_QUEUE             8U
+// Abonne en retard depuis plus longtemps : ferme (reconnexion ou polling)
+#define LIVE_SLOW_CLOSE_MS          10000U
+// File commune worker -> AsyncTCP (messages) ; abonne depasse : ferme
+#define LIVE_OUTBOX_LEN             16U
+// Evenements renvoyes au plus a une reconnexion (Last-Event-ID)
+#define LIVE_REPLAY_MAX             64U
+
+// -----------------------------------------------------------------------------
+// Telechargement binaire des fichiers persistants (/api/download)
+// -----------------------------------------------------------------------------
+// Octets lus en flash par morceau de reponse (tache AsyncTCP)
+#define DOWNLOAD_CHUNK_BYTES        1024U
+// Octets de fin de fichier haches pour l'ETag (CRC des derniers enregistrements)
+#define DOWNLOAD_ETAG_TAIL_BYTES    32U
+
 // Epoch par defaut (0 => non calibre)
 #define DEFAULT_RTC_EPOCH            0ULL
 
@@ -137,13 +244,117 @@
 // Activation buzzer par defaut
 #define DEFAULT_BUZZER_ENABLED       true
 
+// Stockage fichiers (Storage) : backend choisi a la compilation, sur la
+// partition "spiffs" (meme image pour l'UI web : board_build.filesystem)
+#define STORAGE_SPIFFS               0
+#define STORAGE_LITTLEFS             1
+#ifndef STORAGE_BACKEND
+#define STORAGE_BACKEND              STORAGE_SPIFFS
+#endif
+#define STORAGE_PARTITION            "spiffs"
+#define STORAGE_MAX_OPEN_FILES       10U
+// Migration entre backends : fichiers copies au plus (via PSRAM). Marqueur
+// de migration en cours : espace NVS propre (Storage monte avant NVS::Init)
+#define STORAGE_MIGRATE_MAX_FILES    64U
+#define STORAGE_NVS_NAMESPACE        "storage"
+#define STORAGE_NVS_MIGRATE_KEY      "MIGR"
+// Banc de mesure (/api/diag/storage) : operations par type, remplissage (%)
+#define STORAGE_BENCH_OPS            200U
+#define STORAGE_BENCH_FILL_PCT       90U
+// Modules dont la reprise au boot est mesuree (/api/diag/storage)
+#define STORAGE_RECOVERY_SLOTS       8U
+
 // SPIFFS
-// Nombre max d'entrees en RAM (puis persistance JSON)
+// Nombre max d'entrees en RAM (EventLog, 28 octets chacune) / renvoyees
+// par /api/sessions
 #define DEFAULT_EVENTLOG_MAX_ENTRIES 500U
+// Ring buffer EventLog : part du tas au plus (octets) ; borne haute de
+// eventlog.max_entries = budget / 28 octets
+#define EVTLOG_RAM_BUDGET_BYTES      28000U
+#define EVTLOG_MAX_ENTRIES           (EVTLOG_RAM_BUDGET_BYTES / 28U)
 #define DEFAULT_SESSION_MAX_ENTRIES  200U
-// Fichiers JSON sur SPIFFS
+// Fichiers sur SPIFFS (chemins de base, voir formats ci-dessous)
 #define DEFAULT_SPIFFS_SESS_FILE     "/sessions.json"
 #define DEFAULT_SPIFFS_EVT_FILE      "/events.json"
+// SessionHistory : fichier binaire "<fichier sans extension>.bin" (en-tete
+// + enregistrements fixes) ; plein => renomme en ".old" (un seul ancien
+// fichier). Part du SPIFFS pour les deux fichiers (%) et minimum par fichier
+#define SESS_SPIFFS_PCT              50U
+#define SESS_FILE_MIN_RECORDS        256U
+// Agregats de sessions en RAM (/api/session_stats) : jours conserves
+#define SESS_AGG_DAYS                400U
+// EventLog : journal binaire en segments "<fichier sans extension>.N"
+// (enregistrements fixes de 32 octets + CRC, ajout seul) ; enregistrements
+// par segment
+#define EVTLOG_SEG_RECORDS           128U
+// Attente max du mutex du journal pour un evenement de niveau erreur (ms)
+#define EVTLOG_ERROR_LOCK_MS         200U
+// Profil de session (SessionProfile) : un point (courant min / moyen / max,
+// temperature moteur) toutes les PROFILE_PERIOD_MS, blocs compresses de
+// PROFILE_BLOCK_POINTS points (un travail Persist) ajoutes a "/prof.<id>"
+#define PROFILE_FILE_BASE            "/prof"
+#define PROFILE_PERIOD_MS            1000U
+#define PROFILE_BLOCK_POINTS         12U
+// Points max d'un profil (24 h a 1 s, duree max d'une marche) : au-dela,
+// plus d'enregistrement ; indice lu au-dela = fichier incoherent
+#define PROFILE_MAX_POINTS           86400UL
+// Retention : nombre de profils et part du stockage (%)
+#define PROFILE_MAX_FILES            64U
+#define PROFILE_STORAGE_PCT          20U
+// Points (groupes) max par reponse de /api/session_profile
+#define PROFILE_API_MAX_POINTS       300U
+// Archive (TimeArchive) : cumuls 1 min / 1 h par canal, segments
+// journaliers "<base>.<jour UTC>" ; retention en jours (NVS) et part du
+// stockage (%). ARCHIVE_MAX_SEGMENTS >= max minutes + max heures (schema).
+#define ARCHIVE_MINUTE_BASE          "/tsm"
+#define ARCHIVE_HOUR_BASE            "/tsh"
+#define ARCHIVE_MAX_SEGMENTS         512U
+#define ARCHIVE_STORAGE_PCT          25U
+#define DEFAULT_ARCHIVE_MINUTE_DAYS  7U
+#define DEFAULT_ARCHIVE_HOUR_DAYS    365U
+// Epoch minimal archive (RTC non reglee avant : 2024-01-01) et trou
+// maximal entre deux mesures compte comme mesure
+#define ARCHIVE_MIN_EPOCH            1704067200UL
+#define ARCHIVE_MAX_GAP_MS           2000U
+// /api/archive : cumuls max par reponse
+#define ARCHIVE_API_MAX_POINTS       1440U
+
+// NVS : miroir RAM des cles et ecriture differee (voir NVS)
+// Nombre de cles suivies (base + cles par canal) et periode d'ecriture (ms)
+#define NVS_MIRROR_SLOTS             128U
+#define NVS_FLUSH_MS                 2000U
+// Blob de configuration : tous les parametres du schema dans une seule cle
+// (versionnee, CRC), relue en un getBytes() au boot. 0 = cles seules.
+#ifndef NVS_CONFIG_BLOB
+#define NVS_CONFIG_BLOB              1
+#endif
+// Usure NVS : ecritures flash par cle et par heure avant warning W12
+// (0 = pas de warning), cycles d'effacement garantis par secteur (datasheet)
+#ifndef NVS_WRITE_BUDGET_H
+#define NVS_WRITE_BUDGET_H           60U
+#endif
+#define NVS_FLASH_CYCLES             100000U
+// Debit d'ecriture glissant : fenetre d'une heure en NVS_RATE_BUCKETS tranches
+#define NVS_RATE_BUCKETS             12U
+#define NVS_RATE_WINDOW_MS           3600000UL
+
+// Persistance asynchrone (tache Persist) : ecritures flash (sessions,
+// journal, NVS) hors des taches Device / HTTP.
+// Profondeur des voies (haute : sessions, basse : journal). Voie basse
+// pleine : plus ancien travail abandonne ; voie haute pleine : travail
+// range dans une reserve RAM (PERSIST_HIGH_PENDING) reprise par la tache,
+// jamais d'ecriture dans la tache du deposant
+#define PERSIST_HIGH_LEN             8U
+#define PERSIST_HIGH_PENDING         16U
+#define PERSIST_LOW_LEN              24U
+// Taille max d'un travail (>= un bloc SessionProfile brut) et travaux
+// ecrits par lot (meme destinataire => un seul open/close)
+#define PERSIST_JOB_BYTES            108U
+#define PERSIST_BATCH_MAX            8U
+// Attente max de flush() avant reboot / sommeil profond (ms)
+#define PERSIST_FLUSH_TIMEOUT_MS     3000U
+// Attente max du Stop (fin de session deposee) avant ce flush (ms)
+#define PERSIST_STOP_WAIT_MS         1000U
 
 // -----------------------------------------------------------------------------
 // Temporisations LED CMD (clignotements rapides)
@@ -180,6 +391,12 @@ enum class OvcMode : uint8_t {
     AutoRetry = 1
 };
 
+// Action declenchee par la surchauffe predictive.
+enum class TrendAction : uint8_t {
+    Warn = 0,   // Warning W10 uniquement
+    Stop = 1    // Warning W10 + arret relais (non verrouille)
+};
+
 enum class WiFiModeSetting : uint8_t {
     Sta = 0,
     Ap = 1
@@ -203,7 +420,13 @@ enum class WarnCode : uint16_t {
     // Web
     W07_AuthFail    = 7,
     W08_Unauthorized= 8,
-    W09_ClientGone  = 9
+    W09_ClientGone  = 9,
+    // Protection
+    W10_TempTrend   = 10,
+    // Planificateur
+    W11_SchedSkip   = 11,
+    // Stockage
+    W12_NvsWear     = 12
 };
 
 // Codes d'erreur (Exx)
@@ -224,6 +447,8 @@ enum class ErrorCode : uint16_t {
 // -----------------------------------------------------------------------------
 // IMPORTANT: Preferences impose une cle courte (ici <= 6 caracteres).
 // Les commentaires ci-dessous servent de "schema" lisible.
+// Cles par canal (courant, OVC, TMOT, RLYLS) : canal 0 = cle de base, canal N
+// = cle + chiffre N (voir NVS::ChannelKey) ; ces cles de base font <= 5 car.
 #define KEY_DEV_ID        "DEVID"
 #define KEY_DEV_NAME      "DEVNM"
 #define KEY_DEV_HW        "DEVHW"
@@ -251,6 +476,9 @@ enum class ErrorCode : uint16_t {
 #define KEY_TEMP_AMB      "TAMB"
 #define KEY_TEMP_HYST     "THYS"
 #define KEY_LATCH_TEMP    "TLAT"
+#define KEY_TREND_WIN     "TRWIN"
+#define KEY_TREND_HOR     "TRHOR"
+#define KEY_TREND_ACT     "TRACT"
 
 #define KEY_RELAY_LAST    "RLYLS"
 #define KEY_RESET_FLAG    "RSTFL"
@@ -271,10 +499,15 @@ enum class ErrorCode : uint16_t {
 
 #define KEY_RUN_DEFAULT   "RNDEF"
 #define KEY_RUN_MAX       "RNMAX"
+#define KEY_SCHED_RULES   "SCHRL"
+#define KEY_CFG_BLOB      "CFGBL"   // blob config (voir NVS_CONFIG_BLOB)
 
 #define KEY_EVENT_MAX     "EVMAX"
 #define KEY_SESS_MAX      "SSMAX"
 #define KEY_SPIFFS_SESS   "SPSES"
+#define KEY_SESS_ORDER    "SSORD"   // rupture d'ordre des sessions (seq, fin max avant)
 #define KEY_SPIFFS_EVT    "SPEVT"
+#define KEY_ARCH_MIN      "ARMIN"
+#define KEY_ARCH_HOUR     "ARHOR"
 
 #endif // CONFIG_H
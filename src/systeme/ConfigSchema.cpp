@@ -0,0 +1,107 @@
+#include <ConfigSchema.hpp>
+#include <math.h>
+
+// -----------------------------------------------------------------------------
+// Conversions generiques (pilotees par le schema)
+// -----------------------------------------------------------------------------
+static CfgValue fromDouble_(CfgType type, double x) {
+    CfgValue v;
+    v.u64 = 0;
+    switch (type) {
+        case CfgType::Bool:    v.b = (x != 0.0); break;
+        case CfgType::Int:     v.i = static_cast<int32_t>(x); break;
+        case CfgType::UInt:    v.u = static_cast<uint32_t>(x); break;
+        case CfgType::ULong64: v.u64 = static_cast<uint64_t>(x); break;
+        case CfgType::Float:   v.f = static_cast<float>(x); break;
+        default: break;
+    }
+    return v;
+}
+
+static double toDouble_(CfgType type, const CfgValue& v) {
+    switch (type) {
+        case CfgType::Bool:    return v.b ? 1.0 : 0.0;
+        case CfgType::Int:     return v.i;
+        case CfgType::UInt:    return v.u;
+        case CfgType::ULong64: return static_cast<double>(v.u64);
+        case CfgType::Float:   return v.f;
+        default:               return 0.0;
+    }
+}
+
+CfgValue cfgDefault(CfgId id) {
+    const CfgParam& p = cfgParam(id);
+    return fromDouble_(p.type, p.def);
+}
+
+bool cfgInRange(CfgId id, const CfgValue& v) {
+    const CfgParam& p = cfgParam(id);
+    if (p.type == CfgType::String) return false;
+    const double x = toDouble_(p.type, v);
+    // NaN echoue aux deux comparaisons : rejete.
+    return x >= p.min && x <= p.max;
+}
+
+bool cfgInRange(CfgId id, const String& s) {
+    const CfgParam& p = cfgParam(id);
+    if (p.type != CfgType::String) return false;
+    return s.length() >= p.min && s.length() <= p.max;
+}
+
+// -----------------------------------------------------------------------------
+// JSON
+// -----------------------------------------------------------------------------
+bool cfgFromJson(CfgId id, JsonVariantConst in, CfgValue& out) {
+    const CfgParam& p = cfgParam(id);
+    if (p.type == CfgType::String) return false;
+
+    double x = 0.0;
+    if (in.is<bool>()) {
+        x = in.as<bool>() ? 1.0 : 0.0;
+    } else if (in.is<double>()) {
+        x = in.as<double>();
+    } else if (in.is<const char*>()) {
+        // Nom d'enum (insensible a la casse) ou nombre ecrit en texte.
+        const char* s = in.as<const char*>();
+        bool found = false;
+        for (uint8_t i = 0; i < p.nameCount && !found; ++i) {
+            if (strcasecmp(s, p.names[i]) == 0) {
+                x = i;
+                found = true;
+            }
+        }
+        if (!found) {
+            char* end = nullptr;
+            x = strtod(s, &end);
+            if (end == s || *end != 0) return false;
+        }
+    } else {
+        return false;
+    }
+
+    // Entiers : pas de partie decimale (evite une troncature silencieuse).
+    if (p.type != CfgType::Float && p.type != CfgType::Bool && x != floor(x)) return false;
+    if (!(x >= p.min && x <= p.max)) return false;
+
+    out = fromDouble_(p.type, x);
+    return true;
+}
+
+bool cfgFromJson(CfgId id, JsonVariantConst in, String& out) {
+    if (cfgParam(id).type != CfgType::String || !in.is<const char*>()) return false;
+    String s = in.as<const char*>();
+    if (!cfgInRange(id, s)) return false;
+    out = s;
+    return true;
+}
+
+void cfgToJson(CfgId id, const CfgValue& v, JsonVariant out) {
+    switch (cfgParam(id).type) {
+        case CfgType::Bool:    out.set(v.b); break;
+        case CfgType::Int:     out.set(v.i); break;
+        case CfgType::UInt:    out.set(v.u); break;
+        case CfgType::ULong64: out.set(v.u64); break;
+        case CfgType::Float:   out.set(v.f); break;
+        default: break;
+    }
+}
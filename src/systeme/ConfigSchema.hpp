@@ -0,0 +1,261 @@
+/**************************************************************
+ *  Schema de configuration (NVS) - table constexpr typee
+ *
+ *  Une ligne par parametre (X-macro CFG_SCHEMA) :
+ *    id, cle NVS, type, portee, classe, nom JSON, defaut, min, max,
+ *    noms acceptes en JSON (enum).
+ *  A partir de cette table :
+ *  - enum CfgId : index dans la table et dans le cache RAM de NVS
+ *  - NVS::ensureDefaults_ cree les cles manquantes
+ *  - NVS charge/valide toutes les valeurs au boot (hors bornes => defaut)
+ *  - /api/config serialise (GET) et analyse/valide (POST) les parametres
+ *  - NVS::GetCfg<Id>() / PutCfg<Id>() : type verifie a la compilation
+ *
+ *  Portee Channel : une valeur par canal (cle NVS::ChannelKey).
+ *  Classe :
+ *  - Setting  : lu et ecrit par /api/config
+ *  - Secret   : ecrit par /api/config, jamais renvoye (mots de passe)
+ *  - ReadOnly : renvoye par /api/config, ecrit ailleurs (calibration)
+ *  - Internal : hors /api/config (identite, auth, stockage)
+ *  - State    : hors /api/config, etat d'exploitation ecrit souvent
+ *               (relais, horloge) : cle NVS seule, hors blob
+ *  Bornes : valeur pour les nombres, longueur pour les chaines.
+ *
+ *  Ajouter un parametre = une ligne ici + sa cle KEY_* (Config.hpp).
+ **************************************************************/
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Config.hpp>
+
+enum class CfgType : uint8_t { Bool, Int, UInt, ULong64, Float, String };
+enum class CfgScope : uint8_t { Global, Channel };
+enum class CfgClass : uint8_t { Setting, Secret, ReadOnly, Internal, State };
+
+// Valeur numerique brute (le type est donne par le schema).
+union CfgValue {
+    bool b;
+    int32_t i;
+    uint32_t u;
+    uint64_t u64;
+    float f;
+};
+
+// Noms acceptes en JSON pour les parametres "enum" (index = valeur).
+constexpr const char* kCfgOvcModeNames[] = {"latch", "auto"};
+constexpr const char* kCfgTrendActionNames[] = {"warn", "stop"};
+constexpr const char* kCfgWifiModeNames[] = {"sta", "ap"};
+
+#define CFG_NUM(v)   static_cast<double>(v), nullptr
+#define CFG_STR(s)   0.0, s
+#define CFG_ENUM(a)  a, static_cast<uint8_t>(sizeof(a) / sizeof(a[0]))
+#define CFG_NOENUM   nullptr, 0
+
+// X(id, cle, type, portee, classe, json, defaut, min, max, enum)
+#define CFG_SCHEMA(X) \
+    /* Identite (DevId : defaut derive du MAC, voir NVS) */ \
+    X(DevId,         KEY_DEV_ID,      String,  Global,  Internal, "device_id",           CFG_STR(nullptr),                     1, 31,    CFG_NOENUM) \
+    X(DevName,       KEY_DEV_NAME,    String,  Global,  Internal, "device_name",         CFG_STR(DEFAULT_DEVICE_NAME),         1, 31,    CFG_NOENUM) \
+    X(DevSw,         KEY_DEV_SW,      String,  Global,  Internal, "sw",                  CFG_STR(DEVICE_SW_VERSION),           0, 15,    CFG_NOENUM) \
+    X(DevHw,         KEY_DEV_HW,      String,  Global,  Internal, "hw",                  CFG_STR(DEVICE_HW_VERSION),           0, 15,    CFG_NOENUM) \
+    /* Wi-Fi (mot de passe AP : 8+ caracteres, exige par WiFi.softAP) */ \
+    X(StaSsid,       KEY_STA_SSID,    String,  Global,  Setting,  "sta_ssid",            CFG_STR(DEFAULT_STA_SSID),            0, 32,    CFG_NOENUM) \
+    X(StaPass,       KEY_STA_PASS,    String,  Global,  Secret,   "sta_pass",            CFG_STR(DEFAULT_STA_PASS),            0, 64,    CFG_NOENUM) \
+    X(ApSsid,        KEY_AP_SSID,     String,  Global,  Setting,  "ap_ssid",             CFG_STR(DEFAULT_AP_SSID),             1, 32,    CFG_NOENUM) \
+    X(ApPass,        KEY_AP_PASS,     String,  Global,  Secret,   "ap_pass",             CFG_STR(DEFAULT_AP_PASS),             8, 63,    CFG_NOENUM) \
+    X(WifiMode,      KEY_WIFI_MODE,   Int,     Global,  Setting,  "wifi_mode",           CFG_NUM(static_cast<int>(WiFiModeSetting::Sta)),        0, 1,     CFG_ENUM(kCfgWifiModeNames)) \
+    /* Courant / ADC (calibration ecrite par Acs712Sensor) */ \
+    X(CurZero,       KEY_CUR_ZERO,    Float,   Channel, ReadOnly, "current_zero_mv",     CFG_NUM(DEFAULT_CURRENT_ZERO_MV),     0, 5000,  CFG_NOENUM) \
+    X(CurSens,       KEY_CUR_SENS,    Float,   Channel, ReadOnly, "current_sens_mv_a",   CFG_NUM(DEFAULT_CURRENT_SENS_MV_A),   1, 1000,  CFG_NOENUM) \
+    X(CurScale,      KEY_CUR_SCALE,   Float,   Channel, ReadOnly, "current_input_scale", CFG_NUM(DEFAULT_CURRENT_INPUT_SCALE), 0.01, 10, CFG_NOENUM) \
+    X(AdcRef,        KEY_ADC_REF,     Float,   Global,  Internal, "adc_ref_v",           CFG_NUM(DEFAULT_ADC_REF_V),           0.5, 6,   CFG_NOENUM) \
+    X(AdcMax,        KEY_ADC_MAX,     Int,     Global,  Internal, "adc_max",             CFG_NUM(DEFAULT_ADC_MAX),             255, 65535, CFG_NOENUM) \
+    /* Surintensite */ \
+    X(LimitCurrent,  KEY_LIM_CUR,     Float,   Channel, Setting,  "limit_current_a",     CFG_NUM(DEFAULT_LIMIT_CURRENT_A),     0, 50,    CFG_NOENUM) \
+    X(OvcMode,       KEY_OVC_MODE,    Int,     Channel, Setting,  "ovc_mode",            CFG_NUM(static_cast<int>(OvcMode::Latch)),       0, 1,     CFG_ENUM(kCfgOvcModeNames)) \
+    X(OvcMinMs,      KEY_OVC_MIN,     UInt,    Channel, Setting,  "ovc_min_ms",          CFG_NUM(DEFAULT_OVC_MIN_DURATION_MS), 0, 60000, CFG_NOENUM) \
+    X(OvcRetryMs,    KEY_OVC_RTRY,    UInt,    Channel, Setting,  "ovc_retry_ms",        CFG_NUM(DEFAULT_OVC_RETRY_DELAY_MS),  0, 3600000, CFG_NOENUM) \
+    /* Temperatures */ \
+    X(TempMotor,     KEY_TEMP_MOTOR,  Float,   Channel, Setting,  "temp_motor_c",        CFG_NUM(DEFAULT_TEMP_MOTOR_C),        -40, 150, CFG_NOENUM) \
+    X(TempBoard,     KEY_TEMP_BOARD,  Float,   Global,  Setting,  "temp_board_c",        CFG_NUM(DEFAULT_TEMP_BOARD_C),        -40, 125, CFG_NOENUM) \
+    X(TempAmbient,   KEY_TEMP_AMB,    Float,   Global,  Setting,  "temp_ambient_c",      CFG_NUM(DEFAULT_TEMP_AMBIENT_C),      -40, 125, CFG_NOENUM) \
+    X(TempHyst,      KEY_TEMP_HYST,   Float,   Global,  Setting,  "temp_hyst_c",         CFG_NUM(DEFAULT_TEMP_HYST_C),         0, 50,    CFG_NOENUM) \
+    X(LatchOvertemp, KEY_LATCH_TEMP,  Bool,    Global,  Setting,  "latch_overtemp",      CFG_NUM(DEFAULT_LATCH_OVERTEMP),      0, 1,     CFG_NOENUM) \
+    X(TrendWindow,   KEY_TREND_WIN,   UInt,    Global,  Setting,  "trend_window",        CFG_NUM(DEFAULT_TREND_WINDOW),        2, 600,   CFG_NOENUM) \
+    X(TrendHorizon,  KEY_TREND_HOR,   UInt,    Global,  Setting,  "trend_horizon_s",     CFG_NUM(DEFAULT_TREND_HORIZON_S),     1, 3600,  CFG_NOENUM) \
+    X(TrendAction,   KEY_TREND_ACT,   Int,     Global,  Setting,  "trend_action",        CFG_NUM(DEFAULT_TREND_ACTION),        0, 1,     CFG_ENUM(kCfgTrendActionNames)) \
+    /* Exploitation */ \
+    X(RelayLast,     KEY_RELAY_LAST,  Bool,    Channel, State,    "relay_last",          CFG_NUM(false),                       0, 1,     CFG_NOENUM) \
+    X(ResetFlag,     KEY_RESET_FLAG,  Bool,    Global,  State,    "reset_flag",          CFG_NUM(true),                        0, 1,     CFG_NOENUM) \
+    X(SamplingHz,    KEY_SAMPLING_HZ, UInt,    Global,  Setting,  "sampling_hz",         CFG_NUM(DEFAULT_SAMPLING_HZ),         1, 1000,  CFG_NOENUM) \
+    X(MotorVcc,      KEY_MOTOR_VCC,   Float,   Global,  Setting,  "motor_vcc_v",         CFG_NUM(DEFAULT_MOTOR_VCC_V),         0, 60,    CFG_NOENUM) \
+    X(BuzzerEnabled, KEY_BUZZ_EN,     Bool,    Global,  Setting,  "buzzer_enabled",      CFG_NUM(DEFAULT_BUZZER_ENABLED),      0, 1,     CFG_NOENUM) \
+    /* RTC / NTP */ \
+    X(RtcEpoch,      KEY_RTC_EPOCH,   ULong64, Global,  State,    "rtc_epoch",           CFG_NUM(DEFAULT_RTC_EPOCH),           0, 4102444800.0, CFG_NOENUM) \
+    X(Tz,            KEY_TZ,          String,  Global,  Internal, "tz",                  CFG_STR(DEFAULT_TZ_NAME),             0, 63,    CFG_NOENUM) \
+    X(TzMin,         KEY_TZ_MIN,      Int,     Global,  Internal, "tz_offset_min",       CFG_NUM(DEFAULT_TZ_OFFSET_MIN),       -720, 840, CFG_NOENUM) \
+    X(NtpServer,     KEY_NTP_SERVER,  String,  Global,  Internal, "ntp_server",          CFG_STR(DEFAULT_NTP_SERVER),          0, 63,    CFG_NOENUM) \
+    X(NtpSync,       KEY_NTP_SYNC,    UInt,    Global,  Internal, "ntp_sync_s",          CFG_NUM(DEFAULT_NTP_SYNC_INTERVAL_S), 60, 604800, CFG_NOENUM) \
+    /* Auth (buffers fixes dans WiFiManager::checkAuth_) */ \
+    X(AuthMode,      KEY_AUTH_MODE,   String,  Global,  Internal, "auth_mode",           CFG_STR(DEFAULT_AUTH_MODE),           0, 7,     CFG_NOENUM) \
+    X(AuthUser,      KEY_AUTH_USER,   String,  Global,  Internal, "auth_user",           CFG_STR(DEFAULT_AUTH_USER),           0, 63,    CFG_NOENUM) \
+    X(AuthPass,      KEY_AUTH_PASS,   String,  Global,  Internal, "auth_pass",           CFG_STR(DEFAULT_AUTH_PASS),           0, 63,    CFG_NOENUM) \
+    X(AuthToken,     KEY_AUTH_TOKEN,  String,  Global,  Internal, "auth_token",          CFG_STR(""),                          0, 71,    CFG_NOENUM) \
+    /* Marche temporisee */ \
+    X(RunDefault,    KEY_RUN_DEFAULT, UInt,    Global,  Internal, "run_default_s",       CFG_NUM(DEFAULT_RUN_DEFAULT_S),       1, 86400, CFG_NOENUM) \
+    X(RunMax,        KEY_RUN_MAX,     UInt,    Global,  Internal, "run_max_s",           CFG_NUM(DEFAULT_RUN_MAX_S),           1, 86400, CFG_NOENUM) \
+    /* Stockage SPIFFS */ \
+    X(EventMax,      KEY_EVENT_MAX,   UInt,    Global,  Internal, "eventlog_max",        CFG_NUM(DEFAULT_EVENTLOG_MAX_ENTRIES), 1, EVTLOG_MAX_ENTRIES, CFG_NOENUM) \
+    X(SessMax,       KEY_SESS_MAX,    UInt,    Global,  Internal, "session_max",         CFG_NUM(DEFAULT_SESSION_MAX_ENTRIES),  1, 2000,  CFG_NOENUM) \
+    X(SpiffsSess,    KEY_SPIFFS_SESS, String,  Global,  Internal, "sessions_file",       CFG_STR(DEFAULT_SPIFFS_SESS_FILE),    1, 31,    CFG_NOENUM) \
+    X(SpiffsEvt,     KEY_SPIFFS_EVT,  String,  Global,  Internal, "events_file",         CFG_STR(DEFAULT_SPIFFS_EVT_FILE),     1, 31,    CFG_NOENUM) \
+    /* Archive longue duree (TimeArchive), jours conserves */ \
+    X(ArchMinuteDays, KEY_ARCH_MIN,   UInt,    Global,  Setting,  "archive_minute_days", CFG_NUM(DEFAULT_ARCHIVE_MINUTE_DAYS), 1, 60,    CFG_NOENUM) \
+    X(ArchHourDays,  KEY_ARCH_HOUR,   UInt,    Global,  Setting,  "archive_hour_days",   CFG_NUM(DEFAULT_ARCHIVE_HOUR_DAYS),   1, 400,   CFG_NOENUM)
+
+#define CFG_X_ID(id, ...) id,
+enum class CfgId : uint8_t { CFG_SCHEMA(CFG_X_ID) Count };
+#undef CFG_X_ID
+
+#define CFG_COUNT static_cast<size_t>(CfgId::Count)
+
+struct CfgParam {
+    CfgId id;
+    const char* key;      // cle NVS de base
+    CfgType type;
+    CfgScope scope;
+    CfgClass cls;
+    const char* json;     // nom JSON
+    double def;           // defaut numerique
+    const char* defStr;   // defaut chaine (type String)
+    double min;           // bornes (valeur ou longueur)
+    double max;
+    const char* const* names;  // noms d'enum (JSON), nullptr sinon
+    uint8_t nameCount;
+};
+
+#define CFG_X_ROW(id, key, type, scope, cls, json, def, mn, mx, names) \
+    {CfgId::id, key, CfgType::type, CfgScope::scope, CfgClass::cls, json, def, mn, mx, names},
+constexpr CfgParam kCfgSchema[] = { CFG_SCHEMA(CFG_X_ROW) };
+#undef CFG_X_ROW
+
+constexpr const CfgParam& cfgParam(CfgId id) {
+    return kCfgSchema[static_cast<size_t>(id)];
+}
+
+// Verifications a la compilation : ordre de la table, longueur des cles
+// (<= 6, <= 5 par canal pour le suffixe), bornes coherentes.
+constexpr size_t cfgKeyLen_(const char* s) {
+    return *s ? 1 + cfgKeyLen_(s + 1) : 0;
+}
+constexpr bool cfgRowOk_(size_t i) {
+    return kCfgSchema[i].id == static_cast<CfgId>(i) &&
+           cfgKeyLen_(kCfgSchema[i].key) <= (kCfgSchema[i].scope == CfgScope::Channel ? 5U : 6U) &&
+           kCfgSchema[i].min <= kCfgSchema[i].max &&
+           (kCfgSchema[i].type != CfgType::String || kCfgSchema[i].max <= 255) &&
+           (kCfgSchema[i].type == CfgType::String ||
+            (kCfgSchema[i].def >= kCfgSchema[i].min && kCfgSchema[i].def <= kCfgSchema[i].max));
+}
+constexpr bool cfgSchemaOk_(size_t i) {
+    return i >= CFG_COUNT || (cfgRowOk_(i) && cfgSchemaOk_(i + 1));
+}
+// Nombre de parametres modifiables par l'API (taille de Device::ConfigUpdate).
+constexpr size_t cfgWritableCount_(size_t i) {
+    return i >= CFG_COUNT ? 0
+         : ((kCfgSchema[i].cls == CfgClass::Setting || kCfgSchema[i].cls == CfgClass::Secret) ? 1 : 0) +
+               cfgWritableCount_(i + 1);
+}
+#define CFG_UPDATE_MAX cfgWritableCount_(0)
+
+static_assert(sizeof(kCfgSchema) / sizeof(kCfgSchema[0]) == CFG_COUNT, "schema incomplet");
+static_assert(cfgSchemaOk_(0), "schema invalide (ordre, cle ou bornes)");
+
+// Blob de configuration (NVS_CONFIG_BLOB) :
+// - parametres State exclus (une ecriture frequente ne reecrit pas le blob)
+// - taille d'un parametre : valeur brute par canal, ou 1 octet de longueur
+//   + texte (max <= 255) pour une chaine
+// - empreinte du schema (cles, types, portees, blob) : un blob ecrit par un
+//   autre firmware n'est pas relu (import cle par cle).
+constexpr size_t cfgTypeSize(CfgType t) {
+    return t == CfgType::Bool ? 1 : (t == CfgType::ULong64 ? 8 : 4);
+}
+constexpr bool cfgInBlob(const CfgParam& p) {
+    return p.cls != CfgClass::State;
+}
+constexpr size_t cfgBlobBytes_(size_t i) {
+    return i >= CFG_COUNT ? 0
+         : (!cfgInBlob(kCfgSchema[i]) ? 0
+            : kCfgSchema[i].type == CfgType::String
+                ? 1 + static_cast<size_t>(kCfgSchema[i].max)
+                : cfgTypeSize(kCfgSchema[i].type) *
+                      (kCfgSchema[i].scope == CfgScope::Channel ? DEVICE_CHANNELS : 1)) +
+               cfgBlobBytes_(i + 1);
+}
+constexpr uint32_t cfgHashStr_(const char* s, uint32_t h) {
+    return *s ? cfgHashStr_(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619UL) : h;
+}
+constexpr uint32_t cfgSchemaHash_(size_t i, uint32_t h) {
+    return i >= CFG_COUNT ? h
+         : cfgSchemaHash_(i + 1,
+                          cfgHashStr_(kCfgSchema[i].key,
+                                      (h ^ (static_cast<uint32_t>(cfgInBlob(kCfgSchema[i])) << 8 |
+                                            static_cast<uint32_t>(kCfgSchema[i].type) << 4 |
+                                            static_cast<uint32_t>(kCfgSchema[i].scope))) * 16777619UL));
+}
+#define CFG_BLOB_MAX     cfgBlobBytes_(0)
+#define CFG_SCHEMA_HASH  cfgSchemaHash_(0, 2166136261UL)
+
+// Type C++ d'un parametre (accesseurs NVS::GetCfg / PutCfg).
+template <CfgType T> struct CfgCType;
+template <> struct CfgCType<CfgType::Bool>    { typedef bool type; };
+template <> struct CfgCType<CfgType::Int>     { typedef int32_t type; };
+template <> struct CfgCType<CfgType::UInt>    { typedef uint32_t type; };
+template <> struct CfgCType<CfgType::ULong64> { typedef uint64_t type; };
+template <> struct CfgCType<CfgType::Float>   { typedef float type; };
+template <> struct CfgCType<CfgType::String>  { typedef String type; };
+
+template <CfgId Id> struct CfgOf {
+    typedef typename CfgCType<cfgParam(Id).type>::type type;
+};
+
+// Conversion CfgValue <-> type C++.
+template <typename T> struct CfgConv;
+template <> struct CfgConv<bool> {
+    static bool get(const CfgValue& v) { return v.b; }
+    static CfgValue make(bool x) { CfgValue v; v.u64 = 0; v.b = x; return v; }
+};
+template <> struct CfgConv<int32_t> {
+    static int32_t get(const CfgValue& v) { return v.i; }
+    static CfgValue make(int32_t x) { CfgValue v; v.u64 = 0; v.i = x; return v; }
+};
+template <> struct CfgConv<uint32_t> {
+    static uint32_t get(const CfgValue& v) { return v.u; }
+    static CfgValue make(uint32_t x) { CfgValue v; v.u64 = 0; v.u = x; return v; }
+};
+template <> struct CfgConv<uint64_t> {
+    static uint64_t get(const CfgValue& v) { return v.u64; }
+    static CfgValue make(uint64_t x) { CfgValue v; v.u64 = x; return v; }
+};
+template <> struct CfgConv<float> {
+    static float get(const CfgValue& v) { return v.f; }
+    static CfgValue make(float x) { CfgValue v; v.u64 = 0; v.f = x; return v; }
+};
+
+// Valeur par defaut (numerique) d'un parametre.
+CfgValue cfgDefault(CfgId id);
+
+// true si la valeur respecte les bornes du schema.
+bool cfgInRange(CfgId id, const CfgValue& v);
+bool cfgInRange(CfgId id, const String& s);
+
+// JSON -> valeur validee (nombre, booleen, ou nom d'enum). false si
+// type incompatible ou hors bornes.
+bool cfgFromJson(CfgId id, JsonVariantConst in, CfgValue& out);
+bool cfgFromJson(CfgId id, JsonVariantConst in, String& out);
+
+// Valeur -> JSON (enum renvoye sous forme numerique).
+void cfgToJson(CfgId id, const CfgValue& v, JsonVariant out);
+
+#endif // CONFIG_SCHEMA_H
@@ -3,9 +3,9 @@
 
 Device* Device::inst_ = nullptr;
 
-void Device::Init(Relay* relay,
+void Device::Init(Relay* const* relays,
                   StatusLeds* leds,
-                  Acs712Sensor* current,
+                  Acs712Sensor* const* currents,
                   Ds18b20Sensor* ds18,
                   Bme280Sensor* bme,
                   RTCManager* rtc,
@@ -15,7 +15,7 @@ void Device::Init(Relay* relay,
     // On garde le pattern Singleton pour simplifier l'acces global
     // dans un firmware Arduino (pas de container de DI).
     if (!inst_) {
-        inst_ = new Device(relay, leds, current, ds18, bme, rtc, sessions, events);
+        inst_ = new Device(relays, leds, currents, ds18, bme, rtc, sessions, events);
     }
 }
 
@@ -23,22 +23,25 @@ Device* Device::Get() {
     return inst_;
 }
 
-Device::Device(Relay* relay,
+Device::Device(Relay* const* relays,
                StatusLeds* leds,
-               Acs712Sensor* current,
+               Acs712Sensor* const* currents,
                Ds18b20Sensor* ds18,
                Bme280Sensor* bme,
                RTCManager* rtc,
                SessionHistory* sessions,
                EventLog* events)
-    : relay_(relay),
-      leds_(leds),
-      current_(current),
+    : leds_(leds),
       ds18_(ds18),
       bme_(bme),
       rtc_(rtc),
       sessions_(sessions),
       events_(events) {
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        relay_[ch] = relays ? relays[ch] : nullptr;
+        current_[ch] = currents ? currents[ch] : nullptr;
+        motorEtaS_[ch] = -1.0f;
+    }
 }
 
 void Device::begin() {
@@ -46,18 +49,19 @@ void Device::begin() {
         // Mutex pour proteger snapshot_ et certaines variables partagees.
         mutex_ = xSemaphoreCreateMutex();
     }
-    if (!cmdQueue_) {
-        // File de commandes asynchrones (bouton + HTTP).
-        // Les commandes sont traitees dans la tache controlTask_().
-        cmdQueue_ = xQueueCreate(10, sizeof(Command));
-    }
+    // Voies de commandes asynchrones (bouton + HTTP), traitees dans la
+    // tache controlTask_().
+    lanes_[static_cast<uint8_t>(Lane::Express)].cap = DEVICE_CMD_EXPRESS_LEN;
+    lanes_[static_cast<uint8_t>(Lane::Normal)].cap = DEVICE_CMD_QUEUE_LEN;
 
     // Charge tous les parametres persistants (NVS -> cache runtime)
     loadConfig_();
 
     // Etat initial securise
-    applyRelay_(false);
-    setState_(DeviceState::Idle);
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        applyRelay_(ch, false);
+        setState_(ch, DeviceState::Idle);
+    }
 
     // Le sampler tourne en tache dediee (historique et donnees alignees).
     if (BUS_SAMPLER) {
@@ -72,126 +76,331 @@ void Device::begin() {
 }
 
 void Device::loadConfig_() {
-    // Toutes les cles sont definies dans Config.h (NVS keys courtes <= 6).
-    // Ici on ramene les valeurs en RAM pour eviter des Get() a chaque cycle.
-    limitCurrentA_ = CONF->GetFloat(KEY_LIM_CUR, DEFAULT_LIMIT_CURRENT_A);
-    ovcMode_ = static_cast<OvcMode>(CONF->GetInt(KEY_OVC_MODE, static_cast<int>(OvcMode::Latch)));
-    ovcMinMs_ = CONF->GetUInt(KEY_OVC_MIN, DEFAULT_OVC_MIN_DURATION_MS);
-    ovcRetryMs_ = CONF->GetUInt(KEY_OVC_RTRY, DEFAULT_OVC_RETRY_DELAY_MS);
+    // Valeurs deja validees par NVS (schema) : simples acces tableau.
+    // Cache local conserve pour la boucle de controle (types metier).
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        limitCurrentA_[ch] = CONF->GetCfg<CfgId::LimitCurrent>(ch);
+        ovcMode_[ch] = static_cast<OvcMode>(CONF->GetCfg<CfgId::OvcMode>(ch));
+        ovcMinMs_[ch] = CONF->GetCfg<CfgId::OvcMinMs>(ch);
+        ovcRetryMs_[ch] = CONF->GetCfg<CfgId::OvcRetryMs>(ch);
+        tempMotorC_[ch] = CONF->GetCfg<CfgId::TempMotor>(ch);
+    }
+
+    tempBoardC_ = CONF->GetCfg<CfgId::TempBoard>();
+    tempAmbientC_ = CONF->GetCfg<CfgId::TempAmbient>();
+    tempHystC_ = CONF->GetCfg<CfgId::TempHyst>();
+    latchOvertemp_ = CONF->GetCfg<CfgId::LatchOvertemp>();
 
-    tempMotorC_ = CONF->GetFloat(KEY_TEMP_MOTOR, DEFAULT_TEMP_MOTOR_C);
-    tempBoardC_ = CONF->GetFloat(KEY_TEMP_BOARD, DEFAULT_TEMP_BOARD_C);
-    tempAmbientC_ = CONF->GetFloat(KEY_TEMP_AMB, DEFAULT_TEMP_AMBIENT_C);
-    tempHystC_ = CONF->GetFloat(KEY_TEMP_HYST, DEFAULT_TEMP_HYST_C);
-    latchOvertemp_ = CONF->GetBool(KEY_LATCH_TEMP, DEFAULT_LATCH_OVERTEMP);
+    // Une nouvelle fenetre ne reinitialise pas l'etat des tendances.
+    trendWindow_ = static_cast<uint16_t>(CONF->GetCfg<CfgId::TrendWindow>());
+    trendHorizonS_ = CONF->GetCfg<CfgId::TrendHorizon>();
+    trendAction_ = static_cast<TrendAction>(CONF->GetCfg<CfgId::TrendAction>());
+    for (TempTrend& t : motorTrend_) t.configure(trendWindow_);
+    boardTrend_.configure(trendWindow_);
 
-    motorVcc_ = CONF->GetFloat(KEY_MOTOR_VCC, DEFAULT_MOTOR_VCC_V);
+    motorVcc_ = CONF->GetCfg<CfgId::MotorVcc>();
 }
 
 bool Device::applyConfig(const ConfigUpdate& cfg) {
     // IMPORTANT :
     // - Device est le seul ecrivain NVS.
-    // - On met a jour le cache runtime (variables *_ ) ET on persiste en NVS.
+    // - Valeurs deja validees (schema) par l'appelant ; NVS les re-verifie.
+    // - Le cache runtime est relu depuis NVS (acces tableau) apres ecriture.
     // - Certaines MAJ declenchent des actions (ex: samplingHz -> reinit sampler).
 
-    // MAJ locale + NVS (courant/OVC)
-    if (cfg.hasLimitCurrent) {
-        limitCurrentA_ = cfg.limitCurrentA;
-        CONF->PutFloat(KEY_LIM_CUR, limitCurrentA_);
-    }
-    if (cfg.hasOvcMode) {
-        ovcMode_ = cfg.ovcMode;
-        CONF->PutInt(KEY_OVC_MODE, static_cast<int>(ovcMode_));
-    }
-    if (cfg.hasOvcMinMs) {
-        ovcMinMs_ = cfg.ovcMinMs;
-        CONF->PutUInt(KEY_OVC_MIN, ovcMinMs_);
-    }
-    if (cfg.hasOvcRetryMs) {
-        ovcRetryMs_ = cfg.ovcRetryMs;
-        CONF->PutUInt(KEY_OVC_RTRY, ovcRetryMs_);
-    }
+    if (cfg.channel != CHANNEL_ALL && cfg.channel >= DEVICE_CHANNELS) return false;
+
+    // Parametres par canal : canal vise ou tous.
+    const uint8_t first = (cfg.channel == CHANNEL_ALL) ? 0 : cfg.channel;
+    const uint8_t last = (cfg.channel == CHANNEL_ALL) ? DEVICE_CHANNELS : cfg.channel + 1;
+
+    bool ok = true;
+    bool resample = false;
+    for (uint8_t i = 0; i < cfg.count; ++i) {
+        const ConfigUpdate::Item& it = cfg.items[i];
+        const CfgParam& p = cfgParam(it.id);
+        // Seuls les parametres modifiables par l'API sont acceptes.
+        if (p.cls != CfgClass::Setting && p.cls != CfgClass::Secret) {
+            ok = false;
+            continue;
+        }
 
-    // MAJ temperatures / surchauffe
-    if (cfg.hasTempMotor) {
-        tempMotorC_ = cfg.tempMotorC;
-        CONF->PutFloat(KEY_TEMP_MOTOR, tempMotorC_);
-    }
-    if (cfg.hasTempBoard) {
-        tempBoardC_ = cfg.tempBoardC;
-        CONF->PutFloat(KEY_TEMP_BOARD, tempBoardC_);
-    }
-    if (cfg.hasTempAmbient) {
-        tempAmbientC_ = cfg.tempAmbientC;
-        CONF->PutFloat(KEY_TEMP_AMB, tempAmbientC_);
+        if (p.type == CfgType::String) {
+            ok = CONF->PutCfgString(it.id, it.text) && ok;
+        } else if (it.id == CfgId::BuzzerEnabled) {
+            // Persistance geree par Buzzer::setEnabled.
+            BUZZ->setEnabled(it.value.b);
+        } else if (p.scope == CfgScope::Channel) {
+            for (uint8_t ch = first; ch < last; ++ch) {
+                ok = CONF->PutCfgValue(it.id, ch, it.value) && ok;
+            }
+        } else {
+            ok = CONF->PutCfgValue(it.id, 0, it.value) && ok;
+        }
+        if (it.id == CfgId::SamplingHz) resample = true;
     }
-    if (cfg.hasTempHyst) {
-        tempHystC_ = cfg.tempHystC;
-        CONF->PutFloat(KEY_TEMP_HYST, tempHystC_);
+
+    loadConfig_();
+
+    // Sampler : si la frequence change, on recalcule la periode.
+    if (resample && BUS_SAMPLER) {
+        BUS_SAMPLER->begin(current_, ds18_, bme_, CONF->GetCfg<CfgId::SamplingHz>());
+        BUS_SAMPLER->start();
     }
-    if (cfg.hasLatchOvertemp) {
-        latchOvertemp_ = cfg.latchOvertemp;
-        CONF->PutBool(KEY_LATCH_TEMP, latchOvertemp_);
+
+    // Wi-Fi : le demarrage/restart Wi-Fi est gere par WiFiManager
+    // (ici on ne redemarre pas automatiquement le Wi-Fi).
+    return ok;
+}
+
+bool Device::calibrateCurrentZero(uint8_t ch) {
+    // Calibration "zero" : mesure le capteur ACS712 du canal moteur arrete.
+    if (ch >= DEVICE_CHANNELS || !current_[ch]) return false;
+    current_[ch]->calibrateZero();
+    return true;
+}
+
+bool Device::setCurrentCalibration(uint8_t ch, float zeroMv, float sensMvPerA, float inputScale) {
+    // Calibration avancee : ajuste offset + sensibilite + echelle analogique.
+    // Les valeurs sont stockees par la classe capteur (NVS, cles du canal).
+    if (ch >= DEVICE_CHANNELS || !current_[ch]) return false;
+    current_[ch]->setCalibration(zeroMv, sensMvPerA, inputScale);
+    return true;
+}
+
+void Device::notifyCommand() {
+    // Petit blink qui indique qu'une commande a ete acceptee (UI/bouton).
+    if (leds_) leds_->notifyCommand();
+    BUZZ->playSuccess();
+}
+
+bool Device::CmdLane::push(const Command& c) {
+    if (count >= cap) return false;
+    buf[(head + count) % cap] = c;
+    count++;
+    if (count > maxDepth) maxDepth = count;
+    return true;
+}
+
+bool Device::CmdLane::pop(Command& out) {
+    if (count == 0) return false;
+    out = buf[head];
+    head = (head + 1) % cap;
+    count--;
+    return true;
+}
+
+Device::Lane Device::laneOf_(Command::Type t) {
+    // Securite d'abord : Stop et ClearFault ne doivent jamais attendre.
+    return (t == Command::Type::Stop || t == Command::Type::ClearFault)
+               ? Lane::Express : Lane::Normal;
+}
+
+Device::Command* Device::findRedundant_(CmdLane& lane, Lane which, const Command& c) {
+    if (which == Lane::Express) {
+        // Stop/ClearFault sont idempotents : un seul exemplaire par type et
+        // par canal suffit (une commande "tous canaux" couvre les autres).
+        for (uint8_t i = 0; i < lane.count; ++i) {
+            Command* p = lane.at(i);
+            if (p->type == c.type && (p->channel == c.channel || p->channel == CHANNEL_ALL)) return p;
+        }
+        return nullptr;
     }
 
-    // Parametres puissance
-    if (cfg.hasMotorVcc) {
-        motorVcc_ = cfg.motorVcc;
-        CONF->PutFloat(KEY_MOTOR_VCC, motorVcc_);
+    // Voie normale : seulement la derniere commande (l'ordre compte), et
+    // seulement si elle est idempotente. Start agit comme Toggle (ON <-> OFF) :
+    // deux Start ne sont jamais fusionnes.
+    Command* tail = lane.back();
+    if (!tail || tail->type != c.type || tail->channel != c.channel) return nullptr;
+    if (c.type == Command::Type::SetRelay && tail->b == c.b) return tail;
+    return nullptr;
+}
+
+bool Device::submitCommand(const Command& cmd, uint32_t* outId) {
+    // Non-bloquant : si la voie est pleine, on retourne false.
+    if (!mutex_) return false;
+
+    Command c = cmd;
+    const Lane which = laneOf_(c.type);
+
+    // Canal valide ; "tous les canaux" seulement pour les commandes express.
+    if (c.channel == CHANNEL_ALL ? which != Lane::Express : c.channel >= DEVICE_CHANNELS) {
+        return false;
     }
+    CmdLane& lane = lanes_[static_cast<uint8_t>(which)];
 
-    // Sampler : si la frequence change, on recalcule la periode.
-    if (cfg.hasSamplingHz) {
-        CONF->PutUInt(KEY_SAMPLING_HZ, cfg.samplingHz);
-        if (BUS_SAMPLER) {
-            BUS_SAMPLER->begin(current_, ds18_, bme_, cfg.samplingHz);
-            BUS_SAMPLER->start();
+    // Resultats a publier hors mutex (refus, annulations).
+    CommandResult res[DEVICE_CMD_QUEUE_LEN + 2];
+    size_t nRes = 0;
+    bool accepted = true;
+
+    if (!lock_()) return false;
+
+    if (c.type == Command::Type::Stop) {
+        // Un Stop annule les commandes normales en attente du meme canal
+        // (sinon un Toggle/Start deja en file rallumerait juste apres l'arret).
+        // Les commandes des autres canaux restent en file, dans l'ordre.
+        CmdLane& normal = lanes_[static_cast<uint8_t>(Lane::Normal)];
+        const uint8_t pending = normal.count;
+        Command old;
+        for (uint8_t i = 0; i < pending && normal.pop(old); ++i) {
+            if (c.channel != CHANNEL_ALL && old.channel != c.channel) {
+                normal.push(old);
+                continue;
+            }
+            CommandResult& r = res[nRes++];
+            r.id = old.id;
+            r.type = old.type;
+            r.channel = old.channel;
+            r.status = CommandResult::Status::Rejected;
+            normal.flushed++;
         }
     }
 
-    // Activation buzzer (persistante en NVS deja geree par Buzzer::setEnabled)
-    if (cfg.hasBuzzerEnabled) {
-        BUZZ->setEnabled(cfg.buzzerEnabled);
+    // Commande redondante : fusion avec celle deja en attente (meme id).
+    if (Command* same = findRedundant_(lane, which, c)) {
+        lane.coalesced++;
+        if (outId) *outId = same->id;
+        unlock_();
+        if (nRes) storeResults_(res, nRes);
+        if (controlTaskHandle_) xTaskNotifyGive(controlTaskHandle_);
+        return true;
     }
 
-    // Wi-Fi : SSID/PASS et mode (STA/AP). Le demarrage/restart Wi-Fi est gere
-    // par WiFiManager (ici on ne redemarre pas automatiquement le Wi-Fi).
-    if (cfg.hasWifiSta) {
-        CONF->PutString(KEY_STA_SSID, cfg.staSsid);
-        CONF->PutString(KEY_STA_PASS, cfg.staPass);
-    }
-    if (cfg.hasWifiAp) {
-        CONF->PutString(KEY_AP_SSID, cfg.apSsid);
-        CONF->PutString(KEY_AP_PASS, cfg.apPass);
+    // Attribution d'un id monotone (sert au suivi /api/command?id=...).
+    c.id = ++lastCmdId_;
+    if (outId) *outId = c.id;
+
+    // Deux Toggle consecutifs (double appui) : annules a la sortie de file
+    // (popCommand_), avec l'etat du canal a ce moment.
+    if (lane.push(c)) {
+        lane.accepted++;
+    } else {
+        // Voie pleine : on enregistre le refus pour que le poll par id aboutisse.
+        lane.dropped++;
+        latency_[static_cast<uint8_t>(c.type)].queueFull++;
+        CommandResult& r = res[nRes++];
+        r.id = c.id;
+        r.type = c.type;
+        r.channel = c.channel;
+        r.status = CommandResult::Status::Rejected;
+        accepted = false;
     }
-    if (cfg.hasWifiMode) {
-        CONF->PutInt(KEY_WIFI_MODE, static_cast<int>(cfg.wifiMode));
+    unlock_();
+
+    if (nRes) storeResults_(res, nRes);
+
+    // Reveille la tache control (sinon la commande attend la fin du cycle 50 ms).
+    if (accepted && controlTaskHandle_) xTaskNotifyGive(controlTaskHandle_);
+    return accepted;
+}
+
+bool Device::popCommand_(Command& out, CommandResult* done, size_t& nDone, size_t maxDone) {
+    if (!lock_()) return false;
+    bool ok = false;
+    for (CmdLane& lane : lanes_) {
+        while (!ok && lane.pop(out)) {
+            // Deux Toggle consecutifs du meme canal s'annulent (double appui) :
+            // les deux ids sont termines avec l'etat reel du canal, lu ici
+            // (tache control, seul ecrivain) sous le verrou de la sortie.
+            Command* next = lane.count ? lane.at(0) : nullptr;
+            if (out.type == Command::Type::Toggle && out.u32 == 0 && next &&
+                next->type == Command::Type::Toggle && next->u32 == 0 &&
+                next->channel == out.channel && nDone + 2 <= maxDone) {
+                Command second;
+                lane.pop(second);
+                lane.coalesced += 2;
+                const uint8_t ch = out.channel;
+                for (uint32_t id : {out.id, second.id}) {
+                    CommandResult& r = done[nDone++];
+                    r.id = id;
+                    r.type = Command::Type::Toggle;
+                    r.channel = ch;
+                    r.status = CommandResult::Status::Done;
+                    r.ok = true;
+                    r.done_ms = millis();
+                    r.relay_on = relay_[ch] ? relay_[ch]->isOn() : false;
+                    r.state = state_[ch];
+                    r.fault_latched = faultLatched_[ch];
+                }
+                continue;
+            }
+            ok = true;
+        }
+        if (ok) break;
     }
+    unlock_();
+    return ok;
+}
 
+bool Device::getLaneStats(Lane lane, LaneStats& out) const {
+    const uint8_t i = static_cast<uint8_t>(lane);
+    if (i >= static_cast<uint8_t>(Lane::Count) || !lock_()) return false;
+
+    const CmdLane& l = lanes_[i];
+    out.depth = l.count;
+    out.capacity = l.cap;
+    out.max_depth = l.maxDepth;
+    out.accepted = l.accepted;
+    out.coalesced = l.coalesced;
+    out.dropped = l.dropped;
+    out.flushed = l.flushed;
+    unlock_();
     return true;
 }
 
-void Device::calibrateCurrentZero() {
-    // Calibration "zero" : mesure le capteur ACS712 moteur arrete.
-    if (current_) current_->calibrateZero();
+void Device::storeResults_(const CommandResult* res, size_t n) {
+    if (!lock_()) return;
+    for (size_t i = 0; i < n; ++i) {
+        results_[res[i].id % DEVICE_CMD_RESULT_SLOTS] = res[i];
+    }
+    unlock_();
 }
 
-void Device::setCurrentCalibration(float zeroMv, float sensMvPerA, float inputScale) {
-    // Calibration avancee : ajuste offset + sensibilite + echelle analogique.
-    // Les valeurs sont stockees par la classe capteur (NVS).
-    if (current_) current_->setCalibration(zeroMv, sensMvPerA, inputScale);
+bool Device::getCommandResult(uint32_t id, CommandResult& out) const {
+    if (id == 0 || !lock_()) return false;
+
+    const CommandResult& r = results_[id % DEVICE_CMD_RESULT_SLOTS];
+    bool known = true;
+    if (r.id == id) {
+        out = r;
+    } else if (id <= lastCmdId_ && (lastCmdId_ - id) < DEVICE_CMD_RESULT_SLOTS) {
+        // Aucun id plus recent n'a pu ecraser le slot : la commande est en file.
+        out = CommandResult{};
+        out.id = id;
+        out.status = CommandResult::Status::Pending;
+    } else {
+        known = false;
+    }
+    unlock_();
+    return known;
 }
 
-void Device::notifyCommand() {
-    // Petit blink qui indique qu'une commande a ete acceptee (UI/bouton).
-    if (leds_) leds_->notifyCommand();
-    BUZZ->playSuccess();
+bool Device::getLatency(Command::Type type, LatencySummary& out) const {
+    const uint8_t t = static_cast<uint8_t>(type);
+    if (t >= kCmdTypeCount || !lock_()) return false;
+
+    const CmdLatency& l = latency_[t];
+    out.count = l.total.count();
+    out.queue_full = l.queueFull;
+    out.queue_p50_us = l.queue.percentileUs(50.0f);
+    out.queue_p99_us = l.queue.percentileUs(99.0f);
+    out.queue_max_us = l.queue.maxUs();
+    out.total_p50_us = l.total.percentileUs(50.0f);
+    out.total_p99_us = l.total.percentileUs(99.0f);
+    out.total_max_us = l.total.maxUs();
+    unlock_();
+    return true;
 }
 
-bool Device::submitCommand(const Command& cmd) {
-    // Non-bloquant : si la file est pleine, on retourne false.
-    if (!cmdQueue_) return false;
-    return xQueueSendToBack(cmdQueue_, &cmd, 0) == pdTRUE;
+void Device::resetLatency() {
+    if (!lock_()) return;
+    for (uint8_t i = 0; i < kCmdTypeCount; ++i) {
+        latency_[i].queue.reset();
+        latency_[i].total.reset();
+        latency_[i].queueFull = 0;
+    }
+    unlock_();
 }
 
 bool Device::getSnapshot(SystemSnapshot& out) const {
@@ -207,108 +416,208 @@ bool Device::getSnapshot(SystemSnapshot& out) const {
 }
 
 DeviceState Device::getState() const {
-    DeviceState s = state_;
+    DeviceState s = aggregateState_();
     if (lock_()) {
-        s = state_;
+        s = aggregateState_();
         unlock_();
     }
     return s;
 }
 
-void Device::applyRelay_(bool on) {
-    if (!relay_) return;
+DeviceState Device::aggregateState_() const {
+    // Un seul canal : etat du canal (comportement historique).
+    bool running = false;
+    bool idle = false;
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        if (state_[ch] == DeviceState::Fault) return DeviceState::Fault;
+        if (state_[ch] == DeviceState::Running) running = true;
+        if (state_[ch] == DeviceState::Idle) idle = true;
+    }
+    if (running) return DeviceState::Running;
+    return idle ? DeviceState::Idle : state_[0];
+}
+
+void Device::applyRelay_(uint8_t ch, bool on) {
+    if (!relay_[ch]) return;
 
     // Action physique (GPIO) + persistance "last state" (utile au reboot).
-    relay_->set(on);
-    CONF->PutBool(KEY_RELAY_LAST, on);
+    relay_[ch]->set(on);
+    lastActuationUs_ = micros();
+    CONF->PutCfg<CfgId::RelayLast>(on, ch);
 }
 
-void Device::setState_(DeviceState s) {
+void Device::setState_(uint8_t ch, DeviceState s) {
+    // Changement d'etat : repetitions en attente journalisees au prochain cycle.
+    if (s != state_[ch]) alertsFlushReq_ = true;
     if (lock_()) {
-        state_ = s;
+        state_[ch] = s;
         unlock_();
     }
 }
 
+void Device::stopChannel_(uint8_t ch, bool success) {
+    applyRelay_(ch, false);
+    endSession_(ch, success);
+    setState_(ch, DeviceState::Idle);
+    runUntilMs_[ch] = 0;
+}
+
 void Device::processCommands_() {
-    // Consomme toutes les commandes en attente (boucle non-bloquante).
-    if (!cmdQueue_) return;
+    // Consomme les commandes en attente (boucle non-bloquante), voie express
+    // d'abord : elle est re-verifiee avant chaque commande normale, un Stop
+    // arrive en cours de cycle passe donc devant le reste.
+    CommandResult done[DEVICE_CMD_QUEUE_LEN + DEVICE_CMD_EXPRESS_LEN];
+    size_t nDone = 0;
 
     Command cmd;
-    while (xQueueReceive(cmdQueue_, &cmd, 0) == pdTRUE) {
-        switch (cmd.type) {
-            case Command::Type::Start:
-            case Command::Type::Toggle: {
-                // Toggle : ON <-> OFF (comportement "bouton").
-                if (state_ == DeviceState::Running) {
-                    // Stop
-                    applyRelay_(false);
-                    endSession_(true);
-                    setState_(DeviceState::Idle);
-                } else {
-                    // Start : si defaut latch, on l'acquitte ici (comportement
-                    // demande : "lock until ON is pressed again").
-                    if (faultLatched_) {
-                        // Clear fault et rearmement
-                        faultLatched_ = false;
-                    }
-                    applyRelay_(true);
-                    startSession_();
-                    setState_(DeviceState::Running);
-                    if (cmd.type == Command::Type::Toggle && cmd.u32 > 0) {
-                        // Option : toggle peut embarquer un timer (secondes).
-                        runUntilMs_ = millis() + (cmd.u32 * 1000U);
+    const size_t maxDone = DEVICE_CMD_QUEUE_LEN + DEVICE_CMD_EXPRESS_LEN;
+    // Une place gardee pour la commande sortie (annulations en plus).
+    while (nDone < maxDone && popCommand_(cmd, done, nDone, maxDone - 1)) {
+        // Latence : sortie de file maintenant, actionnement dans applyRelay_().
+        const uint32_t dequeueUs = micros();
+        lastActuationUs_ = 0;
+        bool ok = true;
+
+        // Canaux vises : un seul, ou tous (Stop / ClearFault).
+        const bool all = (cmd.channel == CHANNEL_ALL);
+        const uint8_t first = all ? 0 : cmd.channel;
+        const uint8_t last = all ? DEVICE_CHANNELS : cmd.channel + 1;
+        for (uint8_t ch = first; ch < last; ++ch) {
+            switch (cmd.type) {
+                case Command::Type::Start:
+                case Command::Type::Toggle: {
+                    // Toggle : ON <-> OFF (comportement "bouton").
+                    if (state_[ch] == DeviceState::Running) {
+                        // Stop
+                        applyRelay_(ch, false);
+                        endSession_(ch, true);
+                        setState_(ch, DeviceState::Idle);
+                    } else {
+                        // Start : si defaut latch, on l'acquitte ici (comportement
+                        // demande : "lock until ON is pressed again").
+                        if (faultLatched_[ch]) {
+                            // Clear fault et rearmement
+                            faultLatched_[ch] = false;
+                        }
+                        applyRelay_(ch, true);
+                        startSession_(ch);
+                        setState_(ch, DeviceState::Running);
+                        if (cmd.type == Command::Type::Toggle && cmd.u32 > 0) {
+                            // Option : toggle peut embarquer un timer (secondes).
+                            runUntilMs_[ch] = millis() + (cmd.u32 * 1000U);
+                        }
                     }
+                    break;
                 }
-                break;
+                case Command::Type::Stop:
+                    // Arret immediat + fermeture de session.
+                    stopChannel_(ch, true);
+                    break;
+                case Command::Type::ClearFault:
+                    // Re-armement manuel (sans demarrer le relais), seulement
+                    // sur un canal en defaut : un canal en marche (relais
+                    // colle, protections actives) n'est jamais touche, meme
+                    // avec CHANNEL_ALL.
+                    if (!faultLatched_[ch] && state_[ch] != DeviceState::Fault) break;
+                    faultLatched_[ch] = false;
+                    setState_(ch, DeviceState::Idle);
+                    break;
+                case Command::Type::TimedRun:
+                    // Marche temporisee : ON pendant cmd.u32 secondes.
+                    if (faultLatched_[ch]) {
+                        faultLatched_[ch] = false;
+                    }
+                    applyRelay_(ch, true);
+                    startSession_(ch);
+                    setState_(ch, DeviceState::Running);
+                    runUntilMs_[ch] = millis() + (cmd.u32 * 1000U);
+                    break;
+                case Command::Type::SetRelay:
+                    // Forcage direct (seulement si pas de defaut latch).
+                    if (!faultLatched_[ch]) {
+                        applyRelay_(ch, cmd.b);
+                    } else {
+                        ok = false;
+                    }
+                    break;
+                case Command::Type::Reset:
+                    // Reset systeme desactive pour eviter les redemarrages non desires.
+                    break;
             }
-            case Command::Type::Stop:
-                // Arret immediat + fermeture de session.
-                applyRelay_(false);
-                endSession_(true);
-                setState_(DeviceState::Idle);
-                runUntilMs_ = 0;
-                break;
-            case Command::Type::ClearFault:
-                // Re-armement manuel (sans demarrer le relais).
-                faultLatched_ = false;
-                setState_(DeviceState::Idle);
-                break;
-            case Command::Type::TimedRun:
-                // Marche temporisee : ON pendant cmd.u32 secondes.
-                if (faultLatched_) {
-                    faultLatched_ = false;
-                }
-                applyRelay_(true);
-                startSession_();
-                setState_(DeviceState::Running);
-                runUntilMs_ = millis() + (cmd.u32 * 1000U);
-                break;
-            case Command::Type::SetRelay:
-                // Forcage direct (seulement si pas de defaut latch).
-                if (!faultLatched_) {
-                    applyRelay_(cmd.b);
-                }
-                break;
-            case Command::Type::Reset:
-                // Reset systeme desactive pour eviter les redemarrages non desires.
-                break;
+        }
+
+        // Commande sans action relais (ex: ClearFault) : fin de traitement.
+        const uint32_t actUs = lastActuationUs_ ? lastActuationUs_ : micros();
+        if (cmd.created_us != 0 && lock_()) {
+            CmdLatency& l = latency_[static_cast<uint8_t>(cmd.type)];
+            l.queue.record(dequeueUs - cmd.created_us);
+            l.total.record(actUs - cmd.created_us);
+            unlock_();
+        }
+
+        // Resultat : etat juste apres actionnement.
+        CommandResult& r = done[nDone++];
+        r.id = cmd.id;
+        r.type = cmd.type;
+        r.channel = cmd.channel;
+        r.status = CommandResult::Status::Done;
+        r.ok = ok;
+        r.done_ms = millis();
+        if (all) {
+            r.relay_on = false;
+            r.fault_latched = false;
+            for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+                if (relay_[ch] && relay_[ch]->isOn()) r.relay_on = true;
+                if (faultLatched_[ch]) r.fault_latched = true;
+            }
+            r.state = aggregateState_();
+        } else {
+            r.relay_on = relay_[cmd.channel] ? relay_[cmd.channel]->isOn() : false;
+            r.state = state_[cmd.channel];
+            r.fault_latched = faultLatched_[cmd.channel];
         }
     }
+
+    if (nDone == 0) return;
+
+    // Snapshot immediat : le seq renvoye au client reflete deja la commande
+    // (pas besoin d'un /api/status supplementaire).
+    updateSnapshot_();
+    lastSnapshotMs_ = millis();
+    for (size_t i = 0; i < nDone; ++i) {
+        done[i].seq = snapshot_.seq;
+    }
+    storeResults_(done, nDone);
+}
+
+void Device::readBoard_(bool anyRunning) {
+    // Carte (BME) : une lecture par cycle, partagee par tous les canaux.
+    boardOk_ = false;
+    boardC_ = bme_ ? bme_->getTempC(&boardOk_) : NAN;
+
+    // Diagnostic BME seulement en marche (comme les autres protections).
+    if (!anyRunning) return;
+    if (bme_ && !bme_->isPresent()) {
+        raiseWarning_(WarnCode::W02_BmeMissing, EvtMsg::BmeMissing, EvtSrc::Bme);
+    } else if (bme_ && !boardOk_) {
+        raiseWarning_(WarnCode::W04_CacheUsed, EvtMsg::BmeCache, EvtSrc::Bme);
+    }
 }
 
-void Device::updateProtection_() {
+void Device::updateProtection_(uint8_t ch) {
+    // Alertes : source + canal (coalescence distincte par canal).
     // Courant
+    Acs712Sensor* current = current_[ch];
     bool curValid = false;
-    float currentA = current_ ? current_->getLastCurrent(&curValid) : 0.0f;
-    lastCurrentA_ = currentA;
+    float currentA = current ? current->getLastCurrent(&curValid) : 0.0f;
+    lastCurrentA_[ch] = currentA;
 
     // Puissance instantanee (on suppose Vcc moteur connu, stocke en NVS).
-    lastPowerW_ = motorVcc_ * currentA;
+    lastPowerW_[ch] = motorVcc_ * currentA;
 
-    if (current_ && !current_->isAdcOk()) {
+    if (current && !current->isAdcOk()) {
         // Diagnostic : saturation ADC (cablage, offset, echelle analogique, etc.)
-        raiseWarning_(WarnCode::W03_AdcSat, "ADC saturation", "current");
+        raiseWarning_(WarnCode::W03_AdcSat, EvtMsg::AdcSat, EvtSrc::Current, ch, currentA);
     }
 
     // OVC
@@ -317,67 +626,80 @@ void Device::updateProtection_() {
     // - Si le depassement dure au moins ovcMinMs_, on declenche le defaut.
     // - En mode Latch : defaut memorise jusqu'a "ON" ou clearFault.
     // - En mode AutoRetry : on relache le latch apres un delai.
-    if (fabsf(currentA) >= limitCurrentA_) {
-        if (ovcStartMs_ == 0) {
-            ovcStartMs_ = millis();
-        } else if (millis() - ovcStartMs_ >= ovcMinMs_) {
-            faultLatched_ = true;
-            applyRelay_(false);
-            setState_(DeviceState::Fault);
-            raiseError_(ErrorCode::E01_OvcLatched, "OVC latch", "current");
-            if (ovcMode_ == OvcMode::AutoRetry) {
-                ovcRetryAtMs_ = millis() + ovcRetryMs_;
+    if (fabsf(currentA) >= limitCurrentA_[ch]) {
+        if (ovcStartMs_[ch] == 0) {
+            ovcStartMs_[ch] = millis();
+        } else if (millis() - ovcStartMs_[ch] >= ovcMinMs_[ch]) {
+            faultLatched_[ch] = true;
+            applyRelay_(ch, false);
+            setState_(ch, DeviceState::Fault);
+            raiseError_(ErrorCode::E01_OvcLatched, EvtMsg::OvcLatch, EvtSrc::Current, ch, currentA);
+            if (ovcMode_[ch] == OvcMode::AutoRetry) {
+                ovcRetryAtMs_[ch] = millis() + ovcRetryMs_[ch];
             }
         }
     } else {
-        ovcStartMs_ = 0;
+        ovcStartMs_[ch] = 0;
     }
 
-    if (faultLatched_ && ovcMode_ == OvcMode::AutoRetry && ovcRetryAtMs_ > 0) {
+    if (faultLatched_[ch] && ovcMode_[ch] == OvcMode::AutoRetry && ovcRetryAtMs_[ch] > 0) {
         // Auto-reprise : on repasse Idle (relais reste OFF tant qu'une commande ON
         // n'est pas envoyee, selon l'usage).
-        if (millis() >= ovcRetryAtMs_) {
-            faultLatched_ = false;
-            ovcRetryAtMs_ = 0;
-            setState_(DeviceState::Idle);
+        if (millis() >= ovcRetryAtMs_[ch]) {
+            faultLatched_[ch] = false;
+            ovcRetryAtMs_[ch] = 0;
+            setState_(ch, DeviceState::Idle);
         }
     }
 
-    // Temperatures
+    // Temperatures : sonde moteur du canal + carte (lue par readBoard_()).
     bool motorOk = false;
-    bool bmeOk = false;
-
-    float motorC = ds18_ ? ds18_->getTempC(&motorOk) : NAN;
-    float boardC = bme_ ? bme_->getTempC(&bmeOk) : NAN;
+    float motorC = ds18_ ? ds18_->getTempC(ch, &motorOk) : NAN;
 
     // Overtemp :
     // - DS18 -> temperature moteur
     // - BME  -> temperature carte (et eventuellement ambiante si on n'a qu'une sonde)
     bool over = false;
-    if (motorOk && motorC >= tempMotorC_) over = true;
-    if (bmeOk && (boardC >= tempBoardC_ || boardC >= tempAmbientC_)) over = true;
+    if (motorOk && motorC >= tempMotorC_[ch]) over = true;
+    if (boardOk_ && (boardC_ >= tempBoardC_ || boardC_ >= tempAmbientC_)) over = true;
 
     if (over) {
-        if (!overtempActive_) {
-            overtempActive_ = true;
+        if (!overtempActive_[ch]) {
+            overtempActive_[ch] = true;
             if (leds_) leds_->setOvertemp(true);
         }
         if (latchOvertemp_) {
             // Surchauffe avec latch : defaut memorise jusqu'a acquittement.
-            faultLatched_ = true;
-            applyRelay_(false);
-            setState_(DeviceState::Fault);
-            raiseError_(ErrorCode::E02_OverTemp, "Overtemp", "temp");
+            faultLatched_[ch] = true;
+            applyRelay_(ch, false);
+            setState_(ch, DeviceState::Fault);
+            raiseError_(ErrorCode::E02_OverTemp, EvtMsg::OverTemp, EvtSrc::Temp, ch,
+                        (motorOk && motorC >= tempMotorC_[ch]) ? motorC : boardC_);
         } else {
             // Mode "non latch" : on coupe le relais mais on ne memorise pas.
-            applyRelay_(false);
+            applyRelay_(ch, false);
         }
-    } else if (overtempActive_) {
+    } else if (overtempActive_[ch]) {
         // Hysteresis simple
-        if ((motorOk && motorC <= (tempMotorC_ - tempHystC_)) ||
-            (bmeOk && boardC <= (tempBoardC_ - tempHystC_))) {
-            overtempActive_ = false;
-            if (leds_) leds_->setOvertemp(false);
+        if ((motorOk && motorC <= (tempMotorC_[ch] - tempHystC_)) ||
+            (boardOk_ && boardC_ <= (tempBoardC_ - tempHystC_))) {
+            overtempActive_[ch] = false;
+            // LED commune : eteinte quand plus aucun canal n'est en surchauffe.
+            bool anyOver = false;
+            for (uint8_t i = 0; i < DEVICE_CHANNELS; ++i) anyOver = anyOver || overtempActive_[i];
+            if (leds_ && !anyOver) leds_->setOvertemp(false);
+        }
+    }
+
+    // Surchauffe predictive :
+    // - la tendance (updateTrend_) projette le temps avant seuil
+    // - si le croisement est prevu dans l'horizon, on previent avant le depassement
+    // - en mode Stop, on coupe sans verrouiller (le seuil fixe reste la vraie protection)
+    if (!over && trendAlert_[ch]) {
+        raiseWarning_(WarnCode::W10_TempTrend, EvtMsg::TempTrend, EvtSrc::Temp, ch,
+                      motorOk ? motorC : NAN);
+        if (trendAction_ == TrendAction::Stop) {
+            stopChannel_(ch, false);
         }
     }
 
@@ -385,41 +707,92 @@ void Device::updateProtection_() {
     // Le but ici est de notifier l'UI qu'on est en "mode degrade" :
     // - capteur absent (missing)
     // - valeur invalide -> cache utilise
-    if (ds18_ && !ds18_->isPresent()) {
-        raiseWarning_(WarnCode::W01_Ds18Missing, "DS18 absent", "ds18");
+    if (ds18_ && !ds18_->isPresent(ch)) {
+        raiseWarning_(WarnCode::W01_Ds18Missing, EvtMsg::Ds18Missing, EvtSrc::Ds18, ch);
     } else if (ds18_ && !motorOk) {
-        raiseWarning_(WarnCode::W04_CacheUsed, "DS18 cache", "ds18");
+        raiseWarning_(WarnCode::W04_CacheUsed, EvtMsg::Ds18Cache, EvtSrc::Ds18, ch);
     }
+}
 
-    if (bme_ && !bme_->isPresent()) {
-        raiseWarning_(WarnCode::W02_BmeMissing, "BME absent", "bme");
-    } else if (bme_ && !bmeOk) {
-        raiseWarning_(WarnCode::W04_CacheUsed, "BME cache", "bme");
+void Device::updateTrend_() {
+    // Alimente les estimateurs a cadence fixe (les capteurs ne rafraichissent
+    // qu'environ 1 fois/s, inutile de filtrer 20 fois la meme valeur).
+    const uint32_t now = millis();
+    if (lastTrendMs_ != 0 && (now - lastTrendMs_) < TREND_UPDATE_PERIOD_MS) return;
+    lastTrendMs_ = now;
+
+    // Carte (commune) : valeur invalide => on saute, absente => on oublie la pente.
+    bool bmeOk = false;
+    const float boardC = bme_ ? bme_->getTempC(&bmeOk) : NAN;
+    if (bmeOk) boardTrend_.update(boardC, now);
+    else if (!bme_ || !bme_->isPresent()) boardTrend_.reset();
+
+    // La carte est comparee au seuil le plus bas (carte ou ambiante), comme
+    // dans updateProtection_().
+    const float boardLimit = (tempAmbientC_ < tempBoardC_) ? tempAmbientC_ : tempBoardC_;
+    boardEtaS_ = boardTrend_.timeToThreshold(boardLimit);
+
+    const float horizon = static_cast<float>(trendHorizonS_);
+    const bool boardSoon = (boardEtaS_ >= 0.0f && boardEtaS_ <= horizon);
+
+    // Moteurs : une sonde par canal.
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        bool motorOk = false;
+        const float motorC = ds18_ ? ds18_->getTempC(ch, &motorOk) : NAN;
+        if (motorOk) motorTrend_[ch].update(motorC, now);
+        else if (!ds18_ || !ds18_->isPresent(ch)) motorTrend_[ch].reset();
+
+        motorEtaS_[ch] = motorTrend_[ch].timeToThreshold(tempMotorC_[ch]);
+        trendAlert_[ch] = (trendHorizonS_ > 0) &&
+                          ((motorEtaS_[ch] >= 0.0f && motorEtaS_[ch] <= horizon) || boardSoon);
     }
 }
 
-void Device::updateEnergy_() {
+void Device::updateEnergy_(uint8_t ch) {
     // Integration de l'energie uniquement quand le moteur tourne.
-    if (state_ != DeviceState::Running) {
-        lastEnergyMs_ = millis();
+    const uint32_t now = millis();
+    if (state_[ch] != DeviceState::Running) {
+        lastEnergyMs_[ch] = now;
         return;
     }
 
-    const uint32_t now = millis();
-    const uint32_t dtMs = (lastEnergyMs_ == 0) ? 0 : (now - lastEnergyMs_);
-    lastEnergyMs_ = now;
+    const uint32_t dtMs = (lastEnergyMs_[ch] == 0) ? 0 : (now - lastEnergyMs_[ch]);
+    lastEnergyMs_[ch] = now;
 
     if (dtMs == 0) return;
 
-    const float powerW = lastPowerW_;
+    const float powerW = lastPowerW_[ch];
     const float dtS = dtMs / 1000.0f;
 
     // Wh = W * s / 3600
-    energyWh_ += (powerW * dtS) / 3600.0f;
+    energyWh_[ch] += (powerW * dtS) / 3600.0f;
 
     // Pics (utiles pour l'historique sessions)
-    if (fabsf(lastCurrentA_) > peakCurrentA_) peakCurrentA_ = fabsf(lastCurrentA_);
-    if (fabsf(powerW) > peakPowerW_) peakPowerW_ = fabsf(powerW);
+    if (fabsf(lastCurrentA_[ch]) > peakCurrentA_[ch]) peakCurrentA_[ch] = fabsf(lastCurrentA_[ch]);
+    if (fabsf(powerW) > peakPowerW_[ch]) peakPowerW_[ch] = fabsf(powerW);
+}
+
+void Device::updateProfile_(uint8_t ch) {
+    // Courbe de la session (agregee en RAM, ecrite par Persist).
+    bool motorOk = false;
+    const float motorC = ds18_ ? ds18_->getTempC(ch, &motorOk) : NAN;
+    PROFILES->sample(ch, lastCurrentA_[ch], motorOk ? motorC : NAN);
+}
+
+void Device::updateArchive_() {
+    // Tous les canaux, moteur arrete compris (temperatures, duty = 0).
+    const uint32_t epoch = static_cast<uint32_t>(rtc_ ? rtc_->getUnixTime() : 0);
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        const bool running = state_[ch] == DeviceState::Running;
+        bool motorOk = false;
+        const float motorC = ds18_ ? ds18_->getTempC(ch, &motorOk) : NAN;
+        ARCHIVE->sample(ch, epoch,
+                        running ? lastCurrentA_[ch] : 0.0f,
+                        running ? lastPowerW_[ch] : 0.0f,
+                        motorOk ? motorC : NAN,
+                        boardOk_ ? boardC_ : NAN,
+                        relay_[ch] && relay_[ch]->isOn());
+    }
 }
 
 void Device::updateSnapshot_() {
@@ -428,23 +801,47 @@ void Device::updateSnapshot_() {
     SystemSnapshot s;
     s.seq = snapshot_.seq + 1;
     s.ts_ms = millis();
-    s.state = state_;
-    s.fault_latched = faultLatched_;
+    s.state = aggregateState_();
+
+    for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+        ChannelSnapshot& c = s.ch[ch];
+        c.state = state_[ch];
+        c.fault_latched = faultLatched_[ch];
+        c.relay_on = relay_[ch] ? relay_[ch]->isOn() : false;
+        c.current_a = lastCurrentA_[ch];
+        c.power_w = lastPowerW_[ch];
+        c.energy_wh = energyWh_[ch];
+
+        bool motorOk = false;
+        c.motor_c = ds18_ ? ds18_->getTempC(ch, &motorOk) : NAN;
+        c.motor_slope_c_s = motorTrend_[ch].slopePerS();
+        c.motor_eta_s = motorEtaS_[ch];
+        c.trend_alert = trendAlert_[ch];
+        c.ds18_ok = (ds18_ && ds18_->isPresent(ch) && motorOk);
+        c.adc_ok = current_[ch] ? current_[ch]->isAdcOk() : true;
+
+        if (c.fault_latched) s.fault_latched = true;
+        if (c.trend_alert) s.trend_alert = true;
+    }
 
-    s.relay_on = relay_ ? relay_->isOn() : false;
-    s.current_a = lastCurrentA_;
-    s.power_w = lastPowerW_;
-    s.energy_wh = energyWh_;
+    // Premier niveau : format historique (canal 0).
+    const ChannelSnapshot& c0 = s.ch[0];
+    s.relay_on = c0.relay_on;
+    s.current_a = c0.current_a;
+    s.power_w = c0.power_w;
+    s.energy_wh = c0.energy_wh;
+    s.motor_c = c0.motor_c;
+    s.motor_slope_c_s = c0.motor_slope_c_s;
+    s.motor_eta_s = c0.motor_eta_s;
+    s.ds18_ok = c0.ds18_ok;
+    s.adc_ok = c0.adc_ok;
 
-    bool motorOk = false;
     bool bmeOk = false;
-    s.motor_c = ds18_ ? ds18_->getTempC(&motorOk) : NAN;
     s.board_c = bme_ ? bme_->getTempC(&bmeOk) : NAN;
     s.ambient_c = s.board_c;
-
-    s.ds18_ok = (ds18_ && ds18_->isPresent() && motorOk);
+    s.board_slope_c_s = boardTrend_.slopePerS();
+    s.board_eta_s = boardEtaS_;
     s.bme_ok = (bme_ && bme_->isPresent() && bmeOk);
-    s.adc_ok = current_ ? current_->isAdcOk() : true;
 
     s.last_warning = lastWarningCode_;
     s.last_error = lastErrorCode_;
@@ -455,50 +852,51 @@ void Device::updateSnapshot_() {
     }
 }
 
-void Device::startSession_() {
-    // Debut d'une session (moteur ON).
-    sessionActive_ = true;
-    sessionStartMs_ = millis();
-    sessionStartEpoch_ = rtc_ ? rtc_->getUnixTime() : 0;
-    energyWh_ = 0.0f;
-    peakPowerW_ = 0.0f;
-    peakCurrentA_ = 0.0f;
-    lastEnergyMs_ = millis();
+void Device::startSession_(uint8_t ch) {
+    // Debut d'une session (moteur du canal ON).
+    sessionActive_[ch] = true;
+    sessionStartMs_[ch] = millis();
+    sessionStartEpoch_[ch] = rtc_ ? static_cast<uint32_t>(rtc_->getUnixTime()) : 0;
+    energyWh_[ch] = 0.0f;
+    peakPowerW_[ch] = 0.0f;
+    peakCurrentA_[ch] = 0.0f;
+    lastEnergyMs_[ch] = millis();
+    PROFILES->start(ch, sessionStartEpoch_[ch]);
 }
 
-void Device::endSession_(bool success) {
+void Device::endSession_(uint8_t ch, bool success) {
     // Termine la session et l'ajoute a l'historique SPIFFS.
     // success peut etre false si arret force / defaut (option future).
-    if (!sessionActive_ || !sessions_) {
-        sessionActive_ = false;
+    PROFILES->stop(ch);
+    if (!sessionActive_[ch] || !sessions_) {
+        sessionActive_[ch] = false;
         return;
     }
 
     SessionHistory::Entry e;
-    e.start_epoch = static_cast<uint32_t>(sessionStartEpoch_);
+    e.start_epoch = sessionStartEpoch_[ch];
     e.end_epoch = static_cast<uint32_t>(rtc_ ? rtc_->getUnixTime() : 0);
-    e.duration_s = (millis() - sessionStartMs_) / 1000U;
-    e.energy_wh = energyWh_;
-    e.peak_power_w = peakPowerW_;
-    e.peak_current_a = peakCurrentA_;
+    e.duration_s = (millis() - sessionStartMs_[ch]) / 1000U;
+    e.energy_wh = energyWh_[ch];
+    e.peak_power_w = peakPowerW_[ch];
+    e.peak_current_a = peakCurrentA_[ch];
     e.success = success;
     e.last_error = lastErrorCode_;
+    e.channel = ch;
 
     sessions_->append(e);
-    sessionActive_ = false;
+    sessionActive_[ch] = false;
 }
 
-void Device::raiseWarning_(WarnCode code, const char* msg, const char* src) {
-    // Anti-spam : on ne repete pas le meme warning trop rapidement.
-    const uint32_t now = millis();
+void Device::raiseWarning_(WarnCode code, EvtMsg msg, EvtSrc src, uint8_t ch, float arg) {
+    // Anti-spam : une repetition est seulement comptee (voir flushAlerts_).
     const uint16_t c = static_cast<uint16_t>(code);
-    if (lastWarningCode_ == c && (now - lastWarnMs_) < 5000) {
+    lastWarningCode_ = c;
+    if (!coalesceAlert_(EventLevel::Warning, c, msg, src, ch, arg)) {
         return;
     }
-    lastWarningCode_ = c;
-    lastWarnMs_ = now;
     if (events_) {
-        events_->append(EventLevel::Warning, lastWarningCode_, msg, src);
+        events_->append(EventLevel::Warning, lastWarningCode_, msg, src, ch, arg);
     }
     if (leds_) {
         // La LED CMD affiche les alertes en "rafales rapides" (voir StatusLeds).
@@ -514,17 +912,12 @@ void Device::raiseWarning_(WarnCode code, const char* msg, const char* src) {
     }
 }
 
-void Device::raiseError_(ErrorCode code, const char* msg, const char* src) {
-    // Anti-spam : idem erreurs (plus agressif car critique).
-    const uint32_t now = millis();
-    const uint16_t c = static_cast<uint16_t>(code);
-    if (lastErrorCode_ == c && (now - lastErrMs_) < 2000) {
-        return;
-    }
-    lastErrorCode_ = c;
-    lastErrMs_ = now;
+void Device::raiseError_(ErrorCode code, EvtMsg msg, EvtSrc src, uint8_t ch, float arg) {
+    // Pas de coalescence : chaque declenchement de protection (qui verrouille
+    // le canal) est journalise, affiche et sonne.
+    lastErrorCode_ = static_cast<uint16_t>(code);
     if (events_) {
-        events_->append(EventLevel::Error, lastErrorCode_, msg, src);
+        events_->append(EventLevel::Error, lastErrorCode_, msg, src, ch, arg);
     }
     if (leds_) {
         leds_->enqueueAlert(EventLevel::Error, lastErrorCode_);
@@ -539,31 +932,118 @@ void Device::raiseError_(ErrorCode code, const char* msg, const char* src) {
     }
 }
 
+bool Device::coalesceAlert_(EventLevel level, uint16_t code, EvtMsg msg, EvtSrc src,
+                            uint8_t ch, float arg) {
+    // Cle = niveau + code + source + canal (W04 existe pour ds18 et bme).
+    const uint32_t now = millis();
+    int free = -1;
+    for (uint8_t i = 0; i < ALERT_COALESCE_SLOTS; ++i) {
+        AlertSlot& s = alerts_[i];
+        if (!s.used) {
+            if (free < 0) free = i;
+            continue;
+        }
+        if (s.level != level || s.code != code || s.src != src || s.channel != ch) {
+            continue;
+        }
+        // Alerte deja journalisee : simple comptage en RAM (valeur max).
+        if (s.pending == 0) {
+            s.firstMs = now;
+            s.arg = arg;
+        } else if (!isnan(arg) && (isnan(s.arg) || fabsf(arg) > fabsf(s.arg))) {
+            s.arg = arg;
+        }
+        s.pending++;
+        s.lastMs = now;
+        return false;
+    }
+
+    // Table pleine : journalisation directe (comportement sans coalescence).
+    if (free < 0) return true;
+
+    AlertSlot& s = alerts_[free];
+    s.used = true;
+    s.level = level;
+    s.code = code;
+    s.msg = msg;
+    s.src = src;
+    s.channel = ch;
+    s.arg = arg;
+    s.firstMs = now;
+    s.lastMs = now;
+    s.flushMs = now;
+    s.pending = 0;
+    return true;
+}
+
+void Device::flushAlerts_() {
+    // Une entree resume par alerte repetee : a intervalle borne, a la fin de
+    // l'alerte (plus vue depuis ALERT_IDLE_MS) ou sur changement d'etat.
+    const uint32_t now = millis();
+    const bool force = alertsFlushReq_;
+    alertsFlushReq_ = false;
+
+    for (uint8_t i = 0; i < ALERT_COALESCE_SLOTS; ++i) {
+        AlertSlot& s = alerts_[i];
+        if (!s.used) continue;
+
+        const bool idle = (now - s.lastMs) >= ALERT_IDLE_MS;
+        if (s.pending > 0 && (force || idle || (now - s.flushMs) >= ALERT_FLUSH_MS)) {
+            if (events_) {
+                events_->append(s.level, s.code, s.msg, s.src, s.channel, s.arg, s.pending, s.firstMs);
+            }
+            // Rappel LED pour une alerte toujours active (pas de buzzer).
+            if (!idle && leds_) {
+                leds_->enqueueAlert(s.level, s.code);
+            }
+            s.pending = 0;
+            s.flushMs = now;
+        }
+        if (idle) s.used = false;
+    }
+}
+
 void Device::controlTaskThunk_(void* param) {
     static_cast<Device*>(param)->controlTask_();
     vTaskDelete(nullptr);
 }
 
 void Device::controlTask_() {
-    // Boucle temps reel "soft" : toutes les 50ms.
+    // Boucle temps reel "soft" : toutes les 50ms (ou des qu'une commande arrive).
     // On garde ce cycle court pour reagir vite aux defauts.
     for (;;) {
         processCommands_();
 
-        if (state_ == DeviceState::Running) {
-            updateProtection_();
-            updateEnergy_();
+        // Tendance temperatures : suivie meme a l'arret (inertie thermique).
+        updateTrend_();
+
+        // Carte lue une fois par cycle, puis une passe par canal en marche.
+        bool anyRunning = false;
+        for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+            anyRunning = anyRunning || (state_[ch] == DeviceState::Running);
+        }
+        readBoard_(anyRunning);
+
+        for (uint8_t ch = 0; ch < DEVICE_CHANNELS; ++ch) {
+            if (state_[ch] != DeviceState::Running) {
+                lastEnergyMs_[ch] = millis();
+                continue;
+            }
+            updateProtection_(ch);
+            updateEnergy_(ch);
+            updateProfile_(ch);
 
-            if (runUntilMs_ > 0 && millis() >= runUntilMs_) {
-                applyRelay_(false);
-                endSession_(true);
-                setState_(DeviceState::Idle);
-                runUntilMs_ = 0;
+            if (runUntilMs_[ch] > 0 && millis() >= runUntilMs_[ch]) {
+                stopChannel_(ch, true);
             }
-        } else {
-            lastEnergyMs_ = millis();
         }
 
+        // Archive longue duree (cumuls minute / heure).
+        updateArchive_();
+
+        // Alertes repetees : resume periodique vers EventLog.
+        flushAlerts_();
+
         // Snapshot integre dans la meme tache (pas de tache dediee).
         const uint32_t now = millis();
         if (lastSnapshotMs_ == 0 || (now - lastSnapshotMs_) >= DEFAULT_SNAPSHOT_PERIOD_MS) {
@@ -571,7 +1051,8 @@ void Device::controlTask_() {
             lastSnapshotMs_ = now;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(50));
+        // Attente du prochain cycle, ou reveil anticipe par submitCommand().
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
     }
 }
 
@@ -4,25 +4,37 @@
  *  Device est le "bloc central" de l'architecture.
  *
  *  Responsabilites :
- *  - Machine d'etats (Off/Idle/Running/Fault/...)
+ *  - DEVICE_CHANNELS canaux independants (relais + capteur courant + sonde
+ *    moteur + protections + session/energie) ; la temperature carte (BME)
+ *    est commune et protege tous les canaux.
+ *  - Machine d'etats par canal (Off/Idle/Running/Fault/...)
  *  - Application des protections :
  *      - OVC (surintensite) avec mode configurable (Latch / AutoRetry)
  *      - Overtemp (surchauffe) moteur/carte
+ *      - Surchauffe predictive (tendance temperature, voir TempTrend)
  *  - Calcul puissance/energie (integration Wh)
  *  - Construction d'un snapshot coherant (SystemSnapshot) pour l'UI Web
  *  - Ecriture unique dans la NVS (tous les parametres persistants)
  *  - Publication des warnings/erreurs vers EventLog + LED + Buzzer
  *
  *  Concurrence :
- *  - Une file de commandes (Queue FreeRTOS) recoit les actions externes
- *    via DeviceTransport.
+ *  - Deux voies de commandes recoivent les actions externes via
+ *    DeviceTransport : "express" (Stop, ClearFault), toujours videe en
+ *    premier, et "normale" (le reste). Les commandes redondantes sont
+ *    fusionnees a l'entree ; un Stop annule les commandes normales en attente.
  *  - Un mutex (semaphore) protege le snapshot et certaines variables
  *    partagees afin d'eviter les incoherences.
+ *
+ *  Organisation memoire :
+ *  - Etat par canal en tableaux (un tableau par champ, index = canal) :
+ *    chaque passe du cycle control parcourt un champ contigu, cout
+ *    lineaire en nombre de canaux.
  **************************************************************/
 #ifndef DEVICE_H
 #define DEVICE_H
 
 #include <Config.hpp>
+#include <ConfigSchema.hpp>
 #include <StatusSnapshot.hpp>
 #include <Relay.hpp>
 #include <StatusLeds.hpp>
@@ -33,7 +45,11 @@
 #include <BusSampler.hpp>
 #include <RTCManager.hpp>
 #include <SessionHistory.hpp>
+#include <SessionProfile.hpp>
+#include <TimeArchive.hpp>
 #include <EventLog.hpp>
+#include <TempTrend.hpp>
+#include <LatencyStats.hpp>
 
 class Device {
 public:
@@ -51,15 +67,78 @@ public:
             Reset        // Redemarrage systeme (ESP.restart)
         } type;
 
+        // Canal cible (CHANNEL_ALL accepte pour Stop et ClearFault).
+        uint8_t channel = 0;
+
         // Champs generiques de "payload" (selon cmd.type)
         uint32_t u32 = 0;
         bool b = false;
+
+        // Identifiant attribue par submitCommand() (0 = non attribue).
+        uint32_t id = 0;
+
+        // Horodatage de creation (micros()) pour la mesure de latence.
+        uint32_t created_us = 0;
+    };
+
+    // Nombre de types de commandes (pour les statistiques par type).
+    static constexpr uint8_t kCmdTypeCount = static_cast<uint8_t>(Command::Type::Reset) + 1;
+
+    // Resume des latences d'un type de commande (us).
+    struct LatencySummary {
+        uint32_t count = 0;        // commandes mesurees
+        uint32_t queue_full = 0;   // refus a l'entree (file pleine)
+        // creation -> sortie de file (processCommands_)
+        uint32_t queue_p50_us = 0;
+        uint32_t queue_p99_us = 0;
+        uint32_t queue_max_us = 0;
+        // creation -> actionnement physique (Relay::set) ou fin de traitement
+        uint32_t total_p50_us = 0;
+        uint32_t total_p99_us = 0;
+        uint32_t total_max_us = 0;
+    };
+
+    // Resultat d'une commande (enregistre par la tache control).
+    struct CommandResult {
+        enum class Status : uint8_t {
+            Unknown = 0, // id inconnu ou trop ancien (ecrase)
+            Pending,     // en file, pas encore traite
+            Done,        // traite par Device (voir ok)
+            Rejected     // refuse a l'entree (voie pleine) ou annule par un Stop
+        };
+
+        uint32_t id = 0;
+        Command::Type type = Command::Type::Start;
+        uint8_t channel = 0;
+        Status status = Status::Unknown;
+        bool ok = false;              // false si l'etat a refuse la commande (ex: defaut latch)
+        uint32_t done_ms = 0;         // instant d'actionnement (millis())
+        bool relay_on = false;        // etat relais du canal apres la commande
+        DeviceState state = DeviceState::Off;   // etat du canal (agrege si CHANNEL_ALL)
+        bool fault_latched = false;
+        uint32_t seq = 0;             // seq du premier snapshot qui reflete la commande
+    };
+
+    // Voies de commandes (priorite decroissante).
+    enum class Lane : uint8_t { Express = 0, Normal, Count };
+
+    // Statistiques d'une voie de commandes.
+    struct LaneStats {
+        uint8_t depth = 0;        // commandes en attente
+        uint8_t capacity = 0;
+        uint8_t max_depth = 0;    // profondeur max observee
+        uint32_t accepted = 0;    // commandes mises en file
+        uint32_t coalesced = 0;   // commandes fusionnees (redondantes)
+        uint32_t dropped = 0;     // refus (voie pleine)
+        uint32_t flushed = 0;     // annulees par un Stop
     };
 
     // Singleton : on injecte les dependances une seule fois pendant setup().
-    static void Init(Relay* relay,
+    // relays / currents : tableaux de DEVICE_CHANNELS pointeurs (index = canal),
+    // ds18 : une sonde par canal sur le meme bus.
+    static void Init(Relay* const* relays,
                      StatusLeds* leds,
-                     Acs712Sensor* current,
+                     Acs712Sensor* const* currents,
                      Ds18b20Sensor* ds18,
                      Bme280Sensor* bme,
                      RTCManager* rtc,
@@ -71,67 +150,68 @@ public:
     // Lance la logique (charge config, demarre sampler + taches).
     void begin();
 
-    // Commande externe (DeviceTransport). Non bloquant : push dans une queue.
-    bool submitCommand(const Command& cmd);
+    // Commande externe (DeviceTransport). Non bloquant : push dans une voie.
+    // outId (optionnel) recoit l'identifiant attribue, meme si la voie est
+    // pleine ; une commande fusionnee recoit l'id de la commande en attente.
+    bool submitCommand(const Command& cmd, uint32_t* outId = nullptr);
+
+    // Resultat d'une commande par id (non bloquant).
+    bool getCommandResult(uint32_t id, CommandResult& out) const;
+
+    // Latences par type de commande (diagnostic) et remise a zero.
+    bool getLatency(Command::Type type, LatencySummary& out) const;
+    void resetLatency();
+
+    // Profondeur et refus par voie de commandes (diagnostic).
+    bool getLaneStats(Lane lane, LaneStats& out) const;
 
     // ---------------------------------------------------------------------
     // Mise a jour config (Device seul ecrivain NVS)
     // ---------------------------------------------------------------------
     struct ConfigUpdate {
-        // Courant / OVC
-        bool hasLimitCurrent = false;
-        float limitCurrentA = 0.0f;
-
-        bool hasOvcMode = false;
-        OvcMode ovcMode = OvcMode::Latch;
-        bool hasOvcMinMs = false;
-        uint32_t ovcMinMs = 0;
-        bool hasOvcRetryMs = false;
-        uint32_t ovcRetryMs = 0;
-
-        // Temperatures / surchauffe
-        bool hasTempMotor = false;
-        float tempMotorC = 0.0f;
-        bool hasTempBoard = false;
-        float tempBoardC = 0.0f;
-        bool hasTempAmbient = false;
-        float tempAmbientC = 0.0f;
-        bool hasTempHyst = false;
-        float tempHystC = 0.0f;
-        bool hasLatchOvertemp = false;
-        bool latchOvertemp = false;
-
-        // Parametres calcul puissance et echantillonnage
-        bool hasMotorVcc = false;
-        float motorVcc = 0.0f;
-        bool hasSamplingHz = false;
-        uint32_t samplingHz = 0;
-        bool hasBuzzerEnabled = false;
-        bool buzzerEnabled = true;
-
-        // Wi-Fi (identifiants et mode)
-        bool hasWifiSta = false;
-        String staSsid;
-        String staPass;
-        bool hasWifiAp = false;
-        String apSsid;
-        String apPass;
-        bool hasWifiMode = false;
-        WiFiModeSetting wifiMode = WiFiModeSetting::Sta;
+        // Canal vise par les parametres "par canal" du schema ;
+        // CHANNEL_ALL = tous les canaux. Les autres sont globaux.
+        uint8_t channel = CHANNEL_ALL;
+
+        // Parametres a ecrire (valeur deja validee, voir cfgFromJson).
+        struct Item {
+            CfgId id;
+            CfgValue value;
+            String text;  // type String
+        };
+        Item items[CFG_UPDATE_MAX];
+        uint8_t count = 0;
+
+        bool add(CfgId id, const CfgValue& v) {
+            if (count >= CFG_UPDATE_MAX) return false;
+            items[count].id = id;
+            items[count].value = v;
+            count++;
+            return true;
+        }
+        bool add(CfgId id, const String& s) {
+            if (count >= CFG_UPDATE_MAX) return false;
+            items[count].id = id;
+            items[count].value.u64 = 0;
+            items[count].text = s;
+            count++;
+            return true;
+        }
     };
 
     // Applique une mise a jour de configuration (et ecrit en NVS).
+    // false si canal invalide, parametre non modifiable ou hors bornes.
     bool applyConfig(const ConfigUpdate& cfg);
 
     // ---------------------------------------------------------------------
     // Calibration courant (ACS712)
     // ---------------------------------------------------------------------
 
-    // Calibre l'offset (zero) en mesurant le courant "a vide".
-    void calibrateCurrentZero();
+    // Calibre l'offset (zero) en mesurant le courant "a vide" du canal.
+    bool calibrateCurrentZero(uint8_t ch = 0);
 
-    // Fixe la calibration (offset + sensibilite + echelle analogique).
-    void setCurrentCalibration(float zeroMv, float sensMvPerA, float inputScale);
+    // Fixe la calibration du canal (offset + sensibilite + echelle analogique).
+    bool setCurrentCalibration(uint8_t ch, float zeroMv, float sensMvPerA, float inputScale);
 
     // Feedback commande (LED CMD) : blink bref "commande recu".
     void notifyCommand();
@@ -143,13 +223,13 @@ public:
     // Copie coherente du snapshot (sous mutex interne).
     bool getSnapshot(SystemSnapshot& out) const;
 
-    // Lecture rapide de l'etat (tentative mutex, sinon valeur courante).
+    // Lecture rapide de l'etat agrege (tentative mutex, sinon valeur courante).
     DeviceState getState() const;
 
 private:
-    Device(Relay* relay,
+    Device(Relay* const* relays,
            StatusLeds* leds,
-           Acs712Sensor* current,
+           Acs712Sensor* const* currents,
            Ds18b20Sensor* ds18,
            Bme280Sensor* bme,
            RTCManager* rtc,
@@ -157,28 +237,51 @@ private:
            EventLog* events);
 
     void loadConfig_();
-    void applyRelay_(bool on);
-    void setState_(DeviceState s);
+    void applyRelay_(uint8_t ch, bool on);
+    void setState_(uint8_t ch, DeviceState s);
+    // Fault > Running > Idle > Off sur l'ensemble des canaux.
+    DeviceState aggregateState_() const;
+    // Arret d'un canal (relais OFF + fin de session + Idle).
+    void stopChannel_(uint8_t ch, bool success);
 
     // Traitement de la file de commandes (start/stop/clearFault/...)
     void processCommands_();
 
-    // Protections (OVC + surchauffe + diagnostics capteurs)
-    void updateProtection_();
+    // Publie des resultats (sous mutex) dans results_.
+    void storeResults_(const CommandResult* res, size_t n);
+
+    // Lecture carte (BME) une fois par cycle + diagnostics BME.
+    void readBoard_(bool anyRunning);
+
+    // Protections d'un canal (OVC + surchauffe + diagnostics capteurs)
+    void updateProtection_(uint8_t ch);
+
+    // Tendance temperatures (O(1) par lecture et par canal) + temps avant seuil
+    void updateTrend_();
 
     // Integration energie (Wh) a partir de la puissance instantanee
-    void updateEnergy_();
+    void updateEnergy_(uint8_t ch);
+    // Point de la courbe de session (SessionProfile).
+    void updateProfile_(uint8_t ch);
+    // Mesures de tous les canaux vers l'archive longue duree (TimeArchive).
+    void updateArchive_();
 
     // Construit un SystemSnapshot coherant pour l'UI
     void updateSnapshot_();
 
     // Sessions : demarre / termine une session, stocke dans SessionHistory
-    void startSession_();
-    void endSession_(bool success);
+    void startSession_(uint8_t ch);
+    void endSession_(uint8_t ch, bool success);
 
     // Publication des warnings/erreurs vers EventLog + LED + buzzer.
-    void raiseWarning_(WarnCode code, const char* msg, const char* src);
-    void raiseError_(ErrorCode code, const char* msg, const char* src);
+    // ch : canal de la source (0 = base, ex: "ds18", sinon "ds18.N") ;
+    // arg : valeur mesuree (NAN : aucune).
+    void raiseWarning_(WarnCode code, EvtMsg msg, EvtSrc src, uint8_t ch = 0, float arg = NAN);
+    void raiseError_(ErrorCode code, EvtMsg msg, EvtSrc src, uint8_t ch = 0, float arg = NAN);
+    // Coalescence : true si l'alerte est nouvelle (a journaliser/signaler).
+    bool coalesceAlert_(EventLevel level, uint16_t code, EvtMsg msg, EvtSrc src, uint8_t ch, float arg);
+    // Resume des repetitions (intervalle, fin d'alerte, changement d'etat).
+    void flushAlerts_();
 
     // Tache "control" : boucle temps reel (process commands + protections + snapshot).
     static void controlTaskThunk_(void* param);
@@ -194,9 +297,9 @@ private:
 
     // Pointeurs non-possede : les objets sont crees dans main.cpp et vivent
     // pendant toute la duree du firmware.
-    Relay* relay_ = nullptr;
+    Relay* relay_[DEVICE_CHANNELS] = {nullptr};
     StatusLeds* leds_ = nullptr;
-    Acs712Sensor* current_ = nullptr;
+    Acs712Sensor* current_[DEVICE_CHANNELS] = {nullptr};
     Ds18b20Sensor* ds18_ = nullptr;
     Bme280Sensor* bme_ = nullptr;
     RTCManager* rtc_ = nullptr;
@@ -206,50 +309,86 @@ private:
     // ---------------------------------------------------------------------
     // Configuration (cache runtime - chargee depuis NVS)
     // ---------------------------------------------------------------------
-    float limitCurrentA_ = DEFAULT_LIMIT_CURRENT_A;
-    OvcMode ovcMode_ = OvcMode::Latch;
-    uint32_t ovcMinMs_ = DEFAULT_OVC_MIN_DURATION_MS;
-    uint32_t ovcRetryMs_ = DEFAULT_OVC_RETRY_DELAY_MS;
-
-    float tempMotorC_ = DEFAULT_TEMP_MOTOR_C;
+    // Par canal (cles NVS suffixees, voir NVS::ChannelKey)
+    float limitCurrentA_[DEVICE_CHANNELS];
+    OvcMode ovcMode_[DEVICE_CHANNELS];
+    uint32_t ovcMinMs_[DEVICE_CHANNELS];
+    uint32_t ovcRetryMs_[DEVICE_CHANNELS];
+    float tempMotorC_[DEVICE_CHANNELS];
+
+    // Globaux
     float tempBoardC_ = DEFAULT_TEMP_BOARD_C;
     float tempAmbientC_ = DEFAULT_TEMP_AMBIENT_C;
     float tempHystC_ = DEFAULT_TEMP_HYST_C;
     bool latchOvertemp_ = DEFAULT_LATCH_OVERTEMP;
 
+    uint16_t trendWindow_ = DEFAULT_TREND_WINDOW;
+    uint32_t trendHorizonS_ = DEFAULT_TREND_HORIZON_S;
+    TrendAction trendAction_ = static_cast<TrendAction>(DEFAULT_TREND_ACTION);
+
     float motorVcc_ = DEFAULT_MOTOR_VCC_V;
 
     // ---------------------------------------------------------------------
-    // Etat runtime / securites
+    // Etat runtime / securites (par canal, index = canal)
     // ---------------------------------------------------------------------
-    DeviceState state_ = DeviceState::Off;
-    bool faultLatched_ = false;
-    uint32_t runUntilMs_ = 0;
+    DeviceState state_[DEVICE_CHANNELS] = {};
+    bool faultLatched_[DEVICE_CHANNELS] = {false};
+    uint32_t runUntilMs_[DEVICE_CHANNELS] = {0};
 
     // OVC (surintensite)
-    uint32_t ovcStartMs_ = 0;
-    uint32_t ovcRetryAtMs_ = 0;
+    uint32_t ovcStartMs_[DEVICE_CHANNELS] = {0};
+    uint32_t ovcRetryAtMs_[DEVICE_CHANNELS] = {0};
+
+    // Surchauffe (moteur du canal ou carte commune)
+    bool overtempActive_[DEVICE_CHANNELS] = {false};
 
-    // Surchauffe
-    bool overtempActive_ = false;
+    // Carte (BME) : lue une fois par cycle, commune a tous les canaux
+    float boardC_ = NAN;
+    bool boardOk_ = false;
+
+    // Surchauffe predictive (tendance DS18 moteur par canal + BME carte)
+    TempTrend motorTrend_[DEVICE_CHANNELS];
+    TempTrend boardTrend_;
+    uint32_t lastTrendMs_ = 0;
+    float motorEtaS_[DEVICE_CHANNELS];
+    float boardEtaS_ = -1.0f;
+    bool trendAlert_[DEVICE_CHANNELS] = {false};
 
     // Energie / session
-    bool sessionActive_ = false;
-    uint32_t sessionStartMs_ = 0;
-    uint64_t sessionStartEpoch_ = 0;
-    float energyWh_ = 0.0f;
-    float peakPowerW_ = 0.0f;
-    float peakCurrentA_ = 0.0f;
-    uint32_t lastEnergyMs_ = 0;
-
-    float lastCurrentA_ = 0.0f;
-    float lastPowerW_ = 0.0f;
-
-    // Derniers codes publies (anti-spam sur l'UI / buzzer)
+    bool sessionActive_[DEVICE_CHANNELS] = {false};
+    uint32_t sessionStartMs_[DEVICE_CHANNELS] = {0};
+    uint32_t sessionStartEpoch_[DEVICE_CHANNELS] = {0};
+    float energyWh_[DEVICE_CHANNELS] = {0.0f};
+    float peakPowerW_[DEVICE_CHANNELS] = {0.0f};
+    float peakCurrentA_[DEVICE_CHANNELS] = {0.0f};
+    uint32_t lastEnergyMs_[DEVICE_CHANNELS] = {0};
+
+    float lastCurrentA_[DEVICE_CHANNELS] = {0.0f};
+    float lastPowerW_[DEVICE_CHANNELS] = {0.0f};
+
+    // Derniers codes publies (snapshot)
     uint16_t lastWarningCode_ = 0;
     uint16_t lastErrorCode_ = 0;
-    uint32_t lastWarnMs_ = 0;
-    uint32_t lastErrMs_ = 0;
+
+    // Table de coalescence (warnings ; les erreurs ne sont jamais
+    // coalescees) : une alerte qui se repete ne produit qu'une
+    // entree EventLog par ALERT_FLUSH_MS (premiere/derniere vue + compteur)
+    // au lieu d'une reecriture SPIFFS a chaque cycle.
+    struct AlertSlot {
+        bool used = false;
+        EventLevel level = EventLevel::Warning;
+        uint16_t code = 0;
+        EvtMsg msg = EvtMsg::None;
+        EvtSrc src = EvtSrc::None;
+        uint8_t channel = 0;
+        float arg = NAN;          // valeur max des occurrences non journalisees
+        uint32_t firstMs = 0;     // premiere occurrence non journalisee
+        uint32_t lastMs = 0;      // derniere occurrence
+        uint32_t flushMs = 0;     // derniere entree EventLog
+        uint32_t pending = 0;     // occurrences non journalisees
+    };
+    AlertSlot alerts_[ALERT_COALESCE_SLOTS];
+    bool alertsFlushReq_ = false;
 
     // Cadence snapshot (integree dans la tache control)
     uint32_t lastSnapshotMs_ = 0;
@@ -261,8 +400,47 @@ private:
     // Tache interne unique (control + snapshot)
     TaskHandle_t controlTaskHandle_ = nullptr;
 
-    // Queue commandes asynchrones
-    QueueHandle_t cmdQueue_ = nullptr;
+    // Voie de commandes : anneau protege par mutex_ (fusion impossible
+    // avec une Queue FreeRTOS, qui ne permet pas de relire la queue).
+    struct CmdLane {
+        Command buf[DEVICE_CMD_QUEUE_LEN];
+        uint8_t cap = 0;
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint8_t maxDepth = 0;
+        uint32_t accepted = 0;
+        uint32_t coalesced = 0;
+        uint32_t dropped = 0;
+        uint32_t flushed = 0;
+
+        bool push(const Command& c);  // sans comptage (accepted : submitCommand)
+        bool pop(Command& out);
+        Command* at(uint8_t i) { return &buf[(head + i) % cap]; }
+        Command* back() { return count ? at(count - 1) : nullptr; }
+    };
+    CmdLane lanes_[static_cast<uint8_t>(Lane::Count)];
+
+    static Lane laneOf_(Command::Type t);
+    // Commande en attente equivalente a c (fusion), nullptr sinon.
+    static Command* findRedundant_(CmdLane& lane, Lane which, const Command& c);
+    // Prochaine commande a traiter (express d'abord) ; paires de Toggle
+    // annulees en route terminees dans done (nDone < maxDone).
+    bool popCommand_(Command& out, CommandResult* done, size_t& nDone, size_t maxDone);
+
+    // Suivi des commandes : id monotone + derniers resultats (slot = id % N).
+    uint32_t lastCmdId_ = 0;
+    CommandResult results_[DEVICE_CMD_RESULT_SLOTS]{};
+
+    // Latences commandes (par type) : file + bout-en-bout.
+    struct CmdLatency {
+        LatencyHistogram queue;
+        LatencyHistogram total;
+        uint32_t queueFull = 0;
+    };
+    CmdLatency latency_[kCmdTypeCount];
+
+    // Instant (micros()) du dernier Relay::set() (0 = pas d'actionnement).
+    uint32_t lastActuationUs_ = 0;
 
     // Mutex snapshot/etat
     mutable SemaphoreHandle_t mutex_ = nullptr;
@@ -2,63 +2,76 @@
 
 DeviceTransport* DeviceTransport::inst_ = nullptr;
 
+// Commande horodatee a la creation (mesure de latence bout-en-bout).
+static Device::Command makeCommand_(uint8_t ch = 0) {
+    Device::Command cmd;
+    cmd.channel = ch;
+    cmd.created_us = micros();
+    return cmd;
+}
+
 DeviceTransport* DeviceTransport::Get() {
     // Singleton paresseux : cree lors du premier appel.
     if (!inst_) inst_ = new DeviceTransport();
     return inst_;
 }
 
-bool DeviceTransport::start() {
+bool DeviceTransport::start(uint8_t ch, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::Start;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::stop() {
+bool DeviceTransport::stop(uint8_t ch, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::Stop;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::toggle() {
+bool DeviceTransport::toggle(uint8_t ch, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::Toggle;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::clearFault() {
+bool DeviceTransport::clearFault(uint8_t ch, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::ClearFault;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::timedRun(uint32_t seconds) {
+bool DeviceTransport::timedRun(uint8_t ch, uint32_t seconds, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::TimedRun;
     // payload : duree en secondes
     cmd.u32 = seconds;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::setRelay(bool on) {
+bool DeviceTransport::setRelay(uint8_t ch, bool on, uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_(ch);
     cmd.type = Device::Command::Type::SetRelay;
     // payload : etat demande
     cmd.b = on;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
 }
 
-bool DeviceTransport::reset() {
+bool DeviceTransport::reset(uint32_t* id) {
     if (!DEVICE) return false;
-    Device::Command cmd;
+    Device::Command cmd = makeCommand_();
     cmd.type = Device::Command::Type::Reset;
-    return DEVICE->submitCommand(cmd);
+    return DEVICE->submitCommand(cmd, id);
+}
+
+bool DeviceTransport::getResult(uint32_t id, Device::CommandResult& out) const {
+    if (!DEVICE) return false;
+    return DEVICE->getCommandResult(id, out);
 }
 
 bool DeviceTransport::getSnapshot(SystemSnapshot& out) const {
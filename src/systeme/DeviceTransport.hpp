@@ -9,8 +9,12 @@
  *
  *  Philosophie :
  *  - Device reste le point de verite (etat + securites + NVS).
- *  - DeviceTransport ne fait que pousser des commandes dans la file
- *    de Device (thread-safe via FreeRTOS queue).
+ *  - DeviceTransport ne fait que pousser des commandes dans les voies
+ *    de Device (thread-safe, voir Device::submitCommand).
+ *  - Chaque commande recoit un id ; Device enregistre son resultat
+ *    (etat, instant d'actionnement, seq snapshot) consultable par id.
+ *  - Chaque commande vise un canal (ch, 0 par defaut) ; stop() et
+ *    clearFault() acceptent CHANNEL_ALL.
  **************************************************************/
 #ifndef DEVICE_TRANSPORT_H
 #define DEVICE_TRANSPORT_H
@@ -22,14 +26,19 @@ public:
     // Singleton simple (pas de destruction a l'arret).
     static DeviceTransport* Get();
 
-    // API de commandes (retourne false si Device non initialise ou file pleine).
-    bool start();
-    bool stop();
-    bool toggle();
-    bool clearFault();
-    bool timedRun(uint32_t seconds);
-    bool setRelay(bool on);
-    bool reset();
+    // API de commandes (retourne false si Device non initialise, canal
+    // invalide ou voie pleine).
+    // id (optionnel) recoit l'identifiant de commande pour le suivi.
+    bool start(uint8_t ch = 0, uint32_t* id = nullptr);
+    bool stop(uint8_t ch = 0, uint32_t* id = nullptr);
+    bool toggle(uint8_t ch = 0, uint32_t* id = nullptr);
+    bool clearFault(uint8_t ch = 0, uint32_t* id = nullptr);
+    bool timedRun(uint8_t ch, uint32_t seconds, uint32_t* id = nullptr);
+    bool setRelay(uint8_t ch, bool on, uint32_t* id = nullptr);
+    bool reset(uint32_t* id = nullptr);
+
+    // Suivi d'execution : poll par id (non bloquant).
+    bool getResult(uint32_t id, Device::CommandResult& out) const;
 
     // Lecture snapshot / etat (utilise les accesseurs thread-safe de Device).
     bool getSnapshot(SystemSnapshot& out) const;
@@ -0,0 +1,57 @@
+#include <LatencyStats.hpp>
+
+void LatencyHistogram::reset() {
+    memset(buckets_, 0, sizeof(buckets_));
+    count_ = 0;
+    max_ = 0;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    buckets_[bucketOf_(us)]++;
+    count_++;
+    if (us > max_) max_ = us;
+}
+
+uint32_t LatencyHistogram::percentileUs(float pct) const {
+    if (count_ == 0) return 0;
+    if (pct >= 100.0f) return max_;
+
+    // Rang cible (1..count_) puis parcours cumulatif des buckets.
+    uint32_t rank = static_cast<uint32_t>((pct / 100.0f) * count_ + 0.5f);
+    if (rank == 0) rank = 1;
+
+    uint32_t cumul = 0;
+    for (uint16_t i = 0; i < kBuckets; ++i) {
+        cumul += buckets_[i];
+        if (cumul >= rank) {
+            const uint32_t ub = upperBoundOf_(i);
+            return (ub < max_) ? ub : max_;
+        }
+    }
+    return max_;
+}
+
+uint16_t LatencyHistogram::bucketOf_(uint32_t us) {
+    if (us < (1UL << kMinShift)) return 0;
+
+    // msb : position du bit de poids fort ; les kSubBits bits suivants
+    // donnent le sous-bucket dans l'octave.
+    const uint8_t msb = 31 - __builtin_clz(us);
+    const uint8_t octave = msb - kMinShift;
+    if (octave >= kOctaves) return kBuckets - 1;
+
+    const uint32_t sub = (us >> (msb - kSubBits)) & ((1U << kSubBits) - 1);
+    return 1 + (octave << kSubBits) + sub;
+}
+
+uint32_t LatencyHistogram::upperBoundOf_(uint16_t idx) {
+    if (idx == 0) return (1UL << kMinShift);
+    if (idx >= kBuckets - 1) return UINT32_MAX;
+
+    const uint16_t i = idx - 1;
+    const uint8_t octave = i >> kSubBits;
+    const uint32_t sub = i & ((1U << kSubBits) - 1);
+    const uint8_t msb = octave + kMinShift;
+    // Bucket = [(4+sub) << (msb-2), (5+sub) << (msb-2))
+    return ((1UL << kSubBits) + sub + 1) << (msb - kSubBits);
+}
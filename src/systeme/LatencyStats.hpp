@@ -0,0 +1,48 @@
+/**************************************************************
+ *  LatencyHistogram - histogramme de latences (microsecondes)
+ *
+ *  But :
+ *  - Mesurer les latences commande -> actionnement (p50/p99/max)
+ *    sans stocker chaque mesure.
+ *
+ *  Principe :
+ *  - Buckets logarithmiques : 4 sous-buckets par octave, de 16 us a
+ *    ~16 s (erreur relative max ~25 %, suffisant pour p50/p99).
+ *  - record() est O(1), sans allocation.
+ *
+ *  Concurrence :
+ *  - Pas de mutex interne : le proprietaire (Device) protege les acces.
+ **************************************************************/
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <Arduino.h>
+
+class LatencyHistogram {
+public:
+    void reset();
+
+    // Ajoute une mesure (us).
+    void record(uint32_t us);
+
+    uint32_t count() const { return count_; }
+    uint32_t maxUs() const { return max_; }
+
+    // Percentile (0..100) estime : borne haute du bucket, bornee par max.
+    uint32_t percentileUs(float pct) const;
+
+private:
+    static constexpr uint8_t kMinShift = 4;   // < 16 us -> bucket 0
+    static constexpr uint8_t kSubBits = 2;    // 4 sous-buckets par octave
+    static constexpr uint8_t kOctaves = 20;   // 16 us .. 16 s
+    static constexpr uint16_t kBuckets = 2 + (kOctaves << kSubBits);
+
+    static uint16_t bucketOf_(uint32_t us);
+    static uint32_t upperBoundOf_(uint16_t idx);
+
+    uint32_t buckets_[kBuckets] = {0};
+    uint32_t count_ = 0;
+    uint32_t max_ = 0;
+};
+
+#endif // LATENCY_STATS_H
@@ -9,6 +9,9 @@
  *
  *  Note :
  *  - Le snapshot est produit par Device (tache periodique).
+ *  - Multi-canal : etat et mesures par canal dans ch[] ; les champs de
+ *    premier niveau gardent le format historique (etat agrege, mesures
+ *    du canal 0).
  *  - L'acces se fait via DeviceTransport -> Device::getSnapshot().
  **************************************************************/
 #ifndef STATUS_SNAPSHOT_H
@@ -17,6 +20,22 @@
 #include <Arduino.h>
 #include <Config.hpp>
 
+// Etat et mesures d'un canal (relais + courant + sonde moteur).
+struct ChannelSnapshot {
+    DeviceState state = DeviceState::Off;
+    bool fault_latched = false;
+    bool relay_on = false;
+    float current_a = 0.0f;
+    float power_w = 0.0f;
+    float energy_wh = 0.0f;
+    float motor_c = NAN;
+    float motor_slope_c_s = 0.0f;
+    float motor_eta_s = -1.0f;
+    bool trend_alert = false;
+    bool ds18_ok = false;
+    bool adc_ok = true;
+};
+
 struct SystemSnapshot {
     // -------------------- Metadonnees --------------------
 
@@ -26,10 +45,15 @@ struct SystemSnapshot {
 
     // -------------------- Etat global --------------------
 
-    DeviceState state = DeviceState::Off; // Machine d'etat (Off/Idle/Running/Fault/...)
-    bool fault_latched = false;           // Vrai si un defaut est memorise (OVC/Overtemp)
+    DeviceState state = DeviceState::Off; // Etat agrege (Fault > Running > Idle > Off)
+    bool fault_latched = false;           // Vrai si un defaut est memorise sur un canal
+
+    // -------------------- Canaux --------------------
 
-    // -------------------- Mesures "puissance" --------------------
+    uint8_t channel_count = DEVICE_CHANNELS;
+    ChannelSnapshot ch[DEVICE_CHANNELS];
+
+    // -------------------- Mesures "puissance" (canal 0) --------------------
 
     bool relay_on = false;     // Etat actuel de sortie (relais)
     float current_a = 0.0f;    // Dernier courant (A) (cache sensor si lecture fail)
@@ -42,6 +66,14 @@ struct SystemSnapshot {
     float board_c = NAN;       // Temperature carte (BME280) en degre C
     float ambient_c = NAN;     // Temperature ambiante (si non disponible, peut dupliquer board_c)
 
+    // -------------------- Tendance temperatures --------------------
+
+    float motor_slope_c_s = 0.0f; // Pente filtree temperature moteur (degC/s)
+    float motor_eta_s = -1.0f;    // Temps estime avant seuil moteur (s), -1 si aucun
+    float board_slope_c_s = 0.0f; // Pente filtree temperature carte (degC/s)
+    float board_eta_s = -1.0f;    // Temps estime avant seuil carte (s), -1 si aucun
+    bool trend_alert = false;     // Vrai si un croisement est prevu dans l'horizon
+
     // -------------------- Sante capteurs --------------------
 
     bool ds18_ok = false;      // Vrai si DS18 present ET valeur valide
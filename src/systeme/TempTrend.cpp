@@ -0,0 +1,54 @@
+#include <TempTrend.hpp>
+#include <math.h>
+
+void TempTrend::configure(uint16_t window) {
+    // Une pente demande au moins 2 points.
+    window_ = (window < 2) ? 2 : window;
+    // Fenetre reduite : gains de la nouvelle fenetre des le point suivant
+    // (sinon count_ reste au-dela et k garde l'ancienne valeur).
+    if (count_ > window_) count_ = window_;
+}
+
+void TempTrend::reset() {
+    count_ = 0;
+    lastMs_ = 0;
+    level_ = NAN;
+    slope_ = 0.0f;
+}
+
+void TempTrend::update(float value, uint32_t tsMs) {
+    if (!isfinite(value)) return;
+
+    if (count_ == 0) {
+        // Premiere lecture : niveau initial, pente inconnue.
+        level_ = value;
+        slope_ = 0.0f;
+        lastMs_ = tsMs;
+        count_ = 1;
+        return;
+    }
+
+    const uint32_t dtMs = tsMs - lastMs_;
+    if (dtMs == 0) return;
+    const float dtS = dtMs / 1000.0f;
+    lastMs_ = tsMs;
+
+    // Gains "moindres carres" : k croit jusqu'a la fenetre puis reste fixe.
+    if (count_ < window_) count_++;
+    const float k = static_cast<float>(count_);
+    const float alpha = (2.0f * (2.0f * k - 1.0f)) / (k * (k + 1.0f));
+    const float beta = 6.0f / (k * (k + 1.0f));
+
+    // Prediction puis correction par le residu.
+    const float predicted = level_ + slope_ * dtS;
+    const float residual = value - predicted;
+    level_ = predicted + alpha * residual;
+    slope_ = slope_ + (beta / dtS) * residual;
+}
+
+float TempTrend::timeToThreshold(float threshold) const {
+    if (!isReady()) return -1.0f;
+    if (level_ >= threshold) return 0.0f;
+    if (slope_ <= 0.0f) return -1.0f;
+    return (threshold - level_) / slope_;
+}
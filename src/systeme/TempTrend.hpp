@@ -0,0 +1,57 @@
+/**************************************************************
+ *  TempTrend - estimateur de tendance temperature (alpha-beta)
+ *
+ *  But :
+ *  - Suivre le niveau et la pente (degC/s) d'une serie de temperatures
+ *    (DS18B20 moteur, BME280 carte) sans buffer d'historique.
+ *  - Projeter le temps restant avant d'atteindre un seuil, afin de
+ *    prevenir AVANT le depassement (le moteur a de l'inertie thermique).
+ *
+ *  Principe :
+ *  - Filtre alpha-beta a gains fixes, derives d'une "fenetre" N :
+ *      alpha = 2(2N-1) / (N(N+1))
+ *      beta  = 6 / (N(N+1))
+ *    Ce sont les gains d'une regression lineaire aux moindres carres sur
+ *    N points ; pendant le demarrage (k < N) on utilise k a la place de N.
+ *  - Cout O(1) par lecture, quelques floats d'etat.
+ *
+ *  Concurrence :
+ *  - Pas de mutex : l'instance appartient a la tache Device (control).
+ **************************************************************/
+#ifndef TEMP_TREND_H
+#define TEMP_TREND_H
+
+#include <Arduino.h>
+
+class TempTrend {
+public:
+    // Fixe la fenetre equivalente (nombre de lectures, min 2).
+    void configure(uint16_t window);
+
+    // Oublie l'etat (ex: capteur deconnecte).
+    void reset();
+
+    // Ajoute une lecture (degC) horodatee (millis()).
+    void update(float value, uint32_t tsMs);
+
+    // true si au moins 2 lectures ont ete integrees (pente exploitable).
+    bool isReady() const { return count_ >= 2; }
+
+    // Niveau filtre (degC) et pente (degC/s).
+    float level() const { return level_; }
+    float slopePerS() const { return slope_; }
+
+    // Temps estime (s) avant d'atteindre threshold :
+    // - 0 si le niveau est deja au-dessus
+    // - -1 si pas de croisement prevu (pente nulle/negative ou pas pret)
+    float timeToThreshold(float threshold) const;
+
+private:
+    uint16_t window_ = 2;
+    uint16_t count_ = 0;
+    uint32_t lastMs_ = 0;
+    float level_ = NAN;
+    float slope_ = 0.0f;
+};
+
+#endif // TEMP_TREND_H